@@ -24,6 +24,8 @@
 #define SYSCALL_IOC_COMPLETED   0x17
 #define SYSCALL_BARRIER_INIT    0x18
 #define SYSCALL_BARRIER_WAIT    0x19
+#define SYSCALL_FB_WRITE_2D     0x1A
+#define SYSCALL_FB_READ_2D      0x1B
 
 /*
  * sys_call()
@@ -496,6 +498,9 @@ printf_arguments:
 #define TIMER_PERIOD    2
 #define TIMER_RESETIRQ  3
 
+#define CYCLE_LO        0
+#define CYCLE_HI        1
+
 /*
  * timer_set_mode()
  *
@@ -557,6 +562,23 @@ unsigned int timer_get_time(unsigned int *time)
             0, 0);
 }
 
+/*
+ * cycle_get()
+ *
+ * This function returns the 64 bits cycle counter of the timer.
+ * It is mapped in the user segment seg_cycle, and read without
+ * system call: reading CYCLE_LO latches the value returned by CYCLE_HI.
+ */
+extern unsigned int seg_cycle_base;
+
+unsigned long long cycle_get()
+{
+    volatile unsigned int *cycle = (unsigned int*)&seg_cycle_base;
+    unsigned int lo = cycle[CYCLE_LO];
+    unsigned int hi = cycle[CYCLE_HI];
+    return ((unsigned long long)hi << 32) | lo;
+}
+
 /*
  * ***********************************************************
  * GCD (Greatest Common Divisor) device related system calls
@@ -786,6 +808,59 @@ unsigned int fb_read(unsigned int offset, void *buffer, unsigned int length)
             0);
 }
 
+/*
+ * fb_write_2d()
+ *
+ * This non-blocking function use the multi-channels DMA coprocessor to
+ * transfer a list of rectangles (sets of lines with a constant stride) from
+ * user buffers to the frame buffer device in kernel space.
+ * The pixels are copied, or transformed by the DMA as defined by the op and
+ * arg fields of each rectangle (FB_2D_FILL, FB_2D_THRESHOLD, FB_2D_LUT).
+ * - list  : array of 2D transfers (see fb_2d_t in stdio.h)
+ * - count : number of 2D transfers (no larger than 16, a FB_2D_LUT transfer
+ *   counts for two)
+ *
+ * - Returns 0 if success, > 0 if error (e.g. memory buffer not in user space,
+ *   or not word aligned).
+ *
+ * The transfer completion is signaled by an IRQ, and must be tested by the
+ * fb_completed() function.
+ */
+unsigned int fb_write_2d(fb_2d_t *list, unsigned int count)
+{
+    return sys_call(SYSCALL_FB_WRITE_2D,
+            (unsigned int)list,
+            count,
+            0,
+            0);
+}
+
+/*
+ * fb_read_2d()
+ *
+ * This non-blocking function use the multi-channels DMA coprocessor to
+ * transfer a list of rectangles (sets of lines with a constant stride) from
+ * the frame buffer device in kernel space to user buffers.
+ * The pixels are transformed as for fb_write_2d().
+ * - list  : array of 2D transfers (see fb_2d_t in stdio.h)
+ * - count : number of 2D transfers (no larger than 16, a FB_2D_LUT transfer
+ *   counts for two)
+ *
+ * - Returns 0 if success, > 0 if error (e.g. memory buffer not in user space,
+ *   or not word aligned).
+ *
+ * The transfer completion is signaled by an IRQ, and must be tested by the
+ * fb_completed() function.
+ */
+unsigned int fb_read_2d(fb_2d_t *list, unsigned int count)
+{
+    return sys_call(SYSCALL_FB_READ_2D,
+            (unsigned int)list,
+            count,
+            0,
+            0);
+}
+
 /*
  * fb_completed()
  *
@@ -25,6 +25,7 @@ unsigned int timer_set_mode(unsigned int mode);
 unsigned int timer_set_period(unsigned int period);
 unsigned int timer_reset_irq();
 unsigned int timer_get_time(unsigned int *time);
+unsigned long long cycle_get();
 
 /* GCD coprocessor related functions */
 unsigned int gcd_set_opa(unsigned int val);
@@ -39,10 +40,14 @@ unsigned int ioc_write(unsigned int lba, void *buffer, unsigned int count);
 unsigned int ioc_completed();
 
 /* Frame buffer device related functions */
+#include "../sys/fb_2d.h"
+
 unsigned int fb_sync_read(unsigned int offset, void *buffer, unsigned int length);
 unsigned int fb_sync_write(unsigned int offset, void *buffer, unsigned int length);
 unsigned int fb_read(unsigned int offset, void *buffer, unsigned int length);
 unsigned int fb_write(unsigned int offset, void *buffer, unsigned int length);
+unsigned int fb_write_2d(fb_2d_t *list, unsigned int count);
+unsigned int fb_read_2d(fb_2d_t *list, unsigned int count);
 unsigned int fb_completed();
 
 /* Software barrier related functions */
@@ -69,6 +69,48 @@ void _dcache_buf_invalidate(const void *buffer, unsigned int size)
     }
 }
 
+/*
+ * _dcache_buf_write_back()
+ *
+ * Write back to memory the dirty data cache lines of a memory buffer
+ * (identified by an address and a size), before the buffer is read by a DMA
+ * or IOC peripheral. It must be used when the data cache uses the write-back
+ * policy: the DCACHE_INVAL request issued for each line writes back the line
+ * if it is dirty, and returns when the write-back is completed.
+ * The lines containing the first and last bytes of the buffer are included.
+ */
+void _dcache_buf_write_back(const void *buffer, unsigned int size)
+{
+    unsigned int addr;
+    unsigned int end;
+    unsigned int tmp;
+    unsigned int line_size;
+
+    if (size == 0)
+        return;
+
+    /*
+     * compute data cache line size based on config register (bits 12:10)
+     */
+    asm volatile("mfc0 %0, $16, 1" : "=r"(tmp));
+    tmp = ((tmp>>10) & 0x7);
+    line_size = 2 << tmp;
+
+    /* iterate on cache lines to write back each one of them */
+    addr = (unsigned int)buffer & ~(line_size - 1);
+    end = (unsigned int)buffer + size - 1;
+    while (1)
+    {
+        asm volatile(
+                " cache %0, %1"
+                ::"i" (0x11), "R" (*(unsigned char*)addr)
+                );
+        if (end - addr < line_size)
+            break;
+        addr = addr + line_size;
+    }
+}
+
 /*
  * _itoa_dec()
  *
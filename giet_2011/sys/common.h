@@ -11,6 +11,7 @@
 unsigned int _putk(const char *msg);
 void _exit() __attribute__((noreturn));
 void _dcache_buf_invalidate(const void *buffer, unsigned int size);
+void _dcache_buf_write_back(const void *buffer, unsigned int size);
 
 void _itoa_dec(unsigned int val, char* buf);
 void _itoa_hex(unsigned int val, char* buf);
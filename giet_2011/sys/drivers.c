@@ -12,6 +12,7 @@
  * - seg_tty_base
  * - seg_gcd_base
  * - seg_dma_base
+ * - seg_mdma_base
  * - seg_fb_base
  * - seg_ioc_base
  */
@@ -57,6 +58,16 @@ in_unckdata volatile unsigned char _dma_busy[NB_PROCS] = {
     [0 ... NB_PROCS-1] = 0
 };
 
+/*
+ * Descriptor chains for the multi-channels DMA (one chain per processor).
+ * The descriptors must be aligned on 32 bytes.
+ */
+
+#define MDMA_MAXDESC    16
+
+in_unckdata volatile unsigned int _mdma_desc[NB_PROCS][MDMA_MAXDESC*MDMA_DESC_SIZE]
+    __attribute__((aligned(32)));
+
 in_unckdata volatile unsigned char _ioc_status;
 in_unckdata volatile unsigned char _ioc_done = 0;
 in_unckdata volatile unsigned int _ioc_lock = 0;
@@ -444,6 +455,9 @@ static inline void _ioc_get_lock()
  * - count  : number of blocks to be transfered.
  *
  * - Returns 0 if success, > 0 if error.
+ *
+ * Note: the dirty cache lines corresponding to the source buffer are written
+ * back for cache coherence.
  */
 unsigned int _ioc_write(unsigned int lba, const void *buffer, unsigned int count)
 {
@@ -462,6 +476,9 @@ unsigned int _ioc_write(unsigned int lba, const void *buffer, unsigned int count
     /* get the lock on ioc device */
     _ioc_get_lock();
 
+    /* write back of data cache */
+    if( NO_HARD_CC ) _dcache_buf_write_back(buffer, block_size*count);
+
     /* block_device configuration for the write transfer */
     ioc_address[BLOCK_DEVICE_BUFFER] = (unsigned int)buffer;
     ioc_address[BLOCK_DEVICE_COUNT] = count;
@@ -561,6 +578,16 @@ unsigned int _ioc_completed()
  * completion.  As each processor has its private DMA, there is up to NB_PROCS
  * _dma_busy locks, that are indexed by the proc_id.
  * A _dma_busy variable is reset by the ISR associated to the DMA device IRQ.
+ * ---
+ * The '_fb_write_2d()' and '_fb_read_2d()' functions use the descriptor chain
+ * mode of the multi-channels DMA coprocessor (channel proc_id) to transfer up
+ * to MDMA_MAXDESC rectangles (a set of lines with a constant stride) with a
+ * single system call. They use the same _dma_busy and _dma_status variables,
+ * and the transfer completion is tested by the '_fb_completed()' function.
+ * The pixels can be transformed by the DMA during the transfer (fill,
+ * threshold, or look-up table), as defined by the 'op' field of each
+ * rectangle : a FB_2D_LUT rectangle uses two descriptors (table loading
+ * and transfer).
  */
 
 /*
@@ -631,6 +658,9 @@ unsigned int _fb_sync_read(unsigned int offset, const void *buffer, unsigned int
  * - length : number of bytes to be transfered.
  *
  * - Returns 0 if success, > 0 if error.
+ *
+ * Note: the dirty cache lines corresponding to the source buffer are written
+ * back for cache coherence.
  */
 unsigned int _fb_write(unsigned int offset, const void *buffer, unsigned int length)
 {
@@ -663,6 +693,9 @@ unsigned int _fb_write(unsigned int offset, const void *buffer, unsigned int len
     }
     _dma_busy[proc_id] = 1;
 
+    /* write back of data cache */
+    if( NO_HARD_CC ) _dcache_buf_write_back(buffer, length);
+
     /* DMA configuration for write transfer */
     dma[DMA_IRQ_DISABLE] = 0;
     dma[DMA_SRC] = (unsigned int)buffer;
@@ -728,6 +761,190 @@ unsigned int _fb_read(unsigned int offset, const void *buffer, unsigned int leng
     return 0;
 }
 
+/*
+ * _fb_2d()
+ *
+ * Build the descriptor chain for a list of 2D transfers between the frame
+ * buffer and memory buffers, and start the multi-channels DMA.
+ * - list  : array of 2D transfers (in user address space).
+ * - count : number of 2D transfers (no larger than MDMA_MAXDESC).
+ * - write : transfer to the frame buffer if non zero.
+ *
+ * The memory buffers and look-up tables must be in user address space, and
+ * the offsets, buffer addresses, lengths and strides must be multiple of 4
+ * bytes. The buffer is not used by a FB_2D_FILL write.
+ *
+ * - Returns 0 if success, > 0 if error.
+ *
+ * Note: the dirty cache lines corresponding to the buffers and look-up tables
+ * are written back for cache coherence (and invalidated: the lines of a
+ * destination buffer are not read by the processor before the completion).
+ */
+static unsigned int _fb_2d(const fb_2d_t *list, unsigned int count, unsigned int write)
+{
+    volatile unsigned int *mdma;
+    volatile unsigned int *desc;
+    unsigned int fb_address;
+    unsigned int buf_address;
+    unsigned int room;
+    unsigned int ndesc;
+    unsigned int flags;
+
+    unsigned int proc_id;
+
+    unsigned int delay;
+    unsigned int i;
+    unsigned int n;
+
+    /* parameters checking */
+    /* list and buffers must be in user space */
+    if ((count == 0) || (count > MDMA_MAXDESC))
+        return 1;
+    if (((unsigned int)list >= 0x80000000)
+            || (((unsigned int)list + count*sizeof(fb_2d_t)) >= 0x80000000))
+        return 1;
+    ndesc = count;
+    for (n = 0; n < count; n++)
+    {
+        if (list[n].op > FB_2D_LUT)
+            return 1;
+        if (list[n].op == FB_2D_LUT)
+        {
+            ndesc++;
+            if (((list[n].arg & 0x3) != 0) || (list[n].arg >= 0x80000000)
+                    || ((list[n].arg + 256) >= 0x80000000))
+                return 1;
+        }
+        if (((list[n].offset | (unsigned int)list[n].buffer | list[n].length
+                        | list[n].fb_stride | list[n].buf_stride) & 0x3) != 0)
+            return 1;
+        if ((list[n].lines == 0) || (write && (list[n].op == FB_2D_FILL)))
+            continue;
+        /* the last line must end in user space : the checks are done
+         * without overflow on the first line end and on the lines span */
+        buf_address = (unsigned int)list[n].buffer;
+        if ((buf_address >= 0x80000000)
+                || (list[n].length > 0x7FFFFFFF - buf_address))
+            return 1;
+        room = 0x7FFFFFFF - buf_address - list[n].length;
+        if ((list[n].buf_stride != 0)
+                && ((list[n].lines - 1) > room / list[n].buf_stride))
+            return 1;
+    }
+    if (ndesc > MDMA_MAXDESC)
+        return 1;
+
+    proc_id = _procid();
+    mdma = (unsigned int*)&seg_mdma_base + (proc_id * MDMA_SPAN);
+    desc = _mdma_desc[proc_id];
+
+    /* waiting until DMA device is available */
+    while (_dma_busy[proc_id] != 0)
+    {
+        /* if the lock failed, busy wait with a pseudo random delay between bus
+         * accesses */
+        delay = (_proctime() & 0xF) << 4;
+        for (i = 0; i < delay; i++)
+            asm volatile("nop");
+    }
+    _dma_busy[proc_id] = 1;
+
+    /* write back of data cache */
+    if( NO_HARD_CC )
+    {
+        for (n = 0; n < count; n++)
+        {
+            if (list[n].op == FB_2D_LUT)
+                _dcache_buf_write_back((const void*)list[n].arg, 256);
+            if ((list[n].lines == 0) || (write && (list[n].op == FB_2D_FILL)))
+                continue;
+            _dcache_buf_write_back(list[n].buffer,
+                    (list[n].lines - 1)*list[n].buf_stride + list[n].length);
+        }
+    }
+
+    /* descriptor chain : IRQ at chain end only */
+    for (n = 0; n < count; n++)
+    {
+        flags = list[n].op << 4;
+        if (list[n].op == FB_2D_THRESHOLD)
+            flags = flags | ((list[n].arg & 0xFFFF) << 8);
+        if (list[n].op == FB_2D_LUT)
+        {
+            /* look-up table loading */
+            desc[MDMA_DESC_SRC] = list[n].arg;
+            desc[MDMA_DESC_DST] = 0;
+            desc[MDMA_DESC_LEN] = 256;
+            desc[MDMA_DESC_COUNT] = 1;
+            desc[MDMA_DESC_SSTRIDE] = 0;
+            desc[MDMA_DESC_DSTRIDE] = 0;
+            desc[MDMA_DESC_FLAGS] = MDMA_OP_LUT_LOAD << 4;
+            desc[MDMA_DESC_NEXT] = (unsigned int)(desc + MDMA_DESC_SIZE);
+            desc = desc + MDMA_DESC_SIZE;
+        }
+
+        fb_address = (unsigned int)&seg_fb_base + list[n].offset;
+        buf_address = (unsigned int)list[n].buffer;
+        if (write)
+        {
+            desc[MDMA_DESC_SRC] = buf_address;
+            desc[MDMA_DESC_DST] = fb_address;
+            desc[MDMA_DESC_SSTRIDE] = list[n].buf_stride;
+            desc[MDMA_DESC_DSTRIDE] = list[n].fb_stride;
+        }
+        else
+        {
+            desc[MDMA_DESC_SRC] = fb_address;
+            desc[MDMA_DESC_DST] = buf_address;
+            desc[MDMA_DESC_SSTRIDE] = list[n].fb_stride;
+            desc[MDMA_DESC_DSTRIDE] = list[n].buf_stride;
+        }
+        if (list[n].op == FB_2D_FILL)
+            desc[MDMA_DESC_SRC] = (list[n].arg & 0xFF) * 0x01010101;
+        desc[MDMA_DESC_LEN] = list[n].length;
+        desc[MDMA_DESC_COUNT] = list[n].lines;
+        desc[MDMA_DESC_FLAGS] = (n == count - 1) ? (flags | MDMA_FLAG_LAST) : flags;
+        desc[MDMA_DESC_NEXT] = (unsigned int)(desc + MDMA_DESC_SIZE);
+        desc = desc + MDMA_DESC_SIZE;
+    }
+
+    /* DMA configuration for the chain */
+    mdma[MDMA_IRQ_DISABLE] = 0;
+    mdma[MDMA_COALESCE] = 0;
+    mdma[MDMA_DESC] = (unsigned int)_mdma_desc[proc_id];
+    return 0;
+}
+
+/*
+ * _fb_write_2d()
+ *
+ * Transfer a list of 2D transfers from memory buffers to the frame buffer
+ * device, using the descriptor chain mode of the multi-channels DMA.
+ * - list  : array of 2D transfers (see fb_2d_t).
+ * - count : number of 2D transfers.
+ *
+ * - Returns 0 if success, > 0 if error.
+ */
+unsigned int _fb_write_2d(const fb_2d_t *list, unsigned int count)
+{
+    return _fb_2d(list, count, 1);
+}
+
+/*
+ * _fb_read_2d()
+ *
+ * Transfer a list of 2D transfers from the frame buffer device to memory
+ * buffers, using the descriptor chain mode of the multi-channels DMA.
+ * - list  : array of 2D transfers (see fb_2d_t).
+ * - count : number of 2D transfers.
+ *
+ * - Returns 0 if success, > 0 if error.
+ */
+unsigned int _fb_read_2d(const fb_2d_t *list, unsigned int count)
+{
+    return _fb_2d(list, count, 0);
+}
+
 /*
  * _fb_completed()
  *
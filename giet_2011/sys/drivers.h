@@ -26,6 +26,7 @@ extern __ldscript_symbol_t seg_timer_base;
 extern __ldscript_symbol_t seg_tty_base;
 extern __ldscript_symbol_t seg_gcd_base;
 extern __ldscript_symbol_t seg_dma_base;
+extern __ldscript_symbol_t seg_mdma_base;
 extern __ldscript_symbol_t seg_fb_base;
 extern __ldscript_symbol_t seg_ioc_base;
 
@@ -43,6 +44,12 @@ extern volatile unsigned int _ioc_lock;
 extern volatile unsigned char _tty_get_buf[];
 extern volatile unsigned char _tty_get_full[];
 
+/*
+ * 2D transfer between the frame buffer and a memory buffer
+ */
+
+#include <fb_2d.h>
+
 /*
  * Prototypes of the hardware drivers functions.
  */
@@ -72,6 +79,8 @@ unsigned int _fb_sync_read(unsigned int offset, const void *buffer, unsigned int
 unsigned int _fb_write(unsigned int offset, const void *buffer, unsigned int length);
 unsigned int _fb_read(unsigned int offset, const void *buffer, unsigned int length);
 unsigned int _fb_completed();
+unsigned int _fb_write_2d(const fb_2d_t *list, unsigned int count);
+unsigned int _fb_read_2d(const fb_2d_t *list, unsigned int count);
 
 #endif
 
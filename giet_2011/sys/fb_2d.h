@@ -0,0 +1,28 @@
+/*
+ * 2D transfers between the frame buffer and memory buffers, using the
+ * descriptor chain mode of the multi-channels DMA (fb_write_2d() and
+ * fb_read_2d() system calls).
+ * This header is shared by the system (drivers.h) and the application
+ * (stdio.h) sides.
+ */
+
+#ifndef _FB_2D_H_
+#define _FB_2D_H_
+
+typedef struct fb_2d_s {
+    unsigned int offset;        /* first line offset in the frame buffer (bytes) */
+    void *buffer;               /* first line address in the memory buffer */
+    unsigned int length;        /* line length (bytes) */
+    unsigned int lines;         /* number of lines */
+    unsigned int fb_stride;     /* distance between two lines in the frame buffer (bytes) */
+    unsigned int buf_stride;    /* distance between two lines in the memory buffer (bytes) */
+    unsigned int op;            /* pixel operation (FB_2D_COPY / FILL / THRESHOLD / LUT) */
+    unsigned int arg;           /* fill pixel / threshold | (value << 8) / LUT address */
+} fb_2d_t;
+
+#define FB_2D_COPY      0       /* pixels are copied */
+#define FB_2D_FILL      1       /* pixels are set to arg (the buffer is not read) */
+#define FB_2D_THRESHOLD 2       /* pixels larger than (arg & 0xFF) are set to (arg >> 8) */
+#define FB_2D_LUT       3       /* pixels are translated by the 256 bytes table at address arg */
+
+#endif
@@ -43,6 +43,44 @@ enum DMA_registers {
     DMA_SPAN        = 8,
 };
 
+/* MULTI_DMA (one 4 Kbytes segment per channel) */
+enum MDMA_registers {
+    MDMA_SRC         = 0,
+    MDMA_DST         = 1,
+    MDMA_LEN         = 2,
+    MDMA_RESET       = 3,
+    MDMA_IRQ_DISABLE = 4,
+    MDMA_DESC        = 5,
+    MDMA_COALESCE    = 6,
+    MDMA_INDEX       = 7,
+    /**/
+    MDMA_END         = 8,
+    MDMA_SPAN        = 1024,
+};
+enum MDMA_descriptor {
+    MDMA_DESC_SRC       = 0,
+    MDMA_DESC_DST       = 1,
+    MDMA_DESC_LEN       = 2,
+    MDMA_DESC_COUNT     = 3,
+    MDMA_DESC_SSTRIDE   = 4,
+    MDMA_DESC_DSTRIDE   = 5,
+    MDMA_DESC_FLAGS     = 6,
+    MDMA_DESC_NEXT      = 7,
+    /**/
+    MDMA_DESC_SIZE      = 8,
+};
+enum MDMA_flags {
+    MDMA_FLAG_LAST      = 0x1,
+    MDMA_FLAG_IRQ       = 0x2,
+};
+enum MDMA_operations {
+    MDMA_OP_COPY        = 0,
+    MDMA_OP_FILL        = 1,
+    MDMA_OP_THRESHOLD   = 2,
+    MDMA_OP_LUT         = 3,
+    MDMA_OP_LUT_LOAD    = 4,
+};
+
 /* GCD */
 enum GCD_registers {
     GCD_OPA     = 0,
@@ -75,6 +113,12 @@ enum TIMER_registers {
     TIMER_SPAN      = 4,
 };
 
+/* TIMER cycle counter (user segment) */
+enum CYCLE_registers {
+    CYCLE_LO        = 0,
+    CYCLE_HI        = 1,
+};
+
 /* TTY */
 enum TTY_registers {
     TTY_WRITE   = 0,
@@ -81,6 +81,27 @@ void _isr_dma()
     dma_address[DMA_RESET] = 0;         /* reset IRQ */
 }
 
+/*
+ * _isr_mdma
+ *
+ * This ISR acknowledges the interrupt from the multi-channels dma controller
+ * (channel proc_id), at the end of a descriptor chain. As the _isr_dma, it
+ * resets the global variable _dma_busy[i], after copying the channel status
+ * into the _dma_status[i] variable.
+ */
+void _isr_mdma()
+{
+    volatile unsigned int* mdma_address;
+    unsigned int proc_id;
+
+    proc_id = _procid();
+    mdma_address = (unsigned int*)&seg_mdma_base + (proc_id * MDMA_SPAN);
+
+    _dma_status[proc_id] = mdma_address[MDMA_LEN]; /* save status */
+    _dma_busy[proc_id] = 0;                        /* release DMA */
+    mdma_address[MDMA_RESET] = 0;                  /* reset IRQ */
+}
+
 /*
  * _isr_ioc
  *
@@ -18,6 +18,7 @@ extern _isr_func_t _interrupt_vector[32];
 void _isr_default();
 
 void _isr_dma();
+void _isr_mdma();
 
 void _isr_ioc();
 
@@ -40,8 +40,8 @@ const void *_syscall_vector[32] = {
     &_ioc_completed,    /* 0x17 */
     &_barrier_init,     /* 0x18 */
     &_barrier_wait,     /* 0x19 */
-    &_sys_ukn,          /* 0x1A */
-    &_sys_ukn,          /* 0x1B */
+    &_fb_write_2d,      /* 0x1A */
+    &_fb_read_2d,       /* 0x1B */
     &_sys_ukn,          /* 0x1C */
     &_sys_ukn,          /* 0x1D */
     &_sys_ukn,          /* 0x1E */
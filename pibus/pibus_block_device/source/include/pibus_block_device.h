@@ -45,6 +45,11 @@
 // the master FSM state to IDLE, and acknowledge the IRQ.
 // Any write access to registers BUFFER, COUNT, LBA, OP is ignored
 // if the device is not IDLE.
+// The block device implements the PibusIdleSkip interface : the access 
+// latency cycles, and the cycles waiting the bus, can be skipped.
+// The block device implements the PibusCheckpointable interface : the
+// local block buffer is saved with the registers (the disk image file
+// is not saved).
 ///////////////////////////////////////////////////////////////////////////
 // This component has 6 "constructor" parameters :
 // - sc_module_name 	name	    : instance name
@@ -61,10 +66,13 @@
 #include <systemc.h>
 #include "pibus_mnemonics.h"
 #include "pibus_segment_table.h"
+#include "pibus_checkpoint.h"
 
 namespace soclib { namespace caba {
 
-class PibusBlockDevice : sc_module {
+class PibusBlockDevice : sc_module, 
+                         public soclib::common::PibusIdleSkip,
+                         public soclib::common::PibusCheckpointable {
 
     // REGISTERS
     sc_register<int>      	r_target_fsm;	// target fsm state register
@@ -91,6 +99,7 @@ class PibusBlockDevice : sc_module {
     int                        	m_fd;           // File descriptor
     uint64_t                   	m_device_size;  // Total number of blocks
     const uint32_t	        m_block_size;   // number of bytes in a block
+    uint32_t	                m_skip;         // skipped idle cycles
 
     char	                m_master_str[17][20];	// master FSM states names
     char	                m_target_str[14][20];	// target FSM states names
@@ -188,6 +197,9 @@ public:
     void transition();
     void genMoore();
     void printTrace();
+    uint32_t idleCycles();
+    void skipCycles(uint32_t ncycles);
+    void checkpoint(soclib::common::PibusCheckpoint& ckpt);
 
     // Constructor   
     PibusBlockDevice( sc_module_name                      name,
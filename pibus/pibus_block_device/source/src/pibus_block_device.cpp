@@ -19,6 +19,10 @@ using namespace soclib::common;
 ///////////////////////////////////
 void PibusBlockDevice::transition()
 {
+    // skipped idle cycles (see skipCycles())
+    uint32_t skip = m_skip;
+    m_skip = 0;
+
     if(p_resetn.read() == false) 
     {
         r_master_fsm = M_IDLE;
@@ -123,7 +127,9 @@ void PibusBlockDevice::transition()
         }
         break;
     case M_READ_BLOCK:  // read one block after waiting m_latency cycles
-        if(r_latency_count == 0)
+    {
+        uint32_t latency = r_latency_count.read() - skip;
+        if(latency == 0)
         {
             r_latency_count = m_latency;
             ::lseek(m_fd, (r_lba + r_block_count)*m_block_size, SEEK_SET);
@@ -132,9 +138,10 @@ void PibusBlockDevice::transition()
         }
         else
         {
-            r_latency_count = r_latency_count - 1;
+            r_latency_count = latency - 1;
         }
         break;
+    }
     case M_READ_REQ:
 	    if(p_gnt.read() == true) 
         {
@@ -150,6 +157,10 @@ void PibusBlockDevice::transition()
         if ( p_tout.read() or (p_ack.read() == PIBUS_ACK_ERROR) )
         {
             r_master_fsm = M_READ_ERROR;
+        }
+        else if ( p_ack.read() == PIBUS_ACK_RETRY )	// split transaction : restart
+        {
+            r_master_fsm = M_READ_REQ;
         }
 	    else if ( p_ack.read() == PIBUS_ACK_READY ) 
         {
@@ -161,6 +172,10 @@ void PibusBlockDevice::transition()
 	    if ( (p_ack.read() == PIBUS_ACK_ERROR) or p_tout.read() )  
         {
             r_master_fsm = M_READ_ERROR;
+        }
+        else if ( p_ack.read() == PIBUS_ACK_RETRY )	// split transaction : restart
+        {
+            r_master_fsm = M_READ_REQ;
         }
 	    else if ( p_ack.read() == PIBUS_ACK_READY )  
         {
@@ -203,6 +218,10 @@ void PibusBlockDevice::transition()
         {
             r_master_fsm = M_WRITE_ERROR;
         }
+        else if ( p_ack.read() == PIBUS_ACK_RETRY )	// split transaction : restart
+        {
+            r_master_fsm = M_WRITE_REQ;
+        }
         else if ( p_ack.read() == PIBUS_ACK_READY ) 
         {
             m_local_buffer[r_word_count - 1] = p_d.read();
@@ -215,6 +234,10 @@ void PibusBlockDevice::transition()
         {
             r_master_fsm = M_WRITE_ERROR;
         }
+        else if ( p_ack.read() == PIBUS_ACK_RETRY )	// split transaction : restart
+        {
+            r_master_fsm = M_WRITE_REQ;
+        }
         else if ( p_ack.read() == PIBUS_ACK_READY ) 
         {
             m_local_buffer[r_word_count - 1] = p_d.read();
@@ -223,7 +246,9 @@ void PibusBlockDevice::transition()
         }
         break;
     case M_WRITE_BLOCK:
-        if(r_latency_count == 0)
+    {
+        uint32_t latency = r_latency_count.read() - skip;
+        if(latency == 0)
         {
             r_latency_count = m_latency;
             ::lseek(m_fd, (r_lba + r_block_count)*m_block_size, SEEK_SET);
@@ -232,9 +257,10 @@ void PibusBlockDevice::transition()
         }
         else
         {
-            r_latency_count = r_latency_count - 1;
+            r_latency_count = latency - 1;
         }
         break;
+    }
     case M_WRITE_TEST:
         if( r_block_count == r_nblocks - 1 )
         {
@@ -356,6 +382,7 @@ PibusBlockDevice::PibusBlockDevice( sc_module_name	   	name,
       m_tgtid(tgtid),
       m_latency(latency),
       m_block_size(block_size),
+      m_skip(0),
       p_ck("p_ck"),
       p_resetn("p_resetn"),
       p_req("p_req"),
@@ -476,6 +503,61 @@ void PibusBlockDevice::printTrace()
               << "    block_count = " << r_block_count.read() << std::endl; 
 }
 
+/////////////////////////////////////////////////////////////////////
+// idle cycles : the block device is idle when the target FSM is not 
+// selected, and the master FSM is waiting the bus grant, a data
+// acknowledge, a new command, or the end of the access latency.
+/////////////////////////////////////////////////////////////////////
+uint32_t PibusBlockDevice::idleCycles()
+{
+    if( (r_target_fsm != T_IDLE) || p_sel.read() ) return 0;
+
+    switch(r_master_fsm) {
+    case M_IDLE:
+        if( !r_go ) return PIBUS_IDLE_FOREVER;
+        break;
+    case M_READ_BLOCK:
+    case M_WRITE_BLOCK:
+        return r_latency_count.read();
+    case M_READ_REQ:
+    case M_WRITE_REQ:
+        if( !p_gnt.read() ) return PIBUS_IDLE_FOREVER;
+        break;
+    case M_READ_DTAD:
+    case M_READ_DT:
+    case M_WRITE_DTAD:
+    case M_WRITE_DT:
+        if( (p_ack.read() == PIBUS_ACK_WAIT) && !p_tout.read() ) return PIBUS_IDLE_FOREVER;
+        break;
+    case M_READ_SUCCESS:
+    case M_READ_ERROR:
+    case M_WRITE_SUCCESS:
+    case M_WRITE_ERROR:
+        if( r_go ) return PIBUS_IDLE_FOREVER;
+        break;
+    }
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+// skip idle cycles : the latency counter is updated by the next
+// transition.
+/////////////////////////////////////////////////////////////////////
+void PibusBlockDevice::skipCycles(uint32_t ncycles)
+{
+    m_skip = ncycles;
+}
+
+/////////////////////////////////////////////////////////////////////
+// checkpoint : the local buffer is not a register
+/////////////////////////////////////////////////////////////////////
+void PibusBlockDevice::checkpoint(soclib::common::PibusCheckpoint& ckpt)
+{
+    ckpt.section(m_name);
+    ckpt.check(m_block_size, "block size");
+    ckpt.state(m_local_buffer, m_block_size);
+}
+
 
 }} // end namespace
 
@@ -0,0 +1,196 @@
+//////////////////////////////////////////////////////////////////////////
+// File : pibus_bridge.h
+// This program is released under the GNU Public License
+// Copyright : UPMC-LIP6
+//////////////////////////////////////////////////////////////////////////
+// This component is a PIBUS to PIBUS bridge, used to build hierarchical
+// (clustered) architectures : it is a target on a "local" PIBUS, and a
+// master on a "remote" PIBUS. The local transactions addressing the
+// bridge are forwarded on the remote PIBUS, with the same address.
+//
+// The address window of the bridge is defined by the segments allocated
+// to the bridge target index in the local segment table : an address
+// that is not contained in one of these segments is answered ERROR.
+//
+// The write transactions are posted : each written word (address, data
+// and OPC) is registered in a write queue, and the local transaction
+// is acknowledged without waiting the remote transaction. The WAIT
+// acknowledge is returned when the write queue is full. The master FSM
+// builds the remote write transactions from the write queue : the
+// consecutive full words (WDU or WDx OPC, contiguous addresses in the
+// same 64 bytes block) are forwarded as a single burst (WD2/WD4/WD8/WD16
+// OPC), so that both the burst transactions and the sequences of single
+// word writes use the remote PIBUS efficiently. An error on a posted
+// write cannot be reported to the local master : it is only counted.
+//
+// The read transactions are not posted : the WAIT acknowledge is
+// returned on the local PIBUS until the remote read transaction is
+// completed. A read is forwarded only when the write queue is empty,
+// so that a master always reads its own previous writes. The remote
+// read has the same length as the local one (the OPC field defines
+// the number of words), and addresses the aligned block containing
+// the first local address : the remote burst starts with this word
+// and wraps around the block boundary, as the critical word first
+// line refills of the caches. The words are stored in a read buffer 
+// indexed by the block offset, and sent on the local PIBUS without 
+// wait cycles, in the order requested by the local master. If it
+// continues the transaction outside the read buffer (burst of single
+// word reads), a new remote read is started. The ERROR acknowledge
+// (or the remote time-out) is transmitted to the local master.
+// As the local PIBUS is not released during a remote read, the local
+// BCU time-out must be larger than the remote PIBUS latency.
+//
+// The remote RETRY acknowledge (split transaction) is handled by the
+// master FSM, that restarts the remote transaction.
+//
+// Restrictions :
+// - The bridges must not build a cycle (a remote PIBUS cannot access
+//   the local PIBUS through another bridge), to avoid dead-locks.
+// - The write transactions are not broadcast on the local PIBUS : the
+//   snoop mechanism of the caches is not supported across a bridge.
+//////////////////////////////////////////////////////////////////////////
+// This component has 4 "constructor" parameters
+// - sc_module_name		name    : instance name
+// - unsigned int  		tgtid   : target index on the local PIBUS
+// - pibusSegmentTable		segtab  : local segment table
+// - unsigned int		depth	: write queue depth (default = 8)
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef PIBUS_BRIDGE_H
+#define PIBUS_BRIDGE_H
+
+#include <systemc>
+#include <stdio.h>
+#include "pibus_segment_table.h"
+#include "pibus_mnemonics.h"
+
+#define BRIDGE_MAXSEG 	16
+#define BRIDGE_MAXREAD	32	// max number of words in a read transaction
+#define BRIDGE_MAXWRITE	16	// max number of words in a write burst
+
+namespace soclib { namespace caba {
+
+class PibusBridge : sc_core::sc_module {
+
+    //  REGISTERS
+    sc_register<int>		r_tgt_fsm;		// target FSM state
+    sc_register<uint32_t>	r_tgt_addr;		// local PIBUS address
+    sc_register<uint32_t>	r_tgt_opc;		// local PIBUS OPC
+
+    sc_register<uint32_t>*	r_wq_addr;		// write queue : addresses
+    sc_register<uint32_t>*	r_wq_data;		// write queue : data
+    sc_register<uint32_t>*	r_wq_opc;		// write queue : OPC
+    sc_register<size_t>		r_wq_ptr;		// write queue : read pointer
+    sc_register<size_t>		r_wq_ptw;		// write queue : write pointer
+    sc_register<size_t>		r_wq_count;		// write queue : number of entries
+
+    sc_register<bool>		r_rd_req;		// remote read request (set by TGT, reset by MST)
+    sc_register<uint32_t>	r_rd_addr;		// remote read block address (aligned)
+    sc_register<uint32_t>	r_rd_first;		// remote read first word index
+    sc_register<uint32_t>	r_rd_nwords;		// remote read number of words
+    sc_register<bool>		r_rd_error;		// remote read error
+    sc_register<uint32_t>*	r_rd_buf;		// read buffer
+
+    sc_register<int>		r_mst_fsm;		// master FSM state
+    sc_register<uint32_t>	r_mst_addr;		// remote transaction first address
+    sc_register<uint32_t>	r_mst_nwords;		// remote transaction number of words
+    sc_register<uint32_t>	r_mst_count;		// number of words addressed
+
+    //  STRUCTURAL PARAMETERS
+    const char*			m_name;			// instance name
+    const uint32_t    	 	m_tgtid;		// target index
+    const size_t		m_depth;		// write queue depth
+    size_t      		m_nbseg;		// segment number
+    uint32_t    		m_segsize[BRIDGE_MAXSEG];	// segment sizes
+    uint32_t   			m_segbase[BRIDGE_MAXSEG];	// segment bases
+    const char*			m_segname[BRIDGE_MAXSEG];	// segment names
+    char			m_tgt_str[6][20];	// target FSM states names
+    char			m_mst_str[9][20];	// master FSM states names
+
+    //  INSTRUMENTATION COUNTERS
+    uint32_t			c_read;			// remote read transactions
+    uint32_t			c_read_words;		// remote read words
+    uint32_t			c_read_wait;		// local wait cycles (read)
+    uint32_t			c_write;		// remote write transactions
+    uint32_t			c_write_words;		// remote written words
+    uint32_t			c_write_full;		// local wait cycles (write queue full)
+    uint32_t			c_burst;		// remote write bursts (more than one word)
+    uint32_t			c_error;		// remote errors (or time-outs)
+    uint32_t			c_retry;		// remote RETRY acknowledges
+
+    // TARGET FSM states
+    enum {
+	TGT_IDLE	= 0,
+	TGT_READ_WAIT	= 1,
+	TGT_READ_OK	= 2,
+	TGT_WRITE_WAIT	= 3,
+	TGT_WRITE_OK	= 4,
+	TGT_ERROR	= 5,
+    };
+
+    // MASTER FSM states
+    enum {
+	MST_IDLE	= 0,
+	MST_READ_REQ	= 1,
+	MST_READ_AD	= 2,
+	MST_READ_DTAD	= 3,
+	MST_READ_DT	= 4,
+	MST_WRITE_REQ	= 5,
+	MST_WRITE_AD	= 6,
+	MST_WRITE_DTAD	= 7,
+	MST_WRITE_DT	= 8,
+    };
+
+    //  METHODS
+    bool inWindow(uint32_t address);
+    bool inBuffer(uint32_t address);
+    uint32_t burstLength();
+
+protected:
+
+    SC_HAS_PROCESS(PibusBridge);
+
+public:
+
+    // IO PORTS
+    sc_core::sc_in<bool> 		p_ck;
+    sc_core::sc_in<bool> 		p_resetn;
+
+    // target ports (local PIBUS)
+    sc_core::sc_in<bool>		p_sel;
+    sc_core::sc_in<uint32_t>		p_a;
+    sc_core::sc_in<bool>		p_read;
+    sc_core::sc_in<uint32_t>		p_opc;
+    sc_core::sc_out<uint32_t>		p_ack;
+    sc_core::sc_inout<uint32_t>		p_d;
+    sc_core::sc_in<bool>		p_tout;
+
+    // master ports (remote PIBUS)
+    sc_core::sc_out<bool>		p_req;
+    sc_core::sc_in<bool>		p_gnt;
+    sc_core::sc_inout<uint32_t>		p_m_a;
+    sc_core::sc_out<bool>		p_m_read;
+    sc_core::sc_out<uint32_t>		p_m_opc;
+    sc_core::sc_out<bool>		p_m_lock;
+    sc_core::sc_inout<uint32_t>		p_m_d;
+    sc_core::sc_in<uint32_t>		p_m_ack;
+    sc_core::sc_in<bool>		p_m_tout;
+
+    // constructor
+    PibusBridge (sc_core::sc_module_name		name,
+		 uint32_t	         		tgtid,
+		 soclib::common::PibusSegmentTable	&segtab,
+		 size_t					depth = 8);
+    ~PibusBridge();
+
+    // methods
+    void transition();
+    void genMoore();
+    void printTrace();
+    void printStatistics();
+
+}; // end class PibusBridge
+
+}} // end name spaces
+
+#endif
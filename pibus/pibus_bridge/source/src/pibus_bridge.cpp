@@ -0,0 +1,575 @@
+///////////////////////////////////////////////////////////
+// File : pibus_bridge.cpp
+// This program is released under the GNU Public License
+// Copyright : UPMC-LIP6
+///////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "pibus_bridge.h"
+#include "alloc_elems.h"
+
+namespace soclib { namespace caba {
+
+using namespace sc_core;
+using namespace soclib::caba;
+using namespace soclib::common;
+
+//////////////////////////////////////////
+inline uint32_t opc2nwords(uint32_t opc)
+{
+    switch(opc) {
+    case PIBUS_OPC_WD2  : return 2;
+    case PIBUS_OPC_WD4  : return 4;
+    case PIBUS_OPC_WD8  : return 8;
+    case PIBUS_OPC_WD16 : return 16;
+    case PIBUS_OPC_WD32 : return 32;
+    default             : return 1;
+    }
+}
+
+//////////////////////////////////////////
+inline uint32_t nwords2opc(uint32_t nwords)
+{
+    switch(nwords) {
+    case 2  : return PIBUS_OPC_WD2;
+    case 4  : return PIBUS_OPC_WD4;
+    case 8  : return PIBUS_OPC_WD8;
+    case 16 : return PIBUS_OPC_WD16;
+    case 32 : return PIBUS_OPC_WD32;
+    default : return PIBUS_OPC_WDU;
+    }
+}
+
+//////////////////////////////////////////
+// returns true if all bytes are written
+inline bool fullWord(uint32_t opc)
+{
+    return ( (opc == PIBUS_OPC_WDU) || (opc == PIBUS_OPC_WD2) || (opc == PIBUS_OPC_WD4) ||
+             (opc == PIBUS_OPC_WD8) || (opc == PIBUS_OPC_WD16) || (opc == PIBUS_OPC_WD32) );
+}
+
+////////////////////////////////////////////////////////////
+PibusBridge::PibusBridge (sc_module_name	 	name,
+			  uint32_t			tgtid,
+			  PibusSegmentTable		&segtab,
+			  size_t			depth)
+    : r_wq_addr(soclib::common::alloc_elems<sc_register<uint32_t> >("r_wq_addr", depth)),
+      r_wq_data(soclib::common::alloc_elems<sc_register<uint32_t> >("r_wq_data", depth)),
+      r_wq_opc(soclib::common::alloc_elems<sc_register<uint32_t> >("r_wq_opc", depth)),
+      r_rd_buf(soclib::common::alloc_elems<sc_register<uint32_t> >("r_rd_buf", BRIDGE_MAXREAD)),
+      m_name(name),
+      m_tgtid(tgtid),
+      m_depth(depth),
+      p_ck("p_ck"),
+      p_resetn("p_resetn"),
+      p_sel("p_sel"),
+      p_a("p_a"),
+      p_read("p_read"),
+      p_opc("p_opc"),
+      p_ack("p_ack"),
+      p_d("p_d"),
+      p_tout("p_tout"),
+      p_req("p_req"),
+      p_gnt("p_gnt"),
+      p_m_a("p_m_a"),
+      p_m_read("p_m_read"),
+      p_m_opc("p_m_opc"),
+      p_m_lock("p_m_lock"),
+      p_m_d("p_m_d"),
+      p_m_ack("p_m_ack"),
+      p_m_tout("p_m_tout")
+{
+    SC_METHOD (transition);
+    sensitive_pos << p_ck;
+
+    SC_METHOD (genMoore);
+    sensitive_neg << p_ck;
+
+    if ( depth == 0 )
+    {
+        printf("ERROR in component PibusBridge %s\n", m_name);
+        printf("The write queue depth cannot be 0\n");
+        exit(1);
+    }
+
+    // address window
+    m_nbseg = 0;
+    std::list<SegmentTableEntry> seglist = segtab.getTargetSegmentList(tgtid);
+    std::list<SegmentTableEntry>::iterator iter;
+
+    for (iter = seglist.begin() ; iter != seglist.end() ; ++iter)
+    {
+        if(m_nbseg == BRIDGE_MAXSEG)
+        {
+            printf("ERROR in component PibusBridge %s\n", m_name);
+            printf("The number of segments cannot be larger than %d\n", BRIDGE_MAXSEG);
+            exit(1);
+        }
+        m_segname[m_nbseg]   = (*iter).getName();
+        m_segsize[m_nbseg]   = (*iter).getSize();
+        m_segbase[m_nbseg]   = (*iter).getBase();
+        m_nbseg              = m_nbseg+1;
+    }
+
+    strcpy(m_tgt_str[0], "TGT_IDLE");
+    strcpy(m_tgt_str[1], "TGT_READ_WAIT");
+    strcpy(m_tgt_str[2], "TGT_READ_OK");
+    strcpy(m_tgt_str[3], "TGT_WRITE_WAIT");
+    strcpy(m_tgt_str[4], "TGT_WRITE_OK");
+    strcpy(m_tgt_str[5], "TGT_ERROR");
+
+    strcpy(m_mst_str[0], "MST_IDLE");
+    strcpy(m_mst_str[1], "MST_READ_REQ");
+    strcpy(m_mst_str[2], "MST_READ_AD");
+    strcpy(m_mst_str[3], "MST_READ_DTAD");
+    strcpy(m_mst_str[4], "MST_READ_DT");
+    strcpy(m_mst_str[5], "MST_WRITE_REQ");
+    strcpy(m_mst_str[6], "MST_WRITE_AD");
+    strcpy(m_mst_str[7], "MST_WRITE_DTAD");
+    strcpy(m_mst_str[8], "MST_WRITE_DT");
+
+    std::cout << std::endl << "Instanciation of PibusBridge : " << m_name << std::endl;
+    std::cout << "    write queue depth = " << depth << std::endl;
+    for(uint32_t i = 0 ; i < m_nbseg ; i++)
+ 	std::cout << "    segment " << m_segname[i] << std::hex
+                  << " | base = 0x" << m_segbase[i]
+                  << " | size = 0x" << m_segsize[i] << std::endl;
+
+} // end constructor
+
+////////////////////////////
+PibusBridge::~PibusBridge()
+{
+    soclib::common::dealloc_elems(r_wq_addr, m_depth);
+    soclib::common::dealloc_elems(r_wq_data, m_depth);
+    soclib::common::dealloc_elems(r_wq_opc, m_depth);
+    soclib::common::dealloc_elems(r_rd_buf, BRIDGE_MAXREAD);
+}
+
+////////////////////////////////////////////////
+bool PibusBridge::inWindow(uint32_t address)
+{
+    for (size_t i = 0 ; i < m_nbseg ; i++)
+    {
+        if ((address >= m_segbase[i]) && (address < m_segbase[i] + m_segsize[i])) return true;
+    }
+    return false;
+}
+
+////////////////////////////////////////////////
+bool PibusBridge::inBuffer(uint32_t address)
+{
+    return ( (address >= r_rd_addr.read()) &&
+             (address <  r_rd_addr.read() + (r_rd_nwords.read() << 2)) );
+}
+
+//////////////////////////////////////////////////////////////////////
+// returns the number of write queue entries that can be forwarded
+// in a single remote transaction (starting from the queue head) :
+// full words with contiguous addresses in the same 64 bytes block.
+// The result is a power of 2 (burst length).
+//////////////////////////////////////////////////////////////////////
+uint32_t PibusBridge::burstLength()
+{
+    size_t	ptr   = r_wq_ptr.read();
+    uint32_t	first = r_wq_addr[ptr].read();
+    uint32_t	n     = 1;
+
+    if ( not fullWord( r_wq_opc[ptr].read() ) ) return 1;
+
+    while ( (n < r_wq_count.read()) && (n < BRIDGE_MAXWRITE) )
+    {
+        size_t   index   = (ptr + n) % m_depth;
+        uint32_t address = r_wq_addr[index].read();
+        if ( not fullWord( r_wq_opc[index].read() ) ||
+             (address != first + (n << 2)) ||
+             ((address & ~0x3F) != (first & ~0x3F)) ) break;
+        n++;
+    }
+
+    uint32_t length = 1;
+    while ( (length << 1) <= n ) length = length << 1;
+    return length;
+}
+
+//////////////////////////////
+void PibusBridge::transition()
+{
+    if (p_resetn == false)
+    {
+        r_tgt_fsm	= TGT_IDLE;
+        r_mst_fsm	= MST_IDLE;
+        r_wq_ptr	= 0;
+        r_wq_ptw	= 0;
+        r_wq_count	= 0;
+        r_rd_req	= false;
+        r_rd_error	= false;
+        r_rd_addr	= 0;
+        r_rd_first	= 0;
+        r_rd_nwords	= 0;
+
+        c_read		= 0;
+        c_read_words	= 0;
+        c_read_wait	= 0;
+        c_write		= 0;
+        c_write_words	= 0;
+        c_write_full	= 0;
+        c_burst		= 0;
+        c_error		= 0;
+        c_retry		= 0;
+        return;
+    } // end p_resetn
+
+    bool	wq_put = false;		// one entry written in the write queue
+    uint32_t	wq_get = 0;		// number of entries removed from the write queue
+
+    ///////////////////////////////////////////////////////////////////
+    // The target FSM controls the following registers :
+    // r_tgt_fsm, r_tgt_addr, r_tgt_opc, the write queue write pointer,
+    // and sets the r_rd_req flip-flop to request a remote read.
+    ///////////////////////////////////////////////////////////////////
+
+    switch (r_tgt_fsm) {
+    case TGT_IDLE :
+    {
+        if (p_sel == true)
+        {
+            uint32_t address = ((uint32_t)p_a.read()) & 0xfffffffc;
+            r_tgt_addr = address;
+            r_tgt_opc  = p_opc.read();
+            if ( not inWindow(address) )
+            {
+                r_tgt_fsm = TGT_ERROR;
+            }
+            else if ( p_read == true )
+            {
+                // if a remote read (aborted by a time-out) is not
+                // completed, a new request is sent in READ_WAIT state
+                if ( r_rd_req == false )
+                {
+                    uint32_t nwords = opc2nwords( p_opc.read() );
+                    r_rd_req    = true;
+                    r_rd_addr   = address & ~((nwords << 2) - 1);
+                    r_rd_first  = (address >> 2) & (nwords - 1);
+                    r_rd_nwords = nwords;
+                }
+                r_tgt_fsm = TGT_READ_WAIT;
+            }
+            else
+            {
+                if ( r_wq_count.read() < m_depth ) r_tgt_fsm = TGT_WRITE_OK;
+                else                               r_tgt_fsm = TGT_WRITE_WAIT;
+            }
+        }
+        break;
+    }
+    case TGT_ERROR :
+    {
+	r_tgt_fsm = TGT_IDLE;
+        break;
+    }
+    case TGT_READ_WAIT :
+    {
+        c_read_wait++;
+        if ( p_tout == true )
+        {
+            r_tgt_fsm = TGT_IDLE;
+        }
+        else if ( r_rd_req == false )
+        {
+            if ( inBuffer( r_tgt_addr.read() ) )
+            {
+                if ( r_rd_error ) r_tgt_fsm = TGT_ERROR;
+                else              r_tgt_fsm = TGT_READ_OK;
+            }
+            else
+            {
+                r_rd_req    = true;
+                r_rd_addr   = r_tgt_addr.read();
+                r_rd_first  = 0;
+                r_rd_nwords = 1;
+            }
+        }
+        break;
+    }
+    case TGT_READ_OK :
+    {
+	if (p_sel == true)
+        {
+            uint32_t address = ((uint32_t)p_a.read()) & 0xfffffffc;
+            if ( not inWindow(address) || (p_read == false) )
+            {
+                r_tgt_fsm = TGT_ERROR;
+            }
+            else
+            {
+                r_tgt_addr = address;
+                if ( not inBuffer(address) )	// new remote read
+                {
+                    r_rd_req    = true;
+                    r_rd_addr   = address;
+                    r_rd_first  = 0;
+                    r_rd_nwords = 1;
+                    r_tgt_fsm   = TGT_READ_WAIT;
+                }
+            }
+        }
+        else
+        {
+            r_tgt_fsm = TGT_IDLE;
+        }
+        break;
+    }
+    case TGT_WRITE_WAIT :
+    {
+        c_write_full++;
+        if      ( p_tout == true )                 r_tgt_fsm = TGT_IDLE;
+        else if ( r_wq_count.read() < m_depth )    r_tgt_fsm = TGT_WRITE_OK;
+        break;
+    }
+    case TGT_WRITE_OK :
+    {
+        size_t ptw = r_wq_ptw.read();
+        r_wq_addr[ptw] = r_tgt_addr.read();
+        r_wq_data[ptw] = (uint32_t)p_d.read();
+        r_wq_opc[ptw]  = r_tgt_opc.read();
+        r_wq_ptw       = (ptw + 1) % m_depth;
+        wq_put         = true;
+
+	if (p_sel == true)
+        {
+	    uint32_t address = ((uint32_t)p_a.read()) & 0xfffffffc;
+            if ( not inWindow(address) || (p_read == true) )
+            {
+                r_tgt_fsm = TGT_ERROR;
+            }
+            else
+            {
+                r_tgt_addr = address;
+                r_tgt_opc  = p_opc.read();
+                if ( r_wq_count.read() + 1 >= m_depth ) r_tgt_fsm = TGT_WRITE_WAIT;
+            }
+	}
+        else
+        {
+            r_tgt_fsm = TGT_IDLE;
+	}
+        break;
+    }
+    } // end switch r_tgt_fsm
+
+    ///////////////////////////////////////////////////////////////////
+    // The master FSM controls the following registers :
+    // r_mst_fsm, r_mst_addr, r_mst_nwords, r_mst_count, the write
+    // queue read pointer, the read buffer, r_rd_error, and resets
+    // the r_rd_req flip-flop when the remote read is completed.
+    // A remote read starts with the r_rd_first word of the block,
+    // and wraps around the block boundary.
+    // The posted writes have priority on the reads.
+    // In case of RETRY, the remote transaction is restarted.
+    ///////////////////////////////////////////////////////////////////
+
+    switch (r_mst_fsm) {
+    case MST_IDLE :
+    {
+        if ( r_wq_count.read() != 0 )
+        {
+            r_mst_addr   = r_wq_addr[r_wq_ptr.read()].read();
+            r_mst_nwords = burstLength();
+            r_mst_count  = 0;
+            r_mst_fsm    = MST_WRITE_REQ;
+        }
+        else if ( r_rd_req == true )
+        {
+            r_mst_addr   = r_rd_addr.read();
+            r_mst_nwords = r_rd_nwords.read();
+            r_mst_count  = 0;
+            r_rd_error   = false;
+            r_mst_fsm    = MST_READ_REQ;
+        }
+        break;
+    }
+    case MST_READ_REQ :
+    case MST_WRITE_REQ :
+    {
+        if ( p_gnt == true )
+        {
+            if ( r_mst_fsm == MST_READ_REQ ) r_mst_fsm = MST_READ_AD;
+            else                             r_mst_fsm = MST_WRITE_AD;
+        }
+        break;
+    }
+    case MST_READ_AD :
+    case MST_WRITE_AD :
+    {
+        bool read  = (r_mst_fsm == MST_READ_AD);
+        r_mst_count = 1;
+        if      ( r_mst_nwords.read() == 1 )	r_mst_fsm = read ? MST_READ_DT : MST_WRITE_DT;
+        else					r_mst_fsm = read ? MST_READ_DTAD : MST_WRITE_DTAD;
+        break;
+    }
+    case MST_READ_DTAD :
+    case MST_READ_DT :
+    {
+        uint32_t ack = p_m_ack.read();
+        if ( (p_m_tout == true) || (ack == PIBUS_ACK_ERROR) )
+        {
+            c_error++;
+            r_rd_error = true;
+            r_rd_req   = false;
+            r_mst_fsm  = MST_IDLE;
+        }
+        else if ( ack == PIBUS_ACK_RETRY )	// split transaction : restart
+        {
+            c_retry++;
+            r_mst_count = 0;
+            r_mst_fsm   = MST_READ_REQ;
+        }
+        else if ( ack == PIBUS_ACK_READY )
+        {
+            uint32_t index = (r_rd_first.read() + r_mst_count.read() - 1) &
+                             (r_mst_nwords.read() - 1);
+            r_rd_buf[index] = (uint32_t)p_m_d.read();
+            r_mst_count = r_mst_count.read() + 1;
+            if ( r_mst_fsm == MST_READ_DT )
+            {
+                c_read++;
+                c_read_words = c_read_words + r_mst_nwords.read();
+                r_rd_req  = false;
+                r_mst_fsm = MST_IDLE;
+            }
+            else if ( r_mst_count.read() == r_mst_nwords.read() - 1 )
+            {
+                r_mst_fsm = MST_READ_DT;
+            }
+        }
+        break;
+    }
+    case MST_WRITE_DTAD :
+    case MST_WRITE_DT :
+    {
+        uint32_t ack = p_m_ack.read();
+        if ( (p_m_tout == true) || (ack == PIBUS_ACK_ERROR) )	// posted write : the words are lost
+        {
+            c_error++;
+            wq_get    = r_mst_nwords.read();
+            r_mst_fsm = MST_IDLE;
+        }
+        else if ( ack == PIBUS_ACK_RETRY )	// split transaction : restart
+        {
+            c_retry++;
+            r_mst_count = 0;
+            r_mst_fsm   = MST_WRITE_REQ;
+        }
+        else if ( ack == PIBUS_ACK_READY )
+        {
+            r_mst_count = r_mst_count.read() + 1;
+            if ( r_mst_fsm == MST_WRITE_DT )
+            {
+                c_write++;
+                c_write_words = c_write_words + r_mst_nwords.read();
+                if ( r_mst_nwords.read() > 1 ) c_burst++;
+                wq_get    = r_mst_nwords.read();
+                r_mst_fsm = MST_IDLE;
+            }
+            else if ( r_mst_count.read() == r_mst_nwords.read() - 1 )
+            {
+                r_mst_fsm = MST_WRITE_DT;
+            }
+        }
+        break;
+    }
+    } // end switch r_mst_fsm
+
+    // write queue update
+    r_wq_ptr   = (r_wq_ptr.read() + wq_get) % m_depth;
+    r_wq_count = r_wq_count.read() + (wq_put ? 1 : 0) - wq_get;
+
+} // end transition()
+
+///////////////////////////////
+void PibusBridge::genMoore()
+{
+    // target side (local PIBUS)
+    switch(r_tgt_fsm) {
+    case TGT_IDLE :
+        break;
+    case TGT_ERROR :
+        p_ack = PIBUS_ACK_ERROR;
+        break;
+    case TGT_READ_WAIT :
+        p_ack = PIBUS_ACK_WAIT;
+        p_d = 0;
+        break;
+    case TGT_READ_OK :
+        p_ack = PIBUS_ACK_READY;
+        p_d = r_rd_buf[(r_tgt_addr.read() - r_rd_addr.read()) >> 2].read();
+        break;
+    case TGT_WRITE_WAIT :
+        p_ack = PIBUS_ACK_WAIT;
+        break;
+    case TGT_WRITE_OK :
+        p_ack = PIBUS_ACK_READY;
+        break;
+    }
+
+    // master side (remote PIBUS)
+    p_req = (r_mst_fsm == MST_READ_REQ) || (r_mst_fsm == MST_WRITE_REQ);
+
+    uint32_t	count  = r_mst_count.read();
+    uint32_t	nwords = r_mst_nwords.read();
+    size_t	ptr    = r_wq_ptr.read();
+
+    switch(r_mst_fsm) {
+    case MST_READ_AD :
+    case MST_READ_DTAD :
+        p_m_a    = r_mst_addr.read() + (((r_rd_first.read() + count) & (nwords - 1)) << 2);
+        p_m_read = true;
+        p_m_opc  = nwords2opc( nwords );
+        p_m_lock = (count < nwords - 1);
+        break;
+    case MST_WRITE_AD :
+    case MST_WRITE_DTAD :
+        p_m_a    = r_mst_addr.read() + (count << 2);
+        p_m_read = false;
+        if ( nwords > 1 )                            p_m_opc = nwords2opc( nwords );
+        else if ( fullWord( r_wq_opc[ptr].read() ) ) p_m_opc = PIBUS_OPC_WDU;
+        else                                         p_m_opc = r_wq_opc[ptr].read();
+        p_m_lock = (count < nwords - 1);
+        if ( r_mst_fsm == MST_WRITE_DTAD ) p_m_d = r_wq_data[(ptr + count - 1) % m_depth].read();
+        break;
+    case MST_WRITE_DT :
+        p_m_d    = r_wq_data[(ptr + count - 1) % m_depth].read();
+        break;
+    default :
+        break;
+    }
+} // end genMoore()
+
+/////////////////////////////
+void PibusBridge::printTrace()
+{
+    std::cout << m_name << " : " << m_tgt_str[r_tgt_fsm]
+              << " / " << m_mst_str[r_mst_fsm]
+              << " / write queue = " << std::dec << r_wq_count.read()
+              << " / read request = " << r_rd_req.read() << std::endl;
+}
+
+///////////////////////////////////
+void PibusBridge::printStatistics()
+{
+    std::cout << "*** " << m_name << " statistics" << std::dec << std::endl;
+    std::cout << "- REMOTE READS          = " << c_read << std::endl;
+    std::cout << "- READ WORDS            = " << c_read_words << std::endl;
+    std::cout << "- LOCAL READ WAIT       = " << c_read_wait << std::endl;
+    std::cout << "- REMOTE WRITES         = " << c_write << std::endl;
+    std::cout << "- WRITTEN WORDS         = " << c_write_words << std::endl;
+    std::cout << "- WRITE BURSTS          = " << c_burst << std::endl;
+    if ( c_write )
+    std::cout << "- WORDS PER WRITE       = " << (float)c_write_words/(float)c_write << std::endl;
+    std::cout << "- WRITE QUEUE FULL      = " << c_write_full << std::endl;
+    std::cout << "- REMOTE ERRORS         = " << c_error << std::endl;
+    std::cout << "- REMOTE RETRY          = " << c_retry << std::endl;
+}
+
+}} // end namespaces
@@ -0,0 +1,119 @@
+//////////////////////////////////////////////////////////////////////////
+// File : pibus_checkpoint.h
+// This program is released under the GNU Public License
+// Copyright : UPMC-LIP6
+//////////////////////////////////////////////////////////////////////////
+// This file defines the checkpoint facility of the PIBUS platforms :
+// the PibusCheckpoint object saves the complete state of a platform
+// in a file at a cycle boundary, or restores this state in a platform
+// built with the same parameters, to skip the simulation of the
+// boot sequence and the cache warm-up.
+//
+// The checkpoint file contains a versioned header (magic string,
+// version number, images alignment, cycle index), followed by named sections, that
+// are checked when the file is restored :
+// - "registers" : the current value of all sc_register, in creation
+//   order (see the register list in pibus_mnemonics.h),
+// - "signals" : the current value of all sc_signal (except the
+//   clocks), in the SystemC objects hierarchy order,
+// - one section per PibusCheckpointable component, containing the
+//   state that is not stored in registers (memory segments, caches,
+//   FIFOs, processor registers, local buffers).
+//
+// The same checkpoint() method of a component is used to save and
+// to restore its state :
+// - state() copies a component variable to the file (saving), or
+//   from the file to the component variable (restoring).
+// - check() saves a structural parameter, or checks that the
+//   restored platform has the same value.
+// - image() is used for the large memory images : the image is
+//   aligned on a page boundary of the saving host in the file (the 
+//   alignment is stored in the header), and the method returns a pointer
+//   on the image in the file (restoring), that replaces the component
+//   buffer. This pointer must not be remapped by the component.
+// When restoring, the whole file is mapped in memory (private mapping,
+// pages copied only when written) : the memory images are not copied,
+// and the restore cost is proportional to the registers and caches
+// state. The mapping is kept until the end of the simulation when
+// an image is used.
+//
+// The checkpoint must be saved between two clock cycles (between two
+// sc_start() calls), and restored after the reset cycle. The restored
+// signals are updated by the next sc_start() call.
+// The instrumentation counters are not saved : the statistics start
+// at the restored cycle. The checkpoint is not available when the
+// registers are implemented as sc_signal (PIBUS_SC_SIGNAL_REGISTERS).
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PIBUS_CHECKPOINT_H
+#define PIBUS_CHECKPOINT_H
+
+#include <systemc>
+#include <stdio.h>
+#include <inttypes.h>
+#include <vector>
+#include "pibus_mnemonics.h"
+
+#define PIBUS_CKPT_MAGIC	"PIBUSCKP"
+#define PIBUS_CKPT_VERSION	2
+#define PIBUS_CKPT_MIN_ALIGN	4096	// minimal memory images alignment (bytes)
+#define PIBUS_CKPT_NAME		32	// section name length (bytes)
+
+namespace soclib { namespace common {
+
+class PibusCheckpoint;
+
+/////////////////////////////////////////////////////////////////
+// This interface is implemented by the components that have a
+// state that is not stored in sc_register : the checkpoint()
+// method saves or restores this state (see ckpt.saving()).
+/////////////////////////////////////////////////////////////////
+class PibusCheckpointable {
+public:
+    virtual void checkpoint(PibusCheckpoint& ckpt) = 0;
+    virtual ~PibusCheckpointable() {}
+};
+
+/////////////////////////////////////////////////////////////////
+class PibusCheckpoint {
+
+    const char*		m_path;			// checkpoint file path name
+    const bool		m_save;			// saving when true / restoring when false
+    uint64_t		m_cycle;		// checkpoint cycle
+    FILE*		m_file;			// output file (saving)
+    uint8_t*		m_base;			// mapped file (restoring)
+    size_t		m_size;			// mapped file size (restoring)
+    size_t		m_ptr;			// current offset in the file
+    size_t		m_images;		// number of images used in place
+    uint32_t		m_align;		// memory images alignment (bytes)
+
+    void write(const void* data, size_t size);
+    const void* read(size_t size);
+    void align();
+    void error(const char* message, const char* name);
+    template<typename T> bool signal(sc_core::sc_object* obj);
+
+public:
+
+    PibusCheckpoint(const char* path, bool save, uint64_t cycle = 0);
+    ~PibusCheckpoint();
+
+    inline bool saving() const { return m_save; }
+    inline uint64_t cycle() const { return m_cycle; }
+
+    void section(const char* name);
+    void state(void* data, size_t size);
+    template<typename T> inline void value(T& v) { state(&v, sizeof(T)); }
+    void values(std::vector<uint32_t>& v);
+    void check(uint64_t value, const char* name);
+    void* image(void* data, size_t size);
+
+    void registers();
+    void signals();
+    void platform(std::vector<PibusCheckpointable*>& components);
+
+}; // end class PibusCheckpoint
+
+}} // end namespaces
+
+#endif
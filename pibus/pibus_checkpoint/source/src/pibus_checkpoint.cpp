@@ -0,0 +1,294 @@
+////////////////////////////////////////////////////////////////////////////
+// File  : pibus_checkpoint.cpp
+// Copyright  UPMC - LIP6
+// This program is released under the GNU public license
+///////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "pibus_checkpoint.h"
+
+namespace soclib { namespace common {
+
+///////////////////////////////////////////////////////////////////////////
+// This function builds the list of all SystemC objects (depth first).
+///////////////////////////////////////////////////////////////////////////
+static void collect(const std::vector<sc_core::sc_object*>& objects,
+                    std::vector<sc_core::sc_object*>& list)
+{
+    for ( size_t i = 0 ; i < objects.size() ; i++ )
+    {
+        list.push_back( objects[i] );
+        collect( objects[i]->get_child_objects(), list );
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+PibusCheckpoint::PibusCheckpoint(const char*	path,
+                                 bool		save,
+                                 uint64_t	cycle)
+    : m_path(path),
+      m_save(save),
+      m_cycle(cycle),
+      m_file(NULL),
+      m_base(NULL),
+      m_size(0),
+      m_ptr(0),
+      m_images(0),
+      m_align(0)
+{
+    char 	magic[8];
+    uint32_t	version = PIBUS_CKPT_VERSION;
+
+    if ( m_save )
+    {
+        // the images are aligned on the host page size
+        m_align = sysconf(_SC_PAGESIZE);
+        if ( m_align < PIBUS_CKPT_MIN_ALIGN ) m_align = PIBUS_CKPT_MIN_ALIGN;
+        m_file = fopen(path, "wb");
+        if ( m_file == NULL ) error("Cannot create the checkpoint file ", path);
+        memcpy(magic, PIBUS_CKPT_MAGIC, 8);
+        write(magic, 8);
+        write(&version, 4);
+        write(&m_align, 4);
+        write(&m_cycle, 8);
+    }
+    else
+    {
+        int fd = open(path, O_RDONLY);
+        if ( fd < 0 ) error("Cannot open the checkpoint file ", path);
+        struct stat st;
+        if ( fstat(fd, &st) != 0 ) error("Cannot read the checkpoint file ", path);
+        m_size = st.st_size;
+        if ( m_size < 24 ) error("Illegal checkpoint file ", path);
+        // private mapping : the mapped pages are copied only when written
+        void* base = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if ( base == MAP_FAILED ) error("Cannot map the checkpoint file ", path);
+        m_base = (uint8_t*)base;
+        memcpy(magic, read(8), 8);
+        memcpy(&version, read(4), 4);
+        memcpy(&m_align, read(4), 4);
+        memcpy(&m_cycle, read(8), 8);
+        if ( memcmp(magic, PIBUS_CKPT_MAGIC, 8) != 0 ) error("Illegal checkpoint file ", path);
+        if ( version != PIBUS_CKPT_VERSION ) error("Unsupported checkpoint version in ", path);
+        if ( (m_align == 0) || ((m_align & (m_align - 1)) != 0) ) 
+            error("Illegal images alignment in ", path);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+// The mapping is kept when a memory image is used by a component.
+////////////////////////////////////////////////////////////////////
+PibusCheckpoint::~PibusCheckpoint()
+{
+    if ( m_file ) fclose(m_file);
+    if ( m_base and (m_images == 0) ) munmap(m_base, m_size);
+}
+
+////////////////////////////////////////////////////////////////////
+void PibusCheckpoint::error(const char* message, const char* name)
+{
+    std::cout << "ERROR in PibusCheckpoint" << std::endl;
+    std::cout << message << name << std::endl;
+    exit(1);
+}
+
+////////////////////////////////////////////////////////////////////
+void PibusCheckpoint::write(const void* data, size_t size)
+{
+    if ( fwrite(data, 1, size, m_file) != size ) error("Cannot write the checkpoint file ", m_path);
+    m_ptr = m_ptr + size;
+}
+
+////////////////////////////////////////////////////////////////////
+// returns a pointer on the next size bytes of the mapped file
+////////////////////////////////////////////////////////////////////
+const void* PibusCheckpoint::read(size_t size)
+{
+    if ( m_ptr + size > m_size ) error("Truncated checkpoint file ", m_path);
+    const void* data = m_base + m_ptr;
+    m_ptr = m_ptr + size;
+    return data;
+}
+
+////////////////////////////////////////////////////////////////////
+void PibusCheckpoint::align()
+{
+    size_t pad = (m_align - (m_ptr % m_align)) % m_align;
+    if ( m_save )
+    {
+        char zero[PIBUS_CKPT_MIN_ALIGN];
+        memset(zero, 0, PIBUS_CKPT_MIN_ALIGN);
+        while ( pad > PIBUS_CKPT_MIN_ALIGN ) 
+        {
+            write(zero, PIBUS_CKPT_MIN_ALIGN);
+            pad = pad - PIBUS_CKPT_MIN_ALIGN;
+        }
+        write(zero, pad);
+    }
+    else
+    {
+        read(pad);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+// A section starts with its name, that is checked when restoring.
+////////////////////////////////////////////////////////////////////
+void PibusCheckpoint::section(const char* name)
+{
+    char buf[PIBUS_CKPT_NAME];
+    memset(buf, 0, PIBUS_CKPT_NAME);
+    strncpy(buf, name, PIBUS_CKPT_NAME - 1);
+    if ( m_save )
+    {
+        write(buf, PIBUS_CKPT_NAME);
+    }
+    else if ( memcmp(buf, read(PIBUS_CKPT_NAME), PIBUS_CKPT_NAME) != 0 )
+    {
+        error("The checkpoint doesn't match the platform : section ", name);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+void PibusCheckpoint::state(void* data, size_t size)
+{
+    if ( m_save ) write(data, size);
+    else          memcpy(data, read(size), size);
+}
+
+////////////////////////////////////////////////////////////////////
+void PibusCheckpoint::values(std::vector<uint32_t>& v)
+{
+    uint64_t n = v.size();
+    value( n );
+    if ( !m_save ) v.resize( n );
+    if ( n ) state( &v[0], n * sizeof(uint32_t) );
+}
+
+////////////////////////////////////////////////////////////////////
+void PibusCheckpoint::check(uint64_t value, const char* name)
+{
+    uint64_t v = value;
+    state( &v, sizeof(uint64_t) );
+    if ( v != value ) error("The checkpoint doesn't match the platform : ", name);
+}
+
+////////////////////////////////////////////////////////////////////
+// The image is aligned in the file. When restoring, it returns
+// a pointer on the mapped image, to be used in place (the page
+// alignment of the saving host is kept in memory, as the file is
+// mapped at a page boundary).
+////////////////////////////////////////////////////////////////////
+void* PibusCheckpoint::image(void* data, size_t size)
+{
+    check( size, "memory image size" );
+    align();
+    if ( m_save )
+    {
+        write(data, size);
+        return data;
+    }
+    m_images++;
+    return (void*)read(size);
+}
+
+////////////////////////////////////////////////////////////////////
+// The registers are identified by their index in the register list.
+////////////////////////////////////////////////////////////////////
+void PibusCheckpoint::registers()
+{
+#ifdef PIBUS_SC_SIGNAL_REGISTERS
+    error("The checkpoint is not supported with ", "PIBUS_SC_SIGNAL_REGISTERS");
+#else
+    std::vector<PibusRegisterBase*>& list = PibusRegisterBase::list();
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+    for ( size_t i = 0 ; i < list.size() ; i++ )
+    {
+        if ( list[i] == NULL ) continue;
+        count++;
+        bytes = bytes + list[i]->stateSize();
+    }
+
+    section("registers");
+    check( count, "number of registers" );
+    check( bytes, "size of registers" );
+    for ( size_t i = 0 ; i < list.size() ; i++ )
+    {
+        if ( list[i] == NULL ) continue;
+        size_t size = list[i]->stateSize();
+        if ( m_save )
+        {
+            uint64_t buf[2];
+            list[i]->saveState(buf);
+            write(buf, size);
+        }
+        else
+        {
+            list[i]->loadState( read(size) );
+        }
+    }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+// saves (or restores) the signal value if the object is a T signal
+////////////////////////////////////////////////////////////////////
+template<typename T>
+bool PibusCheckpoint::signal(sc_core::sc_object* obj)
+{
+    sc_core::sc_signal_inout_if<T>* sig = dynamic_cast<sc_core::sc_signal_inout_if<T>*>(obj);
+    if ( sig == NULL ) return false;
+    T v = sig->read();
+    state( &v, sizeof(T) );
+    if ( !m_save ) sig->write( v );
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////
+// The signals (bool, int, uint32_t and uint64_t) are identified
+// by their index in the objects hierarchy. The clocks are skipped.
+////////////////////////////////////////////////////////////////////
+void PibusCheckpoint::signals()
+{
+    std::vector<sc_core::sc_object*> objects;
+    std::vector<sc_core::sc_object*> list;
+    collect( sc_core::sc_get_top_level_objects(), objects );
+    for ( size_t i = 0 ; i < objects.size() ; i++ )
+    {
+        sc_core::sc_object* obj = objects[i];
+        if ( dynamic_cast<sc_core::sc_clock*>(obj) ) continue;
+        if ( dynamic_cast<sc_core::sc_signal_inout_if<bool>*>(obj) or
+             dynamic_cast<sc_core::sc_signal_inout_if<int>*>(obj) or
+             dynamic_cast<sc_core::sc_signal_inout_if<uint32_t>*>(obj) or
+             dynamic_cast<sc_core::sc_signal_inout_if<uint64_t>*>(obj) ) list.push_back(obj);
+    }
+
+    section("signals");
+    check( list.size(), "number of signals" );
+    for ( size_t i = 0 ; i < list.size() ; i++ )
+    {
+        signal<bool>(list[i]) or
+        signal<int>(list[i]) or
+        signal<uint32_t>(list[i]) or
+        signal<uint64_t>(list[i]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+// saves (or restores) the complete platform state
+////////////////////////////////////////////////////////////////////
+void PibusCheckpoint::platform(std::vector<PibusCheckpointable*>& components)
+{
+    registers();
+    signals();
+    for ( size_t i = 0 ; i < components.size() ; i++ ) components[i]->checkpoint( *this );
+    section("end");
+}
+
+}} // end namespaces
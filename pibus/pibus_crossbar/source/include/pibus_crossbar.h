@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////
+// File  : pibus_crossbar.h
+// Copyright  UPMC - LIP6
+// This program is released under the GNU public license
+///////////////////////////////////////////////////////////////////////////
+// This component is a multi-layer PIBUS interconnect (crossbar), that
+// can replace the PibusSegBcu controller and the shared PIBUS signals :
+// each master and each target is connected to a dedicated set of PIBUS
+// signals (REQ, GNT, A, READ, OPC, LOCK, D, ACK, TOUT for a master,
+// SEL, A, READ, OPC, D, ACK, TOUT for a target).
+// It contains one arbiter per target (round-robin policy), so that
+// several transactions between disjoint (master, target) pairs can be
+// simultaneously running.
+//
+// As the PIBUS masters send the address after the bus grant, the
+// crossbar grants a master as soon as its own port is free. The target
+// is decoded in the address cycle, using the target table built from
+// the segment table (as the PibusSegBcu):
+// - if the target is free and the arbiter selects this master, the
+//   address is transmitted to the target in the same cycle, and the
+//   transaction runs without additional latency.
+// - otherwise, the first address (with the READ, OPC and LOCK values)
+//   is registered in the master port, and the WAIT acknowledge is
+//   returned to the master until the target arbiter selects it.
+//   The registered address is then sent to the target, and the
+//   following cycles are transmitted without modification.
+// The master port FSM has 5 states (IDLE, AD, WAIT, DTAD, DT), the
+// AD, DTAD and DT states having the same meaning as in the PibusSegBcu.
+// The time-out is handled per master port.
+//
+// A component that is both a master and a target (such as the DMA or
+// the block device) uses the same signals for both roles : it must be
+// declared with the setMasterTarget() method. The master port is not
+// granted when the corresponding target port is allocated, and the
+// target port is not selected when the master port is not idle.
+//
+// The crossbar does not broadcast the write transactions : the snoop
+// mechanism of the caches is not supported, and the p_avalid input
+// of the caches must be tied to false.
+//
+// The COUNT_REQ[i] register counts the total number of transaction
+// requests for master i. The COUNT_WAIT[i] register counts the total
+// number of wait cycles for master i (waiting the master port grant,
+// or the target arbiter selection). The COUNT_BUSY[t] register counts
+// the number of cycles where the target t is allocated.
+//////////////////////////////////////////////////////////////////////////
+// This component has 5 "constructor" parameters :
+// - sc_module_name	name		: instance name
+// - pibusSegmentTable	segtab		: segment table
+// - int 		nb_master       : number of PIBUS masters
+// - int 		nb_target       : number of PIBUS targets
+// - int 		time_out	: max wait cycles (default = 100)
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PIBUS_CROSSBAR_H_
+#define PIBUS_CROSSBAR_H_
+
+#include <systemc>
+#include <inttypes.h>
+#include "pibus_segment_table.h"
+#include "pibus_mnemonics.h"
+
+
+namespace soclib { namespace caba {
+
+////////////////////////////////////////
+class PibusCrossbar : sc_core::sc_module {
+
+	// 	MASTER PORT FSM states
+	enum fms_state_e
+        {
+	FSM_IDLE	= 0,
+	FSM_AD		= 1,
+	FSM_WAIT	= 2,
+	FSM_DTAD	= 3,
+	FSM_DT		= 4,
+	};
+
+	//	STRUCTURAL PARAMETERS
+        const char*			m_name;			// instance name
+	const size_t* 			m_target_table;		// MSB to tgtid trancoding ROM
+	const size_t 			m_msb_shift;		// 32 - MSB_bits_number
+	const size_t 			m_nb_master;		// number of connected masters
+	const size_t 			m_nb_target;		// number of connected targets
+	const uint32_t 			m_time_out;		// number of cycles before time-out
+	size_t*				m_master_target;	// target port sharing the master signals
+	size_t*				m_target_master;	// master port sharing the target signals
+        char				m_fsm_str[5][20];	// FSM states names
+
+	// 	REGISTERS (master ports)
+	sc_register<int>* 		r_fsm_state;		// FSM state
+	sc_register<size_t>*		r_target;		// selected target index
+	sc_register<uint32_t>*		r_addr;			// registered first address
+	sc_register<bool>*		r_read;			// registered READ value
+	sc_register<uint32_t>*		r_opc;			// registered OPC value
+	sc_register<bool>*		r_lock;			// registered LOCK value
+	sc_register<uint32_t>*		r_tout_counter;		// time-out counter
+	sc_register<uint32_t>*		r_req_counter;		// number of requests
+	sc_register<uint32_t>*		r_wait_counter;		// number of wait cycles
+
+	// 	REGISTERS (target ports)
+	sc_register<size_t>*		r_owner;		// allocated master (nb_master if free)
+	sc_register<size_t>*		r_last;			// last selected master (round-robin)
+	sc_register<uint32_t>*		r_busy_counter;		// number of busy cycles
+
+	// 	METHODS (combinational functions of the registers and inputs)
+	size_t decode(size_t master);
+	bool targetFree(size_t target);
+	size_t arbitrate(size_t target);
+	bool grant(size_t master);
+
+protected:
+
+	SC_HAS_PROCESS(PibusCrossbar);
+
+public:
+
+	//	I/O PORTS
+	sc_core::sc_in<bool>  		p_ck;
+	sc_core::sc_in<bool>  		p_resetn;
+
+	// master ports
+	sc_core::sc_in<bool>*		p_req;
+	sc_core::sc_out<bool>*		p_gnt;
+	sc_core::sc_in<uint32_t>*	p_m_a;
+	sc_core::sc_in<bool>*		p_m_read;
+	sc_core::sc_in<uint32_t>*	p_m_opc;
+	sc_core::sc_in<bool>*		p_m_lock;
+	sc_core::sc_inout<uint32_t>*	p_m_d;
+	sc_core::sc_out<uint32_t>*	p_m_ack;
+	sc_core::sc_out<bool>*		p_m_tout;
+
+	// target ports
+	sc_core::sc_out<bool>*		p_sel;
+	sc_core::sc_out<uint32_t>*	p_t_a;
+	sc_core::sc_out<bool>*		p_t_read;
+	sc_core::sc_out<uint32_t>*	p_t_opc;
+	sc_core::sc_inout<uint32_t>*	p_t_d;
+	sc_core::sc_in<uint32_t>*	p_t_ack;
+	sc_core::sc_out<bool>*		p_t_tout;
+
+	//	CONSTRUCTOR
+	PibusCrossbar (sc_core::sc_module_name 			name,
+	               soclib::common::PibusSegmentTable       	&segtab,
+		       size_t					nb_master,
+		       size_t					nb_target,
+		       uint32_t					time_out = 100);
+	~PibusCrossbar();
+
+	// 	METHODS
+	void transition();
+	void genMealy();
+	void setMasterTarget(size_t master, size_t target);
+        void printTrace();
+        void printStatistics();
+
+}; // end class PibusCrossbar
+
+}} // end namespaces
+
+#endif
@@ -0,0 +1,461 @@
+////////////////////////////////////////////////////////////////////////////
+// File  : pibus_crossbar.cpp
+// Copyright  UPMC - LIP6
+// This program is released under the GNU public license
+///////////////////////////////////////////////////////////////////////////
+
+#include "pibus_crossbar.h"
+#include "alloc_elems.h"
+
+namespace soclib { namespace caba {
+
+using namespace sc_core;
+using namespace soclib::caba;
+using namespace soclib::common;
+
+//////////////////////////////////////////////////////
+PibusCrossbar::PibusCrossbar (	sc_module_name 			name,
+                            	PibusSegmentTable 	    	&segtab,
+                            	size_t 				nb_master,
+                            	size_t 				nb_target,
+                            	uint32_t 			time_out)
+	: m_name(name),
+      m_target_table(segtab.getTargetTable()),
+      m_msb_shift( 32 - segtab.getMSBnumber() ),
+      m_nb_master(nb_master),
+      m_nb_target(nb_target),
+      m_time_out(time_out),
+      r_fsm_state(alloc_elems<sc_register<int> >("r_fsm_state", nb_master)),
+      r_target(alloc_elems<sc_register<size_t> >("r_target", nb_master)),
+      r_addr(alloc_elems<sc_register<uint32_t> >("r_addr", nb_master)),
+      r_read(alloc_elems<sc_register<bool> >("r_read", nb_master)),
+      r_opc(alloc_elems<sc_register<uint32_t> >("r_opc", nb_master)),
+      r_lock(alloc_elems<sc_register<bool> >("r_lock", nb_master)),
+      r_tout_counter(alloc_elems<sc_register<uint32_t> >("r_tout_counter", nb_master)),
+      r_req_counter(alloc_elems<sc_register<uint32_t> >("r_req_counter", nb_master)),
+      r_wait_counter(alloc_elems<sc_register<uint32_t> >("r_wait_counter", nb_master)),
+      r_owner(alloc_elems<sc_register<size_t> >("r_owner", nb_target)),
+      r_last(alloc_elems<sc_register<size_t> >("r_last", nb_target)),
+      r_busy_counter(alloc_elems<sc_register<uint32_t> >("r_busy_counter", nb_target)),
+      p_ck("p_ck"),
+      p_resetn("p_resetn"),
+      p_req(alloc_elems<sc_in<bool> >("p_req", nb_master)),
+      p_gnt(alloc_elems<sc_out<bool> >("p_gnt", nb_master)),
+      p_m_a(alloc_elems<sc_in<uint32_t> >("p_m_a", nb_master)),
+      p_m_read(alloc_elems<sc_in<bool> >("p_m_read", nb_master)),
+      p_m_opc(alloc_elems<sc_in<uint32_t> >("p_m_opc", nb_master)),
+      p_m_lock(alloc_elems<sc_in<bool> >("p_m_lock", nb_master)),
+      p_m_d(alloc_elems<sc_inout<uint32_t> >("p_m_d", nb_master)),
+      p_m_ack(alloc_elems<sc_out<uint32_t> >("p_m_ack", nb_master)),
+      p_m_tout(alloc_elems<sc_out<bool> >("p_m_tout", nb_master)),
+      p_sel(alloc_elems<sc_out<bool> >("p_sel", nb_target)),
+      p_t_a(alloc_elems<sc_out<uint32_t> >("p_t_a", nb_target)),
+      p_t_read(alloc_elems<sc_out<bool> >("p_t_read", nb_target)),
+      p_t_opc(alloc_elems<sc_out<uint32_t> >("p_t_opc", nb_target)),
+      p_t_d(alloc_elems<sc_inout<uint32_t> >("p_t_d", nb_target)),
+      p_t_ack(alloc_elems<sc_in<uint32_t> >("p_t_ack", nb_target)),
+      p_t_tout(alloc_elems<sc_out<bool> >("p_t_tout", nb_target))
+{
+	SC_METHOD(transition);
+	sensitive << p_ck.pos();
+
+	SC_METHOD(genMealy);
+	sensitive << p_ck.neg();
+	for (size_t i = 0 ; i < m_nb_master ; i++)
+        sensitive << p_req[i] << p_m_a[i] << p_m_read[i] << p_m_opc[i] << p_m_d[i];
+	for (size_t t = 0 ; t < m_nb_target ; t++)
+        sensitive << p_t_ack[t] << p_t_d[t];
+
+    strcpy(m_fsm_str[0], "IDLE");
+    strcpy(m_fsm_str[1], "AD");
+    strcpy(m_fsm_str[2], "WAIT");
+    strcpy(m_fsm_str[3], "DTAD");
+    strcpy(m_fsm_str[4], "DT");
+
+	if (!segtab.isAllBelow( m_nb_target ))
+    {
+	    std::cout << "ERROR in PibusCrossbar Component" << std::endl;
+        std::cout << "Target index larger than the number of targets" << std::endl;
+        exit(0);
+    }
+
+	if (time_out == 0)
+    {
+	    std::cout << "ERROR in PibusCrossbar Component" << std::endl;
+        std::cout << "Time_out argument cannot be 0" << std::endl;
+        exit(0);
+    }
+
+    m_master_target = new size_t[nb_master];
+    m_target_master = new size_t[nb_target];
+    for (size_t i = 0 ; i < m_nb_master ; i++) m_master_target[i] = m_nb_target;
+    for (size_t t = 0 ; t < m_nb_target ; t++) m_target_master[t] = m_nb_master;
+
+    std::cout << std::endl << "Instanciation of PibusCrossbar : " << m_name << std::endl;
+    std::cout << "    nb_master = " << m_nb_master << std::endl;
+    std::cout << "    nb_target = " << m_nb_target << std::endl;
+    std::cout << "    time_out  = " << m_time_out  << std::endl;
+}
+
+PibusCrossbar::~PibusCrossbar()
+{
+    dealloc_elems(r_fsm_state, m_nb_master);
+    dealloc_elems(r_target, m_nb_master);
+    dealloc_elems(r_addr, m_nb_master);
+    dealloc_elems(r_read, m_nb_master);
+    dealloc_elems(r_opc, m_nb_master);
+    dealloc_elems(r_lock, m_nb_master);
+    dealloc_elems(r_tout_counter, m_nb_master);
+    dealloc_elems(r_req_counter, m_nb_master);
+    dealloc_elems(r_wait_counter, m_nb_master);
+    dealloc_elems(r_owner, m_nb_target);
+    dealloc_elems(r_last, m_nb_target);
+    dealloc_elems(r_busy_counter, m_nb_target);
+    dealloc_elems(p_req, m_nb_master);
+    dealloc_elems(p_gnt, m_nb_master);
+    dealloc_elems(p_m_a, m_nb_master);
+    dealloc_elems(p_m_read, m_nb_master);
+    dealloc_elems(p_m_opc, m_nb_master);
+    dealloc_elems(p_m_lock, m_nb_master);
+    dealloc_elems(p_m_d, m_nb_master);
+    dealloc_elems(p_m_ack, m_nb_master);
+    dealloc_elems(p_m_tout, m_nb_master);
+    dealloc_elems(p_sel, m_nb_target);
+    dealloc_elems(p_t_a, m_nb_target);
+    dealloc_elems(p_t_read, m_nb_target);
+    dealloc_elems(p_t_opc, m_nb_target);
+    dealloc_elems(p_t_d, m_nb_target);
+    dealloc_elems(p_t_ack, m_nb_target);
+    dealloc_elems(p_t_tout, m_nb_target);
+    delete [] m_master_target;
+    delete [] m_target_master;
+}
+
+////////////////////////////////////////////////////////////////////
+// This method declares that a component is connected to the master
+// port and to the target port with the same PIBUS signals.
+////////////////////////////////////////////////////////////////////
+void PibusCrossbar::setMasterTarget(size_t master, size_t target)
+{
+    if ( (master >= m_nb_master) or (target >= m_nb_target) )
+    {
+	    std::cout << "ERROR in PibusCrossbar Component" << std::endl;
+        std::cout << "Illegal master or target index in setMasterTarget()" << std::endl;
+        exit(0);
+    }
+    m_master_target[master] = target;
+    m_target_master[target] = master;
+}
+
+////////////////////////////////////////////////////////////////////
+// returns the target index of the transaction of a master port :
+// decoded from the address in the AD state, registered otherwise.
+////////////////////////////////////////////////////////////////////
+size_t PibusCrossbar::decode(size_t master)
+{
+    if ( r_fsm_state[master] == FSM_AD ) return m_target_table[p_m_a[master].read() >> m_msb_shift];
+    else                                 return r_target[master].read();
+}
+
+////////////////////////////////////////////////////////////////////
+// A target is free when it is not allocated, and when the master
+// port sharing the same signals (if any) is idle.
+////////////////////////////////////////////////////////////////////
+bool PibusCrossbar::targetFree(size_t target)
+{
+    size_t master = m_target_master[target];
+    return ( (r_owner[target].read() == m_nb_master) and
+             ((master == m_nb_master) or (r_fsm_state[master] == FSM_IDLE)) );
+}
+
+////////////////////////////////////////////////////////////////////
+// Round-robin arbiter of a target, between the master ports in AD
+// or WAIT state targeting it. It returns m_nb_master if no master
+// port is selected.
+////////////////////////////////////////////////////////////////////
+size_t PibusCrossbar::arbitrate(size_t target)
+{
+    if ( !targetFree( target ) ) return m_nb_master;
+    for (size_t i = 0 ; i < m_nb_master ; i++)
+    {
+        size_t j = (i + 1 + r_last[target].read()) % m_nb_master;
+        if ( ((r_fsm_state[j] == FSM_AD) or (r_fsm_state[j] == FSM_WAIT)) and
+             (decode(j) == target) ) return j;
+    }
+    return m_nb_master;
+}
+
+////////////////////////////////////////////////////////////////////
+// A master port is granted in the IDLE state, and in the last cycle
+// of a transaction (DT state, or DTAD state for a transaction aborted
+// by a RETRY acknowledge), when it is not used by a target sharing 
+// the same signals.
+////////////////////////////////////////////////////////////////////
+bool PibusCrossbar::grant(size_t master)
+{
+    if ( p_req[master] == false ) return false;
+    if ( r_fsm_state[master] != FSM_IDLE ) 
+    {
+        if ( r_tout_counter[master] == 0 ) return false;
+        uint32_t ack = p_t_ack[r_target[master].read()].read();
+        if ( (r_fsm_state[master] == FSM_DT) and (ack == PIBUS_ACK_WAIT) ) return false;
+        if ( (r_fsm_state[master] == FSM_DTAD) and (ack != PIBUS_ACK_RETRY) ) return false;
+        if ( (r_fsm_state[master] != FSM_DT) and (r_fsm_state[master] != FSM_DTAD) ) return false;
+    }
+    size_t target = m_master_target[master];
+    if ( target == m_nb_target ) return true;
+    return ( (r_owner[target].read() == m_nb_master) and (arbitrate(target) == m_nb_master) );
+}
+
+//////////////////////////////
+void PibusCrossbar::transition()
+{
+    if (p_resetn == false)
+    {
+        for(size_t i = 0 ; i < m_nb_master ; i++)
+        {
+            r_fsm_state[i] = FSM_IDLE;
+            r_wait_counter[i] = 0;
+            r_req_counter[i] = 0;
+        }
+        for(size_t t = 0 ; t < m_nb_target ; t++)
+        {
+            r_owner[t] = m_nb_master;
+            r_last[t] = 0;
+            r_busy_counter[t] = 0;
+        }
+        return;
+    } // end p_resetn
+
+    for(size_t i = 0 ; i < m_nb_master ; i++)
+    {
+        if( p_req[i] or (r_fsm_state[i] == FSM_WAIT) ) r_wait_counter[i] = r_wait_counter[i] + 1;
+    }
+    for(size_t t = 0 ; t < m_nb_target ; t++)
+    {
+        if( r_owner[t].read() != m_nb_master ) r_busy_counter[t] = r_busy_counter[t] + 1;
+    }
+
+    for(size_t i = 0 ; i < m_nb_master ; i++)
+    {
+        switch(r_fsm_state[i]) {
+        case FSM_IDLE:
+        {
+            r_tout_counter[i] = m_time_out;
+            if ( grant(i) )
+            {
+                r_req_counter[i] = r_req_counter[i] + 1;
+                r_fsm_state[i] = FSM_AD;
+            }
+            break;
+        }
+        case FSM_AD:
+        {
+            size_t target = decode(i);
+            r_target[i] = target;
+            r_addr[i]   = p_m_a[i].read();
+            r_read[i]   = p_m_read[i].read();
+            r_opc[i]    = p_m_opc[i].read();
+            r_lock[i]   = p_m_lock[i].read();
+            if ( arbitrate(target) == i )
+            {
+                r_owner[target] = i;
+                r_last[target]  = i;
+                if(p_m_lock[i]) r_fsm_state[i] = FSM_DTAD;
+                else            r_fsm_state[i] = FSM_DT;
+            }
+            else
+            {
+                r_fsm_state[i] = FSM_WAIT;
+            }
+            break;
+        }
+        case FSM_WAIT:
+        {
+            size_t target = r_target[i].read();
+            if ( arbitrate(target) == i )
+            {
+                r_owner[target] = i;
+                r_last[target]  = i;
+                if(r_lock[i]) r_fsm_state[i] = FSM_DTAD;
+                else          r_fsm_state[i] = FSM_DT;
+            }
+            break;
+        }
+        case FSM_DTAD:
+        {
+            size_t target = r_target[i].read();
+            if (r_tout_counter[i] == 0)
+            {
+                r_owner[target] = m_nb_master;
+                r_fsm_state[i] = FSM_IDLE;
+            }
+            else if ( p_t_ack[target].read() == PIBUS_ACK_RETRY )  // aborted transaction
+            {
+                r_owner[target] = m_nb_master;
+                r_tout_counter[i] = m_time_out;
+                if ( grant(i) )
+                {
+                    r_req_counter[i] = r_req_counter[i] + 1;
+                    r_fsm_state[i] = FSM_AD;
+                }
+                else
+                {
+                    r_fsm_state[i] = FSM_IDLE;
+                }
+            }
+            else if ( (p_t_ack[target].read() != PIBUS_ACK_WAIT) and (p_m_lock[i] == false) )
+            {
+                r_fsm_state[i] = FSM_DT;
+            }
+            else
+            {
+                r_tout_counter[i] = r_tout_counter[i] - 1;
+            }
+            break;
+        }
+        case FSM_DT:
+        {
+            size_t target = r_target[i].read();
+            if(r_tout_counter[i] == 0)
+            {
+                r_owner[target] = m_nb_master;
+                r_fsm_state[i] = FSM_IDLE;
+            }
+            else if(p_t_ack[target].read() != PIBUS_ACK_WAIT)  // new allocation
+            {
+                r_owner[target] = m_nb_master;
+                r_tout_counter[i] = m_time_out;
+                if ( grant(i) )
+                {
+                    r_req_counter[i] = r_req_counter[i] + 1;
+                    r_fsm_state[i] = FSM_AD;
+                }
+                else
+                {
+                    r_fsm_state[i] = FSM_IDLE;
+                }
+            }
+            else
+            {
+                r_tout_counter[i] = r_tout_counter[i] - 1;
+            }
+            break;
+        }
+        } // end switch FSM
+    }
+} // end transition
+
+////////////////////////////////////////////////////////////////////
+// The target signals are written only when the target is selected
+// or allocated, and the master ACK, D and TOUT signals are not
+// written when the master port signals are used by a target.
+////////////////////////////////////////////////////////////////////
+void PibusCrossbar::genMealy()
+{
+    // master ports : grant
+    for(size_t i = 0 ; i < m_nb_master ; i++) p_gnt[i] = grant(i);
+
+    // target ports : address, write data & time-out
+    for(size_t t = 0 ; t < m_nb_target ; t++)
+    {
+        size_t	owner  = r_owner[t].read();
+        size_t	winner = arbitrate(t);
+        bool	dual   = (m_target_master[t] != m_nb_master);
+
+        if ( winner != m_nb_master )				// AD cycle on target
+        {
+            p_sel[t] = true;
+            if ( r_fsm_state[winner] == FSM_AD )
+            {
+                p_t_a[t]    = p_m_a[winner].read();
+                p_t_read[t] = p_m_read[winner].read();
+                p_t_opc[t]  = p_m_opc[winner].read();
+            }
+            else						// registered address
+            {
+                p_t_a[t]    = r_addr[winner].read();
+                p_t_read[t] = r_read[winner].read();
+                p_t_opc[t]  = r_opc[winner].read();
+            }
+            p_t_tout[t] = false;
+        }
+        else if ( owner != m_nb_master )			// allocated target
+        {
+            p_sel[t] = (r_fsm_state[owner] == FSM_DTAD);
+            if ( r_fsm_state[owner] == FSM_DTAD )
+            {
+                p_t_a[t]    = p_m_a[owner].read();
+                p_t_read[t] = p_m_read[owner].read();
+                p_t_opc[t]  = p_m_opc[owner].read();
+            }
+            if ( r_read[owner] == false ) p_t_d[t] = p_m_d[owner].read();
+            p_t_tout[t] = (r_tout_counter[owner] == 0);
+        }
+        else
+        {
+            p_sel[t] = false;
+            if ( !dual ) p_t_tout[t] = false;
+        }
+    }
+
+    // master ports : acknowledge, read data & time-out
+    for(size_t i = 0 ; i < m_nb_master ; i++)
+    {
+        size_t target = m_master_target[i];
+        if ( (target != m_nb_target) and (r_owner[target].read() != m_nb_master) ) continue;
+
+        if ( (r_fsm_state[i] == FSM_DTAD) or (r_fsm_state[i] == FSM_DT) )
+        {
+            p_m_ack[i] = p_t_ack[r_target[i].read()].read();
+            if ( r_read[i] ) p_m_d[i] = p_t_d[r_target[i].read()].read();
+            p_m_tout[i] = (r_tout_counter[i] == 0);
+        }
+        else
+        {
+            p_m_ack[i] = PIBUS_ACK_WAIT;
+            p_m_tout[i] = false;
+        }
+    }
+} // end genMealy()
+
+//////////////////////////////
+void PibusCrossbar::printTrace()
+{
+    std::cout << m_name << " :" << std::dec;
+    for(size_t i = 0 ; i < m_nb_master ; i++)
+    {
+        std::cout << " | m" << i << " " << m_fsm_str[r_fsm_state[i]];
+        if ( r_fsm_state[i] != FSM_IDLE ) std::cout << " t" << decode(i);
+    }
+    std::cout << std::endl;
+}
+
+///////////////////////////////////
+void PibusCrossbar::printStatistics()
+{
+    std::cout << m_name << " : Statistics" << std::endl;
+    for(size_t i = 0 ; i < m_nb_master ; i++)
+    {
+        size_t req  = r_req_counter[i].read();
+        size_t wait = r_wait_counter[i].read();
+        std::cout << "master " << i << " : n_req = " << req << " , n_wait_cycles = " << wait
+                  << " , access time = " <<  (float)wait/(float)req << std::endl;
+    }
+    for(size_t t = 0 ; t < m_nb_target ; t++)
+    {
+        std::cout << "target " << t << " : n_busy_cycles = " << r_busy_counter[t].read() << std::endl;
+    }
+}
+
+}} // end namespaces
+
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
@@ -39,13 +39,31 @@
 // (states SUCCESS, READ_ERROR, WRITE_ERROR). The IRQ is not asserted
 // if the IRQ_DISABLED register contains a non-zero value.
 // Writing in the RESET register is the normal way to acknowledge IRQ.
-// The initiator FSM uses an internal buffer to store a burst.
+//
+// The initiator FSM uses PIBUS bursts (WD2/WD4/WD8/WD16/WD32 OPC) :
+// a burst of n words is used when the address is aligned on n words,
+// with n no larger than the burst argument and the remaining length.
+// The unaligned edges of the source and destination buffers are
+// transfered with single word (or shorter bursts) transactions.
+// The initiator FSM uses an internal circular buffer of 2 * burst
+// words (double buffering) : the read bursts are issued as long as
+// the buffer can store them, and the write bursts are issued when the
+// buffer contains them. The read burst of block n+1 is issued while
+// the block n waits to be written, and the source and destination
+// bursts are independant (different alignments).
+// The bus is requested after the last data cycle of each transaction
+// (the request is not raised during the data cycles, that can be
+// answered WAIT or ERROR).
+// The DMA implements the PibusIdleSkip interface : it is idle when it 
+// waits the bus, a data acknowledge, or a software command.
+// The DMA implements the PibusCheckpointable interface : the internal
+// buffer is saved with the registers.
 ///////////////////////////////////////////////////////////////////////////
 // This component has 4 "constructor" parameters :
 // - sc_module_name 	name	: instance name
 // - unsigned int	tgtid	: target index
 // - PibusSegmentTable 	segtab	: segment table
-// - unsigned int	burst	: max number of words per burst
+// - unsigned int	burst	: max number of words per burst (no larger than 32 on the bus)
 ////////////////////////////////////////////////////////////////////////////
 
 #ifndef PIBUS_DMA_H
@@ -54,10 +72,13 @@
 #include <systemc.h>
 #include "pibus_mnemonics.h"
 #include "pibus_segment_table.h"
+#include "pibus_checkpoint.h"
 
 namespace soclib { namespace caba {
 
-class PibusDma : sc_module {
+class PibusDma : sc_module, 
+                 public soclib::common::PibusIdleSkip,
+                 public soclib::common::PibusCheckpointable {
 
     // REGISTERS
     sc_register<int>      	r_target_fsm;		// target fsm state register
@@ -71,14 +92,18 @@ class PibusDma : sc_module {
     sc_register<uint32_t>	r_write_ptr;		// pointer on the write buffer
     sc_register<uint32_t>	r_index;		// pointer on the local buffer
     sc_register<uint32_t>	r_max;			// max number of words in a burst
-    sc_register<uint32_t>	r_count;		// number of words to be transfered
+    sc_register<uint32_t>	r_count;		// number of words to be written
+    sc_register<uint32_t>	r_read_count;		// number of words to be read
+    sc_register<uint32_t>	r_read_slot;		// first buffer slot of the read burst
+    sc_register<uint32_t>	r_write_slot;		// first buffer slot of the write burst
    
-    uint32_t*			m_buf;			// local buffer
+    uint32_t*			m_buf;			// local buffer (2 * burst words)
 
     // STRUCTURAL PARAMETERS
     const char*			m_name;			// instance name
     const uint32_t		m_tgtid;		// target index
     const uint32_t		m_burst;		// burst max number of words
+    const uint32_t		m_size;			// local buffer size (words)
     uint32_t			m_segbase;		// segment base address
     uint32_t			m_segsize;		// segment size
     const char*			m_segname;		// segment name
@@ -129,6 +154,10 @@ protected:
 
     SC_HAS_PROCESS(PibusDma);
 
+    uint32_t burstLength(uint32_t address, uint32_t nwords);
+    int schedule(uint32_t read_ptr, uint32_t read_count, 
+                 uint32_t write_ptr, uint32_t write_count, uint32_t* length);
+
 public:
 
     // IO PORTS
@@ -150,6 +179,9 @@ public:
     void transition();
     void genMoore();
     void printTrace();
+    uint32_t idleCycles();
+    void skipCycles(uint32_t ncycles);
+    void checkpoint(soclib::common::PibusCheckpoint& ckpt);
 
     // Constructor   
     PibusDma(sc_module_name			name, 
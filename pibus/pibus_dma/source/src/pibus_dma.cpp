@@ -13,6 +13,60 @@ namespace soclib { namespace caba {
     using namespace soclib::caba;
     using namespace soclib::common;
     
+    //////////////////////////////////////////
+    inline uint32_t nwords2opc(uint32_t nwords)
+    {
+        switch(nwords) {
+        case 2  : return PIBUS_OPC_WD2;
+        case 4  : return PIBUS_OPC_WD4;
+        case 8  : return PIBUS_OPC_WD8;
+        case 16 : return PIBUS_OPC_WD16;
+        case 32 : return PIBUS_OPC_WD32;
+        default : return PIBUS_OPC_WDU;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////
+    // returns the length of the burst starting at address : the
+    // largest power of 2 (no larger than 32, the burst parameter, and
+    // nwords) such that the address is aligned on the burst length.
+    ///////////////////////////////////////////////////////////////////
+    uint32_t PibusDma::burstLength(uint32_t address, uint32_t nwords)
+    {
+        uint32_t length = 1;
+        while( (length < 32) && ((length << 1) <= m_burst) && ((length << 1) <= nwords) &&
+               ((address & ((length << 3) - 1)) == 0) ) length = length << 1;
+        return length;
+    }
+
+    ///////////////////////////////////////////////////////////////////
+    // returns the next master FSM state (READ_REQ, WRITE_REQ or
+    // SUCCESS), and the length of the next burst : a read burst is
+    // selected if the local buffer can store it, a write burst
+    // otherwise. As the bursts are no larger than m_burst, and the
+    // buffer contains 2 * m_burst words, the buffer contains the
+    // next write burst when the next read burst cannot be stored.
+    ///////////////////////////////////////////////////////////////////
+    int PibusDma::schedule(uint32_t	read_ptr,
+                           uint32_t	read_count,
+                           uint32_t	write_ptr,
+                           uint32_t	write_count,
+                           uint32_t*	length)
+    {
+        if(write_count == 0) return DMA_SUCCESS;
+        if(read_count != 0)
+        {
+            uint32_t nwords = burstLength(read_ptr, read_count);
+            if(write_count - read_count + nwords <= m_size)
+            {
+                *length = nwords;
+                return DMA_READ_REQ;
+            }
+        }
+        *length = burstLength(write_ptr, write_count);
+        return DMA_WRITE_REQ;
+    }
+
     ///////////////////////////
     void PibusDma::transition()
     {
@@ -106,7 +160,10 @@ namespace soclib { namespace caba {
         } // end switch target fsm
         
         // The master FSM controls the following registers :
-        // r_master_fsm, r_read_ptr, r_write_ptr, r_index, r_count
+        // r_master_fsm, r_read_ptr, r_write_ptr, r_index, r_max, r_count,
+        // r_read_count, r_read_slot, r_write_slot, and the local buffer.
+        // The next transaction (read or write burst) is selected by the
+        // schedule() method at the end of each transaction.
         // Soft Reset : After each burst (read or write), the master FSM
         // test the r_stop flip-flop to stop the ongoing transfer if requested.
         // It goes to the DMA_SUCCESS state when the tranfer is isuccessfully
@@ -118,13 +175,16 @@ namespace soclib { namespace caba {
             case DMA_IDLE :
                 if (r_stop == false)
                 {
-                    r_master_fsm = DMA_READ_REQ;
+                    uint32_t length = 0;
+                    r_master_fsm = schedule(r_source, r_nwords, r_dest, r_nwords, &length);
+                    r_max        = length;
                     r_read_ptr   = r_source;
                     r_write_ptr  = r_dest;
+                    r_read_count = r_nwords;
                     r_count      = r_nwords;
+                    r_read_slot  = 0;
+                    r_write_slot = 0;
                     r_index      = 0;
-                    if(r_nwords < m_burst)  	r_max  = r_nwords;
-                    else 			r_max  = m_burst;
                 }
                 break;
             case DMA_READ_REQ :
@@ -132,17 +192,21 @@ namespace soclib { namespace caba {
                 break;
             case DMA_READ_AD :
                 r_index    	= r_index + 1;
-                r_count    	= r_count - 1;
                 r_read_ptr 	= r_read_ptr + 4;
                 if(r_index == r_max-1)		r_master_fsm = DMA_READ_DT;
                 else				r_master_fsm = DMA_READ_DTAD;
                 break;
             case DMA_READ_DTAD :
-                if(p_ack.read() == PIBUS_ACK_READY)
+                if(p_ack.read() == PIBUS_ACK_RETRY)	// split transaction : restart
                 {
-                    m_buf[r_index] = (uint32_t)p_d.read();
+                    r_read_ptr   = r_read_ptr - (r_index << 2);
+                    r_index      = 0;
+                    r_master_fsm = DMA_READ_REQ;
+                }
+                else if(p_ack.read() == PIBUS_ACK_READY)
+                {
+                    m_buf[(r_read_slot + r_index - 1) % m_size] = (uint32_t)p_d.read();
                     r_index 	= r_index + 1;
-                    r_count 	= r_count - 1;
                     r_read_ptr 	= r_read_ptr + 4;
                     if(r_index == r_max-1)	r_master_fsm = DMA_READ_DT;
                 }
@@ -152,12 +216,23 @@ namespace soclib { namespace caba {
                 }
                 break;
             case DMA_READ_DT :
-                if(p_ack.read() == PIBUS_ACK_READY)
+                if(p_ack.read() == PIBUS_ACK_RETRY)	// split transaction : restart
                 {
-                    m_buf[r_index] = (uint32_t)p_d.read();
+                    r_read_ptr   = r_read_ptr - (r_index << 2);
                     r_index      = 0;
-                    if(r_stop == true) 	r_master_fsm = DMA_IDLE;
-                    else  		r_master_fsm = DMA_WRITE_REQ;
+                    r_master_fsm = DMA_READ_REQ;
+                }
+                else if(p_ack.read() == PIBUS_ACK_READY)
+                {
+                    uint32_t length = 0;
+                    int      next   = schedule(r_read_ptr, r_read_count - r_max, r_write_ptr, r_count, &length);
+                    m_buf[(r_read_slot + r_index - 1) % m_size] = (uint32_t)p_d.read();
+                    r_read_slot  = (r_read_slot + r_max) % m_size;
+                    r_read_count = r_read_count - r_max;
+                    r_max        = length;
+                    r_index      = 0;
+                    if(r_stop == true) 		r_master_fsm = DMA_IDLE;
+                    else			r_master_fsm = next;
                 }
                 else if(p_ack.read() == PIBUS_ACK_ERROR)
                 {
@@ -174,7 +249,13 @@ namespace soclib { namespace caba {
                 else				r_master_fsm = DMA_WRITE_DTAD;
                 break;
             case DMA_WRITE_DTAD :
-                if(p_ack.read() == PIBUS_ACK_READY)
+                if(p_ack.read() == PIBUS_ACK_RETRY)	// split transaction : restart
+                {
+                    r_write_ptr  = r_write_ptr - (r_index << 2);
+                    r_index      = 0;
+                    r_master_fsm = DMA_WRITE_REQ;
+                }
+                else if(p_ack.read() == PIBUS_ACK_READY)
                 {
                     r_index = r_index + 1;
                     r_write_ptr = r_write_ptr + 4;
@@ -186,19 +267,24 @@ namespace soclib { namespace caba {
                 }
                 break;
             case DMA_WRITE_DT :
-                if(p_ack.read() == PIBUS_ACK_READY)
+                if(p_ack.read() == PIBUS_ACK_RETRY)	// split transaction : restart
                 {
-                    r_index = 0;
+                    r_write_ptr  = r_write_ptr - (r_index << 2);
+                    r_index      = 0;
+                    r_master_fsm = DMA_WRITE_REQ;
+                }
+                else if(p_ack.read() == PIBUS_ACK_READY)
+                {
+                    uint32_t length = 0;
+                    int      next   = schedule(r_read_ptr, r_read_count, r_write_ptr, r_count - r_max, &length);
+                    r_write_slot = (r_write_slot + r_max) % m_size;
+                    r_count      = r_count - r_max;
+                    r_max        = length;
+                    r_index      = 0;
                     if(r_stop == true)  	r_master_fsm = DMA_IDLE;
-                    else if(r_count == 0)	r_master_fsm = DMA_SUCCESS;
-                    else
-                    {
-                        if(r_count < m_burst)  	r_max = r_count;
-                        else			r_max = m_burst;
-                        r_master_fsm = DMA_READ_REQ;
-                    }
+                    else			r_master_fsm = next;
                 }
-                if(p_ack.read() == PIBUS_ACK_ERROR)
+                else if(p_ack.read() == PIBUS_ACK_ERROR)
                 {
                     r_master_fsm = DMA_WRITE_ERROR;
                 }
@@ -252,7 +338,7 @@ namespace soclib { namespace caba {
         if((r_master_fsm == DMA_READ_AD) || (r_master_fsm == DMA_READ_DTAD))
         {
             p_a   = (uint32_t)r_read_ptr;
-            p_opc = PIBUS_OPC_WDU;
+            p_opc = nwords2opc(r_max);
             p_read = true;
             if(r_index == r_max-1) 	p_lock = false;
             else			p_lock = true;
@@ -260,14 +346,15 @@ namespace soclib { namespace caba {
         if((r_master_fsm == DMA_WRITE_AD) || (r_master_fsm == DMA_WRITE_DTAD))
         {
             p_a   = (uint32_t)r_write_ptr;
-            p_opc = PIBUS_OPC_WDU;
+            p_opc = nwords2opc(r_max);
             p_read = false;
             if(r_index == r_max-1) 	p_lock = false;
             else			p_lock = true;
         }
         
         // p_d signal
-        if((r_master_fsm == DMA_WRITE_DTAD) || (r_master_fsm == DMA_WRITE_DT)) p_d = (uint32_t)m_buf[r_index];
+        if((r_master_fsm == DMA_WRITE_DTAD) || (r_master_fsm == DMA_WRITE_DT)) 
+            p_d = (uint32_t)m_buf[(r_write_slot + r_index - 1) % m_size];
         
         // IRQ signal
         if(((r_master_fsm == DMA_SUCCESS)     ||
@@ -284,6 +371,7 @@ namespace soclib { namespace caba {
     : m_name(name),
     m_tgtid(tgtid),
     m_burst(burst),
+    m_size(2*burst),
     p_ck("p_ck"),
     p_resetn("p_resetn"),
     p_req("p_req"),
@@ -336,7 +424,7 @@ namespace soclib { namespace caba {
             exit(1);
         }
         
-        m_buf = new uint32_t[m_burst];
+        m_buf = new uint32_t[m_size];
         
         // get segment base address and segment size
         std::list<SegmentTableEntry> seglist = segtab.getTargetSegmentList(tgtid);
@@ -374,6 +462,52 @@ namespace soclib { namespace caba {
         << " / r_dest = " << std::hex << r_dest.read()
         << " / wcount = " << std::dec << r_count.read() << std::endl;
     }
+
+    ///////////////////////////////////////////////////////////////////
+    // idle cycles : the DMA is idle when the target FSM is not 
+    // selected, and the master FSM is waiting the bus grant, a data 
+    // acknowledge, or a new value of the r_stop register.
+    // As it contains no counter, it is idle for ever.
+    ///////////////////////////////////////////////////////////////////
+    uint32_t PibusDma::idleCycles()
+    {
+        if((r_target_fsm != TGT_IDLE) || p_sel.read()) return 0;
+
+        switch(r_master_fsm) {
+            case DMA_IDLE :
+                if(r_stop == true) return PIBUS_IDLE_FOREVER;
+                break;
+            case DMA_READ_REQ :
+            case DMA_WRITE_REQ :
+                if(p_gnt.read() == false) return PIBUS_IDLE_FOREVER;
+                break;
+            case DMA_READ_DTAD :
+            case DMA_READ_DT :
+            case DMA_WRITE_DTAD :
+            case DMA_WRITE_DT :
+                if(p_ack.read() == PIBUS_ACK_WAIT) return PIBUS_IDLE_FOREVER;
+                break;
+            case DMA_SUCCESS :
+            case DMA_READ_ERROR :
+            case DMA_WRITE_ERROR :
+                if(r_stop == false) return PIBUS_IDLE_FOREVER;
+                break;
+        }
+        return 0;
+    }
+
+    ////////////////////////////////////////////
+    void PibusDma::skipCycles(uint32_t ncycles)
+    {
+    }
+
+    ////////////////////////////////////////////
+    void PibusDma::checkpoint(soclib::common::PibusCheckpoint& ckpt)
+    {
+        ckpt.section(m_name);
+        ckpt.check(m_burst, "DMA burst length");
+        ckpt.state(m_buf, m_size*4);
+    }
     
     
 }} // end namespace
@@ -0,0 +1,188 @@
+//////////////////////////////////////////////////////////////////////////
+// File : pibus_dram.h
+// This program is released under the GNU Public License
+// Copyright : UPMC-LIP6
+//////////////////////////////////////////////////////////////////////////
+// This component is a multi-segment DRAM with PIBUS interface. The
+// segments are implemented by a PibusMemoryImage, as in the
+// PibusSimpleRam (see pibus_memory_image.h), but
+// the access latency depends on the state of the DRAM banks :
+// The memory is split in nbanks banks, and each bank contains one row
+// buffer of row_size bytes. The consecutive rows of the address space
+// are interleaved on the banks :
+// - bank = (address / row_size) % nbanks
+// - row  = address / (row_size * nbanks)
+// The number of wait cycles for the first word of a transaction is :
+// - row hit (the row is open in the bank)         : t_cas
+// - row miss (no open row in the bank)            : t_rcd + t_cas
+// - row conflict (another row is open in the bank) : t_rp + t_rcd + t_cas
+// The next words of a burst in the same row are transfered every
+// t_burst cycles. A burst crossing a row boundary is charged as a new
+// row access (hit, miss or conflict).
+// With the open page policy (open_page = true), the row stays open
+// after the transaction. With the close page policy, the rows are
+// closed at the end of each transaction (the precharge is hidden) :
+// each transaction starts with a row miss.
+// When t_refi is not 0, all banks are refreshed every t_refi cycles :
+// all rows are closed, and the DRAM is not available during t_rfc
+// cycles. A refresh is never started during a transaction : it is
+// delayed to the end of the transaction.
+// In case of burst, all addresses must be in the same segment, and it
+// is forbidden to mix read and write accesses in a single burst.
+// The memory content can be accessed through the PibusFunctionalMemory
+// interface (fast-forward mode).
+// The DRAM counts the row hits, misses and conflicts and the wait
+// cycles for each master : the master index is obtained from the GNT
+// signals of the BCU (the master granted in the cycle preceding the
+// address cycle). When nb_master is 0, the GNT ports are not created,
+// and all transactions are counted for the same master.
+// These statistics are displayed by the printStatistics() method.
+// The DRAM implements the PibusIdleSkip interface (it is idle when it
+// is not selected, and during the wait cycles, until the next refresh),
+// and the PibusCheckpointable interface (as the PibusSimpleRam).
+/////////////////////////////////////////////////////////////////////////
+// This component has 14 "generator" parameters
+// - sc_module_name		name      : instance name
+// - unsigned int  		index     : target index
+// - pibusSegmentTable		segmap    : segment table
+// - soclib::common::Loader	loader    : loader
+// - unsigned int		nb_master : number of observed masters (0 : none)
+// - unsigned int		nbanks    : number of banks (default = 8)
+// - unsigned int		row_size  : row buffer size in bytes (default = 2048)
+// - unsigned int		t_rcd     : activate latency (default = 3)
+// - unsigned int		t_cas     : column access latency (default = 3)
+// - unsigned int		t_rp      : precharge latency (default = 3)
+// - unsigned int		t_burst   : cycles per word in a burst (default = 1)
+// - unsigned int		t_refi    : refresh period (default = 1560, 0 : no refresh)
+// - unsigned int		t_rfc     : refresh duration (default = 26)
+// - bool			open_page : row buffer policy (default = true)
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef PIBUS_DRAM_H
+#define PIBUS_DRAM_H
+
+#include <systemc>
+#include <stdio.h>
+#include "pibus_segment_table.h"
+#include "pibus_mnemonics.h"
+#include "pibus_checkpoint.h"
+#include "pibus_memory_image.h"
+#include "loader.h"
+
+namespace soclib { namespace caba {
+
+class PibusDram : sc_core::sc_module,
+                  public soclib::common::PibusFunctionalMemory,
+                  public soclib::common::PibusIdleSkip,
+                  public soclib::common::PibusCheckpointable {
+
+   //  REGISTERS
+    sc_register<int>		r_fsm_state;		// FSM state
+    sc_register<uint32_t>	r_counter;		// wait cycles counter
+    sc_register<size_t>		r_index;		// selected segment index
+    sc_register<uint32_t>	r_address;		// PIBUS address
+    sc_register<int>		r_opc;			// PIBUS codop
+    sc_register<size_t>		r_master;		// last granted master
+    sc_register<size_t>		r_owner;		// current transaction master
+    sc_register<bool>*		r_bank_open;		// open row (per bank)
+    sc_register<uint32_t>*	r_bank_row;		// open row index (per bank)
+    sc_register<uint32_t>	r_refresh;		// cycles before the next refresh
+    sc_register<uint32_t>	r_busy;			// remaining refresh cycles
+
+    //  STRUCTURAL PARAMETERS
+    const char*			m_name;			// instance name
+    const uint32_t    	 	m_tgtid;		// target index
+    soclib::common::PibusMemoryImage m_mem;		// segments
+    const size_t		m_nb_master;		// number of observed masters
+    const size_t		m_nb_stat;		// number of statistics entries
+    const uint32_t		m_nbanks;		// number of banks
+    const uint32_t		m_row_size;		// row buffer size (bytes)
+    const uint32_t		m_t_rcd;		// activate latency
+    const uint32_t		m_t_cas;		// column access latency
+    const uint32_t		m_t_rp;			// precharge latency
+    const uint32_t		m_t_burst;		// cycles per word in a burst
+    const uint32_t		m_t_refi;		// refresh period
+    const uint32_t		m_t_rfc;		// refresh duration
+    const bool			m_open_page;		// open page policy
+    char			m_fsm_str[6][20];	// FSM states names
+    uint32_t			m_skip;			// skipped idle cycles
+
+    //  INSTRUMENTATION COUNTERS
+    uint32_t*			c_hit;			// row hits (per master)
+    uint32_t*			c_miss;			// row misses (per master)
+    uint32_t*			c_conflict;		// row conflicts (per master)
+    uint32_t*			c_wait;			// wait cycles (per master)
+    uint32_t			c_refresh;		// number of refreshes
+
+    // FSM states
+    enum {
+	FSM_IDLE	= 0,
+	FSM_READ_WAIT	= 1,
+	FSM_READ_OK	= 2,
+	FSM_WRITE_WAIT	= 3,
+	FSM_WRITE_OK	= 4,
+	FSM_ERROR	= 5,
+    };
+
+    //  METHODS
+    void decode(bool refresh, uint32_t busy);
+    uint32_t access(uint32_t address, size_t master, bool first, bool refresh);
+    void next(uint32_t latency, bool read);
+
+protected:
+
+    SC_HAS_PROCESS(PibusDram);
+
+public:
+
+    // IO PORTS
+    sc_core::sc_in<bool> 		p_ck;
+    sc_core::sc_in<bool> 		p_resetn;
+    sc_core::sc_in<bool>		p_sel;
+    sc_core::sc_in<uint32_t>		p_a;
+    sc_core::sc_in<bool>		p_read;
+    sc_core::sc_in<uint32_t>		p_opc;
+    sc_core::sc_out<uint32_t>		p_ack;
+    sc_core::sc_inout<uint32_t>		p_d;
+    sc_core::sc_in<bool>		p_tout;
+    sc_core::sc_in<bool>*		p_gnt;		// observed GNT signals (nb_master)
+
+    // constructor
+    PibusDram (sc_core::sc_module_name			name,
+	       uint32_t	         			tgtid,
+	       soclib::common::PibusSegmentTable	&segtab,
+               const soclib::common::Loader  		&loader,
+	       size_t					nb_master,
+	       uint32_t					nbanks = 8,
+	       uint32_t					row_size = 2048,
+	       uint32_t					t_rcd = 3,
+	       uint32_t					t_cas = 3,
+	       uint32_t					t_rp = 3,
+	       uint32_t					t_burst = 1,
+	       uint32_t					t_refi = 1560,
+	       uint32_t					t_rfc = 26,
+	       bool					open_page = true );
+    ~PibusDram();
+
+    // methods
+    void transition();
+    void genMoore();
+    void printTrace();
+    void printStatistics();
+
+    // functional access
+    bool functionalRead(uint32_t address, uint32_t* data);
+    bool functionalWrite(uint32_t address, uint32_t data, uint32_t be);
+
+    // idle cycles skipping
+    uint32_t idleCycles();
+    void skipCycles(uint32_t ncycles);
+
+    // checkpoint
+    void checkpoint(soclib::common::PibusCheckpoint& ckpt);
+
+};  // end class PibusDram
+
+}} // end name spaces
+
+#endif
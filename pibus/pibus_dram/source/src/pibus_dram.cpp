@@ -0,0 +1,406 @@
+///////////////////////////////////////////////////////////
+// File : pibus_dram.cpp
+// This program is released under the GNU Public License
+// Copyright : UPMC-LIP6
+///////////////////////////////////////////////////////////
+
+#include "pibus_dram.h"
+#include "alloc_elems.h"
+
+namespace soclib { namespace caba {
+
+using namespace sc_core;
+using namespace soclib::caba;
+using namespace soclib::common;
+
+////////////////////////////////////////////////////////////
+PibusDram::PibusDram (sc_module_name	 	name,
+		      uint32_t			tgtid,
+		      PibusSegmentTable		&segtab,
+		      const Loader  		&loader,
+		      size_t			nb_master,
+		      uint32_t			nbanks,
+		      uint32_t			row_size,
+		      uint32_t			t_rcd,
+		      uint32_t			t_cas,
+		      uint32_t			t_rp,
+		      uint32_t			t_burst,
+		      uint32_t			t_refi,
+		      uint32_t			t_rfc,
+		      bool			open_page)
+    : m_name(name),
+      m_tgtid(tgtid),
+      m_mem("PibusDram", name, segtab, tgtid, loader),
+      m_nb_master(nb_master),
+      m_nb_stat(nb_master ? nb_master : 1),
+      m_nbanks(nbanks),
+      m_row_size(row_size),
+      m_t_rcd(t_rcd),
+      m_t_cas(t_cas),
+      m_t_rp(t_rp),
+      m_t_burst(t_burst),
+      m_t_refi(t_refi),
+      m_t_rfc(t_rfc),
+      m_open_page(open_page),
+      m_skip(0),
+      p_ck("p_ck"),
+      p_resetn("p_resetn"),
+      p_sel("p_sel"),
+      p_a("p_a"),
+      p_read("p_read"),
+      p_opc("p_opc"),
+      p_ack("p_ack"),
+      p_d("p_d"),
+      p_tout("p_tout"),
+      p_gnt(nb_master ? soclib::common::alloc_elems<sc_in<bool> >("p_gnt", nb_master) : NULL)
+{
+    SC_METHOD (transition);
+    sensitive_pos << p_ck;
+
+    SC_METHOD (genMoore);
+    sensitive_neg << p_ck;
+
+    if ( (nbanks == 0) || (row_size < 4) || ((row_size & 0x3) != 0) || (t_burst == 0) )
+    {
+	printf("ERROR in component PibusDram %s\n", m_name);
+	printf("The number of banks and the burst cycles must be at least 1,\n");
+	printf("and the row size must be a non zero multiple of 4\n");
+	exit(1);
+    }
+
+    // registers & counters allocation
+    r_bank_open	= new sc_register<bool>[nbanks];
+    r_bank_row	= new sc_register<uint32_t>[nbanks];
+    c_hit	= new uint32_t[m_nb_stat];
+    c_miss	= new uint32_t[m_nb_stat];
+    c_conflict	= new uint32_t[m_nb_stat];
+    c_wait	= new uint32_t[m_nb_stat];
+
+    strcpy(m_fsm_str[0], "IDLE");
+    strcpy(m_fsm_str[1], "READ_WAIT");
+    strcpy(m_fsm_str[2], "READ_OK");
+    strcpy(m_fsm_str[3], "WRITE_WAIT");
+    strcpy(m_fsm_str[4], "WRITE_OK");
+    strcpy(m_fsm_str[5], "ERROR");
+
+    std::cout << std::endl << "Instanciation of PibusDram : " << m_name << std::endl;
+    std::cout << "    banks = " << nbanks << " / row size = " << row_size
+              << " / " << (open_page ? "open" : "close") << " page policy" << std::endl;
+    std::cout << "    t_rcd = " << t_rcd << " / t_cas = " << t_cas << " / t_rp = " << t_rp
+              << " / t_burst = " << t_burst << std::endl;
+    if ( t_refi ) std::cout << "    t_refi = " << t_refi << " / t_rfc = " << t_rfc << std::endl;
+    for(uint32_t i = 0 ; i < m_mem.segments() ; i++)
+ 	std::cout << "    segment " << m_mem.segName(i) << std::hex
+                  << " | base = 0x" << m_mem.base(i)
+                  << " | size = 0x" << m_mem.size(i) << std::dec << std::endl;
+
+} // end constructor
+
+/////////////////////
+PibusDram::~PibusDram()
+{
+    if ( m_nb_master ) soclib::common::dealloc_elems(p_gnt, m_nb_master);
+    delete [] r_bank_open;
+    delete [] r_bank_row;
+    delete [] c_hit;
+    delete [] c_miss;
+    delete [] c_conflict;
+    delete [] c_wait;
+}
+
+//////////////////////////////////////////////////////////////
+// Returns the number of wait cycles for a word access, and
+// updates the banks state and the master counters.
+// - first is true for the first word of a transaction,
+// - refresh is true when a refresh is started before the access.
+// With the close page policy (or after a refresh), all rows are
+// closed at the beginning of a transaction.
+//////////////////////////////////////////////////////////////
+uint32_t PibusDram::access(uint32_t address, size_t master, bool first, bool refresh)
+{
+    uint32_t	bank    = (address / m_row_size) % m_nbanks;
+    uint32_t	row     = address / (m_row_size * m_nbanks);
+    bool	closed  = first && (refresh || !m_open_page);
+    bool	open    = r_bank_open[bank].read() && !closed;
+    uint32_t	latency;
+
+    if ( !first && open && (r_bank_row[bank].read() == row) )	// same row in a burst
+    {
+        c_wait[master] += m_t_burst - 1;
+        return m_t_burst - 1;
+    }
+
+    if ( !open )
+    {
+        latency = m_t_rcd + m_t_cas;
+        c_miss[master]++;
+    }
+    else if ( r_bank_row[bank].read() == row )
+    {
+        latency = m_t_cas;
+        c_hit[master]++;
+    }
+    else
+    {
+        latency = m_t_rp + m_t_rcd + m_t_cas;
+        c_conflict[master]++;
+    }
+    c_wait[master] += latency;
+
+    if ( closed )
+    {
+        for ( size_t b = 0 ; b < m_nbanks ; b++ ) r_bank_open[b] = false;
+    }
+    r_bank_open[bank] = true;
+    r_bank_row[bank]  = row;
+    return latency;
+} // end access()
+
+//////////////////////////////////////////////////////////////
+// next state after a word access
+//////////////////////////////////////////////////////////////
+void PibusDram::next(uint32_t latency, bool read)
+{
+    r_counter = latency;
+    if ( read ) r_fsm_state = latency ? FSM_READ_WAIT : FSM_READ_OK;
+    else        r_fsm_state = latency ? FSM_WRITE_WAIT : FSM_WRITE_OK;
+}
+
+//////////////////////////////////////////////////////////////
+// Decodes the address of a new transaction (the target is selected).
+// A pending refresh is started before the access, and the remaining
+// cycles of the current refresh are added to the latency.
+//////////////////////////////////////////////////////////////
+void PibusDram::decode(bool refresh, uint32_t busy)
+{
+    uint32_t address = ((uint32_t)p_a.read()) & 0xfffffffc;
+    size_t seg = m_mem.segIndex(address);
+    if ( seg == m_mem.segments() )
+    {
+        r_fsm_state = FSM_ERROR;
+        return;
+    }
+
+    size_t	master = r_master.read();
+    uint32_t	extra  = busy;		// refresh cycles
+    if ( refresh )
+    {
+        extra     = extra + m_t_rfc;
+        r_refresh = m_t_refi;
+        c_refresh++;
+    }
+    c_wait[master] += extra;
+
+    r_busy    = 0;
+    r_owner   = master;
+    r_index   = seg;
+    r_address = address;
+    r_opc     = (int) p_opc.read();
+    next( extra + access(address, master, true, refresh), p_read.read() );
+} // end decode()
+
+/////////////////////////////////
+void PibusDram::transition()
+{
+    // skipped idle cycles (see skipCycles())
+    uint32_t skip = m_skip;
+    m_skip = 0;
+
+    if (p_resetn == false)
+    {
+        r_fsm_state = FSM_IDLE;
+        r_master    = 0;
+        r_owner     = 0;
+        r_refresh   = m_t_refi;
+        r_busy      = 0;
+        for ( size_t b = 0 ; b < m_nbanks ; b++ ) r_bank_open[b] = false;
+        m_mem.reset();
+        for ( size_t i = 0 ; i < m_nb_stat ; i++ )
+        {
+            c_hit[i]      = 0;
+            c_miss[i]     = 0;
+            c_conflict[i] = 0;
+            c_wait[i]     = 0;
+        }
+        c_refresh = 0;
+        return;
+    } // end p_resetn
+
+    // granted master : its address cycle is the next cycle
+    for ( size_t i = 0 ; i < m_nb_master ; i++ )
+    {
+        if ( p_gnt[i].read() ) r_master = i;
+    }
+
+    // refresh timer : the refresh is due when r_refresh reaches 0
+    uint32_t refresh = r_refresh.read();
+    uint32_t busy    = r_busy.read();
+    refresh = (refresh > skip + 1) ? refresh - skip - 1 : 0;
+    busy    = (busy > skip + 1) ? busy - skip - 1 : 0;
+    bool due = (m_t_refi != 0) && (refresh == 0);
+    r_refresh = refresh;
+    r_busy    = busy;
+
+    switch (r_fsm_state) {
+    case FSM_IDLE :
+    {
+        if (p_sel == true)
+        {
+            decode(due, busy);
+        }
+        else if ( due )		// refresh : all rows are closed
+        {
+            for ( size_t b = 0 ; b < m_nbanks ; b++ ) r_bank_open[b] = false;
+            r_refresh = m_t_refi;
+            r_busy    = m_t_rfc;
+            c_refresh++;
+        }
+        break;
+    }
+    case FSM_ERROR :
+    {
+	r_fsm_state = FSM_IDLE;
+        break;
+    }
+    case FSM_READ_WAIT :
+    case FSM_WRITE_WAIT :
+    {
+        uint32_t counter = r_counter.read() - skip;
+	r_counter = counter - 1;
+	if(counter == 1)  r_fsm_state = (r_fsm_state.read() == FSM_READ_WAIT) ? FSM_READ_OK : FSM_WRITE_OK;
+        break;
+    }
+    case FSM_READ_OK :
+    case FSM_WRITE_OK :
+    {
+        bool read  = (r_fsm_state.read() == FSM_READ_OK);
+        size_t seg = r_index.read();
+        if ( !read ) m_mem.write(seg, r_address.read(), (uint32_t)p_d.read(), r_opc.read());
+	if (p_sel == true)	// burst
+        {
+            uint32_t address = ((uint32_t)p_a.read()) & 0xfffffffc;
+            if (!m_mem.contains(seg, address) || (p_read.read() != read))
+            {
+                r_fsm_state = FSM_ERROR;
+            }
+            else
+            {
+                r_address = address;
+                next( access(address, r_owner.read(), false, false), read );
+            }
+        }
+        else
+        {
+            r_fsm_state = FSM_IDLE;
+        }
+        break;
+    }
+    } // end switch r_fsm_state
+} // end transition()
+
+///////////////////////////////
+void PibusDram::genMoore()
+{
+    switch(r_fsm_state) {
+    case FSM_IDLE :
+        break;
+    case FSM_ERROR :
+        p_ack = PIBUS_ACK_ERROR;
+        break;
+    case FSM_READ_WAIT :
+        p_ack = PIBUS_ACK_WAIT;
+        p_d = 0;
+        break;
+    case FSM_READ_OK :
+        p_ack = PIBUS_ACK_READY;
+        p_d = m_mem.word(r_index.read(), r_address.read());
+        break;
+    case FSM_WRITE_WAIT :
+        p_ack = PIBUS_ACK_WAIT;
+        break;
+    case FSM_WRITE_OK :
+        p_ack = PIBUS_ACK_READY;
+        break;
+    }
+} // end genMoore()
+
+/////////////////////////////
+void PibusDram::printTrace()
+{
+    std::cout << m_name << " : " << m_fsm_str[r_fsm_state];
+    if ( r_busy.read() ) std::cout << " / refresh";
+    std::cout << std::endl;
+}
+
+//////////////////////////////////
+void PibusDram::printStatistics()
+{
+    std::cout << m_name << " : Statistics (" << (m_open_page ? "open" : "close")
+              << " page policy)" << std::endl;
+    for ( size_t i = 0 ; i < m_nb_stat ; i++ )
+    {
+        uint32_t access = c_hit[i] + c_miss[i] + c_conflict[i];
+        if ( access == 0 ) continue;
+        if ( m_nb_master ) std::cout << "master " << i;
+        else               std::cout << "all masters";
+        std::cout << " : n_row_access = " << access
+                  << " , hit = " << 100.0*c_hit[i]/access << " %"
+                  << " , miss = " << 100.0*c_miss[i]/access << " %"
+                  << " , conflict = " << 100.0*c_conflict[i]/access << " %"
+                  << " , wait cycles / access = " << (float)c_wait[i]/(float)access << std::endl;
+    }
+    std::cout << "n_refresh = " << c_refresh << std::endl;
+}
+
+//////////////////////////////////////////////////////////////////////
+// functional read : returns false if the address is not in a segment
+bool PibusDram::functionalRead(uint32_t address, uint32_t* data)
+{
+    return m_mem.functionalRead(address, data);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// functional write : the be argument defines the written bytes.
+// returns false if the address is not in a segment
+bool PibusDram::functionalWrite(uint32_t address, uint32_t data, uint32_t be)
+{
+    return m_mem.functionalWrite(address, data, be);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// idle cycles : the DRAM is idle when it is not selected, or when it
+// counts the wait cycles. In the IDLE state, a refresh must be started
+// in a simulated cycle.
+uint32_t PibusDram::idleCycles()
+{
+    uint32_t idle;
+    int state = r_fsm_state.read();
+
+    if      ( (state == FSM_IDLE) && !p_sel.read() )	idle = PIBUS_IDLE_FOREVER;
+    else if ( (state == FSM_READ_WAIT) || (state == FSM_WRITE_WAIT) ) idle = r_counter.read() - 1;
+    else						idle = 0;
+
+    if ( m_t_refi && (state == FSM_IDLE) )
+    {
+        uint32_t due = r_refresh.read() ? r_refresh.read() - 1 : 0;
+        if ( due < idle ) idle = due;
+    }
+    return idle;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// skip idle cycles : the counters are updated by the next transition
+void PibusDram::skipCycles(uint32_t ncycles)
+{
+    m_skip = ncycles;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// checkpoint : the segments are saved as memory images
+void PibusDram::checkpoint(PibusCheckpoint& ckpt)
+{
+    ckpt.section(m_name);
+    m_mem.checkpoint(ckpt);
+}
+
+}} // end namespaces
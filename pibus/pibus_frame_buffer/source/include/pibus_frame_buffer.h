@@ -8,8 +8,16 @@
 // This component implements a PIBUS compliant frame buffer.
 // It use the generic SoCLib fb_controler that contains 
 // the buffer itself, and supports both read & write accesses.
+// When the retry argument is true (and the latency is not 0), the
+// frame buffer uses split transactions instead of wait cycles, as
+// the PibusSimpleRam : the first request is registered and answered 
+// RETRY, and it is served without wait cycle when it is restarted.
+// The frame buffer implements the PibusIdleSkip interface : it is idle
+// when it is not selected, and during the latency cycles.
+// The frame buffer implements the PibusCheckpointable interface : the
+// buffer content is copied, as it is shared with the display.
 //////////////////////////////////////////////////////////////////////////
-// This component has 7 constructor parameters
+// This component has 8 constructor parameters
 // - sc_module_name		name    : instance name
 // - unsigned int  		index   : target index      
 // - pibusSegmentTable		segmap  : segment table
@@ -17,6 +25,7 @@
 // - unsigned int		width	: number of pixels per line
 // - unsigned int		height  : number of lines
 // - unsigned int		subsampling : default = 420
+// - bool			retry	: split transactions (default = false)
 //////////////////////////////////////////////////////////////////////////
 
 #ifndef PIBUS_FRAME_BUFFER_H
@@ -26,12 +35,15 @@
 #include <stdio.h>
 #include "pibus_segment_table.h"
 #include "pibus_mnemonics.h"
+#include "pibus_checkpoint.h"
 #include "fb_controller.h"
 #include "process_wrapper.h"
 
 namespace soclib { namespace caba {
 
-class PibusFrameBuffer : sc_core::sc_module {
+class PibusFrameBuffer : sc_core::sc_module, 
+                         public soclib::common::PibusIdleSkip,
+                         public soclib::common::PibusCheckpointable {
 
    //  REGISTERS
     sc_register<int>			r_fsm_state;		// FSM state
@@ -39,16 +51,22 @@ class PibusFrameBuffer : sc_core::sc_module {
     sc_register<uint32_t>		r_display;		// display counter
     sc_register<size_t>			r_word;			// word index in the frame buffer
     sc_register<int>			r_opc;			// PIBUS codop 
+    sc_register<bool>			r_pend_valid;		// registered request (split transaction)
+    sc_register<uint32_t>		r_pend_addr;		// registered request address
+    sc_register<bool>			r_pend_read;		// registered request READ value
+    sc_register<uint32_t>		r_pend_counter;		// cycles since the request registration
 
     //  STRUCTURAL PARAMETERS
     const char*				m_name;			// instance name
     const uint32_t			m_tgtid;		// target index
     const uint32_t			m_latency;		// intrinsic latency
+    const bool				m_retry;		// split transactions activated
     uint32_t				m_segbase;		// segment base address
     uint32_t				m_segsize;   		// segment size
     const char*				m_segname;		// segment name
     soclib::common::FbController        m_fb_controller;	// generic controller
-    char				m_fsm_str[6][20];	// FSM states names
+    char				m_fsm_str[7][20];	// FSM states names
+    uint32_t				m_skip;			// skipped idle cycles
 
     // FSM states
     enum {
@@ -57,7 +75,8 @@ class PibusFrameBuffer : sc_core::sc_module {
 	FSM_READ_OK	= 2,
 	FSM_WRITE_WAIT	= 3,
 	FSM_WRITE_OK	= 4,
-	FSM_ERROR	= 5
+	FSM_ERROR	= 5,
+	FSM_RETRY	= 6
     };
 
 protected:
@@ -84,12 +103,20 @@ public:
 		uint32_t				latency, 		// access latency
 		uint32_t				width, 			// frame width
 		uint32_t				height, 		// frame height
-		int					subsampling = 420); 	// pixel format
+		int					subsampling = 420, 	// pixel format
+		bool					retry = false);		// split transactions
     // methods
     void transition();
     void genMoore();
     void printTrace();
 
+    // idle cycles skipping
+    uint32_t idleCycles();
+    void skipCycles(uint32_t ncycles);
+
+    // checkpoint
+    void checkpoint(soclib::common::PibusCheckpoint& ckpt);
+
 #ifdef SOCVIEW
     void registerDebug( SocviewDebugger db );
 #endif
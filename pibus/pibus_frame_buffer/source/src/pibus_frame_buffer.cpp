@@ -21,11 +21,14 @@ PibusFrameBuffer::PibusFrameBuffer (sc_module_name	name,
 				uint32_t		latency,
 				uint32_t		width,
 				uint32_t		height,
-				int			subsampling)
+				int			subsampling,
+				bool			retry)
     : m_name(name),
       m_tgtid(tgtid),
       m_latency(latency),
+      m_retry(retry),
       m_fb_controller((const char*)name, width, height, subsampling),
+      m_skip(0),
       p_ck("p_ck"),
       p_resetn("p_resetn"),
       p_sel("p_sel"),
@@ -67,9 +70,11 @@ PibusFrameBuffer::PibusFrameBuffer (sc_module_name	name,
     strcpy(m_fsm_str[3], "WRITE_WAIT");
     strcpy(m_fsm_str[4], "WRITE_OK");
     strcpy(m_fsm_str[5], "ERROR");
+    strcpy(m_fsm_str[6], "RETRY");
 
     std::cout << std::endl << "Instanciation of PibusFrameBuffer : " << m_name << std::endl;
     std::cout << "    latency = " << latency << std::endl;
+    if ( retry ) std::cout << "    split transactions" << std::endl;
     std::cout << "    segment " << m_segname << std::hex
               << " | base = 0x" << m_segbase
               << " | size = 0x" << m_segsize << std::endl;
@@ -101,6 +106,11 @@ void write_buf(uint32_t* buf, size_t index, uint32_t data, uint32_t opc)
 	buf[index] = (buf[index] & 0x0000FFFF) | (data & 0xFFFF0000);
         break;
     case PIBUS_OPC_WDU :  // write word
+    case PIBUS_OPC_WD2 :  // write burst 
+    case PIBUS_OPC_WD4 :
+    case PIBUS_OPC_WD8 :
+    case PIBUS_OPC_WD16 :
+    case PIBUS_OPC_WD32 :
 	buf[index] = data;
         break;
     case PIBUS_OPC_NOP :  // no write  
@@ -110,6 +120,7 @@ void write_buf(uint32_t* buf, size_t index, uint32_t data, uint32_t opc)
 	printf("illegal value of the PIBUS OPC field for a WRITE : %0x\n", opc);
 	printf("the supported values are : BY0/BY1/BY2/BY3\n");
 	printf("                           HW0/HW1/WDU/NOP\n");
+	printf("                           WD2/WD4/WD8/WD16/WD32\n");
 	exit(1);
 	break;
     } // end switch 
@@ -118,13 +129,27 @@ void write_buf(uint32_t* buf, size_t index, uint32_t data, uint32_t opc)
 /////////////////////////////////
 void PibusFrameBuffer::transition()
 {
+    // skipped idle cycles (see skipCycles())
+    uint32_t skip = m_skip;
+    m_skip = 0;
+
     if (p_resetn == false) 
     {
         r_fsm_state = FSM_IDLE;
         r_display = 0;
+        r_pend_valid = false;
         return;
     } // end p_resetn
 
+    // registered request (split transaction) : the latency is counted
+    // in parallel with the other transactions
+    if ( r_pend_valid.read() )
+    {
+        uint32_t pend = r_pend_counter.read() + skip;
+        if ( pend == m_latency + PIBUS_RETRY_EXPIRE ) r_pend_valid   = false;
+        else                                         r_pend_counter = pend + 1;
+    }
+
     switch (r_fsm_state) {
     case FSM_IDLE :
     {
@@ -136,10 +161,35 @@ void PibusFrameBuffer::transition()
                 r_word  = (address - m_segbase) >> 2;
                 r_opc   = (int) p_opc.read();
                 r_counter = m_latency;
-                if((p_read == true)  && (m_latency == 0))  r_fsm_state = FSM_READ_OK; 
-                if((p_read == true)  && (m_latency != 0))  r_fsm_state = FSM_READ_WAIT; 
-                if((p_read == false) && (m_latency == 0))  r_fsm_state = FSM_WRITE_OK; 
-                if((p_read == false) && (m_latency != 0))  r_fsm_state = FSM_WRITE_WAIT; 
+                if ( m_retry && (m_latency != 0) )
+                {
+                    if ( r_pend_valid == false )	// register the request
+                    {
+                        r_pend_valid   = true;
+                        r_pend_addr    = address;
+                        r_pend_read    = p_read.read();
+                        r_pend_counter = 0;
+                        r_fsm_state    = FSM_RETRY;
+                    }
+                    else if ( (r_pend_addr.read() == address) && (r_pend_read.read() == p_read.read()) &&
+                              (r_pend_counter.read() >= m_latency) )	// registered request restarted
+                    {
+                        r_pend_valid   = false;
+                        if(p_read == true)  r_fsm_state = FSM_READ_OK;
+                        else                r_fsm_state = FSM_WRITE_OK;
+                    }
+                    else
+                    {
+                        r_fsm_state    = FSM_RETRY;
+                    }
+                }
+                else
+                {
+                    if((p_read == true)  && (m_latency == 0))  r_fsm_state = FSM_READ_OK; 
+                    if((p_read == true)  && (m_latency != 0))  r_fsm_state = FSM_READ_WAIT; 
+                    if((p_read == false) && (m_latency == 0))  r_fsm_state = FSM_WRITE_OK; 
+                    if((p_read == false) && (m_latency != 0))  r_fsm_state = FSM_WRITE_WAIT; 
+                }
             } 
             else 
             {
@@ -149,14 +199,16 @@ void PibusFrameBuffer::transition()
         break;
     }
     case FSM_ERROR :
+    case FSM_RETRY :
     {
 	r_fsm_state = FSM_IDLE;
         break;
     }
     case FSM_READ_WAIT :
     {
-	r_counter = r_counter - 1;
-	if(r_counter == 1)  r_fsm_state = FSM_READ_OK; 
+        uint32_t counter = r_counter.read() - skip;
+	r_counter = counter - 1;
+	if(counter == 1)  r_fsm_state = FSM_READ_OK; 
         break;
     }
     case FSM_READ_OK :
@@ -183,8 +235,9 @@ void PibusFrameBuffer::transition()
     }
     case FSM_WRITE_WAIT :
     {
-        r_counter = r_counter - 1;
-        if(r_counter == 1)  r_fsm_state = FSM_WRITE_OK; 
+        uint32_t counter = r_counter.read() - skip;
+        r_counter = counter - 1;
+        if(counter == 1)  r_fsm_state = FSM_WRITE_OK; 
         break;
     }
     case FSM_WRITE_OK :   
@@ -214,14 +267,27 @@ void PibusFrameBuffer::transition()
     }
     } // end switch r_fsm_state
 
-    if(r_display == 0)
+    // the display is refreshed every 1001 cycles : it is refreshed
+    // only once if several refresh periods have been skipped
+    uint32_t display = r_display.read();
+    if ( skip > display )
+    {
+        m_fb_controller.update();
+        display = 1000 - ((skip - display - 1) % 1001);
+    }
+    else
+    {
+        display = display - skip;
+    }
+
+    if(display == 0)
     {
         m_fb_controller.update();
         r_display = 1000;
     }
     else
     {
-        r_display = r_display - 1;
+        r_display = display - 1;
     }
 } // end transition()
 
@@ -234,6 +300,9 @@ void PibusFrameBuffer::genMoore()
     case FSM_ERROR : 
         p_ack = PIBUS_ACK_ERROR;
         break;
+    case FSM_RETRY : 
+        p_ack = PIBUS_ACK_RETRY;
+        break;
     case FSM_READ_WAIT :
         p_ack = PIBUS_ACK_WAIT;
         p_d = 0;
@@ -260,6 +329,44 @@ void PibusFrameBuffer::printTrace()
     std::cout << m_name << " : " << m_fsm_str[r_fsm_state] << std::endl;
 } // end print()
 
+//////////////////////////////////////////////////////////////////////////
+// idle cycles : the frame buffer is idle when it is not selected, or 
+// when it counts the latency cycles (the display refresh is not an
+// output, and does not limit the number of idle cycles).
+uint32_t PibusFrameBuffer::idleCycles()
+{
+    uint32_t idle;
+    int state = r_fsm_state.read();
+
+    if      ( (state == FSM_IDLE) && !p_sel.read() )	idle = PIBUS_IDLE_FOREVER;
+    else if ( (state == FSM_READ_WAIT) || (state == FSM_WRITE_WAIT) ) idle = r_counter.read() - 1;
+    else						idle = 0;
+
+    if ( r_pend_valid.read() )
+    {
+        uint32_t expire = m_latency + PIBUS_RETRY_EXPIRE - r_pend_counter.read();
+        if ( expire < idle ) idle = expire;
+    }
+    return idle;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// skip idle cycles : the counters are updated by the next transition
+void PibusFrameBuffer::skipCycles(uint32_t ncycles)
+{
+    m_skip = ncycles;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// checkpoint : the buffer content is copied, and the display refreshed
+void PibusFrameBuffer::checkpoint(PibusCheckpoint& ckpt)
+{
+    ckpt.section(m_name);
+    ckpt.check(m_segsize, "frame buffer size");
+    ckpt.state(m_fb_controller.surface(), m_segsize);
+    if ( !ckpt.saving() ) m_fb_controller.update();
+}
+
 #ifdef SOCVIEW
 
 /////////////////////////////////////////////////////
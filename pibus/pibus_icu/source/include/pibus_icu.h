@@ -28,6 +28,8 @@
 // 
 // This component cheks address for segmentation violation,
 // and can be used as a default target.
+// It implements the PibusIdleSkip interface : it is idle when
+// it is not selected.
 //////////////////////////////////////////////////////////////////////////////////
 // This component has 5 "generator" parameters :
 // - sc_module_name	name    : instance name
@@ -46,7 +48,7 @@
 
 namespace soclib { namespace caba {
 
-class PibusIcu : sc_module {
+class PibusIcu : sc_module, public soclib::common::PibusIdleSkip {
 
     // Structural parameters
     const char*                 m_name;                 // instance name
@@ -114,6 +116,8 @@ public:
     void genMoore();
     void genMealy();
     void printTrace();
+    uint32_t idleCycles();
+    void skipCycles(uint32_t ncycles);
 
 }; // end PibusIcu
 
@@ -199,4 +199,17 @@ void PibusIcu::printTrace()
     std::cout << std::endl;
 }
 
+////////////////////////////////////////////////////////
+// idle cycles : the ICU is idle when it is not selected
+uint32_t PibusIcu::idleCycles()
+{
+    if((r_fsm_state == FSM_IDLE) && (p_sel == false)) return PIBUS_IDLE_FOREVER;
+    else                                              return 0;
+}
+
+////////////////////////////////////////////
+void PibusIcu::skipCycles(uint32_t ncycles)
+{
+}
+
 }} // end namespace
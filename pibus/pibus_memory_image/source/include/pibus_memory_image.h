@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////////
+// File : pibus_memory_image.h
+// This program is released under the GNU Public License
+// Copyright : UPMC-LIP6
+//////////////////////////////////////////////////////////////////////////
+// This file defines the memory image shared by the PIBUS memory
+// targets (PibusSimpleRam, PibusDram) : the PibusMemoryImage object
+// contains the segments of a target, and implements the segment
+// allocation, the address decoding, the write accesses, the functional
+// accesses and the checkpoint of the segments.
+//
+// The segments are the segments of the segment table mapped on the
+// target (up to PIBUS_IMAGE_MAXSEG segments). Both the BASE and SIZE
+// of a segment must be multiple of 4 bytes.
+// Each segment is implemented by a table of words, that is a private
+// mapping of a temporary file containing the loaded image : the file
+// is built once by the constructor (the unloaded pages are not written),
+// and the pages are allocated on demand. The reset() method remaps the
+// image (copy-on-write) : the start-up cost and the memory footprint
+// don't depend on the segment sizes, but on the loaded and written pages.
+// The memory organisation is little endian (the loaded words are
+// swapped when the simulation host is big endian).
+// The address decoding uses the MSB pages of the segment table : a page
+// table gives the segment index (a linear search is only used when
+// several segments share the same page).
+// The checkpoint() method saves the segments as memory images, and the
+// restored segments are used in place in the mapped checkpoint file :
+// the segment mappings are then released, and a new mapping of the
+// loaded image is created by the next reset() (the checkpoint mapping
+// is never remapped).
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PIBUS_MEMORY_IMAGE_H
+#define PIBUS_MEMORY_IMAGE_H
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "pibus_segment_table.h"
+#include "pibus_mnemonics.h"
+#include "pibus_checkpoint.h"
+#include "loader.h"
+
+#define PIBUS_IMAGE_MAXSEG	16
+#define PIBUS_IMAGE_PAGE_NONE	0xFF	// no segment in the page
+#define PIBUS_IMAGE_PAGE_MULTI	0xFE	// several segments in the page
+
+namespace soclib { namespace common {
+
+/////////////////////////////////////////////////////////////////
+class PibusMemoryImage {
+
+    const char*		m_component;			// owner class name (error messages)
+    const char*		m_name;				// owner instance name
+    size_t		m_nbseg;			// segment number
+    uint32_t		m_segsize[PIBUS_IMAGE_MAXSEG];	// segment sizes
+    uint32_t		m_segbase[PIBUS_IMAGE_MAXSEG];	// segment bases
+    const char*		m_segname[PIBUS_IMAGE_MAXSEG];	// segment names
+    size_t		m_mapsize[PIBUS_IMAGE_MAXSEG];	// segment mapping sizes (page multiple)
+    size_t		m_mapoffset[PIBUS_IMAGE_MAXSEG];// segment offsets in the image file
+    uint32_t*		m_buf[PIBUS_IMAGE_MAXSEG];	// segment buffers
+    void*		m_map[PIBUS_IMAGE_MAXSEG];	// segment mappings (NULL if restored)
+    FILE*		m_image;			// loaded image (temporary file)
+    uint8_t		m_page_seg[256];		// segment index (indexed by the MSB bits)
+    uint32_t		m_page_shift;			// 32 - number of MSB bits
+
+    void loadImage(const Loader& loader);
+    void mapImage(size_t seg);
+    void error(const char* message, const char* name = "");
+
+public:
+
+    PibusMemoryImage(const char*	component,
+                     const char*	name,
+                     PibusSegmentTable&	segtab,
+                     uint32_t		tgtid,
+                     const Loader&	loader);
+    ~PibusMemoryImage();
+
+    inline size_t segments() const { return m_nbseg; }
+    inline uint32_t base(size_t seg) const { return m_segbase[seg]; }
+    inline uint32_t size(size_t seg) const { return m_segsize[seg]; }
+    inline const char* segName(size_t seg) const { return m_segname[seg]; }
+
+    // true if the address is in the segment
+    inline bool contains(size_t seg, uint32_t address) const
+    { return (address >= m_segbase[seg]) && (address - m_segbase[seg] < m_segsize[seg]); }
+
+    // word containing the address (the address must be in the segment)
+    inline uint32_t& word(size_t seg, uint32_t address)
+    { return m_buf[seg][(address - m_segbase[seg]) >> 2]; }
+
+    size_t segIndex(uint32_t address) const;
+    void reset();
+    void write(size_t seg, uint32_t address, uint32_t data, uint32_t opc);
+    bool functionalRead(uint32_t address, uint32_t* data);
+    bool functionalWrite(uint32_t address, uint32_t data, uint32_t be);
+    void checkpoint(PibusCheckpoint& ckpt);
+
+}; // end class PibusMemoryImage
+
+}} // end namespaces
+
+#endif
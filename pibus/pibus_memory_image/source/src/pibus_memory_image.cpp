@@ -0,0 +1,280 @@
+////////////////////////////////////////////////////////////////////////////
+// File  : pibus_memory_image.cpp
+// Copyright  UPMC - LIP6
+// This program is released under the GNU public license
+///////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "pibus_memory_image.h"
+
+namespace soclib { namespace common {
+
+//////////////////////////////////////////////////////
+//	Functions used to manage the possible
+//	big-endianness of the simulation processor
+static bool image_big_endian()
+{
+    short int 	word = 0x0001;
+    char 	*byte = (char *) &word;
+    return(byte[0] ? false : true);
+}
+
+static uint32_t image_swap(uint32_t LE)
+{
+    return ((LE & 0xFF000000) >> 24 |
+            (LE & 0x00FF0000) >> 8  |
+            (LE & 0x0000FF00) << 8  |
+            (LE & 0x000000FF) << 24 );
+}
+
+////////////////////////////////////////////////////////////////////
+PibusMemoryImage::PibusMemoryImage(const char*		component,
+                                   const char*		name,
+                                   PibusSegmentTable&	segtab,
+                                   uint32_t		tgtid,
+                                   const Loader&	loader)
+    : m_component(component),
+      m_name(name),
+      m_nbseg(0),
+      m_image(NULL)
+{
+    // segments definition
+    std::list<SegmentTableEntry> seglist = segtab.getTargetSegmentList(tgtid);
+    std::list<SegmentTableEntry>::iterator iter;
+
+    for (iter = seglist.begin() ; iter != seglist.end() ; ++iter)
+    {
+    	uint32_t base = (*iter).getBase();
+    	uint32_t size = (*iter).getSize();
+        if(m_nbseg == PIBUS_IMAGE_MAXSEG)
+        {
+	  	printf("ERROR in component %s %s\n", m_component, m_name);
+	  	printf("The number of segments cannot be larger than %d\n", PIBUS_IMAGE_MAXSEG);
+		exit(1);
+	}
+	if(((base & 0x00000003) != 0x0) || ((size & 0x00000003) != 0x0))
+        {
+		error("The segment base and size must be multiple of 4 : ", (*iter).getName());
+	}
+	m_segname[m_nbseg]   = (*iter).getName();
+	m_segsize[m_nbseg]   = size;
+	m_segbase[m_nbseg]   = base;
+	m_buf[m_nbseg]       = NULL;
+	m_map[m_nbseg]       = NULL;
+	m_nbseg              = m_nbseg+1;
+    }
+
+    // page table (address decoding)
+    m_page_shift = 32 - segtab.getMSBnumber();
+    memset(m_page_seg, PIBUS_IMAGE_PAGE_NONE, 256);
+    for (size_t seg = 0 ; seg < m_nbseg ; seg++)
+    {
+        uint8_t* page = &m_page_seg[(uint64_t)m_segbase[seg] >> m_page_shift];
+        if ( *page == PIBUS_IMAGE_PAGE_NONE ) *page = seg;
+        else                                  *page = PIBUS_IMAGE_PAGE_MULTI;
+    }
+
+    // segments allocation
+    loadImage(loader);
+}
+
+////////////////////////////////////////////////////////////////////
+PibusMemoryImage::~PibusMemoryImage()
+{
+    if ( m_image ) fclose(m_image);
+}
+
+////////////////////////////////////////////////////////////////////
+void PibusMemoryImage::error(const char* message, const char* name)
+{
+    printf("ERROR in component %s %s\n", m_component, m_name);
+    printf("%s%s\n", message, name);
+    exit(1);
+}
+
+//////////////////////////////////////////////////////////////
+// The loaded image is built in a temporary file, where each segment
+// is page aligned. The file is sparse : the pages that are not
+// written by the loader are not allocated.
+//////////////////////////////////////////////////////////////
+void PibusMemoryImage::loadImage(const Loader& loader)
+{
+    size_t page  = sysconf(_SC_PAGESIZE);
+    size_t total = 0;
+    for ( size_t seg = 0 ; seg < m_nbseg ; seg++ )
+    {
+        m_mapoffset[seg] = total;
+        m_mapsize[seg]   = (m_segsize[seg] + page - 1) & ~(page - 1);
+        if ( m_mapsize[seg] == 0 ) m_mapsize[seg] = page;
+        total            = total + m_mapsize[seg];
+    }
+
+    m_image = tmpfile();
+    if ( (m_image == NULL) || (ftruncate(fileno(m_image), total) != 0) )
+    {
+        error("Cannot create the memory image file");
+    }
+
+    for ( size_t seg = 0 ; seg < m_nbseg ; seg++ )
+    {
+        void* buf = mmap(NULL, m_mapsize[seg], PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fileno(m_image), m_mapoffset[seg]);
+        if ( buf == MAP_FAILED ) error("Cannot map the memory image of segment ", m_segname[seg]);
+        uint32_t* tab = (uint32_t*)buf;
+        loader.load( tab, m_segbase[seg], m_segsize[seg] );
+        if ( image_big_endian() )
+        {
+            for( size_t word = 0; word < (m_segsize[seg] >> 2); word++)
+              tab[word] = image_swap(tab[word]);
+        }
+        munmap(buf, m_mapsize[seg]);
+        mapImage(seg);
+    }
+} // end loadImage()
+
+//////////////////////////////////////////////////////////////
+// The segment buffer is a private (copy-on-write) mapping of the
+// loaded image : the written pages are dropped when the segment
+// is mapped again (reset). Only the segment own mapping is replaced
+// in place (a restored segment buffer is in the checkpoint mapping).
+//////////////////////////////////////////////////////////////
+void PibusMemoryImage::mapImage(size_t seg)
+{
+    int flags = MAP_PRIVATE;
+#ifdef MAP_NORESERVE
+    flags = flags | MAP_NORESERVE;
+#endif
+    if ( m_map[seg] ) flags = flags | MAP_FIXED;
+    void* buf = mmap(m_map[seg], m_mapsize[seg], PROT_READ | PROT_WRITE, flags,
+                     fileno(m_image), m_mapoffset[seg]);
+    if ( buf == MAP_FAILED ) error("Cannot map the memory image of segment ", m_segname[seg]);
+    m_map[seg] = buf;
+    m_buf[seg] = (uint32_t*)buf;
+} // end mapImage()
+
+//////////////////////////////////////////////////////////////
+// All segments are restored to the loaded image.
+//////////////////////////////////////////////////////////////
+void PibusMemoryImage::reset()
+{
+    for ( size_t seg = 0 ; seg < m_nbseg ; seg++ ) mapImage(seg);
+}
+
+//////////////////////////////////////////////////////////////
+// Returns the index of the segment containing the address,
+// or segments() if the address is not in a segment.
+//////////////////////////////////////////////////////////////
+size_t PibusMemoryImage::segIndex(uint32_t address) const
+{
+    size_t seg = m_page_seg[(uint64_t)address >> m_page_shift];
+    if ( seg == PIBUS_IMAGE_PAGE_MULTI )	// linear search
+    {
+        for ( seg = 0 ; seg < m_nbseg ; seg++ )
+        {
+            if ( contains(seg, address) ) return seg;
+        }
+        return m_nbseg;
+    }
+    if ( (seg < m_nbseg) && contains(seg, address) ) return seg;
+    return m_nbseg;
+} // end segIndex()
+
+////////////////////////////////////////////////////////////////////////
+// PIBUS write : the OPC field defines the written bytes
+// (the memory organisation is little endian).
+////////////////////////////////////////////////////////////////////////
+void PibusMemoryImage::write(size_t seg, uint32_t address, uint32_t data, uint32_t opc)
+{
+    uint32_t& tab = word(seg, address);
+
+    switch (opc) {
+    case PIBUS_OPC_BY0 :  // write byte 0
+	tab = (tab & 0xFFFFFF00) | (data & 0x000000FF);
+        break;
+    case PIBUS_OPC_BY1 :  // write byte 1
+	tab = (tab & 0xFFFF00FF) | (data & 0x0000FF00);
+        break;
+    case PIBUS_OPC_BY2 :  // write byte 2
+	tab = (tab & 0xFF00FFFF) | (data & 0x00FF0000);
+        break;
+    case PIBUS_OPC_BY3 :  // write byte 3
+	tab = (tab & 0x00FFFFFF) | (data & 0xFF000000);
+        break;
+    case PIBUS_OPC_HW0 :  // write lower half
+	tab = (tab & 0xFFFF0000) | (data & 0x0000FFFF);
+        break;
+    case PIBUS_OPC_HW1 :  // write upper half
+	tab = (tab & 0x0000FFFF) | (data & 0xFFFF0000);
+        break;
+    case PIBUS_OPC_WDU :  // write word
+    case PIBUS_OPC_WD2 :  // write burst
+    case PIBUS_OPC_WD4 :
+    case PIBUS_OPC_WD8 :
+    case PIBUS_OPC_WD16 :
+    case PIBUS_OPC_WD32 :
+	tab = data;
+        break;
+    case PIBUS_OPC_NOP :  // no write
+        break;
+    default :
+	printf("ERROR in component %s %s\n", m_component, m_name);
+	printf("illegal value of the PIBUS OPC field for a WRITE : %0x\n", opc);
+	printf("the supported values are : BY0/BY1/BY2/BY3\n");
+	printf("                           HW0/HW1/WDU/NOP\n");
+	printf("                           WD2/WD4/WD8/WD16/WD32\n");
+	exit(1);
+	break;
+    } // end switch
+} // end write()
+
+//////////////////////////////////////////////////////////////////////
+// functional read : returns false if the address is not in a segment
+bool PibusMemoryImage::functionalRead(uint32_t address, uint32_t* data)
+{
+    size_t seg = segIndex(address);
+    if ( seg == m_nbseg ) return false;
+    *data = word(seg, address);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// functional write : the be argument defines the written bytes.
+// returns false if the address is not in a segment
+bool PibusMemoryImage::functionalWrite(uint32_t address, uint32_t data, uint32_t be)
+{
+    size_t seg = segIndex(address);
+    if ( seg == m_nbseg ) return false;
+
+    uint32_t mask = 0;
+    for ( size_t byte = 0 ; byte < 4 ; byte++ )
+    {
+        if ( (be >> byte) & 0x1 ) mask = mask | (0xFF << (byte << 3));
+    }
+    uint32_t& tab = word(seg, address);
+    tab = (tab & ~mask) | (data & mask);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// checkpoint : the segment buffers are replaced by the mapped images,
+// and the segment mappings are released (until the next reset)
+// (the owner component defines the checkpoint section)
+void PibusMemoryImage::checkpoint(PibusCheckpoint& ckpt)
+{
+    ckpt.check(m_nbseg, "number of memory segments");
+    for ( size_t seg = 0 ; seg < m_nbseg ; seg++ )
+    {
+        uint32_t* buf = (uint32_t*)ckpt.image(m_buf[seg], m_segsize[seg]);
+        if ( buf != m_buf[seg] )
+        {
+            if ( m_map[seg] ) munmap(m_map[seg], m_mapsize[seg]);
+            m_map[seg] = NULL;
+            m_buf[seg] = buf;
+        }
+    }
+}
+
+}} // end namespaces
@@ -14,8 +14,9 @@
 //     => The number of words per line must be a power of 2 and no larger than 32.
 //     => The number of associative ways per set must be a power of 2 no larger than 8.
 // It contains a write buffer implemented a simple FIFO. The FIFO depth is a parameter.
-// All Pibus write transactions are single word.
+// The consecutive write buffer entries can be merged in burst transactions.
 // The data cache supports a snoop-invalidate mechanism.
+// The data cache write policy (write-through or write-back) is a parameter.
 //     
 // INSTRUCTION CACHE
 // The ICACHE is read only.
@@ -29,9 +30,146 @@
 // - IMISS	=> generate a read burst on the bus
 // - IUNC	=> generate aRn atomic read on the bus
 //
+// INSTRUCTION PREFETCH
+// When the iprefetch_depth constructor parameter is not zero, the ICACHE 
+// is completed by a stream buffer containing iprefetch_depth lines.
+// In case of ICACHE MISS on line L, the stream buffer is re-initialised
+// with the lines L+1 ... L+N, that are prefetched by the PIBUS controller
+// with the lowest priority (when no other request is pending).
+// A line that is already in the ICACHE, or in a non cacheable segment,
+// is not prefetched. A bus error on a prefetch transaction is silently
+// ignored. In case of ICACHE MISS on line L :
+// - if L is found in the stream buffer, the ICACHE is updated from the
+//   stream buffer (useful prefetch), and the stream buffer slot is
+//   re-allocated to the next line in the stream.
+// - if L is currently prefetched, the ICACHE FSM waits the end of 
+//   the prefetch transaction (late prefetch).
+// 
+// DATA PREFETCH
+// When the dprefetch_depth constructor parameter is not zero, the DCACHE
+// is completed by a prefetch buffer containing dprefetch_depth lines,
+// and an address stride detector : the line addresses of two 
+// successive DCACHE read MISS define a stride. When the same stride
+// is observed twice, the lines L+S ... L+N*S are allocated in the 
+// prefetch buffer, and prefetched by the PIBUS controller when no 
+// other request is pending. To reduce the bus contention, a data 
+// prefetch request that is not granted after dpref_max_wait cycles
+// is dropped, unless the target already answered RETRY (the request
+// is then registered by the target). In case of DCACHE read MISS on 
+// line L, the prefetch buffer is used as the ICACHE stream buffer 
+// (useful or late prefetch).
+// A prefetched line is discarded in case of local write, external 
+// write (snoop), or XTN_DCACHE_INVAL / XTN_DCACHE_FLUSH requests.
+// 
+// VICTIM CACHES
+// When the victim_depth constructor parameter is not zero, both the ICACHE
+// and the DCACHE are completed by a fully associative victim cache 
+// containing victim_depth lines (FIFO replacement policy).
+// A valid line evicted from the cache in the MISS_INVAL state is copied
+// in the victim cache. In case of MISS, the victim cache is checked 
+// before the prefetch buffers : in case of victim hit, the line is 
+// swapped between the victim cache and the cache in the MISS_INVAL state,
+// and no bus transaction is generated.
+// The DCACHE victim cache is invalidated as the DCACHE : local write 
+// (write-through policy), SC, external write (snoop), XTN_DCACHE_INVAL
+// and XTN_DCACHE_FLUSH requests. The lines in the victim cache are 
+// never dirty, as a dirty line is written back before eviction. 
+//
+// CRITICAL WORD FIRST & EARLY RESTART
+// The line refill bursts (IMISS & DMISS) start with the missing word,
+// and wrap around the line boundary. The PIBUS controller registers
+// the received words in the MISS_BUF_MASK register, and the processor
+// is restarted as soon as the requested word is available:
+// the ICACHE_FSM and DCACHE_FSM return the words found in the MISS_BUF 
+// buffer while the rest of the line is written in the background 
+// (only for read requests targeting the missing line). 
+//
+// NON-BLOCKING DATA CACHE
+// When the dcache_mshr constructor parameter is not zero, the DCACHE
+// is non-blocking : it contains dcache_mshr Miss Status Holding Registers,
+// each one describing a pending line refill (line address, reserved
+// cache slot, missing word, and written data for a write-allocate).
+// In case of DCACHE MISS, the victim slot is invalidated, an MSHR is
+// allocated, and its index is posted in the MSHR_FIFO request queue,
+// that replaces the DMISS request flip-flop. The DCACHE FSM returns 
+// to IDLE state without waiting the refill, and serves the read hits
+// (hit under miss), and the misses on other lines (miss under miss)
+// as long as there is a free MSHR. The line refill is written in the
+// cache when the PIBUS controller signals the transaction completion.
+// The following requests are delayed until the refill completion :
+// - a request targeting a line with a pending refill, except the 
+//   read requests served by the miss buffer (early restart).
+// - a miss whose victim slot is reserved by a pending refill.
+// - a miss when all MSHRs are allocated.
+// - uncached reads, SC and XTN requests, that require all MSHRs free.
+// An external write (snoop) on a pending line cancels the cache update.
+// A bus error on a refill is signaled if the processor request targets
+// the missing line (or to the next read for a write-allocate).
+//
+// FAST-FORWARD MODE
+// The processor can be simulated in functional mode (sampled simulation),
+// using the functionalRun() method, called by the top cell between two 
+// simulated cycles, when the functionalReady() method returns true (all 
+// FSMs in IDLE state and no pending request or buffered write).
+// In this mode, the ISS requests are served in zero time by the caches
+// and by the memory components registered by the addFunctionalMemory()
+// method, using their PibusFunctionalMemory interface : there is no PIBUS
+// transaction, and the ICACHE & DCACHE contents are updated as in the
+// cycle-accurate mode (functional warming), with the same write policy.
+// The prefetch buffers and victim caches are not warmed (only invalidated).
+// The functional mode stops when a request requires a PIBUS transaction :
+// access to a peripheral, LL/SC, or XTN requests other than SYNC.
+// The snoop mechanism is not supported : this mode is restricted to
+// single processor platforms.
+//
+// IDLE CYCLES SKIPPING
+// The cache implements the PibusIdleSkip interface : the idleCycles()
+// method returns PIBUS_IDLE_FOREVER when the processor is frozen, and 
+// the cache is waiting the bus grant or a data acknowledge (or has no
+// bus request). The top cell can then skip the cycles where no component
+// is active, using the skipCycles() method : the ISS executes the frozen
+// cycles, and the statistics and the profile are updated as in the 
+// cycle-accurate mode. The cache is never idle when the prefetch buffers
+// or the MSHRs are activated, or in case of external write (snoop).
+//
+// CHECKPOINT
+// The cache implements the PibusCheckpointable interface : the checkpoint()
+// method saves (or restores) the state that is not stored in registers :
+// the valid lines of the ICACHE and DCACHE (found by a lookup of the 
+// cacheable segments, as the GenericCache tags are not accessible), the
+// write buffer and MSHR FIFOs, the dirty bits, the victim caches, the 
+// prefetch buffers, the MSHRs, and the processor registers (through the
+// GDB registers interface). The LRU state is not restored.
+// As the GDB interface doesn't contain the pending data request, the
+// branch delay slot, and the CP0 EPC, COUNT and COMPARE registers, the 
+// checkpoint must be saved when the checkpointReady() method returns true :
+// no pending data request, the next instruction doesn't follow a branch
+// or a jump, the processor is not handling an exception (SR.EXL and 
+// SR.ERL are 0 : EPC is not used), and there is no LL/SC reservation.
+// The CP0 COUNT register restarts from 0 after a restore (the GIET uses
+// it only for the proctime() system call), and COMPARE is not restored.
+//
+// PER-PC PROFILER
+// When the profile_size constructor parameter is not zero, the executed
+// instructions, the frozen cycles, the IMISS, DMISS (read miss and 
+// write-allocate) and uncached reads are counted per instruction
+// address, in an open-addressing hash table containing profile_size 
+// entries (power of 2). To keep the probe sequences short, no new entry 
+// is allocated when the table is 3/4 full (the events are dropped).
+// An instruction is counted when it is executed by the ISS. A frozen cycle
+// is charged to the instruction issuing the pending data request, or to
+// the fetched instruction. The profile is only recorded in cycle-accurate 
+// mode (not in fast-forward mode).
+// The printProfile() method uses the ELF symbols read by the Loader to
+// display a flat profile (per function) and an annotated listing of the
+// hottest loops. A loop is defined by a backward branch (or jump) : 
+// the instructions are read with the PibusFunctionalMemory interface of 
+// the memories registered by the addFunctionalMemory() method.
+//
 // DATA CACHE 
-// The write policy is WRITE-THROUGH: the data is always written 
+// The default write policy is WRITE-THROUGH: the data is always written 
 // in the memory, and the cache is updated only in case of HIT.
+// The optional write policy is WRITE-BACK / WRITE-ALLOCATE (see below).
 // The DCACHE accepts non cachable segments : It decodes the MSB
 // bits of the adress using a CACHED_TABLE ROM constructed from 
 // the informations stored in the segment table.
@@ -48,10 +186,44 @@
 // - DUNC 	=> generate an atomic read on the bus
 // - WRITE   	=> generate an atomic write on the bus
 // - SC      	=> generate an atomic write on the bus
+// - WB      	=> generate a write burst on the bus (write-back policy)
 // 
 // A processor request is refused (i.e. DCACHE.MISS = true)
 // if there is a READ MISS, a READ UNCACHED, or a WRITE with FIFO full.
 //
+// WRITE-BACK
+// When the write_back constructor parameter is true, the cached writes
+// are not posted in the write buffer (only the uncached writes are):
+// - WRITE HIT => the cache is updated, and the line is marked dirty.
+// - WRITE MISS => the line is fetched (write-allocate) as for a read miss,
+//   the cache is updated, and the line is marked dirty. The processor
+//   is not stalled, as the written data is kept in the DCACHE registers.
+// A dirty bit and the line address are registered for each cache slot.
+// When a dirty victim is selected, the line is copied in the 
+// DCACHE_WB_BUF[DCACHE_WORDS] buffer, and written to memory by the
+// PIBUS controller as a single write burst (WB transaction), 
+// before the missing line is read.
+// The XTN_DCACHE_INVAL request writes back the line if it is dirty.
+// The XTN_DCACHE_FLUSH request writes back all dirty lines and
+// invalidates the whole data cache. The XTN_SYNC request writes back
+// all dirty lines, that stay valid in the cache. The response is 
+// returned to the processor when the last write-back burst is completed.
+// The write-back policy does not support the snoop-invalidate 
+// mechanism : the cache coherence must be handled by software.
+//
+// WRITE BUFFER MERGING
+// When the wbuf_merge constructor parameter is true, the write buffer
+// entries are merged while the PIBUS FSM waits for the bus grant:
+// The FIFO head is popped in a WMERGE_BUF[DCACHE_WORDS] buffer, 
+// and the next FIFO entries are merged in this buffer if they target
+// the same cache line (cacheable segments only) and :
+// - the same word : the byte enables are merged, as long as the result
+//   can be encoded as a BY0/BY1/BY2/BY3/HW0/HW1/WDU opc.
+// - the next word : the word is appended if the last word is complete.
+// The full words are sent as WD2/WD4/WD8/WD16 bursts (or WDU), 
+// a burst of N words being aligned on a N words boundary,
+// and a partial last word is sent as a single word transaction.
+//
 // BUS ERRORS
 // For the read transactions (both instruction and data), the processor is
 // stalled, and a bus error can be precisely signaled, using the ICACHE.BERR
@@ -98,9 +270,24 @@
 // 6) DREQ_COUNTER  : Total number of Cached Read requests	
 // The Dcache Miss Rate can be computed as DMISS_COUNTER / DREQ_COUNTER
 // The Icache Miss Rate can be computed as IMISS_COUNTER / IREQ_COUNTER
+// The number of write transactions on the bus (single word or burst)
+// is counted by the BUS_WRITE_COUNTER.
+// The write buffer merge ratio is the number of write buffer entries
+// divided by the number of write buffer transactions.
+// The IPREF_COUNTER, IPREF_USEFUL and IPREF_LATE counters register 
+// the number of prefetch transactions, useful prefetches and late prefetches.
+// The same counters exist for the data prefetcher, and are used to compute
+// the prefetch ACCURACY (useful or late prefetches / prefetch transactions)
+// and COVERAGE (DCACHE MISS served by the prefetch buffer / DCACHE MISS).
+// The IVICT_HIT and DVICT_HIT counters register the number of misses
+// served by the victim caches.
+// The MSHR_HIT and MSHR_MISS counters register the number of read hits
+// and read misses that are served while another refill is pending.
+// The FFWD_COUNTER registers the number of ISS cycles executed in functional
+// mode, that are not taken into account by the other counters.
 //
 /////////////////////////////////////////////////////////////////////////////// 
-// This component has 11 "constructor" parameters
+// This component has 18 "constructor" parameters
 // - sc_module_name 	name		: instance name
 // - pibusSegmentTable 	segtab 		: segment table
 // - uint32_t		proc_id		: processor identifier
@@ -112,19 +299,30 @@
 // - uint32_t		dcache_words 	: number of words per line (dcache)
 // - uint32_t		wbuf_depth   	: write buffer depth 
 // - bool		snoop_active    : default value is true
+// - bool		write_back      : default value is false (write-through)
+// - bool		wbuf_merge      : default value is false
+// - uint32_t		iprefetch_depth : number of prefetched lines (default 0)
+// - uint32_t		dprefetch_depth : number of prefetched lines (default 0)
+// - uint32_t		dcache_mshr     : number of MSHRs (default 0 : blocking)
+// - uint32_t		victim_depth    : number of victim cache lines (default 0)
+// - uint32_t		profile_size    : profiler hash table entries (default 0)
+// - uint32_t		dpref_max_wait  : bus grant wait before a data prefetch is dropped (default 2)
 //////////////////////////////////////////////////////////////////////////////
 
 #ifndef PIBUS_MIPS32_XCACHE_H
 #define PIBUS_MIPS32_XCACHE_H
 
 #include <systemc>
+#include <vector>
 #include "pibus_segment_table.h"
 #include "pibus_mnemonics.h"
+#include "pibus_checkpoint.h"
 #include "generic_fifo.h"
 #include "generic_cache.h"
 #include "mips32.h"
 #include "iss2.h"
 #include "gdbserver.h"
+#include "loader.h"
 
 namespace soclib { namespace caba {
 
@@ -133,7 +331,7 @@ using namespace soclib::common;
 using namespace soclib::caba;
 
 /////////////////////////////////////
-class PibusMips32Xcache : sc_module {
+class PibusMips32Xcache : sc_module, public PibusIdleSkip, public PibusCheckpointable {
 
     // structural parameters 
     const char*			m_name;
@@ -147,12 +345,23 @@ class PibusMips32Xcache : sc_module {
     const uint32_t		m_msb_shift;
     const uint32_t		m_msb_mask;
     const bool			m_snoop_active;
+    const bool			m_write_back;
+    const bool			m_wbuf_merge;
+    const uint32_t		m_ipref_depth;
+    const uint32_t		m_dpref_depth;
+    const uint32_t		m_mshr_count;
+    const uint32_t		m_vict_depth;
+    const uint32_t		m_prof_size;
+    const uint32_t		m_dpref_max_wait;
     uint32_t			m_line_data_mask;
     uint32_t			m_line_inst_mask;
+    std::vector<PibusFunctionalMemory*>	m_fmem;		  // functional memories
+    std::vector<uint32_t>	m_cached_base;		  // cacheable segments base
+    std::vector<uint32_t>	m_cached_size;		  // cacheable segments size
 
-    char			m_dcache_fsm_str[12][20];
+    char			m_dcache_fsm_str[15][20];
     char			m_icache_fsm_str[8][20];
-    char			m_pibus_fsm_str[8][20];
+    char			m_pibus_fsm_str[9][20];
 
     Iss2::InstructionRequest 	m_ireq;
     Iss2::InstructionResponse 	m_irsp;
@@ -178,9 +387,74 @@ class PibusMips32Xcache : sc_module {
     sc_register<bool>		r_dcache_sc_req;  	  // request to Pibus FSM
     sc_register<bool>		r_llsc_pending;		  // LL reservation
     sc_register<uint32_t>	r_llsc_addr;		  // LL/SC address
+    sc_register<bool>		r_dcache_wb_req;  	  // request to Pibus FSM
+    sc_register<uint32_t>	r_dcache_wb_addr;  	  // write-back line address
+    sc_register<uint32_t>	r_dcache_flush_slot;	  // slot index for flush
+    uint32_t			r_dcache_wb_buf[32];	  // write-back data buffer
+    bool*			r_dcache_dirty;		  // dirty bit [ways*sets]
+    uint32_t*			r_dcache_slot_addr;	  // line address [ways*sets]
+    sc_register<bool>		r_dcache_pref_hit;	  // missing line found in prefetch buffer
+    sc_register<uint32_t>	r_dcache_pref_slot;	  // prefetch buffer slot index
+    sc_register<uint32_t>	r_dcache_save_victim;	  // evicted line address
+    sc_register<bool>		r_dcache_vict_hit;	  // missing line found in victim cache
+    sc_register<uint32_t>	r_dcache_vict_slot;	  // victim cache slot index
+
+    // Victim cache (data)
+    sc_register<uint32_t>	r_dvict_ptr;		  // FIFO replacement pointer
+    uint32_t*			r_dvict_addr;		  // line address [depth]
+    bool*			r_dvict_valid;		  // valid line [depth]
+    uint32_t*			r_dvict_buf;		  // line data [depth*dcache_words]
+
+    // Prefetch buffer & stride detector (data prefetch)
+    sc_register<uint32_t>	r_dpref_last;		  // last missing line address
+    sc_register<uint32_t>	r_dpref_stride;		  // last observed stride
+    uint32_t*			r_dpref_addr;		  // line address [depth]
+    int*			r_dpref_state;		  // slot state [depth]
+    uint32_t*			r_dpref_buf;		  // line data [depth*dcache_words]
+
+    // Miss Status Holding Registers (non-blocking data cache)
+    bool*			r_mshr_valid;		  // pending refill [mshr]
+    bool*			r_mshr_inval;		  // cache update cancelled [mshr]
+    uint32_t*			r_mshr_addr;		  // line address [mshr]
+    uint32_t*			r_mshr_way;		  // reserved slot way [mshr]
+    uint32_t*			r_mshr_set;		  // reserved slot set [mshr]
+    uint32_t*			r_mshr_word;		  // missing word index [mshr]
+    uint32_t*			r_mshr_type;		  // request type [mshr]
+    uint32_t*			r_mshr_wdata;		  // written data (write-allocate) [mshr]
+    uint32_t*			r_mshr_be;		  // byte enable (write-allocate) [mshr]
+    GenericFifo<uint32_t>	r_mshr_fifo;		  // refill requests to Pibus FSM
+
+    // Per-PC profiler (open-addressing hash table)
+    struct ProfileEntry {
+        uint32_t		pc;			  // instruction address
+        uint32_t		count[5];		  // events (indexed by PROF_EXEC...)
+    };
+    ProfileEntry*		m_prof_table;		  // hash table [profile_size]
+    uint32_t			m_prof_shift;		  // hash function shift
+    uint32_t			m_prof_used;		  // number of allocated entries
+    uint32_t			m_prof_dpc;		  // last executed instruction address
+    uint32_t			m_skip;			  // skipped idle cycles
   
     sc_register<int>		r_icache_fsm;		  // ICACHE FSM state
     sc_register<uint32_t>	r_icache_save_addr;  
+    sc_register<uint32_t>	r_icache_save_word;	  // missing word index
+    sc_register<bool>		r_icache_pref_hit;	  // missing line found in stream buffer
+    sc_register<uint32_t>	r_icache_pref_slot;	  // stream buffer slot index
+    sc_register<uint32_t>	r_icache_save_victim;	  // evicted line address
+    sc_register<bool>		r_icache_vict_hit;	  // missing line found in victim cache
+    sc_register<uint32_t>	r_icache_vict_slot;	  // victim cache slot index
+
+    // Victim cache (instruction)
+    sc_register<uint32_t>	r_ivict_ptr;		  // FIFO replacement pointer
+    uint32_t*			r_ivict_addr;		  // line address [depth]
+    bool*			r_ivict_valid;		  // valid line [depth]
+    uint32_t*			r_ivict_buf;		  // line data [depth*icache_words]
+
+    // Stream buffer (instruction prefetch)
+    sc_register<uint32_t>	r_ipref_last;		  // last line address in the stream
+    uint32_t*			r_ipref_addr;		  // line address [depth]
+    int*			r_ipref_state;		  // slot state [depth]
+    uint32_t*			r_ipref_buf;		  // line data [depth*icache_words]
     sc_register<uint32_t>	r_icache_save_way;
     sc_register<uint32_t>	r_icache_save_set;
     sc_register<bool>		r_icache_miss_req;  	  // request to Pibus FSM
@@ -192,8 +466,17 @@ class PibusMips32Xcache : sc_module {
     sc_register<uint32_t>	r_pibus_addr; 		  // base address
     sc_register<uint32_t>	r_pibus_wdata;		  // written data
     sc_register<uint32_t>	r_pibus_opc;		  // transaction opc
+    sc_register<bool>		r_pibus_wb;		  // write-back burst when true
+    sc_register<bool>		r_pibus_wbuf;		  // write buffer transaction when true
     sc_register<bool>		r_pibus_rsp_ok;		  // transaction completed : success
     sc_register<bool>		r_pibus_rsp_error;	  // transaction completed : error  
+    sc_register<uint32_t>	r_pibus_first;		  // critical word index (read burst)
+    sc_register<uint32_t>	r_pibus_rmask;		  // received words (read burst)
+    sc_register<bool>		r_pibus_pref;		  // instruction prefetch when true
+    sc_register<uint32_t>	r_pibus_pref_slot;	  // prefetch buffer slot index
+    sc_register<uint32_t>	r_pibus_gnt_wait;	  // cycles waiting the bus grant
+    sc_register<bool>		r_pibus_retry;		  // read restarted after a RETRY
+    sc_register<uint32_t>	r_pibus_mshr;		  // MSHR index of the data read
     uint32_t			r_pibus_buf[32];	  // data buffer 
 
     sc_register<bool>           r_snoop_dcache_inval_req; // dcache slot must be invalidated
@@ -208,14 +491,22 @@ class PibusMips32Xcache : sc_module {
     GenericFifo<uint32_t>      	r_wbuf_data;
     GenericFifo<uint32_t>      	r_wbuf_addr;
     GenericFifo<uint32_t>      	r_wbuf_type;
+
+    // Write buffer merging
+    sc_register<uint32_t>	r_wmerge_addr;		  // line address
+    sc_register<uint32_t>	r_wmerge_first;		  // index of the first word
+    sc_register<uint32_t>	r_wmerge_count;		  // number of words 
+    sc_register<uint32_t>	r_wmerge_be;		  // byte enable of the last word
+    sc_register<bool>		r_wmerge_cached;	  // cacheable line
+    uint32_t			r_wmerge_buf[32];	  // data buffer
    
     // caches
     soclib::GenericCache<uint32_t>	r_icache;
     soclib::GenericCache<uint32_t>	r_dcache;
 
     // Intrumentation counters
-    uint32_t			c_total_cycles;
-    uint32_t			c_frz_cycles;
+    uint64_t			c_total_cycles;
+    uint64_t			c_frz_cycles;
     uint32_t			c_imiss_count;
     uint32_t			c_imiss_frz;
     uint32_t			c_iunc_count;
@@ -229,6 +520,24 @@ class PibusMips32Xcache : sc_module {
     uint32_t			c_write_frz;
     uint32_t			c_sc_ok_count;
     uint32_t			c_sc_ko_count;
+    uint32_t			c_wmiss_count;
+    uint32_t			c_wb_count;
+    uint32_t			c_bus_write_count;
+    uint32_t			c_wbuf_get_count;
+    uint32_t			c_wbuf_trans_count;
+    uint32_t			c_ipref_count;
+    uint32_t			c_ipref_useful;
+    uint32_t			c_ipref_late;
+    uint32_t			c_dpref_count;
+    uint32_t			c_dpref_useful;
+    uint32_t			c_dpref_late;
+    uint32_t			c_dpref_drop;
+    uint32_t			c_mshr_hit;
+    uint32_t			c_mshr_miss;
+    uint32_t			c_ivict_hit;
+    uint32_t			c_dvict_hit;
+    uint32_t			c_ffwd_count;
+    uint32_t			c_prof_drop;
 
     // DCACHE_FSM STATES
     enum{
@@ -244,6 +553,9 @@ class PibusMips32Xcache : sc_module {
 	DCACHE_ERROR,
         DCACHE_INVAL,
         DCACHE_SC_WAIT,
+        DCACHE_MISS_WB,
+        DCACHE_FLUSH,
+        DCACHE_SYNC,
     };
 
     // ICACHE_FSM STATES
@@ -268,8 +580,17 @@ class PibusMips32Xcache : sc_module {
 	PIBUS_WRITE_REQ,
 	PIBUS_WRITE_AD,
 	PIBUS_WRITE_DT,
+	PIBUS_WRITE_DTAD,
     };
 	
+    // PREFETCH BUFFER SLOT STATES
+    enum{
+	PREF_EMPTY,
+	PREF_WAIT,
+	PREF_PENDING,
+	PREF_VALID,
+    };
+
     // SNOOP_FSM STATES
     enum{
 	SNOOP_IDLE,
@@ -277,6 +598,56 @@ class PibusMips32Xcache : sc_module {
 	SNOOP_FLUSH,
     };
 
+    // PROFILER EVENTS
+    enum{
+	PROF_EXEC,
+	PROF_FRZ,
+	PROF_IMISS,
+	PROF_DMISS,
+	PROF_UNC,
+    };
+
+    // copy a dirty line in the write-back buffer
+    void dcacheWriteBack(size_t way, size_t set);
+
+    // test if the data request can be served by the miss buffer
+    bool dcacheEarlyRestart();
+
+    // release the prefetch buffer slot after a prefetch error
+    void prefCancel();
+
+    // validate the prefetch buffer slot at the end of a prefetch
+    void prefComplete();
+
+    // data prefetch buffer lookup, stride detection & invalidation
+    bool dprefLookup(uint32_t line);
+    void dprefTrain(uint32_t line);
+    void dprefInval(uint32_t line);
+
+    // victim caches lookup, line insertion & invalidation
+    bool victLookup(bool ins, uint32_t line, size_t* slot);
+    void victInsert(bool ins, size_t way, size_t set, uint32_t line, size_t slot);
+    void victInval(bool ins, uint32_t line);
+
+    // functional mode : memory access & cache line refill
+    bool functionalRead(uint32_t addr, uint32_t* data);
+    bool functionalWrite(uint32_t addr, uint32_t data, uint32_t be);
+    bool functionalRefill(bool ins, uint32_t line);
+
+    // MSHR allocation, lookup & conflict detection (non-blocking data cache)
+    size_t mshrAlloc(size_t way, size_t set);
+    bool mshrLookup(uint32_t line, size_t* index);
+    size_t mshrActive();
+    bool mshrConflict();
+
+    // profiler : hash table lookup & event counting
+    ProfileEntry* profileEntry(uint32_t pc);
+    void profileCount(uint32_t pc, size_t event);
+
+    // checkpoint : caches and FIFOs content
+    void cacheCheckpoint(PibusCheckpoint& ckpt, bool ins);
+    void fifoCheckpoint(PibusCheckpoint& ckpt, GenericFifo<uint32_t>& fifo);
+
 protected:
 
     SC_HAS_PROCESS(PibusMips32Xcache);
@@ -309,7 +680,15 @@ public:
 			uint32_t		dcache_sets,	// number of icache sets
 			uint32_t		dcache_words,	// number of words per line
                 	uint32_t		fifo_depth,	// write buffer depth
-			bool		snoop_active = true);	// snoop activation 
+			bool		snoop_active = true,	// snoop activation 
+			bool		write_back = false,	// write-back policy
+			bool		wbuf_merge = false,	// write buffer merging
+			uint32_t	iprefetch_depth = 0,	// stream buffer depth
+			uint32_t	dprefetch_depth = 0,	// prefetch buffer depth
+			uint32_t	dcache_mshr = 0,	// number of MSHRs
+			uint32_t	victim_depth = 0,	// victim caches depth
+			uint32_t	profile_size = 0,	// profiler hash table entries
+			uint32_t	dpref_max_wait = 2);	// data prefetch bus wait limit
 
     ~PibusMips32Xcache ();
 
@@ -318,6 +697,24 @@ public:
     void genMoore();
     void printStatistics();
     void printTrace();
+    uint64_t getCycles();
+    uint64_t getInstructions();
+
+    // fast-forward mode
+    void addFunctionalMemory(PibusFunctionalMemory* mem);
+    bool functionalReady();
+    size_t functionalRun(size_t ncycles);
+
+    // idle cycles skipping
+    uint32_t idleCycles();
+    void skipCycles(uint32_t ncycles);
+
+    // checkpoint
+    bool checkpointReady();
+    void checkpoint(PibusCheckpoint& ckpt);
+
+    // per-PC profiler report
+    void printProfile(const Loader &loader, size_t nloops = 4);
 
 }; // end structure PibusMips32Xcache
  
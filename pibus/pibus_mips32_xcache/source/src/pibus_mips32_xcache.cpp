@@ -6,12 +6,17 @@
 // This program is released under the GNU public license
 /////////////////////////////////////////////////////////////////////////////        
 
+#include <algorithm>
+#include <map>
 #include "pibus_mips32_xcache.h"
 #include "alloc_elems.h"
 
 using namespace soclib::caba;
 using namespace soclib::common;
 
+#define PROF_EMPTY	0xFFFFFFFF	// unused profiler entry (not a valid instruction address)
+#define GDB_REG_SR	32		// CP0 status register index in the GDB registers
+
 namespace soclib { namespace caba {
 
 using namespace soclib::caba;
@@ -36,6 +41,116 @@ inline uint32_t be2mask(uint32_t be)
     }
 }
 
+//////////////////////////////////////////
+inline uint32_t opc2be(uint32_t opc)
+{
+    switch(opc) {
+    case PIBUS_OPC_BY0 : return 0x1;
+    case PIBUS_OPC_BY1 : return 0x2;
+    case PIBUS_OPC_BY2 : return 0x4;
+    case PIBUS_OPC_BY3 : return 0x8;
+    case PIBUS_OPC_HW0 : return 0x3;
+    case PIBUS_OPC_HW1 : return 0xC;
+    default            : return 0xF;
+    }
+}
+
+//////////////////////////////////////////
+// returns NOP if the BE value cannot be
+// encoded as a single word write opc
+inline uint32_t be2opc(uint32_t be)
+{
+    switch(be) {
+    case 0x1 : return PIBUS_OPC_BY0;
+    case 0x2 : return PIBUS_OPC_BY1;
+    case 0x4 : return PIBUS_OPC_BY2;
+    case 0x8 : return PIBUS_OPC_BY3;
+    case 0x3 : return PIBUS_OPC_HW0;
+    case 0xC : return PIBUS_OPC_HW1;
+    case 0xF : return PIBUS_OPC_WDU;
+    default  : return PIBUS_OPC_NOP;
+    }
+}
+
+//////////////////////////////////////////
+inline uint32_t opc2nwords(uint32_t opc)
+{
+    switch(opc) {
+    case PIBUS_OPC_WD2  : return 2;
+    case PIBUS_OPC_WD4  : return 4;
+    case PIBUS_OPC_WD8  : return 8;
+    case PIBUS_OPC_WD16 : return 16;
+    case PIBUS_OPC_WD32 : return 32;
+    default             : return 1;
+    }
+}
+
+//////////////////////////////////////////
+inline uint32_t nwords2opc(uint32_t nwords)
+{
+    switch(nwords) {
+    case 2  : return PIBUS_OPC_WD2;
+    case 4  : return PIBUS_OPC_WD4;
+    case 8  : return PIBUS_OPC_WD8;
+    case 16 : return PIBUS_OPC_WD16;
+    case 32 : return PIBUS_OPC_WD32;
+    default : return PIBUS_OPC_WDU;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// selects the prefetch buffer slot in WAIT state with the lowest address
+inline bool prefSelect(uint32_t* addr, int* state, size_t depth, size_t* slot, int wait_state)
+{
+    bool found = false;
+    for ( size_t i = 0 ; i < depth ; i++ )
+    {
+        if ( (state[i] == wait_state) and (!found or (addr[i] < addr[*slot])) ) 
+        {
+            found = true;
+            *slot = i;
+        }
+    }
+    return found;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// returns true (and the target address) if the MIPS32 instruction is a 
+// conditional branch or a J jump (the calls are not taken into account)
+inline bool branchTarget(uint32_t pc, uint32_t ins, uint32_t* target)
+{
+    uint32_t op = ins >> 26;
+    uint32_t rt = (ins >> 16) & 0x1F;
+    if ( op == 0x2 )							// J
+    {
+        *target = ((pc + 4) & 0xF0000000) | ((ins & 0x03FFFFFF) << 2);
+        return true;
+    }
+    if ( ((op >= 0x4) and (op <= 0x7)) or 				// BEQ BNE BLEZ BGTZ
+         ((op >= 0x14) and (op <= 0x17)) or 				// BEQL BNEL BLEZL BGTZL
+         ((op == 0x1) and (rt <= 0x3)) )				// BLTZ BGEZ BLTZL BGEZL
+    {
+        *target = pc + 4 + ((uint32_t)(int32_t)(int16_t)(ins & 0xFFFF) << 2);
+        return true;
+    }
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// profiler report : events summed on a function or a loop
+struct ProfileSum {
+    std::string		name;
+    uint32_t		first;		// loop first instruction address
+    uint32_t		last;		// loop last instruction address
+    uint32_t		cycles;		// executed + frozen cycles
+    uint32_t		count[5];	// events (as in the profiler entries)
+};
+
+template<typename T>
+inline bool profileAddressLess(const T& a, const T& b) { return a.pc < b.pc; }
+
+inline bool profileCyclesMore(const ProfileSum& a, const ProfileSum& b) { return a.cycles > b.cycles; }
+
 //////////////////////////////////////////////////////////////////////////
 PibusMips32Xcache::PibusMips32Xcache (	sc_module_name 		name, 
 					PibusSegmentTable 	&segtab,
@@ -47,7 +162,15 @@ PibusMips32Xcache::PibusMips32Xcache (	sc_module_name 		name,
 					uint32_t		dcache_sets,
 					uint32_t		dcache_words,
 					uint32_t		wbuf_depth,
-					bool			snoop_active)
+					bool			snoop_active,
+					bool			write_back,
+					bool			wbuf_merge,
+					uint32_t		iprefetch_depth,
+					uint32_t		dprefetch_depth,
+					uint32_t		dcache_mshr,
+					uint32_t		victim_depth,
+					uint32_t		profile_size,
+					uint32_t		dpref_max_wait)
     : m_name(name),
       m_cached_table(segtab.getCachedTable()),
       m_icache_sets(icache_sets),
@@ -59,6 +182,14 @@ PibusMips32Xcache::PibusMips32Xcache (	sc_module_name 		name,
       m_msb_shift(32 - segtab.getMSBnumber()),
       m_msb_mask((0x1 << segtab.getMSBnumber()) - 1),
       m_snoop_active(snoop_active),
+      m_write_back(write_back),
+      m_wbuf_merge(wbuf_merge),
+      m_ipref_depth(iprefetch_depth),
+      m_dpref_depth(dprefetch_depth),
+      m_mshr_count(dcache_mshr),
+      m_vict_depth(victim_depth),
+      m_prof_size(profile_size),
+      m_dpref_max_wait(dpref_max_wait),
 
       r_proc( (std::string)name, proc_id),
 
@@ -72,15 +203,49 @@ PibusMips32Xcache::PibusMips32Xcache (	sc_module_name 		name,
 
       r_llsc_pending("r_llsc_pending"),
       r_llsc_addr("r_llsc_addr"),
+      r_dcache_wb_req("r_dcache_wb_req"),
+      r_dcache_wb_addr("r_dcache_wb_addr"),
+      r_dcache_flush_slot("r_dcache_flush_slot"),
+      r_dcache_pref_hit("r_dcache_pref_hit"),
+      r_dcache_pref_slot("r_dcache_pref_slot"),
+      r_dcache_save_victim("r_dcache_save_victim"),
+      r_dcache_vict_hit("r_dcache_vict_hit"),
+      r_dcache_vict_slot("r_dcache_vict_slot"),
+
+      r_dvict_ptr("r_dvict_ptr"),
+
+      r_dpref_last("r_dpref_last"),
+      r_dpref_stride("r_dpref_stride"),
+
+      r_mshr_fifo("r_mshr_fifo", dcache_mshr ? dcache_mshr : 1),
 
       r_icache_fsm("r_icache_fsm"),
       r_icache_save_addr("r_icache_save_addr"),
+      r_icache_save_word("r_icache_save_word"),
+      r_icache_pref_hit("r_icache_pref_hit"),
+      r_icache_pref_slot("r_icache_pref_slot"),
+      r_icache_save_victim("r_icache_save_victim"),
+      r_icache_vict_hit("r_icache_vict_hit"),
+      r_icache_vict_slot("r_icache_vict_slot"),
+
+      r_ivict_ptr("r_ivict_ptr"),
+
+      r_ipref_last("r_ipref_last"),
 
       r_pibus_fsm("r_pibus_fsm"),
       r_pibus_wcount("r_pibus_wcount"),
       r_pibus_addr("r_pibus_addr"),
       r_pibus_wdata("r_pibus_wdata"),
       r_pibus_opc("r_pibus_opc"),
+      r_pibus_wb("r_pibus_wb"),
+      r_pibus_wbuf("r_pibus_wbuf"),
+      r_pibus_first("r_pibus_first"),
+      r_pibus_rmask("r_pibus_rmask"),
+      r_pibus_pref("r_pibus_pref"),
+      r_pibus_pref_slot("r_pibus_pref_slot"),
+      r_pibus_gnt_wait("r_pibus_gnt_wait"),
+      r_pibus_retry("r_pibus_retry"),
+      r_pibus_mshr("r_pibus_mshr"),
 
       r_snoop_dcache_inval_req("r_snoop_dcache_inval_req"),
       r_snoop_dcache_inval_way("r_snoop_dcache_inval_way"),
@@ -93,6 +258,12 @@ PibusMips32Xcache::PibusMips32Xcache (	sc_module_name 		name,
       r_wbuf_addr("r_wbuf_addr", wbuf_depth),
       r_wbuf_type("r_wbuf_type", wbuf_depth),
 
+      r_wmerge_addr("r_wmerge_addr"),
+      r_wmerge_first("r_wmerge_first"),
+      r_wmerge_count("r_wmerge_count"),
+      r_wmerge_be("r_wmerge_be"),
+      r_wmerge_cached("r_wmerge_cached"),
+
       r_icache("r_icache", icache_ways, icache_sets, icache_words),
       r_dcache("r_dcache", dcache_ways, dcache_sets, dcache_words),
 
@@ -146,6 +317,86 @@ PibusMips32Xcache::PibusMips32Xcache (	sc_module_name 		name,
         std::cout << "The data cache line width can be 1,2,4,8,16,32 words" << std::endl;
         exit(0);
     } 
+    if ( m_write_back && m_snoop_active )
+    {
+        std::cout << "ERROR in PibusMips32Xcache : " << name << std::endl;
+        std::cout << "The write-back policy cannot be used with the snoop mechanism" << std::endl;
+        exit(0);
+    } 
+
+    if ( (m_ipref_depth > 8) || (m_dpref_depth > 8) )
+    {
+        std::cout << "ERROR in PibusMips32Xcache : " << name << std::endl;
+        std::cout << "The prefetch buffers depth cannot be larger than 8" << std::endl;
+        exit(0);
+    } 
+
+    if ( m_mshr_count > 8 )
+    {
+        std::cout << "ERROR in PibusMips32Xcache : " << name << std::endl;
+        std::cout << "The number of MSHRs cannot be larger than 8" << std::endl;
+        exit(0);
+    } 
+
+    if ( m_vict_depth > 16 )
+    {
+        std::cout << "ERROR in PibusMips32Xcache : " << name << std::endl;
+        std::cout << "The victim caches depth cannot be larger than 16" << std::endl;
+        exit(0);
+    } 
+
+    if ( m_dpref_max_wait == 0 )
+    {
+        std::cout << "ERROR in PibusMips32Xcache : " << name << std::endl;
+        std::cout << "The data prefetch max wait cannot be zero" << std::endl;
+        exit(0);
+    } 
+
+    if ( m_prof_size and ((m_prof_size < 16) or (m_prof_size & (m_prof_size - 1))) )
+    {
+        std::cout << "ERROR in PibusMips32Xcache : " << name << std::endl;
+        std::cout << "The profiler size must be a power of 2 no smaller than 16" << std::endl;
+        exit(0);
+    } 
+    m_prof_shift = 32;
+    for ( uint32_t size = m_prof_size ; size > 1 ; size = size >> 1 ) m_prof_shift--;
+
+    r_dcache_dirty     = new bool[dcache_ways*dcache_sets];
+    r_dcache_slot_addr = new uint32_t[dcache_ways*dcache_sets];
+    r_ipref_addr       = new uint32_t[iprefetch_depth];
+    r_ipref_state      = new int[iprefetch_depth];
+    r_ipref_buf        = new uint32_t[iprefetch_depth*icache_words];
+    r_dpref_addr       = new uint32_t[dprefetch_depth];
+    r_dpref_state      = new int[dprefetch_depth];
+    r_dpref_buf        = new uint32_t[dprefetch_depth*dcache_words];
+    r_mshr_valid       = new bool[dcache_mshr];
+    r_mshr_inval       = new bool[dcache_mshr];
+    r_mshr_addr        = new uint32_t[dcache_mshr];
+    r_mshr_way         = new uint32_t[dcache_mshr];
+    r_mshr_set         = new uint32_t[dcache_mshr];
+    r_mshr_word        = new uint32_t[dcache_mshr];
+    r_mshr_type        = new uint32_t[dcache_mshr];
+    r_mshr_wdata       = new uint32_t[dcache_mshr];
+    r_mshr_be          = new uint32_t[dcache_mshr];
+    r_ivict_addr       = new uint32_t[victim_depth];
+    r_ivict_valid      = new bool[victim_depth];
+    r_ivict_buf        = new uint32_t[victim_depth*icache_words];
+    r_dvict_addr       = new uint32_t[victim_depth];
+    r_dvict_valid      = new bool[victim_depth];
+    r_dvict_buf        = new uint32_t[victim_depth*dcache_words];
+    m_prof_table       = new ProfileEntry[profile_size];
+    m_skip             = 0;
+
+    // cacheable segments (lookup of the valid lines for checkpoint)
+    std::list<SegmentTableEntry> seglist = segtab.getSegmentList();
+    for ( std::list<SegmentTableEntry>::iterator seg = seglist.begin() ; seg != seglist.end() ; seg++ )
+    {
+        if ( (*seg).getCached() )
+        {
+            m_cached_base.push_back( (*seg).getBase() );
+            m_cached_size.push_back( (*seg).getSize() );
+        }
+    }
 
     std::cout << std::endl << "Instanciation of PibusMips32Xcache : " << m_name << std::dec << std::endl;
     std::cout << "    proc_id      = " << proc_id      << std::endl;
@@ -157,6 +408,14 @@ PibusMips32Xcache::PibusMips32Xcache (	sc_module_name 		name,
     std::cout << "    dcache_words = " << dcache_words << std::endl;
     std::cout << "    wbuf_depth   = " << wbuf_depth   << std::endl;
     std::cout << "    snoop        = " << snoop_active << std::endl;
+    std::cout << "    write_back   = " << write_back   << std::endl;
+    std::cout << "    wbuf_merge   = " << wbuf_merge   << std::endl;
+    std::cout << "    ipref_depth  = " << iprefetch_depth << std::endl;
+    std::cout << "    dpref_depth  = " << dprefetch_depth << std::endl;
+    std::cout << "    dcache_mshr  = " << dcache_mshr  << std::endl;
+    std::cout << "    victim_depth = " << victim_depth << std::endl;
+    std::cout << "    profile_size = " << profile_size << std::endl;
+    std::cout << "    dpref_wait   = " << dpref_max_wait << std::endl;
  
     strcpy(m_dcache_fsm_str[0],  "DCACHE_IDLE");
     strcpy(m_dcache_fsm_str[1],  "DCACHE_WRITE_UPDT");
@@ -170,6 +429,9 @@ PibusMips32Xcache::PibusMips32Xcache (	sc_module_name 		name,
     strcpy(m_dcache_fsm_str[9],  "DCACHE_ERROR");
     strcpy(m_dcache_fsm_str[10], "DCACHE_INVAL");
     strcpy(m_dcache_fsm_str[11], "DCACHE_SC_WAIT");
+    strcpy(m_dcache_fsm_str[12], "DCACHE_MISS_WB");
+    strcpy(m_dcache_fsm_str[13], "DCACHE_FLUSH");
+    strcpy(m_dcache_fsm_str[14], "DCACHE_SYNC");
 
     strcpy(m_icache_fsm_str[0], "ICACHE_IDLE");
     strcpy(m_icache_fsm_str[1], "ICACHE_MISS_SELECT");
@@ -188,15 +450,884 @@ PibusMips32Xcache::PibusMips32Xcache (	sc_module_name 		name,
     strcpy(m_pibus_fsm_str[5], "PIBUS_WRITE_REQ");
     strcpy(m_pibus_fsm_str[6], "PIBUS_WRITE_AD");
     strcpy(m_pibus_fsm_str[7], "PIBUS_WRITE_DT");
+    strcpy(m_pibus_fsm_str[8], "PIBUS_WRITE_DTAD");
 
 } // end  constructor
 
-PibusMips32Xcache::~PibusMips32Xcache () {} 
+PibusMips32Xcache::~PibusMips32Xcache () 
+{
+    delete [] r_dcache_dirty;
+    delete [] r_dcache_slot_addr;
+    delete [] r_ipref_addr;
+    delete [] r_ipref_state;
+    delete [] r_ipref_buf;
+    delete [] r_dpref_addr;
+    delete [] r_dpref_state;
+    delete [] r_dpref_buf;
+    delete [] r_mshr_valid;
+    delete [] r_mshr_inval;
+    delete [] r_mshr_addr;
+    delete [] r_mshr_way;
+    delete [] r_mshr_set;
+    delete [] r_mshr_word;
+    delete [] r_mshr_type;
+    delete [] r_mshr_wdata;
+    delete [] r_mshr_be;
+    delete [] r_ivict_addr;
+    delete [] r_ivict_valid;
+    delete [] r_ivict_buf;
+    delete [] r_dvict_addr;
+    delete [] r_dvict_valid;
+    delete [] r_dvict_buf;
+    delete [] m_prof_table;
+} 
+
+//////////////////////////////////////////////////////////////////
+// This function copies a dirty line, identified by the (way,set)
+// slot, in the write-back buffer, and posts a WB request to the
+// PIBUS FSM. It must be called only when the buffer is empty.
+//////////////////////////////////////////////////////////////////
+void PibusMips32Xcache::dcacheWriteBack(size_t way, size_t set)
+{
+    size_t	slot = way*m_dcache_sets + set;
+    uint32_t	addr = r_dcache_slot_addr[slot];
+    for ( size_t word = 0 ; word < m_dcache_words ; word++ )
+    {
+        size_t	dummy_way;
+        size_t	dummy_set;
+        size_t	dummy_word;
+        r_dcache.read( addr + (word << 2),
+                       &r_dcache_wb_buf[word],
+                       &dummy_way,
+                       &dummy_set,
+                       &dummy_word );
+    }
+    r_dcache_dirty[slot] = false;
+    r_dcache_wb_addr     = addr;
+    r_dcache_wb_req      = true;
+    c_wb_count++;
+}
 
+///////////////////////////////////////////////
+// returns true if the processor data request
+// can be served from the r_pibus_buf buffer
+// (read request on the missing line) 
+bool PibusMips32Xcache::dcacheEarlyRestart()
+{
+    if ( !m_dreq.valid ) return false;
+    if ( r_dcache_save_type.read() == Iss2::DATA_WRITE ) return false;
+    if ( (m_dreq.addr & m_line_data_mask) != r_dcache_save_addr.read() ) return false;
+    if ( m_dreq.type == Iss2::DATA_READ ) return true;
+    // a LL request is served only if the reservation is registered
+    return ( (m_dreq.type == Iss2::DATA_LL) and 
+             r_llsc_pending.read() and 
+             (r_llsc_addr.read() == m_dreq.addr) );
+}
 
-////////////////////////////////////
+///////////////////////////////////////////////
+// releases the prefetch buffer slot in case of
+// bus error on a prefetch transaction 
+void PibusMips32Xcache::prefCancel()
+{
+    uint32_t	slot  = r_pibus_pref_slot.read();
+    uint32_t*	addr  = r_pibus_ins.read() ? r_ipref_addr  : r_dpref_addr;
+    int*	state = r_pibus_ins.read() ? r_ipref_state : r_dpref_state;
+    if ( (state[slot] == PREF_PENDING) and
+         (addr[slot] == r_pibus_addr.read()) ) state[slot] = PREF_EMPTY;
+}
+
+///////////////////////////////////////////////
+// validates the prefetch buffer slot at the end
+// of a prefetch transaction, if the slot has not
+// been re-allocated or invalidated meanwhile
+void PibusMips32Xcache::prefComplete()
+{
+    uint32_t	slot  = r_pibus_pref_slot.read();
+    uint32_t*	addr  = r_pibus_ins.read() ? r_ipref_addr  : r_dpref_addr;
+    int*	state = r_pibus_ins.read() ? r_ipref_state : r_dpref_state;
+    if ( (state[slot] == PREF_PENDING) and
+         (addr[slot] == r_pibus_addr.read()) ) state[slot] = PREF_VALID;
+}
+
+///////////////////////////////////////////////
+// returns true if the missing line is valid or 
+// pending in the data prefetch buffer
+bool PibusMips32Xcache::dprefLookup(uint32_t line)
+{
+    for ( size_t slot = 0 ; slot < m_dpref_depth ; slot++ )
+    {
+        if ( r_dpref_addr[slot] != line ) continue;
+        if ( r_dpref_state[slot] == PREF_VALID ) 
+        {
+            c_dpref_useful++;
+            r_dcache_pref_slot = slot;
+            return true;
+        }
+        if ( r_dpref_state[slot] == PREF_PENDING ) 
+        {
+            c_dpref_late++;
+            r_dcache_pref_slot = slot;
+            return true;
+        }
+    }
+    return false;
+}
+
+///////////////////////////////////////////////
+// stride detection on the missing line address :
+// when the same stride is observed twice, the
+// prefetch buffer is allocated to the next lines
+void PibusMips32Xcache::dprefTrain(uint32_t line)
+{
+    if ( m_dpref_depth == 0 ) return;
+
+    uint32_t stride = line - r_dpref_last.read();
+    r_dpref_last    = line;
+    r_dpref_stride  = stride;
+    if ( (stride == 0) or (stride != r_dpref_stride.read()) ) return;
+
+    // release the slots that are not in the new window
+    for ( size_t slot = 0 ; slot < m_dpref_depth ; slot++ )
+    {
+        bool in_window = false;
+        for ( size_t k = 1 ; k <= m_dpref_depth ; k++ )
+        {
+            if ( r_dpref_addr[slot] == line + k*stride ) in_window = true;
+        }
+        if ( !in_window and (r_dpref_state[slot] != PREF_PENDING) ) 
+            r_dpref_state[slot] = PREF_EMPTY;
+    }
+    // allocate the missing lines of the window
+    for ( size_t k = 1 ; k <= m_dpref_depth ; k++ )
+    {
+        uint32_t	addr  = line + k*stride;
+        bool		found = false;
+        for ( size_t slot = 0 ; slot < m_dpref_depth ; slot++ )
+        {
+            if ( (r_dpref_state[slot] != PREF_EMPTY) and 
+                 (r_dpref_addr[slot] == addr) ) found = true;
+        }
+        for ( size_t slot = 0 ; (slot < m_dpref_depth) and !found ; slot++ )
+        {
+            if ( r_dpref_state[slot] == PREF_EMPTY )
+            {
+                r_dpref_addr[slot]  = addr;
+                r_dpref_state[slot] = PREF_WAIT;
+                found = true;
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////
+// discards a line from the data prefetch buffer 
+void PibusMips32Xcache::dprefInval(uint32_t line)
+{
+    for ( size_t slot = 0 ; slot < m_dpref_depth ; slot++ )
+    {
+        if ( r_dpref_addr[slot] == line ) r_dpref_state[slot] = PREF_EMPTY;
+    }
+}
+
+///////////////////////////////////////////////
+// returns true if the line is valid in the
+// victim cache, and the victim cache slot
+bool PibusMips32Xcache::victLookup(bool ins, uint32_t line, size_t* slot)
+{
+    uint32_t*	addr  = ins ? r_ivict_addr  : r_dvict_addr;
+    bool*	valid = ins ? r_ivict_valid : r_dvict_valid;
+    for ( size_t i = 0 ; i < m_vict_depth ; i++ )
+    {
+        if ( valid[i] and (addr[i] == line) )
+        {
+            *slot = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+///////////////////////////////////////////////
+// copies the line contained in the (way,set) 
+// cache slot in the victim cache slot. 
+// The victim cache slot is released if the
+// cache slot does not contain a valid line.
+void PibusMips32Xcache::victInsert(bool ins, size_t way, size_t set, uint32_t line, size_t slot)
+{
+    soclib::GenericCache<uint32_t>&	cache = ins ? r_icache : r_dcache;
+    size_t	words = ins ? m_icache_words : m_dcache_words;
+    uint32_t*	addr  = ins ? r_ivict_addr  : r_dvict_addr;
+    bool*	valid = ins ? r_ivict_valid : r_dvict_valid;
+    uint32_t*	buf   = ins ? r_ivict_buf   : r_dvict_buf;
+    size_t	hit_way;
+    size_t	hit_set;
+    size_t	hit_word;
+
+    valid[slot] = cache.hit( line, &hit_way, &hit_set, &hit_word ) and 
+                  (hit_way == way) and (hit_set == set);
+    if ( !valid[slot] ) return;
+
+    addr[slot] = line;
+    for ( size_t word = 0 ; word < words ; word++ )
+    {
+        cache.read( line + (word << 2), &buf[slot*words + word] );
+    }
+}
+
+///////////////////////////////////////////////
+// discards a line from the victim cache
+void PibusMips32Xcache::victInval(bool ins, uint32_t line)
+{
+    size_t slot;
+    if ( victLookup( ins, line, &slot ) ) 
+    {
+        if ( ins ) r_ivict_valid[slot] = false;
+        else       r_dvict_valid[slot] = false;
+    }
+}
+
+///////////////////////////////////////////////
+// functional read in the registered memories
+bool PibusMips32Xcache::functionalRead(uint32_t addr, uint32_t* data)
+{
+    for ( size_t i = 0 ; i < m_fmem.size() ; i++ )
+    {
+        if ( m_fmem[i]->functionalRead( addr, data ) ) return true;
+    }
+    return false;
+}
+
+///////////////////////////////////////////////
+// functional write in the registered memories
+bool PibusMips32Xcache::functionalWrite(uint32_t addr, uint32_t data, uint32_t be)
+{
+    for ( size_t i = 0 ; i < m_fmem.size() ; i++ )
+    {
+        if ( m_fmem[i]->functionalWrite( addr, data, be ) ) return true;
+    }
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////
+// This function updates the ICACHE or DCACHE with a line read 
+// in the functional memories. The victim slot is selected as in
+// the cycle-accurate mode, and a dirty victim is written back.
+// It returns false if the line is not mapped in memory.
+//////////////////////////////////////////////////////////////////
+bool PibusMips32Xcache::functionalRefill(bool ins, uint32_t line)
+{
+    soclib::GenericCache<uint32_t>&	cache = ins ? r_icache : r_dcache;
+    size_t	words = ins ? m_icache_words : m_dcache_words;
+    uint32_t	buf[32];
+
+    for ( size_t word = 0 ; word < words ; word++ )
+    {
+        if ( !functionalRead( line + (word << 2), &buf[word] ) ) return false;
+    }
+
+    uint32_t	victim = 0;	// unused
+    uint32_t	nline;		// unused
+    size_t	way;
+    size_t	set;
+    bool	valid = cache.victim_select( line, &victim, &way, &set );
+    size_t	slot  = way*m_dcache_sets + set;
+    if ( !ins and valid and m_write_back and r_dcache_dirty[slot] ) 
+    {
+        uint32_t addr = r_dcache_slot_addr[slot];
+        for ( size_t word = 0 ; word < words ; word++ )
+        {
+            uint32_t data;
+            r_dcache.read( addr + (word << 2), &data );
+            functionalWrite( addr + (word << 2), data, 0xF );
+        }
+    }
+    cache.inval( way, set, &nline );
+    cache.update( line, way, set, buf );
+    victInval( ins, line );
+    if ( !ins and m_write_back )
+    {
+        r_dcache_dirty[slot]     = false;
+        r_dcache_slot_addr[slot] = line;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////
+// allocates a free MSHR to the missing line 
+// registered in the r_dcache_save registers, 
+// and returns the MSHR index 
+size_t PibusMips32Xcache::mshrAlloc(size_t way, size_t set)
+{
+    size_t index = 0;
+    while ( r_mshr_valid[index] ) index++;
+    r_mshr_valid[index] = true;
+    r_mshr_inval[index] = false;
+    r_mshr_addr[index]  = r_dcache_save_addr.read();
+    r_mshr_way[index]   = way;
+    r_mshr_set[index]   = set;
+    r_mshr_word[index]  = r_dcache_save_word.read();
+    r_mshr_type[index]  = r_dcache_save_type.read();
+    r_mshr_wdata[index] = r_dcache_save_wdata.read();
+    r_mshr_be[index]    = r_dcache_save_be.read();
+    return index;
+}
+
+///////////////////////////////////////////////
+// returns true if there is a pending refill 
+// for the line, and the MSHR index
+bool PibusMips32Xcache::mshrLookup(uint32_t line, size_t* index)
+{
+    for ( size_t i = 0 ; i < m_mshr_count ; i++ )
+    {
+        if ( r_mshr_valid[i] and (r_mshr_addr[i] == line) )
+        {
+            *index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+///////////////////////////////////////////////
+// returns the number of pending refills
+size_t PibusMips32Xcache::mshrActive()
+{
+    size_t count = 0;
+    for ( size_t i = 0 ; i < m_mshr_count ; i++ ) 
+    {
+        if ( r_mshr_valid[i] ) count++;
+    }
+    return count;
+}
+
+///////////////////////////////////////////////
+// returns true if the processor data request
+// must be delayed until a pending refill completes
+bool PibusMips32Xcache::mshrConflict()
+{
+    size_t	active = mshrActive();
+    if ( active == 0 ) return false;
+
+    bool	cacheable = m_cached_table[((m_dreq.addr >> m_msb_shift) & m_msb_mask)];
+    uint32_t	line      = m_dreq.addr & m_line_data_mask;
+    size_t	index;
+
+    // the DCACHE must be quiescent for SC, XTN and uncached read requests
+    if ( (m_dreq.type == Iss2::DATA_SC) or 
+         (m_dreq.type == Iss2::XTN_WRITE) ) return true;
+    if ( !cacheable ) return (m_dreq.type != Iss2::DATA_WRITE);
+
+    // the line has a pending refill
+    if ( mshrLookup( line, &index ) ) return true;
+
+    // the request is a hit, or a write-through miss
+    size_t	way, set, word;
+    if ( r_dcache.hit( m_dreq.addr, &way, &set, &word ) ) return false;
+    if ( (m_dreq.type == Iss2::DATA_WRITE) and !m_write_back ) return false;
+
+    // the miss requires a free MSHR (except for a victim cache hit)
+    // and a victim slot that is not reserved
+    if ( (active == m_mshr_count) and !victLookup( false, line, &index ) ) return true;
+    uint32_t	victim;		// unused
+    r_dcache.victim_select( line, &victim, &way, &set );
+    for ( size_t i = 0 ; i < m_mshr_count ; i++ )
+    {
+        if ( r_mshr_valid[i] and (r_mshr_way[i] == way) and (r_mshr_set[i] == set) ) return true;
+    }
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////
+// This function returns the profiler entry associated to the pc
+// instruction address (multiplicative hash and linear probing).
+// A new entry is allocated only if the table is less than 3/4 
+// full, to guarantee short probe sequences. 
+// It returns NULL if the entry cannot be allocated.
+//////////////////////////////////////////////////////////////////
+PibusMips32Xcache::ProfileEntry* PibusMips32Xcache::profileEntry(uint32_t pc)
+{
+    size_t index = (uint32_t)((pc >> 2) * 0x9E3779B1) >> m_prof_shift;
+    while ( true )
+    {
+        ProfileEntry* entry = &m_prof_table[index];
+        if ( entry->pc == pc ) return entry;
+        if ( entry->pc == PROF_EMPTY )
+        {
+            if ( m_prof_used >= (m_prof_size >> 2)*3 ) return NULL;
+            entry->pc = pc;
+            for ( size_t i = 0 ; i < 5 ; i++ ) entry->count[i] = 0;
+            m_prof_used++;
+            return entry;
+        }
+        index = (index + 1) & (m_prof_size - 1);
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+// This function increments the event counter of the pc entry.
+// It does nothing if the profiler is not activated.
+//////////////////////////////////////////////////////////////////
+void PibusMips32Xcache::profileCount(uint32_t pc, size_t event)
+{
+    if ( m_prof_size == 0 ) return;
+    ProfileEntry* entry = profileEntry( pc );
+    if ( entry ) entry->count[event]++;
+    else         c_prof_drop++;
+}
+
+//////////////////////////////////////////////////////////////////
+// This function saves or restores the valid lines of the ICACHE
+// or DCACHE (address, way, set and data). As the GenericCache tags
+// are not accessible, the valid lines are found by a lookup of all
+// lines of the cacheable segments. The LRU state is not restored.
+//////////////////////////////////////////////////////////////////
+void PibusMips32Xcache::cacheCheckpoint(PibusCheckpoint& ckpt, bool ins)
+{
+    soclib::GenericCache<uint32_t>&	cache = ins ? r_icache : r_dcache;
+    size_t	words = ins ? m_icache_words : m_dcache_words;
+    uint32_t	mask  = ins ? m_line_inst_mask : m_line_data_mask;
+    std::vector<uint32_t> lines;	// address, way, set and data of each valid line
+
+    if ( ckpt.saving() )
+    {
+        for ( size_t i = 0 ; i < m_cached_base.size() ; i++ )
+        {
+            uint64_t end = (uint64_t)m_cached_base[i] + m_cached_size[i];
+            for ( uint64_t line = m_cached_base[i] & mask ; line < end ; line += (words << 2) )
+            {
+                size_t	way;
+                size_t	set;
+                size_t	word;
+                if ( !cache.hit( (uint32_t)line, &way, &set, &word ) ) continue;
+                lines.push_back( (uint32_t)line );
+                lines.push_back( way );
+                lines.push_back( set );
+                for ( size_t w = 0 ; w < words ; w++ )
+                {
+                    uint32_t data;
+                    cache.read( (uint32_t)line + (w << 2), &data );
+                    lines.push_back( data );
+                }
+            }
+        }
+    }
+    ckpt.values( lines );
+    if ( !ckpt.saving() )
+    {
+        cache.reset();
+        for ( size_t i = 0 ; i < lines.size() ; i += words + 3 )
+        {
+            cache.update( lines[i], lines[i+1], lines[i+2], &lines[i+3] );
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+// This function saves or restores the content of a FIFO : the 
+// items are read, and written back in the same order.
+//////////////////////////////////////////////////////////////////
+void PibusMips32Xcache::fifoCheckpoint(PibusCheckpoint& ckpt, GenericFifo<uint32_t>& fifo)
+{
+    std::vector<uint32_t> items;
+    if ( ckpt.saving() )
+    {
+        while ( fifo.rok() )
+        {
+            items.push_back( fifo.read() );
+            fifo.simple_get();
+        }
+    }
+    ckpt.values( items );
+    fifo.init();
+    for ( size_t i = 0 ; i < items.size() ; i++ ) fifo.simple_put( items[i] );
+}
+
+///////////////////////////////////////////////////////////////////
+// The processor state is saved through the GDB registers interface,
+// that doesn't contain the pending data request, the next PC and 
+// the CP0 EPC register : it returns true when the processor has no 
+// pending data request, the requested instruction doesn't follow a 
+// branch or a jump, SR.EXL and SR.ERL are 0, and there is no LL/SC
+// reservation.
+///////////////////////////////////////////////////////////////////
+bool PibusMips32Xcache::checkpointReady()
+{
+    Iss2::InstructionRequest	ireq;
+    Iss2::DataRequest		dreq;
+    uint32_t			ins;
+
+    r_proc.getRequests( ireq, dreq );
+    if ( !ireq.valid or dreq.valid ) return false;
+    if ( r_llsc_pending.read() ) return false;
+    if ( r_proc.debugGetRegisterValue( GDB_REG_SR ) & 0x6 ) return false;	// SR.EXL or SR.ERL
+    if ( !functionalRead( ireq.addr - 4, &ins ) and 
+         !r_icache.read( ireq.addr - 4, &ins ) ) return false;
+
+    uint32_t opcode = ins >> 26;
+    if ( (opcode == 0x00) and (((ins & 0x3F) == 0x08) or ((ins & 0x3F) == 0x09)) ) return false; // JR, JALR
+    if ( (opcode >= 0x01) and (opcode <= 0x07) ) return false;	// BCOND, J, JAL, BEQ, BNE, BLEZ, BGTZ
+    if ( (opcode >= 0x14) and (opcode <= 0x17) ) return false;	// BEQL, BNEL, BLEZL, BGTZL
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////
+// This function saves or restores the state that is not stored in
+// registers. It must be called when checkpointReady() returns true.
+///////////////////////////////////////////////////////////////////
+void PibusMips32Xcache::checkpoint(PibusCheckpoint& ckpt)
+{
+    uint32_t params[10] = { m_icache_ways, m_icache_sets, m_icache_words,
+                            m_dcache_ways, m_dcache_sets, m_dcache_words,
+                            m_ipref_depth, m_dpref_depth, m_mshr_count, m_vict_depth };
+
+    ckpt.section( m_name );
+    for ( size_t i = 0 ; i < 10 ; i++ ) ckpt.check( params[i], "cache parameters" );
+
+    // processor registers
+    uint32_t nregs = r_proc.debugGetRegisterCount();
+    ckpt.check( nregs, "number of processor registers" );
+    for ( uint32_t reg = 0 ; reg < nregs ; reg++ )
+    {
+        uint32_t value = r_proc.debugGetRegisterValue( reg );
+        ckpt.value( value );
+        if ( !ckpt.saving() ) r_proc.debugSetRegisterValue( reg, value );
+    }
+
+    // caches & FIFOs
+    cacheCheckpoint( ckpt, true );
+    cacheCheckpoint( ckpt, false );
+    fifoCheckpoint( ckpt, r_wbuf_data );
+    fifoCheckpoint( ckpt, r_wbuf_addr );
+    fifoCheckpoint( ckpt, r_wbuf_type );
+    fifoCheckpoint( ckpt, r_mshr_fifo );
+
+    // data buffers
+    ckpt.state( r_dcache_wb_buf, sizeof(r_dcache_wb_buf) );
+    ckpt.state( r_pibus_buf, sizeof(r_pibus_buf) );
+    ckpt.state( r_wmerge_buf, sizeof(r_wmerge_buf) );
+
+    // dirty bits & slot addresses
+    size_t slots = m_dcache_ways * m_dcache_sets;
+    ckpt.state( r_dcache_dirty, slots * sizeof(bool) );
+    ckpt.state( r_dcache_slot_addr, slots * sizeof(uint32_t) );
+
+    // victim caches
+    ckpt.state( r_ivict_addr, m_vict_depth * sizeof(uint32_t) );
+    ckpt.state( r_ivict_valid, m_vict_depth * sizeof(bool) );
+    ckpt.state( r_ivict_buf, m_vict_depth * m_icache_words * sizeof(uint32_t) );
+    ckpt.state( r_dvict_addr, m_vict_depth * sizeof(uint32_t) );
+    ckpt.state( r_dvict_valid, m_vict_depth * sizeof(bool) );
+    ckpt.state( r_dvict_buf, m_vict_depth * m_dcache_words * sizeof(uint32_t) );
+
+    // prefetch buffers
+    ckpt.state( r_ipref_addr, m_ipref_depth * sizeof(uint32_t) );
+    ckpt.state( r_ipref_state, m_ipref_depth * sizeof(int) );
+    ckpt.state( r_ipref_buf, m_ipref_depth * m_icache_words * sizeof(uint32_t) );
+    ckpt.state( r_dpref_addr, m_dpref_depth * sizeof(uint32_t) );
+    ckpt.state( r_dpref_state, m_dpref_depth * sizeof(int) );
+    ckpt.state( r_dpref_buf, m_dpref_depth * m_dcache_words * sizeof(uint32_t) );
+
+    // MSHRs
+    ckpt.state( r_mshr_valid, m_mshr_count * sizeof(bool) );
+    ckpt.state( r_mshr_inval, m_mshr_count * sizeof(bool) );
+    ckpt.state( r_mshr_addr, m_mshr_count * sizeof(uint32_t) );
+    ckpt.state( r_mshr_way, m_mshr_count * sizeof(uint32_t) );
+    ckpt.state( r_mshr_set, m_mshr_count * sizeof(uint32_t) );
+    ckpt.state( r_mshr_word, m_mshr_count * sizeof(uint32_t) );
+    ckpt.state( r_mshr_type, m_mshr_count * sizeof(uint32_t) );
+    ckpt.state( r_mshr_wdata, m_mshr_count * sizeof(uint32_t) );
+    ckpt.state( r_mshr_be, m_mshr_count * sizeof(uint32_t) );
+
+    // profiler
+    ckpt.value( m_prof_dpc );
+}
+
+///////////////////////////////////////////////////////////////////
+void PibusMips32Xcache::addFunctionalMemory(PibusFunctionalMemory* mem)
+{
+    m_fmem.push_back( mem );
+}
+
+///////////////////////////////////////////////////////////////////
+// returns true if the cache controller is quiescent, and the 
+// processor can be simulated in functional mode
+///////////////////////////////////////////////////////////////////
+bool PibusMips32Xcache::functionalReady()
+{
+    return (r_icache_fsm.read() == ICACHE_IDLE) and
+           (r_dcache_fsm.read() == DCACHE_IDLE) and
+           (r_pibus_fsm.read()  == PIBUS_IDLE) and
+           !r_wbuf_data.rok() and
+           (r_wmerge_count.read() == 0) and
+           !r_icache_miss_req.read() and
+           !r_icache_unc_req.read() and
+           !r_dcache_miss_req.read() and
+           !r_dcache_unc_req.read() and
+           !r_dcache_sc_req.read() and
+           !r_dcache_wb_req.read() and
+           (mshrActive() == 0) and
+           !r_pibus_rsp_ok.read() and
+           !r_snoop_dcache_inval_req.read() and
+           !r_snoop_llsc_inval_req.read() and
+           !r_snoop_flush_req.read();
+}
+
+///////////////////////////////////////////////////////////////////////
+// This function executes up to ncycles ISS cycles in functional mode,
+// and returns the number of executed cycles. It stops before the first
+// request that cannot be served without PIBUS transaction.
+// It must be called only when functionalReady() returns true.
+///////////////////////////////////////////////////////////////////////
+size_t PibusMips32Xcache::functionalRun(size_t ncycles)
+{
+    size_t count = 0;
+    while ( count < ncycles )
+    {
+        r_proc.getRequests( m_ireq, m_dreq );
+        m_irsp.valid = false;
+        m_drsp.valid = false;
+
+        // LL/SC and XTN requests require the cycle-accurate mode
+        // (XTN_SYNC only in write-back mode, to write back the dirty lines)
+        if ( m_dreq.valid and 
+             ((m_dreq.type == Iss2::DATA_LL) or 
+              (m_dreq.type == Iss2::DATA_SC) or
+              (m_dreq.type == Iss2::XTN_READ) or
+              ((m_dreq.type == Iss2::XTN_WRITE) and 
+               ((m_dreq.addr/4 != Iss2::XTN_SYNC) or m_write_back))) ) break;
+
+        // instruction request
+        if ( m_ireq.valid )
+        {
+            uint32_t	ins;
+            if ( m_cached_table[((m_ireq.addr >> m_msb_shift) & m_msb_mask)] )
+            {
+                if ( !r_icache.read( m_ireq.addr, &ins ) )
+                {
+                    if ( !functionalRefill( true, m_ireq.addr & m_line_inst_mask ) ) break;
+                    r_icache.read( m_ireq.addr, &ins );
+                }
+            }
+            else if ( !functionalRead( m_ireq.addr & 0xFFFFFFFC, &ins ) ) break;
+            m_irsp.valid       = true;
+            m_irsp.error       = false;
+            m_irsp.instruction = ins;
+        }
+
+        // data request
+        if ( m_dreq.valid )
+        {
+            bool	cacheable = m_cached_table[((m_dreq.addr >> m_msb_shift) & m_msb_mask)];
+            uint32_t	line      = m_dreq.addr & m_line_data_mask;
+            uint32_t	rdata     = 0;
+            size_t	way;
+            size_t	set;
+            size_t	word;
+
+            if ( m_dreq.type == Iss2::DATA_READ ) 
+            {
+                if ( !cacheable ) 
+                {
+                    if ( !functionalRead( m_dreq.addr & 0xFFFFFFFC, &rdata ) ) break;
+                }
+                else if ( !r_dcache.read( m_dreq.addr, &rdata, &way, &set, &word ) )
+                {
+                    if ( !functionalRefill( false, line ) ) break;
+                    r_dcache.read( m_dreq.addr, &rdata, &way, &set, &word );
+                }
+            }
+            else if ( m_dreq.type == Iss2::DATA_WRITE )
+            {
+                bool hit = cacheable and r_dcache.hit( m_dreq.addr, &way, &set, &word );
+                if ( cacheable and m_write_back )	// write-allocate
+                {
+                    if ( !hit )
+                    {
+                        if ( !functionalRefill( false, line ) ) break;
+                        r_dcache.hit( m_dreq.addr, &way, &set, &word );
+                    }
+                    r_dcache.write( way, set, word, m_dreq.wdata, m_dreq.be );
+                    r_dcache_dirty[way*m_dcache_sets + set] = true;
+                }
+                else
+                {
+                    if ( !functionalWrite( m_dreq.addr & 0xFFFFFFFC, m_dreq.wdata, m_dreq.be ) ) break;
+                    if ( hit ) r_dcache.write( way, set, word, m_dreq.wdata, m_dreq.be );
+                }
+                dprefInval( line );
+                victInval( false, line );
+            }
+            m_drsp.valid = true;
+            m_drsp.error = false;
+            m_drsp.rdata = rdata;
+        }
+
+        uint32_t it = 0;
+        if ( p_irq.read() ) it = 1;
+        r_proc.executeNCycles(1, m_irsp, m_drsp, it);
+        c_ffwd_count++;
+        count++;
+    }
+    return count;
+}
+
+///////////////////////////////////////////////////////////////////////
+// This function returns PIBUS_IDLE_FOREVER when the processor is frozen,
+// and the ICACHE, DCACHE and PIBUS FSMs are waiting a PIBUS event 
+// (bus grant, or data acknowledge) : the cache is then idle until an 
+// input change. It returns 0 in all other cases.
+// The conditions are conservative : the cache is never idle when the
+// prefetch buffers or the MSHRs are activated, or in case of external
+// write (snoop). The m_irsp and m_drsp responses (frozen processor) are
+// computed for the skipCycles() function.
+///////////////////////////////////////////////////////////////////////
+uint32_t PibusMips32Xcache::idleCycles()
+{
+    if ( m_ipref_depth or m_dpref_depth or m_mshr_count ) return 0;
+    if ( r_pibus_rsp_ok.read() ) return 0;
+
+    r_proc.getRequests( m_ireq, m_dreq );
+    m_irsp.valid = false;
+    m_drsp.valid = false;
+
+    // ICACHE FSM : no request, hit, or waiting a response
+    switch( r_icache_fsm.read() ) {
+    case ICACHE_IDLE :
+        if ( m_ireq.valid )
+        {
+            uint32_t	ins;
+            size_t	way;
+            size_t	set;
+            size_t	word;
+            if ( !m_cached_table[((m_ireq.addr >> m_msb_shift) & m_msb_mask)] or
+                 !r_icache.read( m_ireq.addr, &ins, &way, &set, &word ) ) return 0;
+            m_irsp.valid       = true;
+            m_irsp.error       = false;
+            m_irsp.instruction = ins;
+        }
+        else if ( p_irq.read() )	// a sleeping processor can be woken up
+        {
+            return 0;
+        }
+        break;
+    case ICACHE_MISS_WAIT :
+    {
+        uint32_t word = (m_ireq.addr >> 2) & (m_icache_words - 1);
+        if ( m_ireq.valid and
+             ((m_ireq.addr & m_line_inst_mask) == r_icache_save_addr.read()) and
+             r_pibus_ins.read() and 
+             (r_pibus_addr.read() == r_icache_save_addr.read()) and
+             ((r_pibus_rmask.read() >> word) & 0x1) ) return 0;
+        break;
+    }
+    case ICACHE_UNC_WAIT :
+        break;
+    default :
+        return 0;
+    }
+
+    // DCACHE FSM : no request, or waiting a response or a write buffer slot 
+    switch ( r_dcache_fsm.read() ) {
+    case DCACHE_IDLE :
+        if ( m_dreq.valid or 
+             r_snoop_llsc_inval_req.read() or
+             r_snoop_flush_req.read() or
+             r_snoop_dcache_inval_req.read() ) return 0;
+        break;
+    case DCACHE_WRITE_REQ :
+        if ( r_wbuf_data.wok() ) return 0;
+        break;
+    case DCACHE_MISS_WAIT :
+        if ( dcacheEarlyRestart() and
+             !r_pibus_ins.read() and 
+             (r_pibus_addr.read() == r_dcache_save_addr.read()) and
+             ((r_pibus_rmask.read() >> ((m_dreq.addr >> 2) & (m_dcache_words - 1))) & 0x1) ) return 0;
+        break;
+    case DCACHE_UNC_WAIT :
+        break;
+    default :
+        return 0;
+    }
+
+    // the processor must be frozen
+    if ( m_irsp.valid and !m_dreq.valid ) return 0;
+
+    // no external write
+    if ( m_snoop_active and p_avalid.read() and not p_read.read() and 
+         (r_pibus_fsm.read() != PIBUS_WRITE_AD) and
+         (r_pibus_fsm.read() != PIBUS_WRITE_DTAD) ) return 0;
+
+    // PIBUS FSM : no request, or waiting the bus grant or a data acknowledge
+    switch ( r_pibus_fsm.read() ) {
+    case PIBUS_IDLE :
+        if ( r_wbuf_data.rok() or 
+             (r_wmerge_count.read() != 0) or
+             r_dcache_wb_req.read() or 
+             r_dcache_sc_req.read() or
+             r_dcache_miss_req.read() or 
+             r_dcache_unc_req.read() or
+             r_icache_miss_req.read() or 
+             r_icache_unc_req.read() ) return 0;
+        break;
+    case PIBUS_READ_REQ :
+        if ( p_gnt.read() ) return 0;
+        break;
+    case PIBUS_WRITE_REQ :
+        if ( p_gnt.read() ) return 0;
+        if ( m_wbuf_merge and r_pibus_wbuf.read() and 
+             r_wmerge_cached.read() and r_wbuf_data.rok() ) return 0;
+        break;
+    case PIBUS_READ_DTAD :
+    case PIBUS_READ_DT :
+    case PIBUS_WRITE_DTAD :
+    case PIBUS_WRITE_DT :
+        if ( p_tout.read() or (p_ack.read() != PIBUS_ACK_WAIT) ) return 0;
+        break;
+    default :
+        return 0;
+    }
+    return PIBUS_IDLE_FOREVER;
+}
+
+///////////////////////////////////////////////////////////////////////
+// This function skips ncycles idle cycles : the ISS executes ncycles
+// frozen cycles, and the frozen cycles are counted in the statistics
+// and in the profile. It must be called after idleCycles().
+///////////////////////////////////////////////////////////////////////
+void PibusMips32Xcache::skipCycles(uint32_t ncycles)
+{
+    m_skip         = ncycles;
+    c_total_cycles = c_total_cycles + ncycles;
+    c_frz_cycles   = c_frz_cycles + ncycles;
+
+    if ( r_icache_fsm.read() == ICACHE_MISS_WAIT ) c_imiss_frz = c_imiss_frz + ncycles;
+    if ( r_icache_fsm.read() == ICACHE_UNC_WAIT )  c_iunc_frz  = c_iunc_frz + ncycles;
+    if ( r_dcache_fsm.read() == DCACHE_UNC_WAIT )  c_dunc_frz  = c_dunc_frz + ncycles;
+    if ( r_dcache_fsm.read() == DCACHE_WRITE_REQ ) c_write_frz = c_write_frz + ncycles;
+    if ( (r_dcache_fsm.read() == DCACHE_MISS_WAIT) and
+         (r_dcache_save_type.read() != Iss2::DATA_WRITE) ) c_dmiss_frz = c_dmiss_frz + ncycles;
+
+    if ( m_prof_size and m_ireq.valid )
+    {
+        ProfileEntry* entry;
+        if ( m_dreq.valid ) entry = profileEntry( m_prof_dpc );
+        else                entry = profileEntry( m_ireq.addr );
+        if ( entry ) entry->count[PROF_FRZ] += ncycles;
+        else         c_prof_drop += ncycles;
+    }
+
+    uint32_t it = 0;
+    if ( p_irq.read() ) it = 1;
+    r_proc.executeNCycles(ncycles, m_irsp, m_drsp, it);
+}
+
+///////////////////////////////////////////////////////////////////
 void PibusMips32Xcache::transition()
 {
+    // skipped idle cycles (see skipCycles())
+    uint32_t skip = m_skip;
+    m_skip = 0;
+
     // RESET
     if (p_resetn == false) 
     { 
@@ -204,6 +1335,7 @@ void PibusMips32Xcache::transition()
         r_wbuf_data.init();
         r_wbuf_type.init();
         r_wbuf_addr.init();
+        r_mshr_fifo.init();
         r_icache.reset();
         r_dcache.reset();
 
@@ -216,6 +1348,35 @@ void PibusMips32Xcache::transition()
         r_icache_unc_req         = false;
         r_dcache_unc_req         = false;
         r_dcache_sc_req          = false;
+        r_dcache_wb_req          = false;
+        r_wmerge_count           = 0;
+
+        for ( size_t slot = 0 ; slot < m_dcache_ways*m_dcache_sets ; slot++ ) 
+            r_dcache_dirty[slot] = false;
+
+        r_icache_pref_hit        = false;
+        for ( size_t slot = 0 ; slot < m_ipref_depth ; slot++ ) 
+            r_ipref_state[slot] = PREF_EMPTY;
+
+        r_dcache_pref_hit        = false;
+        r_dpref_last             = 0;
+        r_dpref_stride           = 0;
+        for ( size_t slot = 0 ; slot < m_dpref_depth ; slot++ ) 
+            r_dpref_state[slot] = PREF_EMPTY;
+
+        for ( size_t i = 0 ; i < m_mshr_count ; i++ ) 
+            r_mshr_valid[i] = false;
+        r_pibus_mshr             = m_mshr_count;
+
+        r_icache_vict_hit        = false;
+        r_dcache_vict_hit        = false;
+        r_ivict_ptr              = 0;
+        r_dvict_ptr              = 0;
+        for ( size_t slot = 0 ; slot < m_vict_depth ; slot++ ) 
+        {
+            r_ivict_valid[slot] = false;
+            r_dvict_valid[slot] = false;
+        }
 
         r_pibus_rsp_ok           = false;
         r_pibus_rsp_error        = false;
@@ -241,6 +1402,28 @@ void PibusMips32Xcache::transition()
         c_sc_ok_count	= 0;
         c_sc_ko_count	= 0;
         c_write_frz     = 0;
+        c_wmiss_count   = 0;
+        c_wb_count      = 0;
+        c_bus_write_count = 0;
+        c_wbuf_get_count  = 0;
+        c_wbuf_trans_count = 0;
+        c_ipref_count   = 0;
+        c_ipref_useful  = 0;
+        c_ipref_late    = 0;
+        c_dpref_count   = 0;
+        c_dpref_useful  = 0;
+        c_dpref_late    = 0;
+        c_dpref_drop    = 0;
+        c_mshr_hit      = 0;
+        c_mshr_miss     = 0;
+        c_ivict_hit     = 0;
+        c_dvict_hit     = 0;
+        c_ffwd_count    = 0;
+        c_prof_drop     = 0;
+
+        for ( size_t i = 0 ; i < m_prof_size ; i++ ) m_prof_table[i].pc = PROF_EMPTY;
+        m_prof_used = 0;
+        m_prof_dpc  = 0;
         return;
     } 
 
@@ -256,8 +1439,15 @@ void PibusMips32Xcache::transition()
     // - r_icache_fsm 
     // - r_icache
     // - r_icache_save_addr 
+    // - r_icache_save_word 
     // - r_icache_save_way 
     // - r_icache_save_set 
+    // - r_icache_pref_hit
+    // - r_icache_pref_slot
+    // - r_ipref_last, r_ipref_addr, r_ipref_state (stream allocation)
+    // - r_icache_save_victim
+    // - r_icache_vict_hit, r_icache_vict_slot
+    // - r_ivict_ptr, r_ivict_addr, r_ivict_valid, r_ivict_buf
     // - r_icache_miss_req set
     // - r_icache_unc_req set
     // - r_pibus_rsp_ok reset
@@ -292,17 +1482,60 @@ void PibusMips32Xcache::transition()
                 else 
                 { 
                     c_imiss_count++;
+                    profileCount( m_ireq.addr, PROF_IMISS );
                     c_imiss_frz++;
                     r_icache_save_way  = icache_way;
                     r_icache_save_set  = icache_set;
                     r_icache_save_addr = m_ireq.addr & m_line_inst_mask;
-                    r_icache_miss_req  = true;
+                    r_icache_save_word = (m_ireq.addr >> 2) & (m_icache_words - 1);
                     r_icache_fsm       = ICACHE_MISS_SELECT;
+
+                    // victim cache lookup
+                    uint32_t line     = m_ireq.addr & m_line_inst_mask;
+                    size_t   vict_slot;
+                    bool     vict_hit = victLookup( true, line, &vict_slot );
+                    r_icache_vict_hit  = vict_hit;
+                    r_icache_vict_slot = vict_slot;
+                    if ( vict_hit ) c_ivict_hit++;
+
+                    // stream buffer lookup
+                    bool     pref_hit = false;
+                    for ( size_t slot = 0 ; (slot < m_ipref_depth) and !vict_hit ; slot++ )
+                    {
+                        if ( (r_ipref_addr[slot] == line) and
+                             (r_ipref_state[slot] == PREF_VALID) )
+                        {
+                            c_ipref_useful++;
+                            pref_hit           = true;
+                            r_icache_pref_slot = slot;
+                        }
+                        else if ( (r_ipref_addr[slot] == line) and
+                                  (r_ipref_state[slot] == PREF_PENDING) )
+                        {
+                            c_ipref_late++;
+                            pref_hit           = true;
+                            r_icache_pref_slot = slot;
+                        }
+                    }
+                    r_icache_pref_hit = pref_hit;
+
+                    // demand miss : the stream is re-initialised
+                    if ( !pref_hit and !vict_hit ) 
+                    {
+                        r_icache_miss_req  = true;
+                        for ( size_t slot = 0 ; slot < m_ipref_depth ; slot++ )
+                        {
+                            r_ipref_addr[slot]  = line + ((slot + 1) * m_icache_words << 2);
+                            r_ipref_state[slot] = PREF_WAIT;
+                        }
+                        r_ipref_last = line + (m_ipref_depth * m_icache_words << 2);
+                    }
                 }
             }
             else 			
             {
                 c_iunc_count++;
+                profileCount( m_ireq.addr, PROF_UNC );
                 c_iunc_frz++;
                 r_icache_save_addr = m_ireq.addr & 0xFFFFFFFC;
                 r_icache_unc_req   = true;
@@ -314,7 +1547,7 @@ void PibusMips32Xcache::transition()
     case ICACHE_MISS_SELECT :
     {
         c_imiss_frz++;
-        uint32_t victim;	// unused
+        uint32_t victim = 0;
         bool	 valid;
         size_t   way;
         size_t   set;
@@ -322,25 +1555,78 @@ void PibusMips32Xcache::transition()
                                         &victim,
                                         &way,
                                         &set );
-        r_icache_save_way = way;
-        r_icache_save_set = set;
-        if ( valid ) r_icache_fsm = ICACHE_MISS_INVAL;
+        r_icache_save_way    = way;
+        r_icache_save_set    = set;
+        r_icache_save_victim = victim * (m_icache_words << 2);
+        if ( valid or r_icache_vict_hit.read() ) r_icache_fsm = ICACHE_MISS_INVAL;
         else	     r_icache_fsm = ICACHE_MISS_WAIT;
         break;
     }
     case ICACHE_MISS_INVAL :
     {
         c_imiss_frz++;
+        size_t   way = r_icache_save_way.read();
+        size_t   set = r_icache_save_set.read();
         uint32_t nline;		// unused
-        r_icache.inval( r_icache_save_way.read(),
-                        r_icache_save_set.read(),
-                        &nline );
+        if ( r_icache_vict_hit.read() )
+        {
+            // the line is swapped between the victim cache and the ICACHE
+            uint32_t slot = r_icache_vict_slot.read();
+            uint32_t buf[32];
+            for ( size_t word = 0 ; word < m_icache_words ; word++ ) 
+                buf[word] = r_ivict_buf[slot*m_icache_words + word];
+            victInsert( true, way, set, r_icache_save_victim.read(), slot );
+            r_icache.inval( way, set, &nline );
+            r_icache.update( r_icache_save_addr.read(), way, set, buf );
+            r_icache_vict_hit = false;
+            r_icache_fsm      = ICACHE_IDLE;
+            break;
+        }
+        if ( m_vict_depth != 0 )
+        {
+            // the evicted line is copied in the victim cache
+            victInsert( true, way, set, r_icache_save_victim.read(), r_ivict_ptr.read() );
+            r_ivict_ptr = (r_ivict_ptr.read() + 1) % m_vict_depth;
+        }
+        r_icache.inval( way, set, &nline );
         r_icache_fsm = ICACHE_MISS_WAIT;
         break;
     }
     case ICACHE_MISS_WAIT :
     {
-        c_imiss_frz++;
+        // the missing line is in the stream buffer 
+        if ( r_icache_pref_hit.read() )
+        {
+            c_imiss_frz++;
+            int state = r_ipref_state[r_icache_pref_slot.read()];
+            if ( state == PREF_VALID ) 
+            {
+                r_icache_fsm = ICACHE_MISS_UPDT;
+            }
+            else if ( state != PREF_PENDING ) 	// prefetch failure
+            {
+                r_icache_pref_hit = false;
+                r_icache_miss_req = true;
+            }
+            break;
+        }
+
+        // early restart if the requested word has been received 
+        uint32_t word = (m_ireq.addr >> 2) & (m_icache_words - 1);
+        if ( m_ireq.valid and
+             ((m_ireq.addr & m_line_inst_mask) == r_icache_save_addr.read()) and
+             r_pibus_ins.read() and 
+             (r_pibus_addr.read() == r_icache_save_addr.read()) and
+             ((r_pibus_rmask.read() >> word) & 0x1) )
+        {
+            m_irsp.valid       = true;
+            m_irsp.error       = false;
+            m_irsp.instruction = r_pibus_buf[word];
+        }
+        else
+        {
+            c_imiss_frz++;
+        }
         if( r_pibus_ins.read() && r_pibus_rsp_ok.read() )
         {
             if( r_pibus_rsp_error.read() ) 
@@ -359,11 +1645,35 @@ void PibusMips32Xcache::transition()
     }
     case ICACHE_MISS_UPDT :
     {
-        c_imiss_frz++;
+        uint32_t	slot = r_icache_pref_slot.read();
+        uint32_t*	buf  = r_pibus_buf;
+        if ( r_icache_pref_hit.read() ) buf = &r_ipref_buf[slot*m_icache_words];
+
+        if ( m_ireq.valid and
+             ((m_ireq.addr & m_line_inst_mask) == r_icache_save_addr.read()) )
+        {
+            m_irsp.valid       = true;
+            m_irsp.error       = false;
+            m_irsp.instruction = buf[(m_ireq.addr >> 2) & (m_icache_words - 1)];
+        }
+        else
+        {
+            c_imiss_frz++;
+        }
         r_icache.update( r_icache_save_addr.read(),
                          r_icache_save_way.read(),
                          r_icache_save_set.read(),
-                         r_pibus_buf );
+                         buf );
+
+        // the stream buffer slot is allocated to the next line 
+        if ( r_icache_pref_hit.read() )
+        {
+            uint32_t next       = r_ipref_last.read() + (m_icache_words << 2);
+            r_ipref_addr[slot]  = next;
+            r_ipref_state[slot] = PREF_WAIT;
+            r_ipref_last        = next;
+            r_icache_pref_hit   = false;
+        }
         r_icache_fsm = ICACHE_IDLE;
         break;
     }
@@ -421,6 +1731,18 @@ void PibusMips32Xcache::transition()
     // - r_dcache_save_word
     // - r_dcache_miss_req set
     // - r_dcache_unc_req set
+    // - r_dcache_wb_req set
+    // - r_dcache_wb_addr
+    // - r_dcache_wb_buf
+    // - r_dcache_dirty
+    // - r_dcache_slot_addr
+    // - r_dcache_flush_slot
+    // - r_mshr_valid, r_mshr_inval, r_mshr_addr, r_mshr_way, r_mshr_set,
+    //   r_mshr_word, r_mshr_type, r_mshr_wdata, r_mshr_be (MSHR allocation)
+    // - r_mshr_fifo put
+    // - r_dcache_save_victim
+    // - r_dcache_vict_hit, r_dcache_vict_slot
+    // - r_dvict_ptr, r_dvict_addr, r_dvict_valid, r_dvict_buf
     // - r_pibus_rsp_ok reset
     // - r_pibus_rsp_error reset
     // - r_llsc_pending
@@ -438,10 +1760,28 @@ void PibusMips32Xcache::transition()
     // - SC (if llsc pending) => to SC_WAIT to send a write transaction on the bus,
     //   then to IDLE. 
     // - XTN INVAL => to the INVAL state for one cycle, then to IDLE.
+    // - XTN FLUSH => to the FLUSH state for one cycle per cache slot, then to IDLE.
+    // In write-back mode :
+    // - WRITE HIT => to WRITE_UPDT (to update the cache and set the dirty bit),
+    //   then to IDLE.
+    // - WRITE MISS => to MISS_SELECT, MISS_WAIT and MISS_UPDT as a read miss,
+    //   then to WRITE_UPDT.
+    // - a dirty victim line is copied in the write-back buffer in the MISS_WB 
+    //   state, between MISS_SELECT and MISS_INVAL.
+    // In non-blocking mode (m_mshr_count != 0) :
+    // - CACHED MISS => to MISS_SELECT (and MISS_INVAL), where an MSHR is 
+    //   allocated, then directly to IDLE.
+    // - REFILL COMPLETION => to MISS_UPDT (and WRITE_UPDT for a write-allocate),
+    //   then to IDLE. This condition has priority on the processor request.
+    // - a processor request conflicting with a pending refill is delayed
+    //   in the IDLE state (see the mshrConflict() function).
     // Implementation note : to support write bursts, the processor requests are
     // taken into account in the WRITEREQ state as well as in the IDLE state.
     //////////////////////////////////////////////////////////////////////////////////////
 
+    bool	mshr_put   = false;	// MSHR request queue push
+    uint32_t	mshr_index = 0;
+
     switch ( r_dcache_fsm.read() ) {
     case DCACHE_WRITE_REQ :
     {
@@ -467,6 +1807,8 @@ void PibusMips32Xcache::transition()
         if ( r_snoop_flush_req.read() )	    
         {
             r_dcache.reset();
+            for ( size_t i = 0 ; i < m_mshr_count ; i++ ) r_mshr_inval[i] = true;
+            for ( size_t slot = 0 ; slot < m_vict_depth ; slot++ ) r_dvict_valid[slot] = false;
             r_snoop_flush_req        = false;
             r_snoop_dcache_inval_req = false;
             r_dcache_fsm             = DCACHE_IDLE;     
@@ -483,6 +1825,69 @@ void PibusMips32Xcache::transition()
             r_dcache_fsm = DCACHE_IDLE;     
         }
 
+        // refill completion (non-blocking DCACHE)
+        else if ( (r_pibus_mshr.read() < m_mshr_count) and 
+                  !r_pibus_ins.read() and r_pibus_rsp_ok.read() )
+        {
+            size_t index = r_pibus_mshr.read();
+            r_dcache_save_addr  = r_mshr_addr[index];
+            r_dcache_save_way   = r_mshr_way[index];
+            r_dcache_save_set   = r_mshr_set[index];
+            r_dcache_save_word  = r_mshr_word[index];
+            r_dcache_save_type  = r_mshr_type[index];
+            r_dcache_save_wdata = r_mshr_wdata[index];
+            r_dcache_save_be    = r_mshr_be[index];
+            r_mshr_valid[index] = false;
+            r_pibus_rsp_ok      = false;
+            r_pibus_rsp_error   = false;
+            if ( r_pibus_rsp_error.read() and (r_mshr_type[index] == Iss2::DATA_WRITE) )
+            {
+                // the write request has already been acknowledged
+                r_proc.setWriteBerr();
+            }
+            else if ( r_pibus_rsp_error.read() )
+            {
+                // the error is signaled only if the processor waits the missing line
+                if ( m_dreq.valid and ((m_dreq.addr & m_line_data_mask) == r_mshr_addr[index]) )
+                    r_dcache_fsm = DCACHE_ERROR;
+            }
+            else if ( !r_mshr_inval[index] )	// no external write on the line 
+            {
+                r_dcache_fsm = DCACHE_MISS_UPDT;
+            }
+        }
+
+        // Processor request delayed by a pending refill (non-blocking DCACHE) 
+        else if ( m_dreq.valid and mshrConflict() )
+        {
+            size_t	index;
+            size_t	word    = (m_dreq.addr >> 2) & (m_dcache_words - 1);
+            bool	restart = mshrLookup( m_dreq.addr & m_line_data_mask, &index ) and
+                                  (r_mshr_type[index] != Iss2::DATA_WRITE) and
+                                  (r_pibus_mshr.read() == index) and
+                                  !r_pibus_ins.read() and
+                                  ((r_pibus_rmask.read() >> word) & 0x1) and
+                                  ((m_dreq.type == Iss2::DATA_READ) or
+                                   ((m_dreq.type == Iss2::DATA_LL) and 
+                                    r_llsc_pending.read() and
+                                    (r_llsc_addr.read() == m_dreq.addr)));
+            // early restart if the requested word has been received 
+            if ( restart )
+            {
+                m_drsp.valid = true;
+                m_drsp.error = false;
+                m_drsp.rdata = r_pibus_buf[word];
+            }
+            else if ( m_dreq.type == Iss2::DATA_WRITE ) 
+            {
+                c_write_frz++;
+            }
+            else
+            {
+                c_dmiss_frz++;
+            }
+        }
+
         // Processor request
         else if ( m_dreq.valid )
         {
@@ -518,6 +1923,7 @@ void PibusMips32Xcache::transition()
                 c_dread_count++;
                 if ( dcache_hit )
                 {
+                    if ( mshrActive() ) c_mshr_hit++;
                     m_drsp.valid	= true;
                     m_drsp.error    	= false;
                     m_drsp.rdata    	= dcache_rdata;
@@ -525,16 +1931,29 @@ void PibusMips32Xcache::transition()
                 }
                 else if ( dcache_cacheable )
                 {
+                    uint32_t line = m_dreq.addr & m_line_data_mask;
+                    size_t   vict_slot;
+                    bool     vict_hit = victLookup( false, line, &vict_slot );
+                    bool     pref_hit = !vict_hit and dprefLookup( line );
+                    dprefTrain( line );
                     c_dmiss_count++;
                     c_dmiss_frz++;
-                    r_dcache_miss_req  = true;
+                    profileCount( m_prof_dpc, PROF_DMISS );
+                    if ( mshrActive() ) c_mshr_miss++;
+                    if ( vict_hit ) c_dvict_hit++;
+                    r_dcache_vict_hit  = vict_hit;
+                    r_dcache_vict_slot = vict_slot;
+                    r_dcache_pref_hit  = pref_hit;
+                    r_dcache_miss_req  = !pref_hit and !vict_hit and (m_mshr_count == 0);
                     r_dcache_fsm       = DCACHE_MISS_SELECT;
-                    r_dcache_save_addr = m_dreq.addr & m_line_data_mask;
+                    r_dcache_save_addr = line;
+                    r_dcache_save_word = (m_dreq.addr >> 2) & (m_dcache_words - 1);
                     r_dcache_save_type = m_dreq.type;
                 }
                 else
                 {
                     c_dunc_count++;
+                    profileCount( m_prof_dpc, PROF_UNC );
                     c_dunc_frz++;
                     r_dcache_unc_req   = true;
                     r_dcache_fsm       = DCACHE_UNC_WAIT;
@@ -553,12 +1972,36 @@ void PibusMips32Xcache::transition()
             else if ( m_dreq.type == soclib::common::Iss2::DATA_WRITE ) 
             {
                 c_write_count++;
-                r_dcache_save_addr 	= m_dreq.addr;
+                dprefInval( m_dreq.addr & m_line_data_mask );
+                if ( !m_write_back ) victInval( false, m_dreq.addr & m_line_data_mask );
+                if ( dcache_cacheable && !dcache_hit && m_write_back ) 
+                    r_dcache_save_addr  = m_dreq.addr & m_line_data_mask;
+                else
+                    r_dcache_save_addr  = m_dreq.addr;
                 r_dcache_save_type 	= m_dreq.type;
                 r_dcache_save_wdata	= m_dreq.wdata;
                 r_dcache_save_be        = m_dreq.be;
-                if ( dcache_hit && dcache_cacheable ) 	r_dcache_fsm = DCACHE_WRITE_UPDT;
-                else 					r_dcache_fsm = DCACHE_WRITE_REQ;
+                if ( dcache_hit && dcache_cacheable ) 
+                {
+                    r_dcache_fsm       = DCACHE_WRITE_UPDT;
+                }
+                else if ( dcache_cacheable && m_write_back )	// write-allocate 
+                {
+                    size_t vict_slot;
+                    bool   vict_hit = victLookup( false, m_dreq.addr & m_line_data_mask, &vict_slot );
+                    c_wmiss_count++;
+                    profileCount( m_prof_dpc, PROF_DMISS );
+                    if ( vict_hit ) c_dvict_hit++;
+                    r_dcache_vict_hit  = vict_hit;
+                    r_dcache_vict_slot = vict_slot;
+                    r_dcache_miss_req  = !vict_hit and (m_mshr_count == 0);
+                    r_dcache_save_word = (m_dreq.addr >> 2) & (m_dcache_words - 1);
+                    r_dcache_fsm       = DCACHE_MISS_SELECT;
+                }
+                else
+                {
+                    r_dcache_fsm       = DCACHE_WRITE_REQ;
+                }
                 m_drsp.valid = true;
                 m_drsp.error = false;
                 m_drsp.rdata = 0;
@@ -569,6 +2012,8 @@ void PibusMips32Xcache::transition()
             {
                 if ( r_llsc_pending && (r_llsc_addr.read() == m_dreq.addr) )
                 {
+                    dprefInval( m_dreq.addr & m_line_data_mask );
+                    victInval( false, m_dreq.addr & m_line_data_mask );
                     r_dcache_save_addr   = m_dreq.addr;
                     r_dcache_save_wdata  = m_dreq.wdata;
                     r_dcache_save_cached = dcache_hit;
@@ -590,6 +2035,8 @@ void PibusMips32Xcache::transition()
             {
                 if( m_dreq.addr/4 == soclib::common::Iss2::XTN_DCACHE_INVAL)
                 {
+                    dprefInval( m_dreq.wdata & m_line_data_mask );
+                    victInval( false, m_dreq.wdata & m_line_data_mask );
                     // test if the address contained in wdata is in the cache
                     dcache_hit = r_dcache.hit( m_dreq.wdata,
                                                &dcache_way,
@@ -609,19 +2056,37 @@ void PibusMips32Xcache::transition()
                         r_dcache_fsm = DCACHE_IDLE;
                     }
                 }
+                else if( m_dreq.addr/4 == soclib::common::Iss2::XTN_DCACHE_FLUSH)
+                {
+                    for ( size_t slot = 0 ; slot < m_dpref_depth ; slot++ ) 
+                        r_dpref_state[slot] = PREF_EMPTY;
+                    for ( size_t slot = 0 ; slot < m_vict_depth ; slot++ ) 
+                        r_dvict_valid[slot] = false;
+                    r_dcache_flush_slot = 0;
+                    r_dcache_fsm        = DCACHE_FLUSH;
+                }
                 else if( m_dreq.addr/4 == soclib::common::Iss2::XTN_SYNC)
                 {
-                    // do nothing, as this cache implements a strict sequencial behaviour 
-                    // for load/store instructions
-                    m_drsp.valid	= true;
-                    m_drsp.error    	= false;
-                    m_drsp.rdata    	= 0;
-                    r_dcache_fsm 	= DCACHE_IDLE;
+                    // in write-back mode, all dirty lines are written back.
+                    // otherwise do nothing, as this cache implements a strict 
+                    // sequencial behaviour for load/store instructions
+                    if ( m_write_back )
+                    {
+                        r_dcache_flush_slot = 0;
+                        r_dcache_fsm        = DCACHE_SYNC;
+                    }
+                    else
+                    {
+                        m_drsp.valid	= true;
+                        m_drsp.error    = false;
+                        m_drsp.rdata    = 0;
+                        r_dcache_fsm 	= DCACHE_IDLE;
+                    }
                 }
                 else
                 {
                     std::cout << "ERROR in PibuMis32Xcache " << m_name << std::endl;
-                    std::cout << "only DCACHE_INVAL & SYNC external requests are supported" << std::endl;
+                    std::cout << "only DCACHE_INVAL, DCACHE_FLUSH & SYNC external requests are supported" << std::endl;
                     exit(0);
                 }  
             }
@@ -642,10 +2107,25 @@ void PibusMips32Xcache::transition()
     }
     case DCACHE_INVAL:
     {
+        // the dirty line must be written back before invalidation, and
+        // the response is returned when the write-back burst is completed
+        // (as for DCACHE_FLUSH) : an uncached write posted later cannot
+        // overtake the write-back.
+        size_t slot = r_dcache_save_way.read()*m_dcache_sets + r_dcache_save_set.read();
         uint32_t dummy;
+        if ( m_write_back && r_dcache_dirty[slot] )
+        {
+            if ( r_dcache_wb_req.read() ) break;
+            dcacheWriteBack( r_dcache_save_way.read(), r_dcache_save_set.read() );
+            r_dcache.inval( r_dcache_save_way.read(),
+                            r_dcache_save_set.read(),
+                            &dummy );
+            break;
+        }
         r_dcache.inval( r_dcache_save_way.read(),
                         r_dcache_save_set.read(),
                         &dummy );
+        if ( m_write_back && r_dcache_wb_req.read() ) break;
         m_drsp.valid	= true;
         m_drsp.error    = false;
         m_drsp.rdata    = 0;
@@ -659,7 +2139,64 @@ void PibusMips32Xcache::transition()
                         r_dcache_save_word.read(),
                         r_dcache_save_wdata.read(),
                         r_dcache_save_be.read() );
-        r_dcache_fsm = DCACHE_WRITE_REQ;
+        if ( m_write_back )
+        {
+            r_dcache_dirty[r_dcache_save_way.read()*m_dcache_sets + r_dcache_save_set.read()] = true;
+            r_dcache_fsm = DCACHE_IDLE;
+        }
+        else
+        {
+            r_dcache_fsm = DCACHE_WRITE_REQ;
+        }
+        break;
+    }
+    case DCACHE_FLUSH:
+    {
+        // one cache slot is handled per cycle, and the response is
+        // returned when the last write-back burst is completed
+        size_t slot = r_dcache_flush_slot.read();
+        if ( slot < m_dcache_ways*m_dcache_sets )
+        {
+            size_t way = slot / m_dcache_sets;
+            size_t set = slot % m_dcache_sets;
+            if ( m_write_back && r_dcache_dirty[slot] )
+            {
+                if ( r_dcache_wb_req.read() ) break;
+                dcacheWriteBack( way, set );
+            }
+            uint32_t nline;	// unused
+            r_dcache.inval( way, set, &nline );
+            r_dcache_flush_slot = slot + 1;
+        }
+        else if ( !r_dcache_wb_req.read() )
+        {
+            m_drsp.valid = true;
+            m_drsp.error = false;
+            m_drsp.rdata = 0;
+            r_dcache_fsm = DCACHE_IDLE;
+        }
+        break;
+    }
+    case DCACHE_SYNC:
+    {
+        // as DCACHE_FLUSH, but the written back lines stay valid (clean)
+        size_t slot = r_dcache_flush_slot.read();
+        if ( slot < m_dcache_ways*m_dcache_sets )
+        {
+            if ( r_dcache_dirty[slot] )
+            {
+                if ( r_dcache_wb_req.read() ) break;
+                dcacheWriteBack( slot / m_dcache_sets, slot % m_dcache_sets );
+            }
+            r_dcache_flush_slot = slot + 1;
+        }
+        else if ( !r_dcache_wb_req.read() )
+        {
+            m_drsp.valid = true;
+            m_drsp.error = false;
+            m_drsp.rdata = 0;
+            r_dcache_fsm = DCACHE_IDLE;
+        }
         break;
     }
     case DCACHE_SC_WAIT:
@@ -696,8 +2233,8 @@ void PibusMips32Xcache::transition()
     }
     case DCACHE_MISS_SELECT :
     {
-        c_dmiss_frz++;
-        uint32_t victim;	// unused
+        if ( r_dcache_save_type.read() != Iss2::DATA_WRITE ) c_dmiss_frz++;
+        uint32_t victim = 0;
         bool	 valid;
         size_t   way;
         size_t   set;
@@ -705,28 +2242,138 @@ void PibusMips32Xcache::transition()
                                         &victim,
                                         &way,
                                         &set );
-        r_dcache_save_way = way;
-        r_dcache_save_set = set;
-        if ( valid ) r_dcache_fsm = DCACHE_MISS_INVAL;
+        r_dcache_save_way    = way;
+        r_dcache_save_set    = set;
+        r_dcache_save_victim = victim * (m_dcache_words << 2);
+        if ( valid && m_write_back && r_dcache_dirty[way*m_dcache_sets + set] ) 
+                     r_dcache_fsm = DCACHE_MISS_WB;
+        else if ( valid or r_dcache_vict_hit.read() ) r_dcache_fsm = DCACHE_MISS_INVAL;
+        else if ( (m_mshr_count != 0) and !r_dcache_pref_hit.read() )
+        {
+            // non-blocking DCACHE : the refill request is posted
+            mshr_put     = true;
+            mshr_index   = mshrAlloc( way, set );
+            r_dcache_fsm = DCACHE_IDLE;
+        }
         else	     r_dcache_fsm = DCACHE_MISS_WAIT;
         break;
     }
+    case DCACHE_MISS_WB :
+    {
+        if ( r_dcache_save_type.read() != Iss2::DATA_WRITE ) c_dmiss_frz++;
+        // wait until the write-back buffer is empty
+        if ( !r_dcache_wb_req.read() )
+        {
+            dcacheWriteBack( r_dcache_save_way.read(), r_dcache_save_set.read() );
+            r_dcache_fsm = DCACHE_MISS_INVAL;
+        }
+        break;
+    }
     case DCACHE_MISS_INVAL :
     {
-        c_dmiss_frz++;
+        if ( r_dcache_save_type.read() != Iss2::DATA_WRITE ) c_dmiss_frz++;
+        size_t   way = r_dcache_save_way.read();
+        size_t   set = r_dcache_save_set.read();
         uint32_t nline;		// unused
-        r_dcache.inval( r_dcache_save_way.read(),
-                        r_dcache_save_set.read(),
-                        &nline );
-        r_dcache_fsm = DCACHE_MISS_WAIT;
+        // the evicted line is not copied if a snoop invalidation is pending
+        bool     stale = r_snoop_dcache_inval_req.read() and
+                         (r_snoop_dcache_inval_way.read() == way) and 
+                         (r_snoop_dcache_inval_set.read() == set);
+        if ( r_dcache_vict_hit.read() )
+        {
+            // the line is swapped between the victim cache and the DCACHE
+            uint32_t slot = r_dcache_vict_slot.read();
+            uint32_t buf[32];
+            for ( size_t word = 0 ; word < m_dcache_words ; word++ ) 
+                buf[word] = r_dvict_buf[slot*m_dcache_words + word];
+            if ( stale ) r_dvict_valid[slot] = false;
+            else         victInsert( false, way, set, r_dcache_save_victim.read(), slot );
+            r_dcache.inval( way, set, &nline );
+            r_dcache.update( r_dcache_save_addr.read(), way, set, buf );
+            if ( m_write_back )
+            {
+                r_dcache_dirty[way*m_dcache_sets + set]     = false;
+                r_dcache_slot_addr[way*m_dcache_sets + set] = r_dcache_save_addr.read();
+            }
+            r_dcache_vict_hit = false;
+            // write-allocate : the cache is updated in WRITE_UPDT state
+            if ( r_dcache_save_type.read() == Iss2::DATA_WRITE ) r_dcache_fsm = DCACHE_WRITE_UPDT;
+            else                                                 r_dcache_fsm = DCACHE_IDLE;
+            break;
+        }
+        if ( (m_vict_depth != 0) and !stale )
+        {
+            // the evicted line is copied in the victim cache
+            victInsert( false, way, set, r_dcache_save_victim.read(), r_dvict_ptr.read() );
+            r_dvict_ptr = (r_dvict_ptr.read() + 1) % m_vict_depth;
+        }
+        r_dcache.inval( way, set, &nline );
+        if ( (m_mshr_count != 0) and !r_dcache_pref_hit.read() )
+        {
+            // non-blocking DCACHE : the refill request is posted
+            mshr_put     = true;
+            mshr_index   = mshrAlloc( r_dcache_save_way.read(), r_dcache_save_set.read() );
+            r_dcache_fsm = DCACHE_IDLE;
+        }
+        else
+        {
+            r_dcache_fsm = DCACHE_MISS_WAIT;
+        }
         break;
     }
     case DCACHE_MISS_WAIT:
     {
-        c_dmiss_frz++;
+        // the missing line is in the prefetch buffer 
+        if ( r_dcache_pref_hit.read() )
+        {
+            c_dmiss_frz++;
+            int state = r_dpref_state[r_dcache_pref_slot.read()];
+            if ( state == PREF_VALID ) 
+            {
+                r_dcache_fsm = DCACHE_MISS_UPDT;
+            }
+            else if ( state != PREF_PENDING ) 	// prefetch failure or invalidation
+            {
+                r_dcache_pref_hit = false;
+                if ( m_mshr_count != 0 )
+                {
+                    mshr_put     = true;
+                    mshr_index   = mshrAlloc( r_dcache_save_way.read(), r_dcache_save_set.read() );
+                    r_dcache_fsm = DCACHE_IDLE;
+                }
+                else
+                {
+                    r_dcache_miss_req = true;
+                }
+            }
+            break;
+        }
+
+        // early restart if the requested word has been received 
+        if ( dcacheEarlyRestart() and
+             !r_pibus_ins.read() and 
+             (r_pibus_addr.read() == r_dcache_save_addr.read()) and
+             ((r_pibus_rmask.read() >> ((m_dreq.addr >> 2) & (m_dcache_words - 1))) & 0x1) )
+        {
+            m_drsp.valid = true;
+            m_drsp.error = false;
+            m_drsp.rdata = r_pibus_buf[(m_dreq.addr >> 2) & (m_dcache_words - 1)];
+        }
+        else if ( r_dcache_save_type.read() != Iss2::DATA_WRITE ) 
+        {
+            c_dmiss_frz++;
+        }
         if( !r_pibus_ins.read() && r_pibus_rsp_ok.read() )
         {
-            if( r_pibus_rsp_error.read() ) 
+            if( r_pibus_rsp_error.read() && (r_dcache_save_type.read() == Iss2::DATA_WRITE) ) 
+            {
+                // the write request has already been acknowledged
+                r_proc.setWriteBerr();
+                r_dcache_fsm      = DCACHE_IDLE;
+                r_pibus_rsp_error = false;
+                r_pibus_rsp_ok    = false;
+            }
+            else if( r_pibus_rsp_error.read() ) 
             {
                 r_dcache_fsm      = DCACHE_ERROR;
                 r_pibus_rsp_error = false;
@@ -742,12 +2389,39 @@ void PibusMips32Xcache::transition()
     }
     case DCACHE_MISS_UPDT:
     {
-        c_dmiss_frz++;
+        uint32_t	pref_slot = r_dcache_pref_slot.read();
+        uint32_t*	buf       = r_pibus_buf;
+        if ( r_dcache_pref_hit.read() ) buf = &r_dpref_buf[pref_slot*m_dcache_words];
+
+        if ( dcacheEarlyRestart() )
+        {
+            m_drsp.valid = true;
+            m_drsp.error = false;
+            m_drsp.rdata = buf[(m_dreq.addr >> 2) & (m_dcache_words - 1)];
+        }
+        else if ( r_dcache_save_type.read() != Iss2::DATA_WRITE ) 
+        {
+            c_dmiss_frz++;
+        }
         r_dcache.update( r_dcache_save_addr.read(),
                          r_dcache_save_way.read(),
                          r_dcache_save_set.read(),
-                         r_pibus_buf );
-        r_dcache_fsm = DCACHE_IDLE;
+                         buf );
+        // the line is now in the DCACHE : the prefetch buffer slot is released
+        if ( r_dcache_pref_hit.read() )
+        {
+            r_dpref_state[pref_slot] = PREF_EMPTY;
+            r_dcache_pref_hit        = false;
+        }
+        if ( m_write_back )
+        {
+            size_t slot = r_dcache_save_way.read()*m_dcache_sets + r_dcache_save_set.read();
+            r_dcache_dirty[slot]     = false;
+            r_dcache_slot_addr[slot] = r_dcache_save_addr.read();
+        }
+        // write-allocate : the cache is updated in WRITE_UPDT state
+        if ( r_dcache_save_type.read() == Iss2::DATA_WRITE ) r_dcache_fsm = DCACHE_WRITE_UPDT;
+        else                                                 r_dcache_fsm = DCACHE_IDLE;
         break;
     }
     case DCACHE_UNC_WAIT:
@@ -800,6 +2474,18 @@ void PibusMips32Xcache::transition()
     r_proc.executeNCycles(1, m_irsp, m_drsp, it);
     if ( (m_ireq.valid && !m_irsp.valid) || (m_dreq.valid && !m_drsp.valid) || !m_ireq.valid ) c_frz_cycles++;
 
+    // per-PC profiler : the pending data request belongs to the last executed instruction
+    if ( m_prof_size and m_ireq.valid )
+    {
+        if      ( m_dreq.valid && !m_drsp.valid ) profileCount( m_prof_dpc, PROF_FRZ );
+        else if ( !m_irsp.valid )                 profileCount( m_ireq.addr, PROF_FRZ );
+        else
+        {
+            profileCount( m_ireq.addr, PROF_EXEC );
+            m_prof_dpc = m_ireq.addr;
+        }
+    }
+
     //////////////////////////////////////////////////////////////////////////////
     // The SNOOP FSM implements a snoop_invalidate policy.
     // It controls the following registers:
@@ -849,10 +2535,18 @@ void PibusMips32Xcache::transition()
   
         external_write = p_avalid.read() and 
                          not p_read.read() and 
-                         (r_pibus_fsm.read() != PIBUS_WRITE_AD); 
+                         (r_pibus_fsm.read() != PIBUS_WRITE_AD) and
+                         (r_pibus_fsm.read() != PIBUS_WRITE_DTAD); 
 
         if ( external_write )
         {
+            dprefInval( snoop_addr & m_line_data_mask );
+            victInval( false, snoop_addr & m_line_data_mask );
+
+            // the cache update is cancelled for a pending refill 
+            size_t index;
+            if ( mshrLookup( snoop_addr & m_line_data_mask, &index ) ) r_mshr_inval[index] = true;
+
             cache_hit = r_dcache.hit( snoop_addr, 
                                       &snoop_way, 
                                       &snoop_set, 
@@ -901,6 +2595,15 @@ void PibusMips32Xcache::transition()
     // - r_pibus_write_type
     // - r_pibus_read_type
     // - r_pibus_buf 
+    // - r_pibus_wb
+    // - r_pibus_wbuf
+    // - r_pibus_pref, r_pibus_pref_slot
+    // - r_pibus_mshr
+    // - r_mshr_fifo get
+    // - r_ipref_state, r_ipref_buf (prefetch transactions)
+    // - r_wmerge_addr, r_wmerge_first, r_wmerge_count, r_wmerge_be 
+    // - r_wmerge_cached, r_wmerge_buf
+    // - r_dcache_wb_req reset
     // - r_icache_miss_req reset
     // - r_icache_unc_req reset
     // - r_dcache_miss_req reset
@@ -909,25 +2612,88 @@ void PibusMips32Xcache::transition()
     // 
     // There is 7 write request types :  WDU, WH0, WH1, WB0, WB1, WB2, WB3, 
     // and 6 read request types : WDU, WD2, WD4, WD8, WD16, WD32.
+    // The write-back requests use the same 6 burst types as the read requests.
     // Read requests can be for data or instructions.
     // The cache controller implement the following priorities :
     // 1/ DATA WRITE       : write buffer not empty
-    // 2/ DATA SC          : r_dcache_sc_req
-    // 3/ DATA READ        : r_dcache_miss_req or r_dcache_unc_req
-    // 4/ INSTRUCTION READ : r_icache_miss_req or r_icache_unc_req
+    // 2/ DATA WRITE-BACK  : r_dcache_wb_req
+    // 3/ DATA SC          : r_dcache_sc_req
+    // 4/ DATA READ        : r_mshr_fifo, r_dcache_miss_req or r_dcache_unc_req
+    // 5/ INSTRUCTION READ : r_icache_miss_req or r_icache_unc_req
+    // 6/ DATA PREFETCH    : prefetch buffer slot in WAIT state
+    // 7/ INSTRUCTION PREFETCH : stream buffer slot in WAIT state
+    // A data prefetch request is dropped if the bus is not granted
+    // after m_dpref_max_wait cycles, unless it has been restarted after
+    // a RETRY : the target has then registered the request.
+    // The write-back request has priority on the data read requests, 
+    // to guarantee that a line is never read before the completion of
+    // its write-back. The r_dcache_wb_req flip-flop is reset at the end 
+    // of the write-back transaction, as the r_dcache_wb_buf is used
+    // until the last data cycle.
+    //
+    // In non-blocking mode, the r_pibus_buf buffer is shared by several 
+    // pending refills : a new read transaction using this buffer is not 
+    // started before the previous response has been consumed (r_pibus_rsp_ok).
+    //
+    // The write buffer head is popped in the r_wmerge_buf buffer in the IDLE
+    // state, and the next write buffer entries are merged in this buffer 
+    // in the WRITE_REQ state, until the bus is granted.
+    // The merged words are sent as one or several write transactions, 
+    // and the r_wmerge_buf buffer must be empty before a new entry is popped.
     //////////////////////////////////////////////////////////////////////////
 
+    bool	wbuf_get = false;	// write buffer pop
+    bool	mshr_get = false;	// MSHR request queue pop
+    bool	buf_free = (m_mshr_count == 0) or !r_pibus_rsp_ok.read();
+
     switch (r_pibus_fsm) {
     case PIBUS_IDLE : 
     {
         r_pibus_wcount = 0;
+        r_pibus_first  = 0;
+        r_pibus_rmask  = 0;
+        r_pibus_pref   = false;
+        r_pibus_gnt_wait = 0;
+        r_pibus_retry    = false;
 
-	if ( r_wbuf_data.rok() )		// WRITE request
+	if ( r_wmerge_count.read() != 0 )	// WRITE request (merged words)
+        {
+            c_bus_write_count++;
+            c_wbuf_trans_count++;
+            r_pibus_ins   = false;
+            r_pibus_wb    = false;
+            r_pibus_wbuf  = true;
+            r_pibus_addr  = r_wmerge_addr.read() + (r_wmerge_first.read() << 2);
+            r_pibus_fsm   = PIBUS_WRITE_REQ; 
+        }
+	else if ( r_wbuf_data.rok() )		// WRITE request
+        {
+            uint32_t addr = r_wbuf_addr.read();
+            uint32_t word = (addr >> 2) & (m_dcache_words - 1);
+            wbuf_get = true;
+            c_wbuf_get_count++;
+            c_bus_write_count++;
+            c_wbuf_trans_count++;
+            r_wmerge_addr      = addr & m_line_data_mask;
+            r_wmerge_first     = word;
+            r_wmerge_count     = 1;
+            r_wmerge_be        = opc2be( r_wbuf_type.read() );
+            r_wmerge_cached    = m_cached_table[((addr >> m_msb_shift) & m_msb_mask)];
+            r_wmerge_buf[word] = r_wbuf_data.read();
+            r_pibus_ins   = false;
+            r_pibus_wb    = false;
+            r_pibus_wbuf  = true;
+            r_pibus_addr  = addr & 0xFFFFFFFC;
+            r_pibus_fsm   = PIBUS_WRITE_REQ; 
+        }
+        else if ( r_dcache_wb_req.read() )	// WB request
         {
+            c_bus_write_count++;
             r_pibus_ins   = false;
-            r_pibus_addr  = r_wbuf_addr.read();
-            r_pibus_wdata = r_wbuf_data.read();
-            r_pibus_opc   = r_wbuf_type.read();
+            r_pibus_wb    = true;
+            r_pibus_wbuf  = false;
+            r_pibus_addr  = r_dcache_wb_addr.read();
+            r_pibus_opc   = nwords2opc( m_dcache_words );
             r_pibus_fsm   = PIBUS_WRITE_REQ; 
         }
         else if ( r_dcache_sc_req.read() )	// SC request
@@ -939,7 +2705,10 @@ void PibusMips32Xcache::transition()
             }
             else
             {
+                c_bus_write_count++;
                 r_pibus_ins     = false;
+                r_pibus_wb      = false;
+                r_pibus_wbuf    = false;
                 r_pibus_addr    = r_dcache_save_addr.read();
                 r_pibus_wdata   = r_dcache_save_wdata.read();
                 r_pibus_opc     = PIBUS_OPC_WDU;
@@ -947,41 +2716,46 @@ void PibusMips32Xcache::transition()
                 r_dcache_sc_req = false;
             }
         }
+        else if ( r_mshr_fifo.rok() and buf_free )	// DMISS request (MSHR)
+        {
+            size_t index  = r_mshr_fifo.read();
+            mshr_get      = true;
+            r_pibus_ins   = false;
+            r_pibus_mshr  = index;
+            r_pibus_addr  = r_mshr_addr[index];
+            r_pibus_first = r_mshr_word[index];
+            r_pibus_opc   = nwords2opc( m_dcache_words );
+            r_pibus_fsm   = PIBUS_READ_REQ;
+        }
         else if ( r_dcache_miss_req.read() )	// DMISS request
         {
             r_pibus_ins   = false;
+            r_pibus_mshr  = m_mshr_count;
             r_pibus_addr  = r_dcache_save_addr.read();
-            if      ( m_dcache_words == 1  ) r_pibus_opc = PIBUS_OPC_WDU;
-            else if ( m_dcache_words == 2  ) r_pibus_opc = PIBUS_OPC_WD2;
-            else if ( m_dcache_words == 4  ) r_pibus_opc = PIBUS_OPC_WD4;
-            else if ( m_dcache_words == 8  ) r_pibus_opc = PIBUS_OPC_WD8;
-            else if ( m_dcache_words == 16 ) r_pibus_opc = PIBUS_OPC_WD16;
-            else if ( m_dcache_words == 32 ) r_pibus_opc = PIBUS_OPC_WD32;
+            r_pibus_first = r_dcache_save_word.read();
+            r_pibus_opc   = nwords2opc( m_dcache_words );
             r_pibus_fsm       = PIBUS_READ_REQ;
             r_dcache_miss_req = false;
         }
-        else if ( r_dcache_unc_req.read() )	// DUNC request
+        else if ( r_dcache_unc_req.read() and buf_free )	// DUNC request
         {
             r_pibus_ins      = false;
+            r_pibus_mshr     = m_mshr_count;
             r_pibus_addr     = r_dcache_save_addr.read();
             r_pibus_opc      = PIBUS_OPC_WDU;
             r_pibus_fsm      = PIBUS_READ_REQ;
             r_dcache_unc_req = false;
         }
-        else if ( r_icache_miss_req.read() )	// IMISS request
+        else if ( r_icache_miss_req.read() and buf_free )	// IMISS request
         {
             r_pibus_ins   = true;
             r_pibus_addr  = r_icache_save_addr.read();
-            if      ( m_icache_words == 1  ) r_pibus_opc = PIBUS_OPC_WDU;
-            else if ( m_icache_words == 2  ) r_pibus_opc = PIBUS_OPC_WD2;
-            else if ( m_icache_words == 4  ) r_pibus_opc = PIBUS_OPC_WD4;
-            else if ( m_icache_words == 8  ) r_pibus_opc = PIBUS_OPC_WD8;
-            else if ( m_icache_words == 16 ) r_pibus_opc = PIBUS_OPC_WD16;
-            else if ( m_icache_words == 32 ) r_pibus_opc = PIBUS_OPC_WD32;
+            r_pibus_first = r_icache_save_word.read();
+            r_pibus_opc   = nwords2opc( m_icache_words );
             r_pibus_fsm  = PIBUS_READ_REQ;
             r_icache_miss_req = false;
         }
-        else if ( r_icache_unc_req.read() )	// IUNC request	
+        else if ( r_icache_unc_req.read() and buf_free )	// IUNC request	
         {
             r_pibus_ins      = true;
             r_pibus_addr     = r_icache_save_addr;
@@ -989,12 +2763,74 @@ void PibusMips32Xcache::transition()
             r_pibus_fsm      = PIBUS_READ_REQ;
             r_icache_unc_req = false;
         }
+        else if ( (m_dpref_depth != 0) or (m_ipref_depth != 0) )	// PREF request
+        {
+            size_t	slot = 0;
+            size_t	way, set, word;		// unused
+            if ( prefSelect( r_dpref_addr, r_dpref_state, m_dpref_depth, &slot, PREF_WAIT ) )
+            {
+                uint32_t	addr = r_dpref_addr[slot];
+                if ( !m_cached_table[((addr >> m_msb_shift) & m_msb_mask)] or
+                     r_dcache.hit( addr, &way, &set, &word ) or
+                     victLookup( false, addr, &way ) )
+                {
+                    r_dpref_state[slot] = PREF_EMPTY;
+                }
+                else
+                {
+                    c_dpref_count++;
+                    r_dpref_state[slot] = PREF_PENDING;
+                    r_pibus_ins       = false;
+                    r_pibus_pref      = true;
+                    r_pibus_pref_slot = slot;
+                    r_pibus_addr      = addr;
+                    r_pibus_opc       = nwords2opc( m_dcache_words );
+                    r_pibus_fsm       = PIBUS_READ_REQ;
+                }
+            }
+            else if ( prefSelect( r_ipref_addr, r_ipref_state, m_ipref_depth, &slot, PREF_WAIT ) )
+            {
+                uint32_t	addr = r_ipref_addr[slot];
+                if ( !m_cached_table[((addr >> m_msb_shift) & m_msb_mask)] or
+                     r_icache.hit( addr, &way, &set, &word ) or
+                     victLookup( true, addr, &way ) )
+                {
+                    r_ipref_state[slot] = PREF_EMPTY;
+                }
+                else
+                {
+                    c_ipref_count++;
+                    r_ipref_state[slot] = PREF_PENDING;
+                    r_pibus_ins       = true;
+                    r_pibus_pref      = true;
+                    r_pibus_pref_slot = slot;
+                    r_pibus_addr      = addr;
+                    r_pibus_opc       = nwords2opc( m_icache_words );
+                    r_pibus_fsm       = PIBUS_READ_REQ;
+                }
+            }
+        }
         break;
     }
     // READ transaction
     case PIBUS_READ_REQ :
     {
-	if (p_gnt == true)  r_pibus_fsm = PIBUS_READ_AD; 
+	if (p_gnt == true)  
+        {
+            r_pibus_fsm = PIBUS_READ_AD; 
+        }
+        // a data prefetch is dropped in case of bus contention
+        else if ( r_pibus_pref.read() and !r_pibus_ins.read() and !r_pibus_retry.read() and
+                  (r_pibus_gnt_wait.read() >= m_dpref_max_wait - 1) )
+        {
+            c_dpref_drop++;
+            prefCancel();
+            r_pibus_fsm = PIBUS_IDLE;
+        }
+        else
+        {
+            r_pibus_gnt_wait = r_pibus_gnt_wait.read() + 1 + skip;
+        }
         break;
     }
     case PIBUS_READ_AD :
@@ -1008,12 +2844,34 @@ void PibusMips32Xcache::transition()
     {
         if ( p_tout.read()  or (p_ack.read() == PIBUS_ACK_ERROR) )
         {
-            r_pibus_rsp_error             = true;
+            if ( r_pibus_pref.read() ) prefCancel();
+            else                       r_pibus_rsp_error = true;
+        }
+        else if ( p_ack.read() == PIBUS_ACK_RETRY )	// split transaction : restart
+        {
+            r_pibus_wcount   = 0;
+            r_pibus_gnt_wait = 0;
+            r_pibus_retry    = true;
+            r_pibus_fsm      = PIBUS_READ_REQ;
         }
 	else if ( p_ack.read() == PIBUS_ACK_READY )
         { 
+            uint32_t index = (r_pibus_first.read() + r_pibus_wcount.read() - 1) & 
+                             (opc2nwords(r_pibus_opc.read()) - 1);
             r_pibus_wcount = r_pibus_wcount.read() + 1;
-            r_pibus_buf[r_pibus_wcount.read() - 1] = p_d.read();
+            if ( r_pibus_pref.read() and r_pibus_ins.read() )
+            {
+                r_ipref_buf[r_pibus_pref_slot.read()*m_icache_words + index] = p_d.read();
+            }
+            else if ( r_pibus_pref.read() )
+            {
+                r_dpref_buf[r_pibus_pref_slot.read()*m_dcache_words + index] = p_d.read();
+            }
+            else
+            {
+                r_pibus_buf[index] = p_d.read();
+                r_pibus_rmask  = r_pibus_rmask.read() | (1u << index);
+            }
             if (  r_pibus_ins.read() and 
                  (r_pibus_wcount.read() == m_icache_words-1) ) r_pibus_fsm = PIBUS_READ_DT; 
             if ( !r_pibus_ins.read() and 
@@ -1023,15 +2881,40 @@ void PibusMips32Xcache::transition()
     }
     case PIBUS_READ_DT :
     {
-	if ( (p_ack.read() == PIBUS_ACK_ERROR) or p_tout.read() ) 
+	if ( ((p_ack.read() == PIBUS_ACK_ERROR) or p_tout.read()) and r_pibus_pref.read() ) 
+        {
+            prefCancel();
+            r_pibus_fsm                   = PIBUS_IDLE;
+        }
+	else if ( (p_ack.read() == PIBUS_ACK_ERROR) or p_tout.read() ) 
         { 
             r_pibus_rsp_error             = true;
             r_pibus_rsp_ok                = true;
             r_pibus_fsm                   = PIBUS_IDLE;
         } 
+        else if ( p_ack.read() == PIBUS_ACK_RETRY )	// split transaction : restart
+        {
+            r_pibus_wcount                = 0;
+            r_pibus_gnt_wait              = 0;
+            r_pibus_retry                 = true;
+            r_pibus_fsm                   = PIBUS_READ_REQ;
+        }
+        else if ( (p_ack.read() == PIBUS_ACK_READY) and r_pibus_pref.read() ) 
+        { 
+            uint32_t slot = r_pibus_pref_slot.read();
+            if ( r_pibus_ins.read() ) 
+                r_ipref_buf[slot*m_icache_words + r_pibus_wcount.read() - 1] = p_d.read();
+            else
+                r_dpref_buf[slot*m_dcache_words + r_pibus_wcount.read() - 1] = p_d.read();
+            prefComplete();
+            r_pibus_fsm                   = PIBUS_IDLE;
+        } 
         else if (p_ack.read() == PIBUS_ACK_READY) 
         { 
-            r_pibus_buf[r_pibus_wcount-1] = p_d.read();
+            uint32_t index = (r_pibus_first.read() + r_pibus_wcount.read() - 1) & 
+                             (opc2nwords(r_pibus_opc.read()) - 1);
+            r_pibus_buf[index]            = p_d.read();
+            r_pibus_rmask                 = r_pibus_rmask.read() | (1u << index);
             r_pibus_rsp_ok                = true;
             r_pibus_fsm                   = PIBUS_IDLE;
 	}
@@ -1043,6 +2926,27 @@ void PibusMips32Xcache::transition()
         // start Pibus transaction if bus is allocated
 	if (p_gnt == true) 
         {
+            // for a write buffer transaction, the full words are sent
+            // as a burst, and a partial word as a single word transaction.
+            // A burst of N words is aligned on a N words boundary : the
+            // leading words are sent as smaller bursts
+            if ( r_pibus_wbuf.read() )
+            {
+                uint32_t first = r_wmerge_first.read();
+                uint32_t nfull = r_wmerge_count.read();
+                if ( r_wmerge_be.read() != 0xF ) nfull = nfull - 1;
+                if ( nfull == 0 ) 
+                {
+                    r_pibus_opc = be2opc( r_wmerge_be.read() );
+                }
+                else
+                {
+                    uint32_t nwords = 1;
+                    while ( ((nwords << 1) <= nfull) and 
+                            ((first & ((nwords << 1) - 1)) == 0) ) nwords = nwords << 1;
+                    r_pibus_opc = nwords2opc( nwords );
+                }
+            }
             r_pibus_fsm = PIBUS_WRITE_AD; 
         }
         // Abort the bus transaction in case of external hit on a LL/SC address
@@ -1050,11 +2954,69 @@ void PibusMips32Xcache::transition()
         {
             r_pibus_fsm = PIBUS_IDLE;
         }
+        // Merge the write buffer head while waiting for the bus
+        else if ( m_wbuf_merge and r_pibus_wbuf.read() and 
+                  r_wmerge_cached.read() and r_wbuf_data.rok() )
+        {
+            uint32_t addr = r_wbuf_addr.read();
+            uint32_t word = (addr >> 2) & (m_dcache_words - 1);
+            uint32_t last = r_wmerge_first.read() + r_wmerge_count.read() - 1;
+            uint32_t be   = opc2be( r_wbuf_type.read() );
+            if ( (addr & m_line_data_mask) == r_wmerge_addr.read() ) 
+            {
+                if ( (word == last) and 
+                     (be2opc( r_wmerge_be.read() | be ) != PIBUS_OPC_NOP) ) 	// same word
+                {
+                    uint32_t mask = be2mask( be );
+                    r_wmerge_buf[word] = (r_wmerge_buf[word] & ~mask) | 
+                                         (r_wbuf_data.read() & mask);
+                    r_wmerge_be = r_wmerge_be.read() | be;
+                    wbuf_get    = true;
+                    c_wbuf_get_count++;
+                }
+                else if ( (word == last + 1) and (r_wmerge_be.read() == 0xF) )	// next word
+                {
+                    r_wmerge_buf[word] = r_wbuf_data.read();
+                    r_wmerge_be    = be;
+                    r_wmerge_count = r_wmerge_count.read() + 1;
+                    wbuf_get       = true;
+                    c_wbuf_get_count++;
+                }
+            }
+        }
         break;
     }
     case PIBUS_WRITE_AD :
     {
-	r_pibus_fsm = PIBUS_WRITE_DT; 
+	r_pibus_wcount = r_pibus_wcount + 1;
+	if ( opc2nwords(r_pibus_opc.read()) > 1 )	r_pibus_fsm = PIBUS_WRITE_DTAD; 
+	else						r_pibus_fsm = PIBUS_WRITE_DT; 
+        break;
+    }
+    case PIBUS_WRITE_DTAD :
+    {
+        if ( p_tout.read() or (p_ack.read() == PIBUS_ACK_ERROR) )
+        {
+            r_pibus_fsm = PIBUS_IDLE; 
+            r_proc.setWriteBerr();
+            if ( r_pibus_wb.read() ) r_dcache_wb_req = false;
+            if ( r_pibus_wbuf.read() ) 
+            {
+                r_wmerge_first = r_wmerge_first.read() + opc2nwords(r_pibus_opc.read());
+                r_wmerge_count = r_wmerge_count.read() - opc2nwords(r_pibus_opc.read());
+            }
+        }
+        else if ( p_ack.read() == PIBUS_ACK_RETRY )	// split transaction : restart
+        {
+            r_pibus_wcount = 0;
+            r_pibus_fsm    = PIBUS_WRITE_REQ;
+        }
+	else if ( p_ack.read() == PIBUS_ACK_READY )
+        { 
+            r_pibus_wcount = r_pibus_wcount.read() + 1;
+            if ( r_pibus_wcount.read() == opc2nwords(r_pibus_opc.read()) - 1 ) 
+                r_pibus_fsm = PIBUS_WRITE_DT; 
+	} 
         break;
     }
     case PIBUS_WRITE_DT :
@@ -1063,10 +3025,27 @@ void PibusMips32Xcache::transition()
         {
             r_pibus_fsm = PIBUS_IDLE; 
             r_proc.setWriteBerr();
+            if ( r_pibus_wb.read() ) r_dcache_wb_req = false;
+            if ( r_pibus_wbuf.read() ) 
+            {
+                r_wmerge_first = r_wmerge_first.read() + opc2nwords(r_pibus_opc.read());
+                r_wmerge_count = r_wmerge_count.read() - opc2nwords(r_pibus_opc.read());
+            }
+        }
+        else if ( p_ack.read() == PIBUS_ACK_RETRY )	// split transaction : restart
+        {
+            r_pibus_wcount = 0;
+            r_pibus_fsm    = PIBUS_WRITE_REQ;
         }
 	else if (p_ack.read() == PIBUS_ACK_READY) 
         { 
             r_pibus_fsm = PIBUS_IDLE; 
+            if ( r_pibus_wb.read() ) r_dcache_wb_req = false;
+            if ( r_pibus_wbuf.read() ) 
+            {
+                r_wmerge_first = r_wmerge_first.read() + opc2nwords(r_pibus_opc.read());
+                r_wmerge_count = r_wmerge_count.read() - opc2nwords(r_pibus_opc.read());
+            }
 	} 
     }
     break;
@@ -1079,7 +3058,7 @@ void PibusMips32Xcache::transition()
     //  from the DCACHE FSM to the PIBUS FSM.
     ///////////////////////////////////////////
 
-    bool 	fifo_get  = (r_pibus_fsm == PIBUS_IDLE) && r_wbuf_data.rok();
+    bool 	fifo_get  = wbuf_get;
     bool 	fifo_put  = (r_dcache_fsm == DCACHE_WRITE_REQ) && r_wbuf_data.wok();
     uint32_t	fifo_wdata = r_dcache_save_wdata;
     uint32_t	fifo_waddr = r_dcache_save_addr;
@@ -1110,6 +3089,16 @@ void PibusMips32Xcache::transition()
 	r_wbuf_type.simple_get(); 
     }
 
+    ///////////////////////////////////////////
+    //  MSHR request queue handling
+    //  This FIFO contains the refill requests
+    //  from the DCACHE FSM to the PIBUS FSM.
+    ///////////////////////////////////////////
+
+    if ( mshr_put and mshr_get ) r_mshr_fifo.put_and_get(mshr_index);
+    if ( mshr_put and !mshr_get ) r_mshr_fifo.simple_put(mshr_index);
+    if ( !mshr_put and mshr_get ) r_mshr_fifo.simple_get();
+
 } // end transition()
 
 //////////////////////////////////
@@ -1131,7 +3120,10 @@ void PibusMips32Xcache::genMoore()
     case PIBUS_READ_DTAD :
     {
 	p_req  = false; 
-	p_a    = r_pibus_addr.read() + ( r_pibus_wcount.read() << 2);
+	// critical word first, with wrap-around
+	p_a    = r_pibus_addr.read() + 
+                 (((r_pibus_first.read() + r_pibus_wcount.read()) & 
+                   (opc2nwords(r_pibus_opc.read()) - 1)) << 2);
 	p_read = true;
         p_opc  = r_pibus_opc.read();
         if      ( r_pibus_opc == PIBUS_OPC_WD2 ) 	p_lock = (r_pibus_wcount < 1);
@@ -1148,18 +3140,26 @@ void PibusMips32Xcache::genMoore()
         break; 
     }
     case PIBUS_WRITE_AD :
+    case PIBUS_WRITE_DTAD :
     {
 	p_req  = false; 
-	p_a    = r_pibus_addr.read();
+	p_a    = r_pibus_addr.read() + (r_pibus_wcount.read() << 2);
         p_read = false;
-	p_lock = false;
+	p_lock = (r_pibus_wcount.read() < opc2nwords(r_pibus_opc.read()) - 1);
 	p_opc  = r_pibus_opc.read();
+        if ( r_pibus_fsm == PIBUS_WRITE_DTAD ) 
+        {
+            if ( r_pibus_wb.read() ) p_d = r_dcache_wb_buf[r_pibus_wcount.read() - 1];
+            else                     p_d = r_wmerge_buf[r_wmerge_first.read() + r_pibus_wcount.read() - 1];
+        }
         break;
     }
     case PIBUS_WRITE_DT : 
     {
 	p_req = false;  
-	p_d   = r_pibus_wdata.read(); 
+        if      ( r_pibus_wb.read() )   p_d = r_dcache_wb_buf[r_pibus_wcount.read() - 1];
+        else if ( r_pibus_wbuf.read() ) p_d = r_wmerge_buf[r_wmerge_first.read() + r_pibus_wcount.read() - 1];
+	else                            p_d = r_pibus_wdata.read(); 
         break; 
     }
     } // end switch r_pibus_fsm 
@@ -1178,19 +3178,37 @@ void PibusMips32Xcache::printTrace()
                                  << m_pibus_fsm_str[r_pibus_fsm] << std::endl;
 
     if ( r_wbuf_data.rok() ) std::cout << "  WBUF = " << r_wbuf_data.filled_status() << " ";
+    if ( r_wmerge_count.read() ) std::cout << "  WMERGE = " << r_wmerge_count.read() << " ";
     if ( r_dcache_sc_req.read() ) std::cout << "  SC_REQ";
+    if ( r_dcache_wb_req.read() ) std::cout << "  WB_REQ : " << std::hex << r_dcache_wb_addr.read();
+    if ( mshrActive() ) std::cout << "  MSHR = " << std::dec << mshrActive() << " ";
     if ( r_snoop_dcache_inval_req.read() ) std::cout << "  SNOOP_DCACHE_REQ";
     if ( r_snoop_llsc_inval_req.read() ) std::cout << "  SNOOP_LLSC_REQ";
     if ( r_snoop_flush_req.read() ) std::cout << "  SNOOP_FLUSH_REQ";
     if ( r_llsc_pending.read() ) std::cout << "  LLSC_ADDR : " << std::hex << r_llsc_addr;
     if ( r_wbuf_data.rok() or
+         r_wmerge_count.read() or
          r_dcache_sc_req.read() or
+         r_dcache_wb_req.read() or
+         mshrActive() or
          r_snoop_dcache_inval_req.read() or
          r_snoop_llsc_inval_req.read() or
          r_snoop_flush_req.read() or 
          r_llsc_pending.read() ) std::cout << std::endl;
 }
 
+////////////////////////////////////
+uint64_t PibusMips32Xcache::getCycles()
+{
+    return c_total_cycles;
+}
+
+//////////////////////////////////////////
+uint64_t PibusMips32Xcache::getInstructions()
+{
+    return c_total_cycles - c_frz_cycles;
+}
+
 /////////////////////////////////////////
 void PibusMips32Xcache::printStatistics()
 {
@@ -1203,10 +3221,159 @@ void PibusMips32Xcache::printStatistics()
     std::cout << "- WRITE RATE         = " << (float)c_write_count/run_cycles << std::endl;
     std::cout << "- IMISS RATE         = " << (float)c_imiss_count/run_cycles << std::endl;
     std::cout << "- DMISS RATE         = " << (float)c_dmiss_count/(c_dread_count - c_dunc_count) << std::endl ;
+    if ( m_dpref_depth )
+    {
+        std::cout << "- DPREF ACCURACY     = " << (float)(c_dpref_useful + c_dpref_late)/(c_dpref_count - c_dpref_drop) << std::endl;
+        std::cout << "- DPREF COVERAGE     = " << (float)(c_dpref_useful + c_dpref_late)/c_dmiss_count << std::endl;
+        std::cout << "- DPREF DROP RATE    = " << (float)c_dpref_drop/c_dpref_count << std::endl;
+    }
+    if ( m_mshr_count )
+    {
+        std::cout << "- HIT UNDER MISS     = " << (float)c_mshr_hit/(c_dread_count - c_dunc_count) << std::endl;
+        std::cout << "- MISS UNDER MISS    = " << (float)c_mshr_miss/c_dmiss_count << std::endl;
+    }
     std::cout << "- IMISS COST         = " << (float)c_imiss_frz/c_imiss_count << std::endl;
     std::cout << "- DMISS COST         = " << (float)c_dmiss_frz/c_dmiss_count << std::endl;
     std::cout << "- UNC COST           = " << (float)c_dunc_frz/c_dunc_count << std::endl;
     std::cout << "- WRITE COST         = " << (float)c_write_frz/c_write_count << std::endl;
+    std::cout << "- BUS WRITE RATE     = " << (float)c_bus_write_count/run_cycles << std::endl;
+    std::cout << "- WBUF MERGE RATIO   = " << (float)c_wbuf_get_count/c_wbuf_trans_count << std::endl;
+    if ( m_ipref_depth )
+    {
+        std::cout << "- IPREF ISSUED       = " << c_ipref_count << std::endl;
+        std::cout << "- IPREF USEFUL       = " << c_ipref_useful << std::endl;
+        std::cout << "- IPREF LATE         = " << c_ipref_late << std::endl;
+    }
+    if ( m_vict_depth )
+    {
+        std::cout << "- IVICT HIT RATE     = " << (float)c_ivict_hit/c_imiss_count << std::endl;
+        std::cout << "- DVICT HIT RATE     = " << (float)c_dvict_hit/(c_dmiss_count + c_wmiss_count) << std::endl;
+    }
+    if ( c_ffwd_count )
+    {
+        std::cout << "- FUNCTIONAL CYCLES  = " << c_ffwd_count << std::endl;
+    }
+    if ( m_write_back )
+    {
+        std::cout << "- WRITE MISS RATE    = " << (float)c_wmiss_count/c_write_count << std::endl;
+        std::cout << "- WRITE BACK RATE    = " << (float)c_wb_count/run_cycles << std::endl;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////
+// This function displays the per-PC profile, using the symbols of the
+// ELF files read by the loader:
+// - the flat profile contains one line per function, sorted by the 
+//   number of cycles (executed + frozen).
+// - the annotated listing contains the nloops hottest loops, with one 
+//   line per executed instruction. A loop is defined by a backward branch 
+//   or jump, and contains the instructions from the branch target to 
+//   the branch delay slot. The number of iterations is the number of
+//   executions of the backward branch.
+/////////////////////////////////////////////////////////////////////////
+void PibusMips32Xcache::printProfile(const Loader &loader, size_t nloops)
+{
+    if ( m_prof_size == 0 ) return;
+
+    // allocated entries sorted by address
+    std::vector<ProfileEntry> entries;
+    for ( size_t i = 0 ; i < m_prof_size ; i++ )
+    {
+        if ( m_prof_table[i].pc != PROF_EMPTY ) entries.push_back( m_prof_table[i] );
+    }
+    std::sort( entries.begin(), entries.end(), profileAddressLess<ProfileEntry> );
+
+    // flat profile
+    std::map<std::string, size_t>	index;
+    std::vector<ProfileSum>		functions;
+    uint32_t				total = 0;
+    for ( size_t i = 0 ; i < entries.size() ; i++ )
+    {
+        std::string name = loader.get_symbol_by_addr( entries[i].pc ).name();
+        if ( index.find( name ) == index.end() )
+        {
+            ProfileSum sum;
+            sum.name   = name;
+            sum.first  = entries[i].pc;
+            sum.last   = entries[i].pc;
+            sum.cycles = 0;
+            for ( size_t k = 0 ; k < 5 ; k++ ) sum.count[k] = 0;
+            index[name] = functions.size();
+            functions.push_back( sum );
+        }
+        ProfileSum* sum = &functions[index[name]];
+        for ( size_t k = 0 ; k < 5 ; k++ ) sum->count[k] += entries[i].count[k];
+        sum->cycles += entries[i].count[PROF_EXEC] + entries[i].count[PROF_FRZ];
+        total       += entries[i].count[PROF_EXEC] + entries[i].count[PROF_FRZ];
+    }
+    std::sort( functions.begin(), functions.end(), profileCyclesMore );
+
+    std::cout << "*** " << name() << " profile at cycle " << std::dec << c_total_cycles << std::endl;
+    std::cout << "- PROFILED CYCLES    = " << total << std::endl;
+    std::cout << "- PROFILED ADDRESSES = " << entries.size() << std::endl;
+    std::cout << "- DROPPED EVENTS     = " << c_prof_drop << std::endl;
+    std::cout << std::endl << "  -- flat profile --" << std::endl;
+    printf("  %%cycles     cycles       exec        frz  imiss  dmiss    unc    CPI  function\n");
+    for ( size_t f = 0 ; f < functions.size() ; f++ )
+    {
+        ProfileSum* sum = &functions[f];
+        printf("  %7.2f %10u %10u %10u %6u %6u %6u %6.2f  %s\n",
+               total ? 100.0*sum->cycles/total : 0.0,
+               sum->cycles, sum->count[PROF_EXEC], sum->count[PROF_FRZ],
+               sum->count[PROF_IMISS], sum->count[PROF_DMISS], sum->count[PROF_UNC],
+               sum->count[PROF_EXEC] ? (double)sum->cycles/sum->count[PROF_EXEC] : 0.0,
+               sum->name.c_str());
+    }
+
+    // hot loops : backward branches found in the executed instructions
+    std::vector<ProfileSum> loops;
+    for ( size_t i = 0 ; i < entries.size() ; i++ )
+    {
+        uint32_t ins;
+        uint32_t target;
+        if ( entries[i].count[PROF_EXEC] == 0 ) continue;
+        if ( !functionalRead( entries[i].pc, &ins ) ) continue;
+        if ( !branchTarget( entries[i].pc, ins, &target ) or (target > entries[i].pc) ) continue;
+
+        ProfileSum loop;
+        loop.name   = loader.get_symbol_by_addr( target ).name();
+        loop.first  = target;
+        loop.last   = entries[i].pc + 4;	// delay slot
+        loop.cycles = 0;
+        for ( size_t k = 0 ; k < 5 ; k++ ) loop.count[k] = 0;
+        loop.count[PROF_EXEC] = entries[i].count[PROF_EXEC];	// iterations
+        for ( size_t j = 0 ; j < entries.size() ; j++ )
+        {
+            if ( (entries[j].pc < loop.first) or (entries[j].pc > loop.last) ) continue;
+            loop.cycles += entries[j].count[PROF_EXEC] + entries[j].count[PROF_FRZ];
+        }
+        loops.push_back( loop );
+    }
+    std::sort( loops.begin(), loops.end(), profileCyclesMore );
+
+    std::cout << std::endl << "  -- hot loops --" << std::endl;
+    for ( size_t l = 0 ; (l < loops.size()) and (l < nloops) ; l++ )
+    {
+        ProfileSum* loop = &loops[l];
+        printf("  loop %d : 0x%08x - 0x%08x in %s : %.2f%% cycles / %u iterations\n",
+               (int)l, loop->first, loop->last, loop->name.c_str(),
+               total ? 100.0*loop->cycles/total : 0.0, loop->count[PROF_EXEC]);
+        printf("       address  instruction       exec        frz  imiss  dmiss    unc\n");
+        for ( size_t j = 0 ; j < entries.size() ; j++ )
+        {
+            if ( (entries[j].pc < loop->first) or (entries[j].pc > loop->last) ) continue;
+            uint32_t ins = 0;
+            functionalRead( entries[j].pc, &ins );
+            printf("    0x%08x     %08x %10u %10u %6u %6u %6u  %s+0x%x\n",
+                   entries[j].pc, ins,
+                   entries[j].count[PROF_EXEC], entries[j].count[PROF_FRZ], 
+                   entries[j].count[PROF_IMISS], entries[j].count[PROF_DMISS], 
+                   entries[j].count[PROF_UNC],
+                   loader.get_symbol_by_addr( entries[j].pc ).name().c_str(),
+                   (uint32_t)loader.get_symbol_by_addr( entries[j].pc ).offset());
+        }
+    }
+    std::cout << std::endl;
 }
 
 }} // end namespaces
@@ -5,16 +5,142 @@
 // Copyright UPMC/LIP6
 //
 // This file defines the mnemonics for the PIBUS opcodes
-// and acknowledges.
+// and acknowledges, the functional memory access interface,
+// and the sc_register type used by all PIBUS components.
 /////////////////////////////////////////////////////////////////
 
 #ifndef PIBUS_MNEMONICS_H
 #define PIBUS_MNEMONICS_H
 
+#include <systemc>
+#include <vector>
+#include <string.h>
+
+/////////////////////////////////////////////////////////////////
+// The sc_register type is a lightweight two-phase register :
+// read() returns the current value, write() (or =) sets the
+// next value, that becomes the current value at the end of
+// the delta cycle, as for an sc_signal. There is no event and
+// no sensitivity : it can only be used for the internal state
+// registers written in the transition() method.
+// All the registers written during a cycle are linked in a 
+// global list, that is committed by a single primitive channel.
+// All the registers are also registered (in creation order) in
+// a global register list, used by the checkpoint facility to save
+// and restore the current values (see pibus_checkpoint.h).
+// Defining PIBUS_SC_SIGNAL_REGISTERS restores the sc_signal
+// implementation (for performance comparison).
+/////////////////////////////////////////////////////////////////
+
+#ifdef PIBUS_SC_SIGNAL_REGISTERS
 #define sc_register sc_core::sc_signal
+#else
+#define sc_register soclib::common::PibusRegister
+#endif
 
 namespace soclib { namespace common {
 
+class PibusRegisterBase {
+    size_t m_index;	// index in the register list
+public:
+    bool m_pending;	// registered in the commit list
+    PibusRegisterBase();
+    virtual void commit() = 0;
+    virtual size_t stateSize() const = 0;
+    virtual void saveState(void* buf) const = 0;
+    virtual void loadState(const void* buf) = 0;
+    virtual ~PibusRegisterBase();
+    static std::vector<PibusRegisterBase*>& list()
+    {
+        static std::vector<PibusRegisterBase*>* registers = new std::vector<PibusRegisterBase*>();	// never deleted
+        return *registers;
+    }
+};
+
+/////////////////////////////////////////////////////////////////
+// The commit channel is created during elaboration, by the 
+// first register constructor. It requests one update per delta
+// cycle, only when at least one register has been written.
+/////////////////////////////////////////////////////////////////
+class PibusRegisterCommit : public sc_core::sc_prim_channel {
+    std::vector<PibusRegisterBase*> m_written;
+protected:
+    void update()
+    {
+        for ( size_t i = 0 ; i < m_written.size() ; i++ ) m_written[i]->commit();
+        m_written.clear();
+    }
+public:
+    PibusRegisterCommit()
+        : sc_core::sc_prim_channel(sc_core::sc_gen_unique_name("pibus_register_commit"))
+    {
+        m_written.reserve(1024);
+    }
+    inline void add(PibusRegisterBase* reg)
+    {
+        if ( m_written.empty() ) request_update();
+        m_written.push_back(reg);
+    }
+    // a register deleted before the commit is removed from the list
+    void remove(PibusRegisterBase* reg)
+    {
+        for ( size_t i = 0 ; i < m_written.size() ; i++ )
+        {
+            if ( m_written[i] == reg ) 
+            {
+                m_written.erase(m_written.begin() + i);
+                return;
+            }
+        }
+    }
+    static PibusRegisterCommit* instance()
+    {
+        static PibusRegisterCommit* commit = new PibusRegisterCommit();	// never deleted
+        return commit;
+    }
+};
+
+inline PibusRegisterBase::PibusRegisterBase()
+    : m_index(list().size()),
+      m_pending(false)
+{
+    PibusRegisterCommit::instance();
+    list().push_back(this);
+}
+
+inline PibusRegisterBase::~PibusRegisterBase()
+{
+    if ( m_pending ) PibusRegisterCommit::instance()->remove(this);
+    list()[m_index] = NULL;
+}
+
+template<typename T>
+class PibusRegister : public PibusRegisterBase {
+    T	m_cur;
+    T	m_next;
+    PibusRegister(const PibusRegister&);	// not copyable
+public:
+    PibusRegister() : m_cur(T()), m_next(T()) {}
+    explicit PibusRegister(const char* name) : m_cur(T()), m_next(T()) { (void)name; }
+
+    inline const T& read() const { return m_cur; }
+    inline operator const T&() const { return m_cur; }
+    inline void write(const T& value)
+    {
+        m_next = value;
+        if ( !m_pending ) {
+            m_pending = true;
+            PibusRegisterCommit::instance()->add(this);
+        }
+    }
+    inline PibusRegister& operator=(const T& value) { write(value); return *this; }
+    inline PibusRegister& operator=(const PibusRegister& reg) { write(reg.read()); return *this; }
+    void commit() { m_cur = m_next; m_pending = false; }
+    size_t stateSize() const { return sizeof(T); }
+    void saveState(void* buf) const { memcpy(buf, &m_cur, sizeof(T)); }
+    void loadState(const void* buf) { memcpy(&m_cur, buf, sizeof(T)); m_next = m_cur; }
+};
+
 // PIBUS ACK Codes
 enum {
 PIBUS_ACK_WAIT    = 0,  
@@ -23,6 +149,13 @@ PIBUS_ACK_READY   = 2,
 PIBUS_ACK_RETRY   = 3, 
 };
 
+// A target can answer RETRY in the first data cycle of a transaction
+// (split transaction) : the transaction is aborted, the bus is released,
+// and the master must request the bus again to restart the transaction.
+// A target that registers a retried request discards it if it is not
+// restarted PIBUS_RETRY_EXPIRE cycles after the data is available.
+#define PIBUS_RETRY_EXPIRE	64
+
 // PIBUS OPC codes
 enum {
 PIBUS_OPC_NOP   =0x0, 
@@ -43,6 +176,40 @@ PIBUS_OPC_BY2   =0xE, // byre 2
 PIBUS_OPC_BY3   =0xF, // byte 3
 };
 
+/////////////////////////////////////////////////////////////////
+// Functional (backdoor) memory access interface : it is 
+// implemented by the memory components, and used by the
+// processors in fast-forward mode, without PIBUS transaction.
+// The methods return false if the address is not mapped.
+/////////////////////////////////////////////////////////////////
+class PibusFunctionalMemory {
+public:
+    virtual bool functionalRead(uint32_t address, uint32_t* data) = 0;
+    virtual bool functionalWrite(uint32_t address, uint32_t data, uint32_t be) = 0;
+    virtual ~PibusFunctionalMemory() {}
+};
+
+/////////////////////////////////////////////////////////////////
+// Idle cycles skipping interface : it is implemented by all
+// components of a platform, and used by the top cell to skip
+// the cycles where no component changes its outputs.
+// - idleCycles() returns the number of next cycles where the
+//   component only decrements (or increments) internal counters,
+//   assuming that its inputs don't change (0 if it is active,
+//   PIBUS_IDLE_FOREVER if it is waiting for an input change).
+// - skipCycles(n) updates the component state as if n cycles
+//   had been executed : it must be called when all components
+//   returned idleCycles() >= n, just before the next clock cycle.
+/////////////////////////////////////////////////////////////////
+#define PIBUS_IDLE_FOREVER	0xFFFFFFFF
+
+class PibusIdleSkip {
+public:
+    virtual uint32_t idleCycles() = 0;
+    virtual void skipCycles(uint32_t ncycles) = 0;
+    virtual ~PibusIdleSkip() {}
+};
+
 }} // end namespace
 
 #endif
@@ -15,13 +15,16 @@
 // allocation policy (in case of simultaneous transferts) is round-robin
 // with a PIBUS transaction granularity.
 
-// For each channel, this DMA controler contains  5 memory mapped registers
+// For each channel, this DMA controler contains  8 memory mapped registers
 // (only the 5 less significant bits of the VCI address are decoded)
 // - SOURCE		(0x00)	Read/Write	Source buffer base address
 // - DEST		(0x04)  Read/Write	Destination buffer base address
 // - LENGTH/STATUS	(0x08)	Read/Write	Transfer length (bytes) / Status
 // - RESET  		(0x0C)	Write Only	Software reset & IRQ acknowledge
 // - NOIRQ       	(0x10)	Read/Write	IRQ disabled when non zeo
+// - DESC		(0x14)	Read/Write	Descriptor chain address / next descriptor
+// - COALESCE		(0x18)	Read/Write	IRQ every N descriptors (0 : chain end only)
+// - INDEX		(0x1C)	Read/Write	Current descriptor index / descriptor IRQ acknowledge
 //
 // Both the source and destination address must be word aligned, and
 // and the transfer length must be a multiple of 4 bytes.
@@ -48,7 +51,68 @@
 // (states SUCCESS, READ_ERROR, WRITE_ERROR). The IRQ is not asserted
 // if the NOIRQ register contains a non-zero value.
 // Writing in the RESET register is the normal way to acknowledge IRQ.
-// Each DMA channel contains a private buffer to store a burst.
+//
+// Descriptor chains (scatter-gather mode) :
+// A write access to register DESC starts the execution of a chain of
+// descriptors stored in memory, the written value being the address 
+// of the first descriptor. A descriptor is a 32 bytes aligned 
+// structure containing 8 words :
+// - SRC	(0x00)	source buffer address (first line)
+// - DST	(0x04)	destination buffer address (first line)
+// - LEN	(0x08)	line length (bytes)
+// - COUNT	(0x0C)	number of lines
+// - SSTRIDE	(0x10)	source stride (bytes between two line starts)
+// - DSTRIDE	(0x14)	destination stride (bytes between two line starts)
+// - FLAGS	(0x18)	bit 0 : last descriptor / bit 1 : IRQ at completion
+//			bits 6:4 : operation / bits 15:8 : threshold / bits 23:16 : value
+// - NEXT	(0x1C)	next descriptor address
+// The descriptor is fetched by the master port, in bursts of min(8, burst)
+// words (one WD8 transaction when burst is 8 or more), and describes a
+// 2D transfer of COUNT lines of LEN bytes : a single descriptor can
+// move a frame, or a rectangle in a frame. The chain
+// ends with the LAST descriptor, and a NEXT pointer can build a ring,
+// that is executed until a software reset.
+// The INDEX register contains the number of completed descriptors
+// (that is the index of the current descriptor in the chain).
+// At chain end, the channel goes to the SUCCESS state and asserts the
+// IRQ, as a simple transfer. The channel asserts also the IRQ after a
+// descriptor with the IRQ flag, or every COALESCE descriptors when the
+// COALESCE register is not zero : this IRQ is acknowledged by a write
+// in the INDEX register, and doesn't stop the chain.
+// In case of error, the INDEX register points on the faulty descriptor.
+// The addresses, lengths and strides contained in a descriptor must be
+// multiple of 4 bytes.
+//
+// Blit operations (descriptor chains only) :
+// The operation field of the FLAGS word defines the transformation
+// applied to the pixels (bytes) written in the destination buffer :
+// - COPY	(0)	pixels are copied
+// - FILL	(1)	the SRC word is used as fill pattern (no read)
+// - THRESHOLD	(2)	pixels larger than threshold are replaced by value
+// - LUT	(3)	pixels are translated by the channel look-up table
+// - LUT_LOAD	(4)	the 256 bytes look-up table is read at address SRC
+//			(LEN must be 256 and COUNT must be 1 / no write)
+// The look-up table is kept by the channel until the next LUT_LOAD.
+// It is cleared by the hardware reset : before the first LUT_LOAD, all
+// pixels are translated to 0.
+// The simple transfers (LENGTH register) are always COPY operations.
+//
+// The PIBUS transactions are WD2 to WD32 bursts on the aligned parts
+// of the source and destination buffers (the burst size is bounded by
+// the burst argument), and single words on the unaligned edges.
+// Each channel owns a 2 * burst words circular buffer : the channel
+// reads ahead (block n+1) while block n is waiting to be written, and
+// the read and write bursts can have different sizes when the source
+// and destination buffers have different alignments.
+// The bus is requested after the last data cycle of a transaction :
+// when another channel is waiting, the master port goes directly from
+// this last data cycle to the request of the next transaction.
+//
+// The DMA implements the PibusIdleSkip interface : it is idle when
+// the channels wait the master port or a software command, and the
+// master port waits the bus, or a data acknowledge.
+// The DMA implements the PibusCheckpointable interface : the channel
+// buffers and look-up tables are saved with the registers.
 ///////////////////////////////////////////////////////////////////////////
 // Implementation note:
 // This component contains NB_CHANNELS + 2 FSMs:
@@ -57,12 +121,19 @@
 //   or desactivate the CHANNEL_FSM[k]
 // - the MASTER_FSM is a server handling the PIBUS transactions requested
 //   by the CHANNEL_FSM[k]
+// A bus error in a burst is reported to the CHANNEL_FSM[k] at the end
+// of the burst.
+// The descriptor words are directly written in the channel registers
+// by the MASTER_FSM, and the CHANNEL_FSM[k] handles the line changes
+// in a 2D transfer (the bursts never cross a line boundary).
+// The blit operation is applied on the fly, when the buffered words are
+// sent on the PIBUS.
 ///////////////////////////////////////////////////////////////////////////
 // This component has 5 "constructor" parameters :
 // - sc_module_name 	name		: instance name
 // - unsigned int	tgtid		: target index
 // - PibusSegmentTable 	segtab		: segment table
-// - unsigned int	burst		: burst length number of bytes
+// - unsigned int	burst		: max burst length (number of words, no larger than 32 on the bus)
 // - unsigned int	channels	: number of channels
 ////////////////////////////////////////////////////////////////////////////
 
@@ -72,10 +143,13 @@
 #include <systemc.h>
 #include "pibus_mnemonics.h"
 #include "pibus_segment_table.h"
+#include "pibus_checkpoint.h"
 
 namespace soclib { namespace caba {
 
-class PibusMultiDma : sc_module {
+class PibusMultiDma : sc_module,
+                      public soclib::common::PibusIdleSkip,
+                      public soclib::common::PibusCheckpointable {
 
     // REGISTERS
     sc_register<int>      	r_target_fsm;		// target fsm state register
@@ -85,28 +159,46 @@ class PibusMultiDma : sc_module {
     sc_register<uint32_t>       r_master_index;		// selected channel
     sc_register<uint32_t>       r_master_count;		// word counter in a burst
     sc_register<uint32_t>       r_master_burst;		// actual burst length (words)
+    sc_register<bool>		r_master_desc;		// descriptor fetch
 
     sc_register<int>*		r_channel_fsm;		// channel fsm state registers [channel]
     sc_register<uint32_t>*     	r_channel_source;	// source buffer base address [channel]
     sc_register<uint32_t>*     	r_channel_dest;  	// destination buffer base address [channel]
-    sc_register<uint32_t>*     	r_channel_length;	// number of bytes to be transfered [channel]
+    sc_register<uint32_t>*     	r_channel_length;	// number of bytes to be written [channel]
+    sc_register<uint32_t>*     	r_channel_rlength;	// number of bytes to be read [channel]
+    sc_register<uint32_t>*     	r_channel_rslot;	// first buffer slot of the read burst [channel]
+    sc_register<uint32_t>*     	r_channel_wslot;	// first buffer slot of the write burst [channel]
+    sc_register<uint32_t>*     	r_channel_line;		// line length (bytes) [channel]
+    sc_register<uint32_t>*     	r_channel_rlines;	// number of lines to be read [channel]
+    sc_register<uint32_t>*     	r_channel_wlines;	// number of lines to be written [channel]
+    sc_register<uint32_t>*     	r_channel_sstride;	// source stride (bytes) [channel]
+    sc_register<uint32_t>*     	r_channel_dstride;	// destination stride (bytes) [channel]
+    sc_register<uint32_t>*     	r_channel_desc;		// next descriptor address [channel]
+    sc_register<uint32_t>*     	r_channel_flags;	// current descriptor flags [channel]
+    sc_register<uint32_t>*     	r_channel_dword;	// number of fetched descriptor words [channel]
+    sc_register<uint32_t>*     	r_channel_index;	// number of completed descriptors [channel]
+    sc_register<uint32_t>*     	r_channel_coalesce;	// IRQ every N descriptors [channel]
+    sc_register<bool>*     	r_channel_chain;	// descriptor chain mode [channel]
+    sc_register<bool>*     	r_channel_irq;		// descriptor IRQ pending [channel]
     sc_register<bool>*     	r_channel_noirq;	// IRQ disabled [channel]
     sc_register<bool>*     	r_channel_active;	// channel activation [channel]
     sc_register<bool>*     	r_channel_done;		// bus transaction completed [channel]
     sc_register<bool>*     	r_channel_error;	// bus error reported [channel]
-    uint32_t**			r_channel_buf;		// local buffer [channels][burst]
+    uint32_t**			r_channel_buf;		// local buffer [channels][2*burst]
+    uint8_t**			r_channel_lut;		// look-up table [channels][256]
     
     // STRUCTURAL PARAMETERS
     const char*			m_name;			// instance name
     const uint32_t		m_tgtid;		// target index
     const uint32_t		m_burst;		// burst max number of words
+    const uint32_t		m_size;			// channel buffer size (words)
     const uint32_t		m_channels;		// number of channels
     uint32_t			m_segbase;		// segment base address
     uint32_t			m_segsize;		// segment size
     const char*			m_segname;		// segment name
     char			m_master_str[9][20];	// master FSM states names
-    char			m_target_str[11][20];	// target FSM states names
-    char			m_channel_str[8][20];	// channel FSM states names
+    char			m_target_str[17][20];	// target FSM states names
+    char			m_channel_str[10][20];	// channel FSM states names
 
     //  CHANNEL_FSM STATES
     enum {
@@ -118,6 +210,8 @@ class PibusMultiDma : sc_module {
     CHANNEL_READ_WAIT	= 5,
     CHANNEL_WRITE_REQ 	= 6,
     CHANNEL_WRITE_WAIT	= 7,
+    CHANNEL_DESC_REQ	= 8,
+    CHANNEL_DESC_WAIT	= 9,
     };
 
     // MASTER FSM STATES
@@ -141,11 +235,17 @@ class PibusMultiDma : sc_module {
     TGT_WRITE_LENGTH	= 3,
     TGT_WRITE_RESET	= 4,
     TGT_WRITE_NOIRQ	= 5,
-    TGT_READ_SOURCE	= 6,
-    TGT_READ_DEST  	= 7,
-    TGT_READ_STATUS	= 8,
-    TGT_READ_NOIRQ	= 9,
-    TGT_ERROR		= 10,
+    TGT_WRITE_DESC	= 6,
+    TGT_WRITE_COALESCE	= 7,
+    TGT_WRITE_INDEX	= 8,
+    TGT_READ_SOURCE	= 9,
+    TGT_READ_DEST  	= 10,
+    TGT_READ_STATUS	= 11,
+    TGT_READ_NOIRQ	= 12,
+    TGT_READ_DESC	= 13,
+    TGT_READ_COALESCE	= 14,
+    TGT_READ_INDEX	= 15,
+    TGT_ERROR		= 16,
     };
 
     // Addressable registers map
@@ -155,12 +255,53 @@ class PibusMultiDma : sc_module {
     DMA_LEN,
     DMA_RST,
     DMA_IRQ,
+    DMA_DESC,
+    DMA_COALESCE,
+    DMA_INDEX,
+    };
+
+    // Descriptor map
+    enum {
+    DESC_SRC,
+    DESC_DST,
+    DESC_LEN,
+    DESC_COUNT,
+    DESC_SSTRIDE,
+    DESC_DSTRIDE,
+    DESC_FLAGS,
+    DESC_NEXT,
+    };
+
+    // Descriptor flags
+    enum {
+    DESC_FLAG_LAST	= 0x1,
+    DESC_FLAG_IRQ	= 0x2,
+    };
+
+    // Blit operations (FLAGS bits 6:4)
+    enum {
+    DESC_OP_COPY	= 0,
+    DESC_OP_FILL	= 1,
+    DESC_OP_THRESHOLD	= 2,
+    DESC_OP_LUT		= 3,
+    DESC_OP_LUT_LOAD	= 4,
     };
 
 protected:
 
     SC_HAS_PROCESS(PibusMultiDma);
 
+    uint32_t burstLength(uint32_t address, uint32_t nwords);
+    uint32_t nextBurst(size_t k);
+    int schedule(size_t k);
+    size_t select(size_t first);
+    void next();
+    void checkDescriptor(size_t k);
+    void loadDescriptor(size_t k, uint32_t word, uint32_t data);
+    void storeData(size_t k, uint32_t data);
+    uint32_t pixels(size_t k, uint32_t data);
+    inline uint32_t operation(size_t k) { return (r_channel_flags[k].read() >> 4) & 0x7; }
+
 public:
 
     // IO PORTS
@@ -182,6 +323,9 @@ public:
     void transition();
     void genMoore();
     void printTrace();
+    uint32_t idleCycles();
+    void skipCycles(uint32_t ncycles);
+    void checkpoint(soclib::common::PibusCheckpoint& ckpt);
 
     // Constructor   
     PibusMultiDma(sc_module_name			name, 
@@ -189,6 +333,7 @@ public:
                   soclib::common::PibusSegmentTable	&segtab,
                   size_t				burst,
                   size_t				channels);
+    ~PibusMultiDma();
 
 }; // end class PibusMultiDma
 
@@ -14,6 +14,275 @@ namespace soclib { namespace caba {
 using namespace soclib::caba;
 using namespace soclib::common;
 
+//////////////////////////////////////////
+inline uint32_t nwords2opc(uint32_t nwords)
+{
+    switch(nwords) {
+    case 2  : return PIBUS_OPC_WD2;
+    case 4  : return PIBUS_OPC_WD4;
+    case 8  : return PIBUS_OPC_WD8;
+    case 16 : return PIBUS_OPC_WD16;
+    case 32 : return PIBUS_OPC_WD32;
+    default : return PIBUS_OPC_WDU;
+    }
+}
+
+///////////////////////////////////////////////////////////////////
+// burst length (number of words) for a transfer of nwords words
+// starting at address : power of 2, bounded by 32 and m_burst,
+// and the address must be a multiple of the burst size.
+///////////////////////////////////////////////////////////////////
+uint32_t PibusMultiDma::burstLength(uint32_t address, uint32_t nwords)
+{
+    uint32_t length = 1;
+    while( (length < 32) && ((length << 1) <= m_burst) && ((length << 1) <= nwords) &&
+           ((address & ((length << 3) - 1)) == 0) ) length = length << 1;
+    return length;
+}
+
+///////////////////////////////////////////////////////////////////
+// returns the length of the next burst requested by channel k
+// (the descriptor is fetched by bursts bounded by m_burst)
+///////////////////////////////////////////////////////////////////
+uint32_t PibusMultiDma::nextBurst(size_t k)
+{
+    if( r_channel_fsm[k].read() == CHANNEL_DESC_REQ ) 
+        return burstLength( r_channel_desc[k].read() + (r_channel_dword[k].read() << 2),
+                            8 - r_channel_dword[k].read() );
+    else if( r_channel_fsm[k].read() == CHANNEL_READ_REQ ) 
+        return burstLength( r_channel_source[k].read(), r_channel_rlength[k].read() >> 2 );
+    else
+        return burstLength( r_channel_dest[k].read(), r_channel_length[k].read() >> 2 );
+}
+
+///////////////////////////////////////////////////////////////////
+// returns the next state of channel k (READ_REQ, WRITE_REQ, 
+// DESC_REQ or DONE). The reads have priority as long as the channel
+// buffer has room for the next read burst. When it has not, it 
+// contains more than m_burst words, and the next write burst is
+// available.
+// The source (or destination) address jumps to the next line when
+// the current line has been read (or written).
+// There is no read for a FILL operation, and no write for a LUT_LOAD
+// operation.
+// When the descriptor is completed in chain mode, the descriptor 
+// index is incremented, and the next descriptor is requested, 
+// unless it was the last one.
+///////////////////////////////////////////////////////////////////
+int PibusMultiDma::schedule(size_t k)
+{
+    uint32_t line    = r_channel_line[k].read();
+    uint32_t source  = r_channel_source[k].read();
+    uint32_t rlength = r_channel_rlength[k].read();
+    uint32_t rlines  = r_channel_rlines[k].read();
+    uint32_t dest    = r_channel_dest[k].read();
+    uint32_t length  = r_channel_length[k].read();
+    uint32_t wlines  = r_channel_wlines[k].read();
+    uint32_t op      = operation(k);
+
+    if( op == DESC_OP_FILL ) rlines = 0;
+
+    if( (rlength == 0) && (rlines > 1) )	// next source line
+    {
+        source  = source + r_channel_sstride[k].read() - line;
+        rlength = line;
+        rlines  = rlines - 1;
+        r_channel_source[k]  = source;
+        r_channel_rlength[k] = rlength;
+        r_channel_rlines[k]  = rlines;
+    }
+    if( (length == 0) && (wlines > 1) )		// next destination line
+    {
+        r_channel_dest[k]   = dest + r_channel_dstride[k].read() - line;
+        r_channel_length[k] = line;
+        r_channel_wlines[k] = wlines - 1;
+        length = line;
+        wlines = wlines - 1;
+    }
+
+    // remaining words to be read and written
+    uint32_t rwords = (rlines == 0) ? 0 : (rlength + (rlines - 1)*line) >> 2;
+    uint32_t wwords = (wlines == 0) ? 0 : (length + (wlines - 1)*line) >> 2;
+    if( op == DESC_OP_LUT_LOAD ) wwords = rwords;
+
+    if( wwords == 0 ) 
+    {
+        if( not r_channel_chain[k].read() ) return CHANNEL_DONE;
+        uint32_t index    = r_channel_index[k].read() + 1;
+        uint32_t coalesce = r_channel_coalesce[k].read();
+        r_channel_index[k] = index;
+        if( r_channel_flags[k].read() & DESC_FLAG_LAST ) return CHANNEL_DONE;
+        if( (r_channel_flags[k].read() & DESC_FLAG_IRQ) or
+            ((coalesce != 0) and ((index % coalesce) == 0)) ) r_channel_irq[k] = true;
+        if( (r_channel_desc[k].read() & 0x1F) != 0 )
+        {
+            printf("ERROR in component PibusMultiDma : %s\n",m_name);
+            printf("The descriptor address must be multiple of 32 bytes\n");
+            exit(1);
+        }
+        return CHANNEL_DESC_REQ;
+    }
+    if( (rwords != 0) && 
+        (wwords - rwords + burstLength(source, rlength >> 2) <= m_size) ) return CHANNEL_READ_REQ;
+    return CHANNEL_WRITE_REQ;
+}
+
+///////////////////////////////////////////////////////////////////
+// checks the descriptor loaded in the registers of channel k.
+///////////////////////////////////////////////////////////////////
+void PibusMultiDma::checkDescriptor(size_t k)
+{
+    uint32_t op = operation(k);
+    if( (((op == DESC_OP_FILL) ? 0 : r_channel_source[k].read()) | r_channel_dest[k].read() | 
+          r_channel_line[k].read() | r_channel_sstride[k].read() | r_channel_dstride[k].read()) & 0x3 )
+    {
+        printf("ERROR in component PibusMultiDma : %s\n",m_name);
+        printf("The descriptor addresses, lengths and strides must be multiple of 4 bytes\n");
+        exit(1);
+    }
+    if( op > DESC_OP_LUT_LOAD )
+    {
+        printf("ERROR in component PibusMultiDma : %s\n",m_name);
+        printf("Illegal operation in descriptor : %d\n", op);
+        exit(1);
+    }
+    if( (op == DESC_OP_LUT_LOAD) and ((r_channel_line[k].read() != 256) or (r_channel_rlines[k].read() != 1)) )
+    {
+        printf("ERROR in component PibusMultiDma : %s\n",m_name);
+        printf("A LUT_LOAD descriptor must contain one line of 256 bytes\n");
+        exit(1);
+    }
+}
+
+///////////////////////////////////////////////////////////////////
+// writes the descriptor word received by the master port in the
+// corresponding register of channel k.
+///////////////////////////////////////////////////////////////////
+void PibusMultiDma::loadDescriptor(size_t k, uint32_t word, uint32_t data)
+{
+    switch( word ) {
+    case DESC_SRC :
+        r_channel_source[k] = data;
+        break;
+    case DESC_DST :
+        r_channel_dest[k] = data;
+        break;
+    case DESC_LEN :
+        r_channel_line[k]    = data;
+        r_channel_rlength[k] = data;
+        r_channel_length[k]  = data;
+        break;
+    case DESC_COUNT :
+        r_channel_rlines[k] = data;
+        r_channel_wlines[k] = data;
+        break;
+    case DESC_SSTRIDE :
+        r_channel_sstride[k] = data;
+        break;
+    case DESC_DSTRIDE :
+        r_channel_dstride[k] = data;
+        break;
+    case DESC_FLAGS :
+        r_channel_flags[k] = data;
+        break;
+    case DESC_NEXT :
+        r_channel_desc[k] = data;
+        break;
+    }
+}
+
+///////////////////////////////////////////////////////////////////
+// stores the word received by the master port for channel k :
+// descriptor, look-up table, or channel buffer. The address of
+// the received word is r_channel_source[k] - 4.
+///////////////////////////////////////////////////////////////////
+void PibusMultiDma::storeData(size_t k, uint32_t data)
+{
+    if( r_master_desc.read() )
+    {
+        loadDescriptor(k, r_channel_dword[k].read() + r_master_count.read() - 1, data);
+    }
+    else if( operation(k) == DESC_OP_LUT_LOAD )
+    {
+        uint32_t byte = r_channel_line[k].read() - r_channel_rlength[k].read() - 4;
+        for( size_t i=0 ; i<4 ; i++ ) r_channel_lut[k][byte + i] = (uint8_t)(data >> (i<<3));
+    }
+    else
+    {
+        uint32_t word = (r_channel_rslot[k].read() + r_master_count.read() - 1) % m_size;
+        r_channel_buf[k][word] = data;
+    }
+}
+
+///////////////////////////////////////////////////////////////////
+// returns the word sent on the PIBUS by channel k, after the blit
+// operation defined by the descriptor (4 pixels per word).
+///////////////////////////////////////////////////////////////////
+uint32_t PibusMultiDma::pixels(size_t k, uint32_t data)
+{
+    uint32_t flags     = r_channel_flags[k].read();
+    uint32_t threshold = (flags >> 8) & 0xFF;
+    uint32_t value     = (flags >> 16) & 0xFF;
+    uint32_t result    = 0;
+    switch( operation(k) ) {
+    case DESC_OP_FILL :
+        return r_channel_source[k].read();
+    case DESC_OP_THRESHOLD :
+        for( size_t i=0 ; i<4 ; i++ )
+        {
+            uint32_t pixel = (data >> (i<<3)) & 0xFF;
+            if( pixel > threshold ) pixel = value;
+            result = result | (pixel << (i<<3));
+        }
+        return result;
+    case DESC_OP_LUT :
+        for( size_t i=0 ; i<4 ; i++ )
+            result = result | ((uint32_t)r_channel_lut[k][(data >> (i<<3)) & 0xFF] << (i<<3));
+        return result;
+    default :
+        return data;
+    }
+}
+
+///////////////////////////////////////////////////////////////////
+// returns the first requesting channel (round-robin from channel
+// first), or m_channels if no channel is requesting.
+///////////////////////////////////////////////////////////////////
+size_t PibusMultiDma::select(size_t first)
+{
+    for( size_t n=0 ; n < m_channels ; n++ )
+    {
+        size_t k = (first + n) % m_channels;
+        if ( (r_channel_fsm[k] == CHANNEL_READ_REQ) or
+             (r_channel_fsm[k] == CHANNEL_WRITE_REQ) or
+             (r_channel_fsm[k] == CHANNEL_DESC_REQ) ) return k;
+    }
+    return m_channels;
+}
+
+///////////////////////////////////////////////////////////////////
+// end of transaction : the master FSM requests directly the bus 
+// for the next requesting channel, or goes to IDLE state.
+///////////////////////////////////////////////////////////////////
+void PibusMultiDma::next()
+{
+    size_t k = select( (r_master_index.read() + 1) % m_channels );
+    if ( k < m_channels )
+    {
+        r_master_index     = k;
+        r_master_count     = 0;
+        r_master_burst     = nextBurst(k);
+        r_master_desc      = (r_channel_fsm[k].read() == CHANNEL_DESC_REQ);
+        r_channel_error[k] = false;
+        if( r_channel_fsm[k].read() == CHANNEL_WRITE_REQ ) r_master_fsm = MST_WRITE_REQ;
+        else                                               r_master_fsm = MST_READ_REQ;
+    }
+    else
+    {
+        r_master_fsm = MST_IDLE;
+    }
+}
+
 ////////////////////////////////
 void PibusMultiDma::transition()
 {
@@ -28,6 +297,12 @@ void PibusMultiDma::transition()
             r_channel_done[k]     = false;
             r_channel_error[k]    = false;
 	    r_channel_noirq[k]    = false;
+            r_channel_chain[k]    = false;
+            r_channel_irq[k]      = false;
+            r_channel_coalesce[k] = 0;
+            r_channel_index[k]    = 0;
+            r_channel_dword[k]    = 0;
+            memset(r_channel_lut[k], 0, 256);
         }
 	return;
     } 
@@ -49,10 +324,16 @@ void PibusMultiDma::transition()
             else if( !read && ((address & 0x1F) == (DMA_LEN << 2)) ) 		r_target_fsm = TGT_WRITE_LENGTH;
             else if( !read && ((address & 0x1F) == (DMA_RST << 2)) ) 		r_target_fsm = TGT_WRITE_RESET;
             else if( !read && ((address & 0x1F) == (DMA_IRQ << 2)) ) 		r_target_fsm = TGT_WRITE_NOIRQ;
+            else if( !read && ((address & 0x1F) == (DMA_DESC << 2)) ) 		r_target_fsm = TGT_WRITE_DESC;
+            else if( !read && ((address & 0x1F) == (DMA_COALESCE << 2)) ) 	r_target_fsm = TGT_WRITE_COALESCE;
+            else if( !read && ((address & 0x1F) == (DMA_INDEX << 2)) ) 		r_target_fsm = TGT_WRITE_INDEX;
             else if(  read && ((address & 0x1F) == (DMA_SRC << 2)) ) 		r_target_fsm = TGT_READ_SOURCE;
             else if(  read && ((address & 0x1F) == (DMA_DST << 2)) ) 		r_target_fsm = TGT_READ_DEST;
             else if(  read && ((address & 0x1F) == (DMA_LEN << 2)) ) 		r_target_fsm = TGT_READ_STATUS;
             else if(  read && ((address & 0x1F) == (DMA_IRQ << 2)) ) 		r_target_fsm = TGT_READ_NOIRQ;
+            else if(  read && ((address & 0x1F) == (DMA_DESC << 2)) ) 		r_target_fsm = TGT_READ_DESC;
+            else if(  read && ((address & 0x1F) == (DMA_COALESCE << 2)) ) 	r_target_fsm = TGT_READ_COALESCE;
+            else if(  read && ((address & 0x1F) == (DMA_INDEX << 2)) ) 		r_target_fsm = TGT_READ_INDEX;
             else                                                        	r_target_fsm = TGT_ERROR;
             r_target_index = (address & 0xF000) >> 12;
         }
@@ -102,6 +383,14 @@ void PibusMultiDma::transition()
                 exit(1);
             }
             r_channel_length[k]   = p_d.read();
+            r_channel_rlength[k]  = p_d.read();
+            r_channel_line[k]     = p_d.read();
+            r_channel_rlines[k]   = 1;
+            r_channel_wlines[k]   = 1;
+            r_channel_rslot[k]    = 0;
+            r_channel_wslot[k]    = 0;
+            r_channel_flags[k]    = 0;
+            r_channel_chain[k]    = false;
             r_channel_active[k] = true;
         }
         r_target_fsm = TGT_IDLE;
@@ -111,6 +400,7 @@ void PibusMultiDma::transition()
     {
         uint32_t k = r_target_index.read();    
         r_channel_active[k]  = false;
+        r_channel_irq[k]     = false;
         r_target_fsm = TGT_IDLE;
         break;
     }
@@ -121,11 +411,47 @@ void PibusMultiDma::transition()
         r_target_fsm = TGT_IDLE;
         break;
     }
+    case TGT_WRITE_DESC:
+    {
+        uint32_t k = r_target_index.read();    
+        if(r_channel_fsm[k] == CHANNEL_IDLE)
+        {
+            if( (p_d.read() & 0x1F) != 0 )
+            {
+	        printf("ERROR in component PibusMultiDma : %s\n",m_name);
+	        printf("The descriptor address must be multiple of 32 bytes\n");
+                exit(1);
+            }
+            r_channel_desc[k]     = p_d.read();
+            r_channel_index[k]    = 0;
+            r_channel_chain[k]    = true;
+            r_channel_active[k]   = true;
+        }
+        r_target_fsm = TGT_IDLE;
+        break;
+    }
+    case TGT_WRITE_COALESCE:
+    {
+        uint32_t k = r_target_index.read();    
+        if(r_channel_fsm[k] == CHANNEL_IDLE) r_channel_coalesce[k] = p_d.read();
+        r_target_fsm = TGT_IDLE;
+        break;
+    }
+    case TGT_WRITE_INDEX:
+    {
+        uint32_t k = r_target_index.read();    
+        r_channel_irq[k] = false;
+        r_target_fsm = TGT_IDLE;
+        break;
+    }
     case TGT_ERROR:
     case TGT_READ_STATUS:
     case TGT_READ_SOURCE:
     case TGT_READ_DEST:
     case TGT_READ_NOIRQ:
+    case TGT_READ_DESC:
+    case TGT_READ_COALESCE:
+    case TGT_READ_INDEX:
     {
         r_target_fsm = TGT_IDLE;
         break;
@@ -134,29 +460,32 @@ void PibusMultiDma::transition()
 	
     // The master FSM implements a round-robin policy between the clients channels
     // It controls the following registers :
-    // r_master_fsm, r_master_index, r_master_count
+    // r_master_fsm, r_master_index, r_master_count, r_master_burst
+    // r_channel_source[k], r_channel_dest[k], r_channel_rlength[k], r_channel_length[k],
+    // r_channel_rslot[k], r_channel_wslot[k] for the selected channel,
     // r_channel_done[k] set and r_channel_error[k] to signal the pibus 
-    // transaction completion.
+    // transaction completion (an error in a burst is signaled at the end
+    // of the burst).
+    // For a descriptor fetch (r_master_desc), the source and length 
+    // registers are not modified, the descriptor words are written
+    // in the channel registers, and r_channel_dword[k] is incremented
+    // at the end of the burst.
+    // When another channel is requesting, the bus is requested after 
+    // the last data cycle, without going through the IDLE state.
 
     switch( r_master_fsm.read() ) {
     case MST_IDLE :
     {
-        bool found = false;
-	for( size_t n=0 ; (n < m_channels) and not found ; n++ )
+        size_t k = select( r_master_index.read() );
+        if ( k < m_channels )
         {
-            size_t k = (r_master_index.read() + n) % m_channels;
-            if ( (r_channel_fsm[k] == CHANNEL_READ_REQ) or
-                 (r_channel_fsm[k] == CHANNEL_WRITE_REQ) )
-            {
-                uint32_t nwords = r_channel_length[k].read() >> 2;
-                found           = true;
-                r_master_index  = k;
-                r_master_count  = 0;
-                if( nwords < m_burst ) r_master_burst = nwords;
-                else                   r_master_burst = m_burst;
-                if( r_channel_fsm[k].read() == CHANNEL_READ_REQ ) r_master_fsm = MST_READ_REQ;
-                else                                              r_master_fsm = MST_WRITE_REQ;
-            }
+            r_master_index  = k;
+            r_master_count  = 0;
+            r_master_burst  = nextBurst(k);
+            r_master_desc   = (r_channel_fsm[k].read() == CHANNEL_DESC_REQ);
+            r_channel_error[k] = false;
+            if( r_channel_fsm[k].read() == CHANNEL_WRITE_REQ ) r_master_fsm = MST_WRITE_REQ;
+            else                                               r_master_fsm = MST_READ_REQ;
         }
         break;
     }
@@ -170,19 +499,37 @@ void PibusMultiDma::transition()
         uint32_t k = r_master_index.read();
 	if( r_master_burst.read() == 1 ) r_master_fsm = MST_READ_DT;
 	else				     r_master_fsm = MST_READ_DTAD;
-	r_master_count      = r_master_count.read() + 1;
-        r_channel_source[k] = r_channel_source[k].read() + 4;
+	r_master_count       = r_master_count.read() + 1;
+        if( not r_master_desc.read() )
+        {
+            r_channel_source[k]  = r_channel_source[k].read() + 4;
+            r_channel_rlength[k] = r_channel_rlength[k].read() - 4;
+        }
         break;
     }
     case MST_READ_DTAD :
     {
         uint32_t k = r_master_index.read();
-	if( p_ack.read() != PIBUS_ACK_WAIT ) 
+        if( p_ack.read() == PIBUS_ACK_RETRY )	// split transaction : restart
         {
-            uint32_t word = r_master_count.read();
-            r_channel_buf[k][word] = (uint32_t)p_d.read();
+            if( not r_master_desc.read() )
+            {
+                r_channel_source[k]  = r_channel_source[k].read() - (r_master_count.read() << 2);
+                r_channel_rlength[k] = r_channel_rlength[k].read() + (r_master_count.read() << 2);
+            }
+            r_master_count       = 0;
+            r_master_fsm         = MST_READ_REQ;
+        }
+	else if( p_ack.read() != PIBUS_ACK_WAIT ) 
+        {
+            if( p_ack.read() == PIBUS_ACK_READY ) storeData(k, (uint32_t)p_d.read());
+            else                                  r_channel_error[k] = true;
 	    r_master_count         = r_master_count.read() + 1;
-            r_channel_source[k]    = r_channel_source[k].read() + 4;
+            if( not r_master_desc.read() )
+            {
+                r_channel_source[k]    = r_channel_source[k].read() + 4;
+                r_channel_rlength[k]   = r_channel_rlength[k].read() - 4;
+            }
 	    if( r_master_count == (r_master_burst.read() - 1) ) r_master_fsm = MST_READ_DT;
 	    else				                r_master_fsm = MST_READ_DTAD;
 	}
@@ -191,19 +538,29 @@ void PibusMultiDma::transition()
     case MST_READ_DT :
     {
         uint32_t k = r_master_index.read();
-	if( p_ack.read() == PIBUS_ACK_READY ) 
+        if( p_ack.read() == PIBUS_ACK_RETRY )	// split transaction : restart
         {
-            uint32_t word          = r_master_count.read();
-            r_channel_buf[k][word] = (uint32_t)p_d.read();
-            r_channel_done[k]      = true;
-            r_channel_error[k]     = false;
-            r_master_fsm           = MST_IDLE;
+            if( not r_master_desc.read() )
+            {
+                r_channel_source[k]  = r_channel_source[k].read() - (r_master_count.read() << 2);
+                r_channel_rlength[k] = r_channel_rlength[k].read() + (r_master_count.read() << 2);
+            }
+            r_master_count       = 0;
+            r_master_fsm         = MST_READ_REQ;
         }
-        else if( p_ack.read() == PIBUS_ACK_ERROR ) 
+	else if( p_ack.read() != PIBUS_ACK_WAIT ) 
         {
+            if( p_ack.read() == PIBUS_ACK_READY )
+            {
+                storeData(k, (uint32_t)p_d.read());
+                if( r_master_desc.read() )
+                    r_channel_dword[k] = r_channel_dword[k].read() + r_master_burst.read();
+                else
+                    r_channel_rslot[k] = (r_channel_rslot[k].read() + r_master_burst.read()) % m_size;
+            }
             r_channel_done[k]      = true;
-            r_channel_error[k]     = true;
-            r_master_fsm           = MST_IDLE;
+            r_channel_error[k]     = r_channel_error[k].read() or (p_ack.read() == PIBUS_ACK_ERROR);
+            next();
         }
         break;
     }
@@ -225,8 +582,16 @@ void PibusMultiDma::transition()
     case MST_WRITE_DTAD :
     {
         uint32_t k = r_master_index.read();
-        if( p_ack.read() != PIBUS_ACK_WAIT ) 
+        if( p_ack.read() == PIBUS_ACK_RETRY )	// split transaction : restart
+        {
+            r_channel_dest[k]   = r_channel_dest[k].read() - (r_master_count.read() << 2);
+            r_channel_length[k] = r_channel_length[k].read() + (r_master_count.read() << 2);
+            r_master_count      = 0;
+            r_master_fsm        = MST_WRITE_REQ;
+        }
+        else if( p_ack.read() != PIBUS_ACK_WAIT ) 
         {
+            if( p_ack.read() == PIBUS_ACK_ERROR ) r_channel_error[k] = true;
 	    r_master_count         = r_master_count.read() + 1;
             r_channel_dest[k]      = r_channel_dest[k].read() + 4;
             r_channel_length[k]    = r_channel_length[k].read() - 4;
@@ -238,17 +603,20 @@ void PibusMultiDma::transition()
     case MST_WRITE_DT :
     {
         uint32_t k = r_master_index.read();
-        if( p_ack.read() == PIBUS_ACK_READY ) 
+        if( p_ack.read() == PIBUS_ACK_RETRY )	// split transaction : restart
         {
-            r_channel_done[k]      = true;
-            r_channel_error[k]     = false;
-            r_master_fsm           = MST_IDLE;
+            r_channel_dest[k]   = r_channel_dest[k].read() - (r_master_count.read() << 2);
+            r_channel_length[k] = r_channel_length[k].read() + (r_master_count.read() << 2);
+            r_master_count      = 0;
+            r_master_fsm        = MST_WRITE_REQ;
         }
-        else if( p_ack.read() == PIBUS_ACK_ERROR )
+        else if( p_ack.read() != PIBUS_ACK_WAIT ) 
         {
+            if( p_ack.read() == PIBUS_ACK_READY )
+                r_channel_wslot[k] = (r_channel_wslot[k].read() + r_master_burst.read()) % m_size;
             r_channel_done[k]      = true;
-            r_channel_error[k]     = true;
-            r_master_fsm           = MST_IDLE;
+            r_channel_error[k]     = r_channel_error[k].read() or (p_ack.read() == PIBUS_ACK_ERROR);
+            next();
         }
         break;
     }
@@ -258,6 +626,16 @@ void PibusMultiDma::transition()
     // define the channel state and control the following registers
     // - r_channel_fsm[k]
     // - r_channel_done[k] reset
+    // - r_channel_rslot[k], r_channel_wslot[k] reset when a descriptor
+    //   is loaded (the channel buffer is empty)
+    // - r_channel_dword[k] reset when a descriptor fetch starts or
+    //   completes (the descriptor is fetched by several bursts
+    //   when m_burst is smaller than 8)
+    // - r_channel_source[k], r_channel_dest[k], r_channel_rlength[k], 
+    //   r_channel_length[k], r_channel_rlines[k], r_channel_wlines[k] 
+    //   at the end of a line (2D transfer)
+    // - r_channel_index[k] and r_channel_irq[k] set at the end of a 
+    //   descriptor (chain mode)
     // Soft reset : After each burst (read or write), the master FSM
     // test the r_activate flip-flop to stop the ongoing transfer if requested. 
     // It goes to the MST_SUCCESS state when the tranfer is isuccessfully 
@@ -270,13 +648,44 @@ void PibusMultiDma::transition()
         {
             case CHANNEL_IDLE:
             {
-                if ( r_channel_active[k].read() ) r_channel_fsm[k] = CHANNEL_READ_REQ;
+                if      ( not r_channel_active[k].read() ) break;
+                else if ( r_channel_chain[k].read() )
+                {
+                    r_channel_dword[k] = 0;
+                    r_channel_fsm[k]   = CHANNEL_DESC_REQ;
+                }
+                else                                       r_channel_fsm[k] = schedule(k);
+                break;
+            }
+            case CHANNEL_DESC_REQ:      // requesting a descriptor fetch
+            {
+                if ( ((r_master_fsm.read() == MST_READ_REQ) or (r_master_fsm.read() == MST_READ_AD)) and 
+                     (r_master_index.read() == k) ) r_channel_fsm[k] = CHANNEL_DESC_WAIT;
+                break;
+            }
+            case CHANNEL_DESC_WAIT:     // waiting the descriptor
+            {
+                if ( r_channel_done[k].read() ) 
+                {
+                    if      ( not r_channel_active[k].read() ) r_channel_fsm[k] = CHANNEL_IDLE;
+                    else if ( r_channel_error[k].read() )      r_channel_fsm[k] = CHANNEL_READ_ERROR;
+                    else if ( r_channel_dword[k].read() < 8 )  r_channel_fsm[k] = CHANNEL_DESC_REQ;
+                    else
+                    {
+                        r_channel_dword[k] = 0;
+                        checkDescriptor(k);
+                        r_channel_rslot[k] = 0;
+                        r_channel_wslot[k] = 0;
+                        r_channel_fsm[k]   = schedule(k);
+                    }
+                    r_channel_done[k] = false;
+                }
                 break;
             }
             case CHANNEL_READ_REQ:      // requesting a VCI READ transaction
             {
-                if ( (r_master_fsm.read() == MST_READ_REQ) and (r_master_index.read() == k) ) 
-                    r_channel_fsm[k] = CHANNEL_READ_WAIT;
+                if ( ((r_master_fsm.read() == MST_READ_REQ) or (r_master_fsm.read() == MST_READ_AD)) and 
+                     (r_master_index.read() == k) ) r_channel_fsm[k] = CHANNEL_READ_WAIT;
                 break;
             }
             case CHANNEL_READ_WAIT:     // waiting  VCI READ response
@@ -285,15 +694,15 @@ void PibusMultiDma::transition()
                 {
                     if      ( not r_channel_active[k].read() ) r_channel_fsm[k] = CHANNEL_IDLE;
                     else if ( r_channel_error[k].read() )      r_channel_fsm[k] = CHANNEL_READ_ERROR;
-                    else                                       r_channel_fsm[k] = CHANNEL_WRITE_REQ;
+                    else                                       r_channel_fsm[k] = schedule(k);
                     r_channel_done[k] = false;
                 }
                 break;
             }
             case CHANNEL_WRITE_REQ:     // requesting a VCI WRITE transaction
             {
-                if ( (r_master_fsm.read() == MST_WRITE_REQ) and (r_master_index.read() == k) ) 
-                    r_channel_fsm[k] = CHANNEL_WRITE_WAIT;
+                if ( ((r_master_fsm.read() == MST_WRITE_REQ) or (r_master_fsm.read() == MST_WRITE_AD)) and 
+                     (r_master_index.read() == k) ) r_channel_fsm[k] = CHANNEL_WRITE_WAIT;
                 break;
             }
             case CHANNEL_WRITE_WAIT:    // waiting VCI WRITE response
@@ -302,8 +711,7 @@ void PibusMultiDma::transition()
                 {
                     if      ( not r_channel_active[k].read() ) r_channel_fsm[k] = CHANNEL_IDLE;
                     else if ( r_channel_error[k].read() )      r_channel_fsm[k] = CHANNEL_WRITE_ERROR;
-                    else if ( r_channel_length[k].read()== 0 ) r_channel_fsm[k] = CHANNEL_DONE;
-                    else                                       r_channel_fsm[k] = CHANNEL_READ_REQ;
+                    else                                       r_channel_fsm[k] = schedule(k);
                     r_channel_done[k] = false;
                 }
                 break;
@@ -345,6 +753,18 @@ void PibusMultiDma::genMoore()
 	p_ack = PIBUS_ACK_READY;
 	p_d = (uint32_t)r_channel_noirq[tk].read();
         break;
+    case TGT_READ_DESC:
+	p_ack = PIBUS_ACK_READY;
+	p_d = (uint32_t)r_channel_desc[tk].read();
+        break;
+    case TGT_READ_COALESCE:
+	p_ack = PIBUS_ACK_READY;
+	p_d = (uint32_t)r_channel_coalesce[tk].read();
+        break;
+    case TGT_READ_INDEX:
+	p_ack = PIBUS_ACK_READY;
+	p_d = (uint32_t)r_channel_index[tk].read();
+        break;
     case TGT_ERROR:
 	p_ack = PIBUS_ACK_ERROR;
         break;
@@ -353,17 +773,19 @@ void PibusMultiDma::genMoore()
         break;
     } // end switch target fsm
 
+    uint32_t	mk = r_master_index.read();
+
     // p_req signal
     if((r_master_fsm == MST_READ_REQ) || (r_master_fsm == MST_WRITE_REQ)) 	p_req = true;
     else									p_req = false;
 
-    uint32_t	mk = r_master_index.read();
-
     // p_a, p_lock, p_read, p_opc signals
     if((r_master_fsm == MST_READ_AD) || (r_master_fsm == MST_READ_DTAD)) 
     {
-	p_a   = (uint32_t)r_channel_source[mk].read();
-	p_opc = PIBUS_OPC_WDU;
+	if( r_master_desc.read() ) p_a = (uint32_t)r_channel_desc[mk].read() + 
+                                         ((r_channel_dword[mk].read() + r_master_count.read()) << 2);
+	else                       p_a = (uint32_t)r_channel_source[mk].read();
+	p_opc = nwords2opc(r_master_burst.read());
 	p_read = true;
 	if(r_master_count.read() == r_master_burst.read() - 1) p_lock = false;
 	else			                                p_lock = true;
@@ -371,7 +793,7 @@ void PibusMultiDma::genMoore()
     if((r_master_fsm == MST_WRITE_AD) || (r_master_fsm == MST_WRITE_DTAD)) 
     {
 	p_a   = (uint32_t)r_channel_dest[mk].read();
-	p_opc = PIBUS_OPC_WDU;
+	p_opc = nwords2opc(r_master_burst.read());
 	p_read = false;
 	if(r_master_count.read() == r_master_burst.read() - 1) p_lock = false;
 	else			                                p_lock = true;
@@ -380,8 +802,8 @@ void PibusMultiDma::genMoore()
     // p_d signal
     if((r_master_fsm == MST_WRITE_DTAD) || (r_master_fsm == MST_WRITE_DT)) 
     {
-        uint32_t word = r_master_count.read();
-        p_d = (uint32_t)r_channel_buf[mk][word];
+        uint32_t word = (r_channel_wslot[mk].read() + r_master_count.read() - 1) % m_size;
+        p_d = pixels(mk, r_channel_buf[mk][word]);
     }
 
     // IRQ signal
@@ -389,7 +811,8 @@ void PibusMultiDma::genMoore()
     {
         p_irq[k] = (( (r_channel_fsm[k].read() == CHANNEL_DONE) or
                       (r_channel_fsm[k].read() == CHANNEL_READ_ERROR) or
-                      (r_channel_fsm[k].read() == CHANNEL_WRITE_ERROR) )
+                      (r_channel_fsm[k].read() == CHANNEL_WRITE_ERROR) or
+                      r_channel_irq[k].read() )
                       and not r_channel_noirq[k].read() );
     }
 } // end GenMoore()
@@ -407,17 +830,34 @@ PibusMultiDma::PibusMultiDma(sc_module_name	name,
       r_master_index("r_master_count"),
       r_master_count("r_master_index"),
       r_master_burst("r_master_burst"),
-      r_channel_fsm(alloc_elems<sc_signal<int> >("r_channel_fsm", channels)),
-      r_channel_source(alloc_elems<sc_signal<uint32_t> >("r_channel_source", channels)),
-      r_channel_dest(alloc_elems<sc_signal<uint32_t> >("r_channel_dest", channels)),
-      r_channel_length(alloc_elems<sc_signal<uint32_t> >("r_channel_length", channels)),
-      r_channel_noirq(alloc_elems<sc_signal<bool> >("r_channel_noirq", channels)),
-      r_channel_active(alloc_elems<sc_signal<bool> >("r_channel_active", channels)),
-      r_channel_done(alloc_elems<sc_signal<bool> >("r_channel_done", channels)),
-      r_channel_error(alloc_elems<sc_signal<bool> >("r_channel_error", channels)),
+      r_master_desc("r_master_desc"),
+      r_channel_fsm(alloc_elems<sc_register<int> >("r_channel_fsm", channels)),
+      r_channel_source(alloc_elems<sc_register<uint32_t> >("r_channel_source", channels)),
+      r_channel_dest(alloc_elems<sc_register<uint32_t> >("r_channel_dest", channels)),
+      r_channel_length(alloc_elems<sc_register<uint32_t> >("r_channel_length", channels)),
+      r_channel_rlength(alloc_elems<sc_register<uint32_t> >("r_channel_rlength", channels)),
+      r_channel_rslot(alloc_elems<sc_register<uint32_t> >("r_channel_rslot", channels)),
+      r_channel_wslot(alloc_elems<sc_register<uint32_t> >("r_channel_wslot", channels)),
+      r_channel_line(alloc_elems<sc_register<uint32_t> >("r_channel_line", channels)),
+      r_channel_rlines(alloc_elems<sc_register<uint32_t> >("r_channel_rlines", channels)),
+      r_channel_wlines(alloc_elems<sc_register<uint32_t> >("r_channel_wlines", channels)),
+      r_channel_sstride(alloc_elems<sc_register<uint32_t> >("r_channel_sstride", channels)),
+      r_channel_dstride(alloc_elems<sc_register<uint32_t> >("r_channel_dstride", channels)),
+      r_channel_desc(alloc_elems<sc_register<uint32_t> >("r_channel_desc", channels)),
+      r_channel_flags(alloc_elems<sc_register<uint32_t> >("r_channel_flags", channels)),
+      r_channel_dword(alloc_elems<sc_register<uint32_t> >("r_channel_dword", channels)),
+      r_channel_index(alloc_elems<sc_register<uint32_t> >("r_channel_index", channels)),
+      r_channel_coalesce(alloc_elems<sc_register<uint32_t> >("r_channel_coalesce", channels)),
+      r_channel_chain(alloc_elems<sc_register<bool> >("r_channel_chain", channels)),
+      r_channel_irq(alloc_elems<sc_register<bool> >("r_channel_irq", channels)),
+      r_channel_noirq(alloc_elems<sc_register<bool> >("r_channel_noirq", channels)),
+      r_channel_active(alloc_elems<sc_register<bool> >("r_channel_active", channels)),
+      r_channel_done(alloc_elems<sc_register<bool> >("r_channel_done", channels)),
+      r_channel_error(alloc_elems<sc_register<bool> >("r_channel_error", channels)),
       m_name(name),
       m_tgtid(tgtid),
       m_burst(burst),
+      m_size(2*burst),
       m_channels(channels),
       p_ck("p_ck"),
       p_resetn("p_resetn"),
@@ -448,6 +888,8 @@ PibusMultiDma::PibusMultiDma(sc_module_name	name,
     strcpy (m_channel_str[5], "READ_WAIT");
     strcpy (m_channel_str[6], "WRITE_REQ");
     strcpy (m_channel_str[7], "WRITE_WAIT");
+    strcpy (m_channel_str[8], "DESC_REQ");
+    strcpy (m_channel_str[9], "DESC_WAIT");
 
     strcpy (m_master_str[0], "IDLE");
     strcpy (m_master_str[1], "READ_REQ");
@@ -465,11 +907,17 @@ PibusMultiDma::PibusMultiDma(sc_module_name	name,
     strcpy (m_target_str[3], "WRITE_LENGTH");
     strcpy (m_target_str[4], "WRITE_RESET");
     strcpy (m_target_str[5], "WRITE_NOIRQ");
-    strcpy (m_target_str[6], "READ_SOURCE");
-    strcpy (m_target_str[7], "READ_DEST");
-    strcpy (m_target_str[8], "READ_STATUS");
-    strcpy (m_target_str[9], "READ_NOIRQ");
-    strcpy (m_target_str[10], "ERROR");
+    strcpy (m_target_str[6], "WRITE_DESC");
+    strcpy (m_target_str[7], "WRITE_COALESCE");
+    strcpy (m_target_str[8], "WRITE_INDEX");
+    strcpy (m_target_str[9], "READ_SOURCE");
+    strcpy (m_target_str[10], "READ_DEST");
+    strcpy (m_target_str[11], "READ_STATUS");
+    strcpy (m_target_str[12], "READ_NOIRQ");
+    strcpy (m_target_str[13], "READ_DESC");
+    strcpy (m_target_str[14], "READ_COALESCE");
+    strcpy (m_target_str[15], "READ_INDEX");
+    strcpy (m_target_str[16], "ERROR");
 
     if( (channels < 1) or (channels > 16) )
     {
@@ -486,7 +934,9 @@ PibusMultiDma::PibusMultiDma(sc_module_name	name,
     }
 
     r_channel_buf = new uint32_t*[channels];
-    for( size_t k=0 ; k<channels ; k++) r_channel_buf[k] = new uint32_t[burst];
+    for( size_t k=0 ; k<channels ; k++) r_channel_buf[k] = new uint32_t[m_size]();
+    r_channel_lut = new uint8_t*[channels];
+    for( size_t k=0 ; k<channels ; k++) r_channel_lut[k] = new uint8_t[256]();
 
     // get segment base address and segment size
     std::list<SegmentTableEntry> seglist = segtab.getTargetSegmentList(tgtid);
@@ -509,13 +959,49 @@ PibusMultiDma::PibusMultiDma(sc_module_name	name,
     }
     std::cout << std::endl << "Instanciation of PibusMultiDma : " << m_name << std::endl;
     std::cout << "    burst length = " << m_burst << std::endl;
-    std::cout << "    channels     = " << m_burst << std::endl;
+    std::cout << "    channels     = " << m_channels << std::endl;
     std::cout << "    segment " << m_segname << std::hex
               << " | base = 0x" << m_segbase
               << " | size = 0x" << m_segsize << std::endl;
 
 } // end constructor
 
+////////////////////////////////
+PibusMultiDma::~PibusMultiDma()
+{
+    for( size_t k=0 ; k<m_channels ; k++)
+    {
+        delete [] r_channel_buf[k];
+        delete [] r_channel_lut[k];
+    }
+    delete [] r_channel_buf;
+    delete [] r_channel_lut;
+    dealloc_elems(r_channel_fsm, m_channels);
+    dealloc_elems(r_channel_source, m_channels);
+    dealloc_elems(r_channel_dest, m_channels);
+    dealloc_elems(r_channel_length, m_channels);
+    dealloc_elems(r_channel_rlength, m_channels);
+    dealloc_elems(r_channel_rslot, m_channels);
+    dealloc_elems(r_channel_wslot, m_channels);
+    dealloc_elems(r_channel_line, m_channels);
+    dealloc_elems(r_channel_rlines, m_channels);
+    dealloc_elems(r_channel_wlines, m_channels);
+    dealloc_elems(r_channel_sstride, m_channels);
+    dealloc_elems(r_channel_dstride, m_channels);
+    dealloc_elems(r_channel_desc, m_channels);
+    dealloc_elems(r_channel_flags, m_channels);
+    dealloc_elems(r_channel_dword, m_channels);
+    dealloc_elems(r_channel_index, m_channels);
+    dealloc_elems(r_channel_coalesce, m_channels);
+    dealloc_elems(r_channel_chain, m_channels);
+    dealloc_elems(r_channel_irq, m_channels);
+    dealloc_elems(r_channel_noirq, m_channels);
+    dealloc_elems(r_channel_active, m_channels);
+    dealloc_elems(r_channel_done, m_channels);
+    dealloc_elems(r_channel_error, m_channels);
+    dealloc_elems(p_irq, m_channels);
+} // end destructor
+
 ////////////////////////////////
 void PibusMultiDma::printTrace()
 {
@@ -529,10 +1015,87 @@ void PibusMultiDma::printTrace()
             std::cout  << m_name << "_channel " << k << " : " << m_channel_str[r_channel_fsm[k].read()]
                        << " / source = " << std::hex << r_channel_source[k].read() 
                        << " / dest = " << std::hex << r_channel_dest[k].read() 
-                       << " / nwords = " << std::dec << r_channel_length[k].read() << std::endl;
+                       << " / nwords = " << std::dec << r_channel_length[k].read();
+            if( r_channel_chain[k].read() )
+                std::cout  << " / lines = " << r_channel_wlines[k].read()
+                           << " / index = " << r_channel_index[k].read();
+            std::cout << std::endl;
         }
     }
 } // end printTrace
 
+///////////////////////////////////////////////////////////////////
+// idle cycles : the DMA is idle when the target FSM is not 
+// selected, the master FSM waits the bus grant or a data 
+// acknowledge (or has no requesting channel), and each channel 
+// waits a software command or the end of its bus transaction.
+// A requesting channel is idle when the master FSM serves another 
+// channel. As it contains no counter, the DMA is idle for ever.
+///////////////////////////////////////////////////////////////////
+uint32_t PibusMultiDma::idleCycles()
+{
+    if((r_target_fsm != TGT_IDLE) || p_sel.read()) return 0;
+
+    switch(r_master_fsm) {
+        case MST_IDLE :
+            if(select(r_master_index.read()) < m_channels) return 0;
+            break;
+        case MST_READ_REQ :
+        case MST_WRITE_REQ :
+            if(p_gnt.read() == true) return 0;
+            break;
+        case MST_READ_DTAD :
+        case MST_READ_DT :
+        case MST_WRITE_DTAD :
+        case MST_WRITE_DT :
+            if(p_ack.read() != PIBUS_ACK_WAIT) return 0;
+            break;
+        default :
+            return 0;
+    }
+
+    for( size_t k=0 ; k<m_channels ; k++ )
+    {
+        switch(r_channel_fsm[k].read()) {
+            case CHANNEL_IDLE :
+                if(r_channel_active[k].read()) return 0;
+                break;
+            case CHANNEL_DONE :
+            case CHANNEL_READ_ERROR :
+            case CHANNEL_WRITE_ERROR :
+                if(not r_channel_active[k].read()) return 0;
+                break;
+            case CHANNEL_READ_WAIT :
+            case CHANNEL_WRITE_WAIT :
+            case CHANNEL_DESC_WAIT :
+                if(r_channel_done[k].read()) return 0;
+                break;
+            default :	// READ_REQ, WRITE_REQ, DESC_REQ
+                if((r_master_index.read() == k) && 
+                   ((r_master_fsm == MST_READ_REQ) || (r_master_fsm == MST_WRITE_REQ))) return 0;
+                break;
+        }
+    }
+    return PIBUS_IDLE_FOREVER;
+}
+
+////////////////////////////////////////////
+void PibusMultiDma::skipCycles(uint32_t ncycles)
+{
+}
+
+////////////////////////////////////////////
+void PibusMultiDma::checkpoint(soclib::common::PibusCheckpoint& ckpt)
+{
+    ckpt.section(m_name);
+    ckpt.check(m_burst, "DMA burst length");
+    ckpt.check(m_channels, "DMA number of channels");
+    for( size_t k=0 ; k<m_channels ; k++ )
+    {
+        ckpt.state(r_channel_buf[k], m_size*4);
+        ckpt.state(r_channel_lut[k], 256);
+    }
+}
+
 
 }} // end namespace
@@ -29,6 +29,27 @@
 // A write request resets the TIMER_IRQ[i] register to false.
 // A read request returns the 0 value if TIMER_IRQ[i] is false.
 //
+// The timers are not decremented at each cycle : the component contains
+// a 64 bits cycle counter, and the state of a running timer is the 
+// absolute cycle of its next expiration (IRQ[i] set). The TIMER_VALUE[i]
+// register is stored as an offset to the cycle counter, and computed
+// when it is read. A timer is only handled when it expires or when it
+// is written, so the cost of a cycle does not depend on the number of
+// timers. The nextExpire() method returns the cycle of the next
+// expiration (TIMER_NEVER if no timer is running), and the timer
+// implements the PibusIdleSkip interface : the simulation loop can skip
+// the cycles without activity, up to the next expiration.
+//
+// The cycle counter can be read by software, in an optional second
+// segment allocated to the same target (at least 8 bytes) :
+// - CYCLE_LO		(0x0)	(read only)
+// A read request returns the 32 LSB bits of the cycle counter, and
+// latches the 32 MSB bits in the CYCLE_HI register.
+// - CYCLE_HI		(0x4)	(read only)
+// A read request returns the 32 MSB bits latched by the last CYCLE_LO read.
+// When this segment is mapped in the user address space, the software
+// can read the cycle counter without system call.
+//
 // This component cheks address for segmentation violation,
 // and can be used as a default target.
 ///////////////////////////////////////////////////////////////////////////////
@@ -46,9 +67,11 @@
 #include "pibus_mnemonics.h"
 #include "pibus_segment_table.h"
 
+#define TIMER_NEVER	0xFFFFFFFFFFFFFFFFULL
+
 namespace soclib { namespace caba {
 
-class PibusMultiTimer : sc_core::sc_module {
+class PibusMultiTimer : sc_core::sc_module, public soclib::common::PibusIdleSkip {
 
     // Structural parameters
     const char*                 m_name;                 // instance name
@@ -57,17 +80,25 @@ class PibusMultiTimer : sc_core::sc_module {
     uint32_t                    m_segbase;              // segment base address
     uint32_t                    m_segsize;              // segment size
     const char*                 m_segname;              // segment name
+    uint32_t                    m_cycbase;              // cycle counter segment base address
+    uint32_t                    m_cycsize;              // cycle counter segment size (0 if none)
     char			m_fsm_str[4][20];	// FSM states names 
+    uint32_t                    m_skip;                 // skipped idle cycles
 
     //	Registers
     sc_register<int>		r_fsm_state;
-    sc_register<uint32_t>	*r_value;
+    sc_register<uint32_t>	*r_value;		// TIMER_VALUE - cycle counter
     sc_register<uint32_t>	*r_period;
-    sc_register<uint32_t>	*r_counter;
+    sc_register<uint32_t>	*r_counter;		// remaining cycles (stopped timer)
+    sc_register<uint64_t>	*r_expire;		// expiration cycle (running timer)
     sc_register<bool>		*r_running;
     sc_register<bool>		*r_irq;
     sc_register<uint32_t>	r_index;
     sc_register<uint32_t>	r_cell;
+    sc_register<uint64_t>	r_cycles;		// cycle counter
+    sc_register<uint32_t>	r_cycles_hi;		// latched cycle counter MSB bits
+    sc_register<uint64_t>	r_next_expire;		// next expiration cycle (all timers)
+    sc_register<bool>		r_update;		// r_next_expire must be computed
 
     //	FSM states
     enum{
@@ -83,6 +114,8 @@ class PibusMultiTimer : sc_core::sc_module {
     RUNNING_ADDRESS	= 4,
     PERIOD_ADDRESS	= 8,
     IRQ_ADDRESS  	= 12, 
+    CYCLE_LO_ADDRESS	= 16,	// cycle counter segment
+    CYCLE_HI_ADDRESS	= 20,	// cycle counter segment
     };
 
 protected:
@@ -113,6 +146,9 @@ public:
     void transition();
     void genMoore();
     void printTrace();
+    uint64_t nextExpire();
+    uint32_t idleCycles();
+    void skipCycles(uint32_t ncycles);
 
 }; // end class PibusMultiTimer
 
@@ -22,6 +22,7 @@ PibusMultiTimer::PibusMultiTimer(sc_module_name		name,
     : m_name(name),
       m_tgtid(tgtid),
       m_ntimer(ntimer),
+      m_skip(0),
       p_ck("p_ck"),
       p_resetn("p_resetn"),
       p_sel("p_sel"),
@@ -50,6 +51,22 @@ PibusMultiTimer::PibusMultiTimer(sc_module_name		name,
     m_segsize = (*seglist.begin()).getSize();
     m_segname = (*seglist.begin()).getName();
 
+    // optional cycle counter segment
+    m_cycbase = 0;
+    m_cycsize = 0;
+    if (seglist.size() > 1)
+    {
+        std::list<SegmentTableEntry>::iterator seg = ++seglist.begin();
+        m_cycbase = (*seg).getBase();
+        m_cycsize = (*seg).getSize();
+        if (((m_cycbase & 0x7) != 0) || (m_cycsize < 8))
+        {
+            printf(" ERROR in PibusMultiTimer component : %s\n",m_name);
+            printf(" The cycle counter segment must be aligned on 8 bytes, and at least 8 bytes !\n");
+            exit(1);
+        }
+    }
+
     if ((m_ntimer < 1) || (m_ntimer > 32))
     {
         printf(" ERROR in PibusMultiTimer component : %s\n", m_name);
@@ -75,17 +92,40 @@ PibusMultiTimer::PibusMultiTimer(sc_module_name		name,
     r_value	= new	sc_register<uint32_t>[ntimer];
     r_period	= new	sc_register<uint32_t>[ntimer];
     r_counter	= new	sc_register<uint32_t>[ntimer];
+    r_expire	= new	sc_register<uint64_t>[ntimer];
 		
     std::cout << std::endl << "Instanciation of PibusMultiTimer : " << m_name << std::endl;
     std::cout << "    ntimer = " << m_ntimer << std::endl;
     std::cout << "    segment " << m_segname << std::hex
                   << " | base = 0x" << m_segbase
                   << " | size = 0x" << m_segsize << std::endl;
+    if ( m_cycsize )
+    std::cout << "    cycle counter" << std::hex
+                  << " | base = 0x" << m_cycbase
+                  << " | size = 0x" << m_cycsize << std::endl;
 } // end constructor
 
+//////////////////////////////////////////////////////////////
+// Returns the first expiration cycle of the running timers, 
+// or TIMER_NEVER if no timer is running.
+//////////////////////////////////////////////////////////////
+uint64_t PibusMultiTimer::nextExpire()
+{
+    uint64_t next = TIMER_NEVER;
+    for(size_t i = 0 ; i < m_ntimer ; i++) 
+    {
+        if ( r_running[i] && (r_expire[i].read() < next) ) next = r_expire[i].read();
+    }
+    return next;
+}
+
 ///////////////////////////////////
 void PibusMultiTimer::transition() 
 {
+    // skipped idle cycles (see skipCycles())
+    uint32_t skip = m_skip;
+    m_skip = 0;
+
     if(p_resetn == false) 
     {
 	r_fsm_state = FSM_IDLE;
@@ -94,15 +134,28 @@ void PibusMultiTimer::transition()
             r_running[i] = false;
             r_irq[i] = false;
 	}
+        r_cycles      = 0;
+        r_next_expire = TIMER_NEVER;
+        r_update      = false;
 	return;
     }
+
+    uint64_t cycle = r_cycles.read() + skip;
+    bool     update = false;	// a timer has been modified or has expired
 		
     switch(r_fsm_state) {
     case FSM_IDLE :
 	if(p_sel == true) 
         {			
             uint32_t address = (uint32_t)p_a.read() & 0xFFFFFFFC;
-            if ((address < m_segbase) || (address >= (m_segbase + m_segsize))) 
+            if ((address >= m_cycbase) && (address < (m_cycbase + m_cycsize)))
+            {
+                r_cell = CYCLE_LO_ADDRESS + ((address - m_cycbase) & 0x4);
+                if ((address & 0x4) == 0) r_cycles_hi = (uint32_t)((cycle + 1) >> 32);
+		if (p_read.read()) r_fsm_state = FSM_READ;
+                else	           r_fsm_state = FSM_ERROR;
+            }
+            else if ((address < m_segbase) || (address >= (m_segbase + m_segsize))) 
             { 
                 r_fsm_state = FSM_ERROR;
             } 
@@ -116,17 +169,37 @@ void PibusMultiTimer::transition()
         }
         break;
     case FSM_WRITE :
-	if      (r_cell == VALUE_ADDRESS)     	r_value[r_index] = (uint32_t)p_d.read();
-	else if (r_cell == IRQ_ADDRESS)  	r_irq[r_index] = ((uint32_t)p_d.read() != 0);
-        else if (r_cell == RUNNING_ADDRESS)   	r_running[r_index] = ((uint32_t)p_d.read() != 0);
+    {
+        size_t   i    = r_index.read();
+        uint32_t data = (uint32_t)p_d.read();
+	if      (r_cell == VALUE_ADDRESS)     	r_value[i] = data - (uint32_t)(cycle + 1);
+	else if (r_cell == IRQ_ADDRESS)  	r_irq[i] = (data != 0);
+        else if (r_cell == RUNNING_ADDRESS)   	
+        {
+            if ( (data != 0) && (r_running[i] == false) )	// start : expiration cycle
+            {
+                r_expire[i] = cycle + 1 + r_counter[i].read();
+                update = true;
+            }
+            if ( (data == 0) && (r_running[i] == true) )	// stop : remaining cycles
+            {
+                uint64_t expire = r_expire[i].read();
+                if ( expire == cycle ) expire = cycle + 1 + r_period[i].read();
+                r_counter[i] = (uint32_t)(expire - cycle - 1);
+                update = true;
+            }
+            r_running[i] = (data != 0);
+        }
 	else if (r_cell == PERIOD_ADDRESS) 
         {
-						r_period[r_index] = (uint32_t)p_d.read();
-						r_counter[r_index] = (uint32_t)p_d.read();
-						r_running[r_index] = false;
+						r_period[i] = data;
+						r_counter[i] = data;
+						r_running[i] = false;
+            update = true;
 	}
 	r_fsm_state = FSM_IDLE;
         break;
+    }
     case FSM_READ :
 	r_fsm_state = FSM_IDLE;
         break;
@@ -135,24 +208,28 @@ void PibusMultiTimer::transition()
         break;
     } // end switch TARGET FSM
 
-    // Increment r_value[i], decrement r_counter[i] & Set r_irq[i]
+    // Increment the cycle counter, and set r_irq[i] for the expired timers.
+    // The timers are scanned only when one of them expires, and 
+    // r_next_expire is computed in the cycle following a modification.
 
-    for(size_t i = 0 ; i < m_ntimer ; i++) 
+    r_cycles = cycle + 1;
+
+    uint64_t next = r_next_expire.read();
+    if ( r_update.read() ) next = nextExpire();
+    if ( next <= cycle )
     {
-	r_value[i] = r_value[i] + 1;
-	if (r_running[i]  == true) 
-        { 
-            if ( r_counter[i] > 0) 
-            {
-                r_counter[i] = r_counter[i] - 1;
-            } 
-            else 
+        for(size_t i = 0 ; i < m_ntimer ; i++) 
+        {
+            if ( r_running[i] && (r_expire[i].read() == cycle) )
             {
-                r_counter[i] = r_period[i];
+                r_expire[i] = cycle + 1 + r_period[i].read();
                 r_irq[i] = true; 
             }
-	} // end if timer running
-    } // end for
+        } // end for
+        update = true;
+    }
+    r_next_expire = next;
+    r_update      = update;
 } // end transition()
 
 ////////////////////////////////
@@ -167,10 +244,12 @@ void PibusMultiTimer::genMoore()
             break;
 	case FSM_READ :
 	    p_ack = PIBUS_ACK_READY;
-	    if      (r_cell == VALUE_ADDRESS)    p_d.write((uint32_t)r_value[r_index]); 
+	    if      (r_cell == VALUE_ADDRESS)    p_d.write((uint32_t)r_cycles.read() + r_value[r_index].read()); 
             else if (r_cell == PERIOD_ADDRESS)   p_d.write((uint32_t)r_period[r_index]);
             else if (r_cell == RUNNING_ADDRESS)  p_d.write((uint32_t)r_running[r_index]); 
             else if (r_cell == IRQ_ADDRESS)      p_d.write((uint32_t)r_irq[r_index]); 
+            else if (r_cell == CYCLE_LO_ADDRESS) p_d.write((uint32_t)r_cycles.read()); 
+            else if (r_cell == CYCLE_HI_ADDRESS) p_d.write(r_cycles_hi.read()); 
             break;
 	case FSM_ERROR:
             p_ack = PIBUS_ACK_ERROR;
@@ -182,12 +261,37 @@ void PibusMultiTimer::genMoore()
 
 } // end genMoore()
 	
+//////////////////////////////////////////////////////////////
+// idle cycles : the timer is idle when it is not selected, 
+// until the next expiration cycle.
+//////////////////////////////////////////////////////////////
+uint32_t PibusMultiTimer::idleCycles()
+{
+    if ( (r_fsm_state != FSM_IDLE) || p_sel.read() || r_update.read() ) return 0;
+
+    uint64_t cycle = r_cycles.read();
+    uint64_t next  = r_next_expire.read();
+    if ( next <= cycle )                          return 0;
+    if ( next - cycle >= PIBUS_IDLE_FOREVER ) return PIBUS_IDLE_FOREVER;
+    return (uint32_t)(next - cycle);
+}
+
+//////////////////////////////////////////////////////////////
+// skip idle cycles : the cycle counter is updated by the 
+// next transition.
+//////////////////////////////////////////////////////////////
+void PibusMultiTimer::skipCycles(uint32_t ncycles)
+{
+    m_skip = ncycles;
+}
+
 //////////////////////////////////
 void PibusMultiTimer::printTrace()
 {
     std::cout << m_name << " : " << m_fsm_str[r_fsm_state] 
               << "   period[0] = " << r_period[0] 
-              << "   running[0] = " << r_running[0] << std::endl;
+              << "   running[0] = " << r_running[0] 
+              << "   cycles = " << std::dec << r_cycles.read() << std::endl;
 }
 
 }} // end namespace
@@ -47,6 +47,10 @@
 // The constructor creates as many UNIX XTERM processes as
 // the number of emulated terminals. It creates a PTY pseudo-terminal 
 // for each XTERM supporting bi-directional inter-process communication.
+//
+// The TTY implements the PibusIdleSkip interface : it is idle when it
+// is not selected. As the keyboards are scanned in each simulated cycle,
+// a stroken key is registered after the skipped cycles.
 /////////////////////////////////////////////////////////////////////
 // This component has 4 "constructor" parameters :
 // - sc_module_name	name		: instance name  
@@ -73,7 +77,7 @@ namespace soclib { namespace caba {
 using namespace sc_core;
 using namespace soclib::common;
 
-class PibusMultiTty : sc_module {
+class PibusMultiTty : sc_module, public soclib::common::PibusIdleSkip {
 
     //	STRUTURAL PARAMETERS
     const char*			m_name;			// instance name
@@ -144,6 +148,8 @@ public:
     void transition();
     void genMoore();
     void printTrace();
+    uint32_t idleCycles();
+    void skipCycles(uint32_t ncycles);
 
 #ifdef SOCVIEW
     void registerDebug( SocviewDebugger db);
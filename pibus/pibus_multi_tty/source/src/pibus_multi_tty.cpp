@@ -321,4 +321,19 @@ void PibusMultiTty::printTrace()
                         << "   display status[0] = "  << r_display_sts[0] << std::endl;
 }
 
+/////////////////////////////////////////////////////////////////
+// idle cycles : the TTY is idle when it is not selected.
+// The keyboards are not scanned in the skipped cycles.
+/////////////////////////////////////////////////////////////////
+uint32_t PibusMultiTty::idleCycles()
+{
+    if ((r_fsm_state == FSM_IDLE) && (p_sel == false)) return PIBUS_IDLE_FOREVER;
+    else                                               return 0;
+}
+
+/////////////////////////////////////////////////
+void PibusMultiTty::skipCycles(uint32_t ncycles)
+{
+}
+
 }} // end namespaces
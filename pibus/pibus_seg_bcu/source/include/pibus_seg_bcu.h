@@ -14,23 +14,91 @@
 // - The default master mechanism is not supported.
 // - Only four values are supported for the ACK signal:
 //   READY, WAIT, ERROR, RETRY.
-// - The arbitration policy between masters is round-robin.
+// - The default arbitration policy between masters is round-robin.
 // The bus is granted to a new master in the FSM_IDLE state 
 // (the bus is not used), and in the FSM_DT state (last cycle 
 // of a transaction) when the ACK signal is not PI_ACK-WAT.
+// A transaction answered RETRY by the target (split transaction)
+// is aborted in the FSM_DTAD or FSM_DT state, and the bus is
+// granted to a new master in the same cycle. As the round-robin 
+// order starts after the retried master, all other requesting 
+// masters are served before this master restarts its transaction :
+// the retried master is not starved, and the target latency is
+// overlapped with the other transactions.
+//
+// The arbitration policy is defined by the policy constructor argument,
+// and uses a per-master weight (default 1) defined by setWeight() :
+// - PIBUS_ARB_ROUND_ROBIN : the weights are not used.
+// - PIBUS_ARB_FIXED_PRIORITY : the requesting master with the largest
+//   weight is granted. The masters with the same weight are served
+//   in round-robin order.
+// - PIBUS_ARB_WEIGHTED_RR : round-robin, but a master can be granted
+//   up to weight consecutive transactions before the bus is given to
+//   the next requesting master.
+// - PIBUS_ARB_TDMA : the time is split in slots of slot_cycles cycles,
+//   and a frame contains one slot per weight unit (master 0 owns the
+//   weight[0] first slots, and so on). The slot owner is granted if it
+//   is requesting. Otherwise the bus is granted in round-robin order
+//   (work-conserving policy).
+// A bandwidth regulator (token bucket) can be defined for each master
+// by setRegulator() : the bucket receives one token every period 
+// cycles, and contains at most depth tokens (initially full). Each
+// transaction consumes one token, and a master with an empty bucket 
+// is not granted, even if the bus is free.
 // The COUNT_REQ[i] register counts the total number of transaction 
 // requests for master i. The COUNT_WAIT[i] register counts the total
-// number of wait cycles for master i.
+// number of wait cycles for master i. The COUNT_RETRY[i] register
+// counts the number of transactions answered RETRY for master i.
+//
+// For a finer analysis, the BCU builds histograms (log2 buckets : 
+// bucket 0 for 0 cycle, bucket k for [2**(k-1), 2**k[ cycles, the last
+// bucket containing all larger values) of the arbitration wait (cycles
+// between the request and the grant) for each master, and of the 
+// transaction duration (cycles between the address cycle and the last 
+// cycle) for each master and each target.
+// When the util_period constructor argument is not 0, it also samples
+// the bus utilization (number of busy cycles) and the occupancy of each
+// target (number of cycles allocated to a transaction addressing this 
+// target) every util_period cycles.
+// These results are saved by the saveStatistics() method, in JSON 
+// format if the file name ends with ".json", and in CSV format otherwise.
+//
+// When the pipeline constructor argument is true, the BCU implements the
+// address pipelining between transactions of different masters : the
+// next master is granted in the last address cycle of the current
+// transaction (FSM_AD or FSM_DTAD state, with LOCK = false), and its
+// address cycle is overlapped with the last data cycle of the current
+// transaction (FSM_DT_AD state). In this state, the target of the new
+// transaction is selected while the previous target sends its last
+// acknowledge. A sequence of single word transactions can then use
+// the bus at one word per cycle.
+// As the PIBUS masters do not wait in the address cycle, the last data
+// cycle cannot be extended : the pipelining is only used when the
+// current target has been declared by the setPipelined() method. Such
+// a target never answers WAIT, and decodes each selected address as 
+// a new transaction (including in its last data cycle). A declared 
+// target answering WAIT in the FSM_DT_AD state is a fatal error.
+// The bus throughput (transfered words per cycle) is displayed by the
+// printStatistics() method.
+//
+// The BCU implements the PibusIdleSkip interface : it is idle when the
+// bus is not used and no master is requesting, and when the current
+// target answers WAIT. The skipped cycles are counted in the wait
+// counters, the TDMA frame, the token buckets and the histograms.
 // This component use the Segment Table to build the Target ROM table, 
 // that decode the address MSB bits and gives the the selected target 
 // index to generate the SEL[i] signals.
 //////////////////////////////////////////////////////////////////////////
-// This component has 5 "constructor" parameters :
+// This component has 9 "constructor" parameters :
 // - sc_module_name	name		: instance name
 // - pibusSegmentTable	segtab		: segment table
 // - int 		nb_master       : number of PIBUS masters   
 // - int 		nb_slave        : number of PIBUS slaves  
 // - int 		time_out	: max wait cycles (default = 100)
+// - int 		policy		: arbitration policy (default = round-robin)
+// - int 		slot_cycles	: TDMA slot length (default = 1)
+// - int 		util_period	: utilization sampling period (default = 0)
+// - bool 		pipeline	: address pipelining (default = false)
 //////////////////////////////////////////////////////////////////////////
 
 #ifndef PIBUS_BCU_H_
@@ -38,14 +106,26 @@
 
 #include <systemc>
 #include <inttypes.h>
+#include <vector>
 #include "pibus_segment_table.h"
 #include "pibus_mnemonics.h"
 
+#define PIBUS_BCU_HIST_BUCKETS	16	// number of buckets in the cycles histograms
+
 
 namespace soclib { namespace caba {
 
+//	ARBITRATION POLICIES
+enum pibus_arbitration_e
+{
+	PIBUS_ARB_ROUND_ROBIN		= 0,
+	PIBUS_ARB_FIXED_PRIORITY	= 1,
+	PIBUS_ARB_WEIGHTED_RR		= 2,
+	PIBUS_ARB_TDMA			= 3,
+};
+
 ////////////////////////////////////////
-class PibusSegBcu : sc_core::sc_module {
+class PibusSegBcu : sc_core::sc_module, public soclib::common::PibusIdleSkip {
 
 	// 	FSM states
 	enum fms_state_e 
@@ -54,6 +134,7 @@ class PibusSegBcu : sc_core::sc_module {
 	FSM_AD		= 1,
 	FSM_DTAD	= 2,
 	FSM_DT		= 3,
+	FSM_DT_AD	= 4,
 	};
 
 	//	STRUCTURAL PARAMETERS
@@ -63,14 +144,54 @@ class PibusSegBcu : sc_core::sc_module {
 	const size_t 			m_nb_master;		// number of connected masters
 	const size_t 			m_nb_target;		// number of connected targets
 	const uint32_t 			m_time_out;		// number of cycles before time-out
-        char				m_fsm_str[4][20];	// FSM states names
+	const uint32_t 			m_policy;		// arbitration policy
+	const uint32_t 			m_slot_cycles;		// TDMA slot length
+	uint32_t*			m_weight;		// arbitration weight (per master)
+	uint32_t*			m_tb_period;		// token refill period (per master, 0 if no regulation)
+	uint32_t*			m_tb_depth;		// token bucket depth (per master)
+	uint32_t			m_frame_slots;		// number of slots in a TDMA frame
+        char				m_fsm_str[5][20];	// FSM states names
+        char				m_policy_str[4][20];	// policies names
+	const uint32_t 			m_util_period;		// utilization sampling period
+	const bool 			m_pipeline;		// address pipelining activated
+	bool*				m_pipelined;		// pipelined target (per target)
+	uint32_t			m_skip;			// skipped idle cycles
 
 	// 	REGISTERS
 	sc_register<int> 		r_fsm_state;		// FSM state
 	sc_register<size_t>		r_current_master;	// current master index
+	sc_register<size_t>		r_prev_master;		// previous master index (FSM_DT_AD)
 	sc_register<uint32_t>		r_tout_counter;		// time-out counter
 	sc_register<uint32_t>*		r_req_counter;		// number of requests (per master)
 	sc_register<uint32_t>*		r_wait_counter;		// number of wait cycles (per master)
+	sc_register<uint32_t>*		r_retry_counter;	// number of retried transactions (per master)
+	sc_register<uint32_t>		r_credit;		// remaining grants for current master (WRR)
+	sc_register<uint32_t>		r_slot_cycle;		// cycle index in the TDMA frame
+	sc_register<uint32_t>*		r_tb_tokens;		// available tokens (per master)
+	sc_register<uint32_t>*		r_tb_timer;		// cycles since last token (per master)
+
+	//	INSTRUMENTATION COUNTERS
+	uint32_t			c_cycles;		// number of cycles since reset
+	uint32_t			c_words;		// number of transfered words
+	uint32_t*			c_wait_hist;		// arbitration wait histograms (per master)
+	uint32_t*			c_master_hist;		// transaction duration histograms (per master)
+	uint32_t*			c_target_hist;		// transaction duration histograms (per target)
+	uint32_t*			c_cur_wait;		// current arbitration wait (per master)
+	uint32_t			c_cur_cycles;		// current transaction duration
+	size_t				c_cur_target;		// current transaction target
+	uint32_t			c_util_cycles;		// cycles in the current sampling period
+	uint32_t			c_util_busy;		// busy cycles in the current sampling period
+	uint32_t*			c_util_target;		// occupancy in the current sampling period (per target)
+	std::vector<uint32_t>		m_util_busy;		// bus utilization samples
+	std::vector<uint32_t>		m_util_target;		// target occupancy samples (nb_target per sample)
+
+	// 	METHODS (combinational functions of the registers and inputs)
+	bool allocation();
+	bool pipelined();
+	bool eligible(size_t master);
+	size_t slotOwner();
+	size_t select();
+	static size_t bucket(uint32_t cycles);
 
 protected:
 
@@ -95,7 +216,11 @@ public:
 	             soclib::common::PibusSegmentTable       	&segtab,
 		     size_t					nb_master,
 		     size_t					nb_slave,
-		     uint32_t					time_out = 1000000000);
+		     uint32_t					time_out = 1000000000,
+		     uint32_t					policy = PIBUS_ARB_ROUND_ROBIN,
+		     uint32_t					slot_cycles = 1,
+		     uint32_t					util_period = 0,
+		     bool					pipeline = false);
 	~PibusSegBcu();
 
 	// 	METHODS
@@ -103,8 +228,14 @@ public:
 	void genMealy_gnt(); 
 	void genMealy_sel();
 	void genMoore();
+	void setWeight(size_t master, uint32_t weight);
+	void setRegulator(size_t master, uint32_t period, uint32_t depth);
+	void setPipelined(size_t target);
         void printTrace();
         void printStatistics();
+        void saveStatistics(const char* filename);
+	uint32_t idleCycles();
+	void skipCycles(uint32_t ncycles);
 
 #ifdef SOCVIEW
         void registerDebug( SocviewDebugger db );
@@ -6,6 +6,8 @@
 // This program is released under the GNU public license
 ///////////////////////////////////////////////////////////////////////////
 
+#include <stdio.h>
+#include <string.h>
 #include "pibus_seg_bcu.h"
 #include "alloc_elems.h"
 
@@ -20,18 +22,34 @@ PibusSegBcu::PibusSegBcu (	sc_module_name 			name,
                             PibusSegmentTable 	    &segtab,
                             size_t 					nb_master,
                             size_t 					nb_target,
-                            uint32_t 				time_out)
+                            uint32_t 				time_out,
+                            uint32_t 				policy,
+                            uint32_t 				slot_cycles,
+                            uint32_t 				util_period,
+                            bool 					pipeline)
 	: m_name(name),
       m_target_table(segtab.getTargetTable()),
       m_msb_shift( 32 - segtab.getMSBnumber() ),
       m_nb_master(nb_master),
       m_nb_target(nb_target),
       m_time_out(time_out),
+      m_policy(policy),
+      m_slot_cycles(slot_cycles),
+      m_frame_slots(nb_master),
+      m_util_period(util_period),
+      m_pipeline(pipeline),
+      m_skip(0),
       r_fsm_state("r_fsm_state"),
       r_current_master("r_current_master"),
+      r_prev_master("r_prev_master"),
       r_tout_counter("r_tout_counter"),
-      r_req_counter(soclib::common::alloc_elems<sc_signal<uint32_t> >("r_req_counter", nb_master)),
-      r_wait_counter(soclib::common::alloc_elems<sc_signal<uint32_t> >("r_wait_counter", nb_master)),
+      r_req_counter(soclib::common::alloc_elems<sc_register<uint32_t> >("r_req_counter", nb_master)),
+      r_wait_counter(soclib::common::alloc_elems<sc_register<uint32_t> >("r_wait_counter", nb_master)),
+      r_retry_counter(soclib::common::alloc_elems<sc_register<uint32_t> >("r_retry_counter", nb_master)),
+      r_credit("r_credit"),
+      r_slot_cycle("r_slot_cycle"),
+      r_tb_tokens(soclib::common::alloc_elems<sc_register<uint32_t> >("r_tb_tokens", nb_master)),
+      r_tb_timer(soclib::common::alloc_elems<sc_register<uint32_t> >("r_tb_timer", nb_master)),
       p_ck("p_ck"),
       p_resetn("p_resetn"),
       p_req(soclib::common::alloc_elems<sc_in<bool> >("p_req", nb_master)),
@@ -56,6 +74,8 @@ PibusSegBcu::PibusSegBcu (	sc_module_name 			name,
 	SC_METHOD(genMealy_gnt);
 	sensitive << p_ck.neg();
     sensitive << p_ack;
+    sensitive << p_a;
+    sensitive << p_lock;
 	for (size_t i = 0 ; i < m_nb_master; i++)
         sensitive << p_req[i];
 
@@ -63,6 +83,31 @@ PibusSegBcu::PibusSegBcu (	sc_module_name 			name,
     strcpy(m_fsm_str[1], "AD");
     strcpy(m_fsm_str[2], "DTAD");
     strcpy(m_fsm_str[3], "DT");
+    strcpy(m_fsm_str[4], "DT_AD");
+
+    strcpy(m_policy_str[PIBUS_ARB_ROUND_ROBIN],    "round-robin");
+    strcpy(m_policy_str[PIBUS_ARB_FIXED_PRIORITY], "fixed priority");
+    strcpy(m_policy_str[PIBUS_ARB_WEIGHTED_RR],    "weighted round-robin");
+    strcpy(m_policy_str[PIBUS_ARB_TDMA],           "TDMA");
+
+    c_wait_hist   = new uint32_t[nb_master*PIBUS_BCU_HIST_BUCKETS];
+    c_master_hist = new uint32_t[nb_master*PIBUS_BCU_HIST_BUCKETS];
+    c_target_hist = new uint32_t[nb_target*PIBUS_BCU_HIST_BUCKETS];
+    c_cur_wait    = new uint32_t[nb_master];
+    c_util_target = new uint32_t[nb_target];
+
+    m_pipelined = new bool[nb_target];
+    for (size_t t = 0 ; t < m_nb_target ; t++) m_pipelined[t] = false;
+
+    m_weight    = new uint32_t[nb_master];
+    m_tb_period = new uint32_t[nb_master];
+    m_tb_depth  = new uint32_t[nb_master];
+    for (size_t i = 0 ; i < m_nb_master ; i++)
+    {
+        m_weight[i]    = 1;
+        m_tb_period[i] = 0;
+        m_tb_depth[i]  = 0;
+    }
 
 	if (!segtab.isAllBelow( m_nb_target )) 
     {
@@ -78,10 +123,31 @@ PibusSegBcu::PibusSegBcu (	sc_module_name 			name,
         exit(0);
     }
 
+	if (policy > PIBUS_ARB_TDMA) 
+    {
+	    std::cout << "ERROR in PibusSegBcu Component" << std::endl;
+        std::cout << "Illegal arbitration policy : " << policy << std::endl;
+        exit(0);
+    }
+
+	if (slot_cycles == 0) 
+    {
+	    std::cout << "ERROR in PibusSegBcu Component" << std::endl;
+        std::cout << "Slot_cycles argument cannot be 0" << std::endl;
+        exit(0);
+    }
+
     std::cout << std::endl << "Instanciation of PibuBcu : " << m_name << std::endl;
     std::cout << "    nb_master = " << m_nb_master << std::endl;
     std::cout << "    nb_target = " << m_nb_target << std::endl;
     std::cout << "    time_out  = " << m_time_out  << std::endl;
+    std::cout << "    policy    = " << m_policy_str[m_policy] << std::endl;
+    if ( m_policy == PIBUS_ARB_TDMA )
+    std::cout << "    slot      = " << m_slot_cycles << " cycles" << std::endl;
+    if ( m_util_period )
+    std::cout << "    sampling  = " << m_util_period << " cycles" << std::endl;
+    if ( m_pipeline )
+    std::cout << "    address pipelining" << std::endl;
 
 }
 
@@ -92,49 +158,221 @@ PibusSegBcu::~PibusSegBcu()
     soclib::common::dealloc_elems(p_sel, m_nb_target);
     soclib::common::dealloc_elems(r_req_counter, m_nb_master);
     soclib::common::dealloc_elems(r_wait_counter, m_nb_master);
+    soclib::common::dealloc_elems(r_retry_counter, m_nb_master);
+    soclib::common::dealloc_elems(r_tb_tokens, m_nb_master);
+    soclib::common::dealloc_elems(r_tb_timer, m_nb_master);
+    delete [] c_wait_hist;
+    delete [] c_master_hist;
+    delete [] c_target_hist;
+    delete [] c_cur_wait;
+    delete [] c_util_target;
+    delete [] m_pipelined;
+    delete [] m_weight;
+    delete [] m_tb_period;
+    delete [] m_tb_depth;
+}
+
+//////////////////////////////////////////////////////////////
+void PibusSegBcu::setWeight(size_t master, uint32_t weight)
+{
+    if ( (master >= m_nb_master) || (weight == 0) )
+    {
+	    std::cout << "ERROR in PibusSegBcu Component" << std::endl;
+        std::cout << "Illegal weight " << weight << " for master " << master << std::endl;
+        exit(0);
+    }
+    m_frame_slots = m_frame_slots - m_weight[master] + weight;
+    m_weight[master] = weight;
+
+    std::cout << "    master " << master << " : weight = " << weight << std::endl;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+void PibusSegBcu::setRegulator(size_t master, uint32_t period, uint32_t depth)
+{
+    if ( (master >= m_nb_master) || ((period != 0) && (depth == 0)) )
+    {
+	    std::cout << "ERROR in PibusSegBcu Component" << std::endl;
+        std::cout << "Illegal regulator for master " << master << std::endl;
+        exit(0);
+    }
+    m_tb_period[master] = period;
+    m_tb_depth[master]  = depth;
+
+    std::cout << "    master " << master << " : one token every " << period 
+              << " cycles / bucket depth = " << depth << std::endl;
+}
+
+//////////////////////////////////////////////////
+void PibusSegBcu::setPipelined(size_t target)
+{
+    if ( target >= m_nb_target )
+    {
+	    std::cout << "ERROR in PibusSegBcu Component" << std::endl;
+        std::cout << "Illegal pipelined target " << target << std::endl;
+        exit(0);
+    }
+    m_pipelined[target] = true;
+
+    if ( m_pipeline ) std::cout << "    target " << target << " : pipelined" << std::endl;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Returns the log2 histogram bucket for a number of cycles.
+/////////////////////////////////////////////////////////////////////
+size_t PibusSegBcu::bucket(uint32_t cycles)
+{
+    size_t b = 0;
+    while ( (cycles != 0) && (b < PIBUS_BCU_HIST_BUCKETS - 1) )
+    {
+        cycles = cycles >> 1;
+        b++;
+    }
+    return b;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Returns true when the bus can be granted to a new master :
+// the bus is not used, or it is the last cycle of a transaction
+// (completed or aborted by a RETRY acknowledge), or the last address
+// cycle of a pipelined transaction.
+/////////////////////////////////////////////////////////////////////
+bool PibusSegBcu::allocation()
+{
+    if ( r_fsm_state == FSM_IDLE ) return true;
+    if ( r_fsm_state == FSM_DT )   return (p_ack.read() != PIBUS_ACK_WAIT);
+    if ( r_fsm_state == FSM_DTAD ) return (p_ack.read() == PIBUS_ACK_RETRY) || pipelined();
+    return pipelined();
+}
+
+/////////////////////////////////////////////////////////////////////
+// Returns true when the next address cycle can overlap the last 
+// data cycle of the current transaction : the current cycle is the
+// last address cycle (LOCK = false) and the addressed target has
+// been declared with setPipelined().
+/////////////////////////////////////////////////////////////////////
+bool PibusSegBcu::pipelined()
+{
+    if ( (m_pipeline == false) || p_lock.read() ) return false;
+    if ( m_pipelined[m_target_table[p_a.read() >> m_msb_shift]] == false ) return false;
+    if ( r_fsm_state == FSM_DTAD ) return (p_ack.read() == PIBUS_ACK_READY);
+    return (r_fsm_state == FSM_AD) || (r_fsm_state == FSM_DT_AD);
+}
+
+/////////////////////////////////////////////////////////////////////
+// A master can be granted if it is requesting, and if its token
+// bucket is not empty (when a bandwidth regulator is defined).
+/////////////////////////////////////////////////////////////////////
+bool PibusSegBcu::eligible(size_t master)
+{
+    if ( p_req[master] == false ) return false;
+    if ( m_tb_period[master] == 0 ) return true;
+    return (r_tb_tokens[master].read() != 0);
+}
+
+/////////////////////////////////////////////////////////////////////
+// Returns the owner of the current TDMA slot.
+/////////////////////////////////////////////////////////////////////
+size_t PibusSegBcu::slotOwner()
+{
+    uint32_t slot = r_slot_cycle.read() / m_slot_cycles;
+    for (size_t i = 0 ; i < m_nb_master ; i++)
+    {
+        if ( slot < m_weight[i] ) return i;
+        slot = slot - m_weight[i];
+    }
+    return m_nb_master;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Returns the index of the master to be granted, depending on the 
+// arbitration policy, or m_nb_master if no master can be granted.
+// The round-robin order starts after the last granted master.
+/////////////////////////////////////////////////////////////////////
+size_t PibusSegBcu::select()
+{
+    if ( m_policy == PIBUS_ARB_TDMA )
+    {
+        size_t owner = slotOwner();
+        if ( (owner < m_nb_master) && eligible(owner) ) return owner;
+    }
+    if ( (m_policy == PIBUS_ARB_WEIGHTED_RR) && (r_credit.read() != 0) && 
+         eligible(r_current_master.read()) ) return r_current_master.read();
+
+    size_t winner = m_nb_master;
+    for(size_t i = 0 ; i < m_nb_master ; i++) 
+    {
+        size_t j = (i + 1 + r_current_master) % m_nb_master;
+        if ( eligible(j) == false ) continue;
+        if ( m_policy != PIBUS_ARB_FIXED_PRIORITY ) return j;
+        if ( (winner == m_nb_master) || (m_weight[j] > m_weight[winner]) ) winner = j;
+    }
+    return winner;
 }
 
 //////////////////////////////
 void PibusSegBcu::transition()
 {
+    // skipped idle cycles (see skipCycles())
+    uint32_t skip = m_skip;
+    m_skip = 0;
+
     if (p_resetn == false) 
     {
         r_fsm_state = FSM_IDLE;
         r_current_master = 0;
+        r_prev_master = 0;
+        r_credit = 0;
+        r_slot_cycle = 0;
         for(size_t i = 0 ; i < m_nb_master ; i++) 
         {
             r_wait_counter[i] = 0;
             r_req_counter[i] = 0;
+            r_retry_counter[i] = 0;
+            r_tb_tokens[i] = m_tb_depth[i];
+            r_tb_timer[i] = 0;
+            c_cur_wait[i] = 0;
         }
+        memset(c_wait_hist,   0, m_nb_master*PIBUS_BCU_HIST_BUCKETS*sizeof(uint32_t));
+        memset(c_master_hist, 0, m_nb_master*PIBUS_BCU_HIST_BUCKETS*sizeof(uint32_t));
+        memset(c_target_hist, 0, m_nb_target*PIBUS_BCU_HIST_BUCKETS*sizeof(uint32_t));
+        memset(c_util_target, 0, m_nb_target*sizeof(uint32_t));
+        c_cycles      = 0;
+        c_words       = 0;
+        c_cur_cycles  = 0;
+        c_cur_target  = 0;
+        c_util_cycles = 0;
+        c_util_busy   = 0;
+        m_util_busy.clear();
+        m_util_target.clear();
         return;
     } // end p_resetn
 
     for(size_t i = 0 ; i < m_nb_master ; i++) 
     {
-        if(p_req[i]) r_wait_counter[i] = r_wait_counter[i] + 1;
+        if(p_req[i]) r_wait_counter[i] = r_wait_counter[i] + 1 + skip;
 	}
+
+    size_t granted = m_nb_master;	// index of the master granted in this cycle
 	
     switch(r_fsm_state) {
 	case FSM_IDLE:
     {
         r_tout_counter = m_time_out;
-        for(size_t i = 0 ; i < m_nb_master ; i++) 
-        {
-            int j = (i + 1 + r_current_master) % m_nb_master;
-            if (p_req[j]) 
-            {
-                r_current_master = j;
-                r_req_counter[j] = r_req_counter[j] + 1;
-                r_fsm_state = FSM_AD;
-                break;
-            }
-        } 
+        granted = select();
+        if ( granted < m_nb_master ) r_fsm_state = FSM_AD;
         break;
     }
 	case FSM_AD:
     {
-        if(p_lock)   r_fsm_state = FSM_DTAD;  
-        else	     r_fsm_state = FSM_DT; 
+        if ( pipelined() ) granted = select();
+        if ( granted < m_nb_master )    // pipelined allocation
+        {
+            r_tout_counter = m_time_out;
+            r_fsm_state = FSM_DT_AD;
+        }
+        else if(p_lock)   r_fsm_state = FSM_DTAD;  
+        else	          r_fsm_state = FSM_DT; 
         break;
     }
 	case FSM_DTAD:
@@ -143,13 +381,30 @@ void PibusSegBcu::transition()
         {
             r_fsm_state = FSM_IDLE;
         } 
+        else if ( p_ack.read() == PIBUS_ACK_RETRY )  // aborted transaction
+        {
+            r_retry_counter[r_current_master] = r_retry_counter[r_current_master] + 1;
+            r_tout_counter = m_time_out;
+            granted = select();
+            if(granted < m_nb_master) r_fsm_state = FSM_AD; 
+            else                      r_fsm_state = FSM_IDLE; 
+        }
         else if ( (p_ack.read() != PIBUS_ACK_WAIT) and (p_lock == false) ) 
         {
-            r_fsm_state = FSM_DT; 
+            if ( pipelined() ) granted = select();
+            if ( granted < m_nb_master )    // pipelined allocation
+            {
+                r_tout_counter = m_time_out;
+                r_fsm_state = FSM_DT_AD;
+            }
+            else
+            {
+                r_fsm_state = FSM_DT; 
+            }
         } 
         else 
         { 
-            r_tout_counter = r_tout_counter - 1;
+            r_tout_counter = r_tout_counter - 1 - skip;
         }
         break;
     }
@@ -161,48 +416,190 @@ void PibusSegBcu::transition()
         } 
         else if(p_ack.read() != PIBUS_ACK_WAIT)  // new allocation
         {
+            if ( p_ack.read() == PIBUS_ACK_RETRY )
+                r_retry_counter[r_current_master] = r_retry_counter[r_current_master] + 1;
             r_tout_counter = m_time_out;
-            bool found = false;
-            for(size_t i = 0 ; (i < m_nb_master) and (found == false) ; i++) 
-            {
-                int j = (i + 1 + r_current_master) % m_nb_master;
-                if( p_req[j] == true )
-                {
-                    r_current_master = j;
-                    r_req_counter[j] = r_req_counter[j] + 1;
-                    found = true;
-                }
-            } 
-            if(found == true) r_fsm_state = FSM_AD; 
-            else              r_fsm_state = FSM_IDLE; 
+            granted = select();
+            if(granted < m_nb_master) r_fsm_state = FSM_AD; 
+            else                      r_fsm_state = FSM_IDLE; 
         } 
         else 
         { 
-            r_tout_counter = r_tout_counter - 1;
+            r_tout_counter = r_tout_counter - 1 - skip;
+        }
+        break;
+    }
+	case FSM_DT_AD:     // last data cycle of the previous transaction
+    {
+        if ( p_ack.read() == PIBUS_ACK_WAIT )
+        {
+	        std::cout << "ERROR in PibusSegBcu Component " << m_name << std::endl;
+            std::cout << "WAIT acknowledge from a pipelined target" << std::endl;
+            exit(1);
+        }
+        if ( p_ack.read() == PIBUS_ACK_RETRY )
+            r_retry_counter[r_prev_master] = r_retry_counter[r_prev_master] + 1;
+        if ( pipelined() ) granted = select();
+        if ( granted < m_nb_master )    // pipelined allocation
+        {
+            r_tout_counter = m_time_out;
         }
+        else if(p_lock)   r_fsm_state = FSM_DTAD;  
+        else	          r_fsm_state = FSM_DT; 
         break;
     }
     } // end switch FSM
+
+    // new allocation
+    if ( granted < m_nb_master )
+    {
+        r_prev_master = r_current_master.read();
+        if ( (m_policy == PIBUS_ARB_WEIGHTED_RR) && (granted == r_current_master.read()) && 
+             (r_credit.read() != 0) ) r_credit = r_credit - 1;
+        else                          r_credit = m_weight[granted] - 1;
+        r_current_master = granted;
+        r_req_counter[granted] = r_req_counter[granted] + 1;
+    }
+
+    // TDMA frame
+    uint32_t slot_cycle = (r_slot_cycle.read() + skip) % (m_frame_slots * m_slot_cycles);
+    if ( slot_cycle == (m_frame_slots * m_slot_cycles) - 1 ) r_slot_cycle = 0;
+    else                                                   r_slot_cycle = slot_cycle + 1;
+
+    // token buckets
+    for(size_t i = 0 ; i < m_nb_master ; i++) 
+    {
+        if ( m_tb_period[i] == 0 ) continue;
+        uint32_t tokens = r_tb_tokens[i].read() + (r_tb_timer[i].read() + skip) / m_tb_period[i];
+        uint32_t timer  = (r_tb_timer[i].read() + skip) % m_tb_period[i];
+        if ( tokens > m_tb_depth[i] ) tokens = m_tb_depth[i];
+        if ( timer == m_tb_period[i] - 1 )
+        {
+            r_tb_timer[i] = 0;
+            if ( tokens < m_tb_depth[i] ) tokens++;
+        }
+        else
+        {
+            r_tb_timer[i] = timer + 1;
+        }
+        if ( i == granted ) tokens--;
+        r_tb_tokens[i] = tokens;
+    }
+
+    // instrumentation : arbitration wait & transaction duration histograms
+    c_cycles++;
+    for(size_t i = 0 ; i < m_nb_master ; i++) 
+    {
+        if ( p_req[i] ) c_cur_wait[i]++;
+    }
+    if ( granted < m_nb_master )
+    {
+        c_wait_hist[granted*PIBUS_BCU_HIST_BUCKETS + bucket(c_cur_wait[granted] - 1)]++;
+        c_cur_wait[granted] = 0;
+    }
+    if ( ((r_fsm_state == FSM_DTAD) || (r_fsm_state == FSM_DT) || (r_fsm_state == FSM_DT_AD)) &&
+         (p_ack.read() == PIBUS_ACK_READY) ) c_words++;
+    if ( r_fsm_state == FSM_DT_AD )     // end of the previous transaction
+    {
+        c_master_hist[r_prev_master.read()*PIBUS_BCU_HIST_BUCKETS + bucket(c_cur_cycles + 1)]++;
+        c_target_hist[c_cur_target*PIBUS_BCU_HIST_BUCKETS + bucket(c_cur_cycles + 1)]++;
+        c_cur_cycles = 0;
+    }
+    if ( (r_fsm_state == FSM_AD) || (r_fsm_state == FSM_DT_AD) ) 
+        c_cur_target = m_target_table[p_a.read() >> m_msb_shift];
+    if ( r_fsm_state != FSM_IDLE ) 
+    {
+        c_cur_cycles++;
+        c_util_busy++;
+        c_util_target[c_cur_target]++;
+        bool last = (r_tout_counter == 0) ||
+                    ((r_fsm_state == FSM_DT)   && (p_ack.read() != PIBUS_ACK_WAIT)) || 
+                    ((r_fsm_state == FSM_DTAD) && (p_ack.read() == PIBUS_ACK_RETRY));
+        if ( last && (r_fsm_state != FSM_AD) && (r_fsm_state != FSM_DT_AD) )
+        {
+            c_master_hist[r_current_master.read()*PIBUS_BCU_HIST_BUCKETS + bucket(c_cur_cycles)]++;
+            c_target_hist[c_cur_target*PIBUS_BCU_HIST_BUCKETS + bucket(c_cur_cycles)]++;
+            c_cur_cycles = 0;
+        }
+    }
+
+    // instrumentation : utilization sampling
+    if ( m_util_period != 0 )
+    {
+        c_util_cycles++;
+        if ( c_util_cycles == m_util_period )
+        {
+            m_util_busy.push_back(c_util_busy);
+            for(size_t t = 0 ; t < m_nb_target ; t++) 
+            {
+                m_util_target.push_back(c_util_target[t]);
+                c_util_target[t] = 0;
+            }
+            c_util_cycles = 0;
+            c_util_busy   = 0;
+        }
+    }
 } // end transition
 
+/////////////////////////////////////////////////////////////////////
+// idle cycles : the BCU is idle when the bus is not used and no 
+// master is requesting, or when the current target answers WAIT 
+// (until the time-out). The number of idle cycles is limited by the
+// end of the current utilization sampling period.
+/////////////////////////////////////////////////////////////////////
+uint32_t PibusSegBcu::idleCycles()
+{
+    uint32_t idle = 0;
+
+    if ( r_fsm_state == FSM_IDLE )
+    {
+        idle = PIBUS_IDLE_FOREVER;
+        for(size_t i = 0 ; i < m_nb_master ; i++) 
+        {
+            if ( p_req[i] ) idle = 0;
+        }
+    }
+    else if ( ((r_fsm_state == FSM_DT) || (r_fsm_state == FSM_DTAD)) &&
+              (p_ack.read() == PIBUS_ACK_WAIT) && (r_tout_counter.read() != 0) )
+    {
+        idle = r_tout_counter.read() - 1;
+    }
+
+    if ( (m_util_period != 0) && (idle > m_util_period - 1 - c_util_cycles) ) 
+        idle = m_util_period - 1 - c_util_cycles;
+    return idle;
+}
+
+/////////////////////////////////////////////////////////////////////
+// skip idle cycles : the instrumentation counters are updated here,
+// and the registers are updated by the next transition.
+/////////////////////////////////////////////////////////////////////
+void PibusSegBcu::skipCycles(uint32_t ncycles)
+{
+    m_skip = ncycles;
+    c_cycles = c_cycles + ncycles;
+    for(size_t i = 0 ; i < m_nb_master ; i++) 
+    {
+        if ( p_req[i] ) c_cur_wait[i] = c_cur_wait[i] + ncycles;
+    }
+    if ( r_fsm_state != FSM_IDLE ) 
+    {
+        c_cur_cycles = c_cur_cycles + ncycles;
+        c_util_busy  = c_util_busy + ncycles;
+        c_util_target[c_cur_target] = c_util_target[c_cur_target] + ncycles;
+    }
+    if ( m_util_period != 0 ) c_util_cycles = c_util_cycles + ncycles;
+}
+
 ////////////////////////////////
 void PibusSegBcu::genMealy_gnt()
 {
-    bool	found = false;
-    if( (r_fsm_state == FSM_IDLE) || ((r_fsm_state == FSM_DT) && (p_ack.read() != PIBUS_ACK_WAIT)) ) 
+    if( allocation() ) 
     {
+        size_t granted = select();
         for(size_t i = 0 ; i < m_nb_master ; i++) 
         {
-            int j = (i + 1 + r_current_master) % m_nb_master;
-            if((p_req[j] == true) && (found == false)) 
-            {
-                p_gnt[j] = true;
-                found = true;
-            } 
-            else 
-            {
-                p_gnt[j] = false;
-            }
+            p_gnt[i] = (i == granted);
         } 
     } 
     else 
@@ -217,7 +614,7 @@ void PibusSegBcu::genMealy_gnt()
 ////////////////////////////////
 void PibusSegBcu::genMealy_sel()
 {
-    if((r_fsm_state == FSM_AD) || (r_fsm_state == FSM_DTAD)) 
+    if((r_fsm_state == FSM_AD) || (r_fsm_state == FSM_DTAD) || (r_fsm_state == FSM_DT_AD)) 
     {
         size_t index = m_target_table[p_a.read() >> m_msb_shift];
         for(size_t i = 0; i < m_nb_target ; i++) 
@@ -239,7 +636,7 @@ void PibusSegBcu::genMealy_sel()
 void PibusSegBcu::genMoore() 
 {
     p_tout = (r_tout_counter == 0);
-    p_avalid = (r_fsm_state == FSM_AD) || (r_fsm_state == FSM_DTAD);
+    p_avalid = (r_fsm_state == FSM_AD) || (r_fsm_state == FSM_DTAD) || (r_fsm_state == FSM_DT_AD);
 }
 
 //////////////////////////////
@@ -247,21 +644,12 @@ void PibusSegBcu::printTrace()
 {
     std::cout << m_name << " : fsm = " << m_fsm_str[r_fsm_state] << std::dec;
 
-    if( (r_fsm_state == FSM_IDLE) || ((r_fsm_state == FSM_DT) && (p_ack.read() != PIBUS_ACK_WAIT)) ) 
+    if( allocation() ) 
     {
-        bool found = false;
-        size_t  index;
-        for(size_t i=0 ; (i<m_nb_master) and (found == false) ; i++) 
-        {
-            index = (i + 1 + r_current_master) % m_nb_master;
-            if( p_req[index] == true )
-            {
-                std::cout << " | granted master = " << index;
-                found = true;
-            }
-        } 
+        size_t index = select();
+        if ( index < m_nb_master ) std::cout << " | granted master = " << index;
     }
-    if( (r_fsm_state == FSM_AD) || (r_fsm_state == FSM_DTAD) ) 
+    if( (r_fsm_state == FSM_AD) || (r_fsm_state == FSM_DTAD) || (r_fsm_state == FSM_DT_AD) ) 
     {
         size_t index = m_target_table[p_a.read() >> m_msb_shift];
         std::cout << " | selected target = " << index; 
@@ -272,14 +660,115 @@ void PibusSegBcu::printTrace()
 ///////////////////////////////////
 void PibusSegBcu::printStatistics()
 {
-    std::cout << m_name << " : Statistics" << std::endl;
+    std::cout << m_name << " : Statistics (" << m_policy_str[m_policy] << ")" << std::endl;
     for(size_t i = 0 ; i < m_nb_master ; i++) 
     {
         size_t req  = r_req_counter[i].read();
         size_t wait = r_wait_counter[i].read();
         std::cout << "master " << i << " : n_req = " << req << " , n_wait_cycles = " << wait
-                  << " , access time = " <<  (float)wait/(float)req << std::endl;
+                  << " , access time = " <<  (float)wait/(float)req;
+        if ( r_retry_counter[i].read() ) 
+            std::cout << " , n_retry = " << r_retry_counter[i].read();
+        std::cout << std::endl;
+    }
+    if ( c_cycles )
+    std::cout << "bus throughput = " << (float)c_words/(float)c_cycles << " words/cycle" << std::endl;
+}
+
+///////////////////////////////////////////////////////////
+void PibusSegBcu::saveStatistics(const char* filename)
+{
+    FILE*	file = fopen(filename, "w");
+    if ( file == NULL )
+    {
+	    std::cout << "ERROR in PibusSegBcu Component" << std::endl;
+        std::cout << "Cannot open statistics file " << filename << std::endl;
+        exit(0);
+    }
+    size_t	len  = strlen(filename);
+    bool	json = (len > 5) && (strcmp(filename + len - 5, ".json") == 0);
+    size_t	nsamples = m_util_busy.size();
+
+    if ( json )
+    {
+        fprintf(file, "{\n  \"name\": \"%s\",\n  \"cycles\": %u,\n  \"words\": %u,\n  \"buckets\": [", 
+                m_name, c_cycles, c_words);
+        for(size_t b = 0 ; b < PIBUS_BCU_HIST_BUCKETS ; b++) 
+            fprintf(file, "%s%u", b ? ", " : "", b ? (1 << (b-1)) : 0);
+        fprintf(file, "],\n  \"masters\": [\n");
+        for(size_t i = 0 ; i < m_nb_master ; i++) 
+        {
+            fprintf(file, "    { \"index\": %lu, \"requests\": %u, \"wait_cycles\": %u, \"retries\": %u,\n",
+                    (unsigned long)i, r_req_counter[i].read(), r_wait_counter[i].read(), r_retry_counter[i].read());
+            fprintf(file, "      \"wait_hist\": [");
+            for(size_t b = 0 ; b < PIBUS_BCU_HIST_BUCKETS ; b++) 
+                fprintf(file, "%s%u", b ? ", " : "", c_wait_hist[i*PIBUS_BCU_HIST_BUCKETS + b]);
+            fprintf(file, "],\n      \"duration_hist\": [");
+            for(size_t b = 0 ; b < PIBUS_BCU_HIST_BUCKETS ; b++) 
+                fprintf(file, "%s%u", b ? ", " : "", c_master_hist[i*PIBUS_BCU_HIST_BUCKETS + b]);
+            fprintf(file, "] }%s\n", (i == m_nb_master - 1) ? "" : ",");
+        }
+        fprintf(file, "  ],\n  \"targets\": [\n");
+        for(size_t t = 0 ; t < m_nb_target ; t++) 
+        {
+            fprintf(file, "    { \"index\": %lu, \"duration_hist\": [", (unsigned long)t);
+            for(size_t b = 0 ; b < PIBUS_BCU_HIST_BUCKETS ; b++) 
+                fprintf(file, "%s%u", b ? ", " : "", c_target_hist[t*PIBUS_BCU_HIST_BUCKETS + b]);
+            fprintf(file, "] }%s\n", (t == m_nb_target - 1) ? "" : ",");
+        }
+        fprintf(file, "  ],\n  \"utilization\": {\n    \"period\": %u,\n    \"bus\": [", m_util_period);
+        for(size_t k = 0 ; k < nsamples ; k++) 
+            fprintf(file, "%s%u", k ? ", " : "", m_util_busy[k]);
+        fprintf(file, "],\n    \"targets\": [");
+        for(size_t t = 0 ; t < m_nb_target ; t++) 
+        {
+            fprintf(file, "%s[", t ? ", " : "");
+            for(size_t k = 0 ; k < nsamples ; k++) 
+                fprintf(file, "%s%u", k ? ", " : "", m_util_target[k*m_nb_target + t]);
+            fprintf(file, "]");
+        }
+        fprintf(file, "]\n  }\n}\n");
+    }
+    else
+    {
+        // histograms : one line per master or target
+        fprintf(file, "histogram,index");
+        for(size_t b = 0 ; b < PIBUS_BCU_HIST_BUCKETS ; b++) 
+            fprintf(file, ",%u", b ? (1 << (b-1)) : 0);
+        fprintf(file, "\n");
+        for(size_t i = 0 ; i < m_nb_master ; i++) 
+        {
+            fprintf(file, "master_wait,%lu", (unsigned long)i);
+            for(size_t b = 0 ; b < PIBUS_BCU_HIST_BUCKETS ; b++) 
+                fprintf(file, ",%u", c_wait_hist[i*PIBUS_BCU_HIST_BUCKETS + b]);
+            fprintf(file, "\nmaster_duration,%lu", (unsigned long)i);
+            for(size_t b = 0 ; b < PIBUS_BCU_HIST_BUCKETS ; b++) 
+                fprintf(file, ",%u", c_master_hist[i*PIBUS_BCU_HIST_BUCKETS + b]);
+            fprintf(file, "\n");
+        }
+        for(size_t t = 0 ; t < m_nb_target ; t++) 
+        {
+            fprintf(file, "target_duration,%lu", (unsigned long)t);
+            for(size_t b = 0 ; b < PIBUS_BCU_HIST_BUCKETS ; b++) 
+                fprintf(file, ",%u", c_target_hist[t*PIBUS_BCU_HIST_BUCKETS + b]);
+            fprintf(file, "\n");
+        }
+        // utilization : one line per sample
+        if ( nsamples )
+        {
+            fprintf(file, "\ncycle,bus");
+            for(size_t t = 0 ; t < m_nb_target ; t++) fprintf(file, ",target%lu", (unsigned long)t);
+            fprintf(file, "\n");
+            for(size_t k = 0 ; k < nsamples ; k++) 
+            {
+                fprintf(file, "%lu,%u", (unsigned long)((k+1)*m_util_period), m_util_busy[k]);
+                for(size_t t = 0 ; t < m_nb_target ; t++) 
+                    fprintf(file, ",%u", m_util_target[k*m_nb_target + t]);
+                fprintf(file, "\n");
+            }
+        }
     }
+    fclose(file);
 }
 
 #ifdef SOCVIEW
@@ -11,21 +11,44 @@
 // Each segment is defined by a BASE address and a SIZE
 // (the SIZE is a number of bytes)
 // Both the BASE and SIZE must be multiple of 4 bytes.
-// Each segment is implemented by a table of "int" dynamically
-// allocated by the RAM constructor.
+// The segments are implemented by a PibusMemoryImage (private mapping
+// of the loaded image, remapped by the reset, page indexed address
+// decoding) : see pibus_memory_image.h.
 // This component checks address for segmentation violation.
 // In case of burst, all addresses must be in the same segment,
 // and it is forbidden to mix read and write accesses in
 // a single burst.
+// For a write burst, the OPC field can contain a burst length
+// (WD2/WD4/WD8/WD16/WD32) : all words are fully written.
 // The number of wait cycles at the beginning of a transaction 
 // is a parameter (The value can be 0).
+// The memory content can be accessed without PIBUS transaction,
+// through the PibusFunctionalMemory interface (fast-forward mode).
+// When the retry argument is true (and the latency is not 0), the RAM
+// uses split transactions instead of wait cycles : a new request is
+// registered (address and READ value) and the RAM answers RETRY to
+// release the bus. The latency is counted while the bus is used by 
+// other transactions, and the request is served without wait cycle 
+// when the master restarts it. Only one request can be registered : 
+// the other requests are answered RETRY until the registered one is 
+// served (or discarded after PIBUS_RETRY_EXPIRE cycles).
+// When the latency is 0, each selected address is decoded as a new
+// transaction, including in the last data cycle : the RAM can be
+// declared as a pipelined target of the PibusSegBcu (address cycle of
+// the next transaction overlapped with the last data cycle). In this
+// case, a burst is not checked against the segment of its first address.
+// The RAM implements the PibusIdleSkip interface : it is idle when it is
+// not selected, and during the latency cycles.
+// The RAM implements the PibusCheckpointable interface : the segments
+// are saved as memory images (see PibusMemoryImage).
 ///////////////////////////////////////////////////////////////////////// 
-// This component has 4 "generator" parameters
+// This component has 6 "generator" parameters
 // - sc_module_name		name    : instance name
 // - unsigned int  		index   : target index      
 // - pibusSegmentTable		segmap  : segment table
 // - int			latency	: number of wait cycles
 // - soclib::common::Loader	loader  : loader
+// - bool			retry	: split transactions (default = false)
 /////////////////////////////////////////////////////////////////////////
 
 #ifndef PIBUS_SIMPLE_RAM_H
@@ -35,13 +58,16 @@
 #include <stdio.h>
 #include "pibus_segment_table.h"
 #include "pibus_mnemonics.h"
+#include "pibus_checkpoint.h"
+#include "pibus_memory_image.h"
 #include "loader.h"
 
-#define MAXSEG 	16
-
 namespace soclib { namespace caba {
 
-class PibusSimpleRam : sc_core::sc_module {
+class PibusSimpleRam : sc_core::sc_module, 
+                       public soclib::common::PibusFunctionalMemory,
+                       public soclib::common::PibusIdleSkip,
+                       public soclib::common::PibusCheckpointable {
 
    //  REGISTERS
     sc_register<int>		r_fsm_state;		// FSM state
@@ -49,21 +75,22 @@ class PibusSimpleRam : sc_core::sc_module {
     sc_register<size_t>		r_index;		// Selected segment index
     sc_register<uint32_t>	r_address;		// PIBUS address
     sc_register<int>		r_opc;			// PIBUS codop 
-    uint32_t*			r_buf[MAXSEG];		// segment buffers
+    sc_register<bool>		r_pend_valid;		// registered request (split transaction)
+    sc_register<uint32_t>	r_pend_addr;		// registered request address
+    sc_register<bool>		r_pend_read;		// registered request READ value
+    sc_register<uint32_t>	r_pend_counter;		// cycles since the request registration
 
     //  STRUCTURAL PARAMETERS
     const char*			m_name;			// instance name
     const uint32_t    	 	m_tgtid;		// target index
-    size_t      		m_nbseg;		// segment number
-    uint32_t    		m_segsize[MAXSEG];	// segment sizes
-    uint32_t   			m_segbase[MAXSEG];	// segment bases
-    const char*			m_segname[MAXSEG];	// segment names
+    soclib::common::PibusMemoryImage m_mem;		// segments
     const uint32_t		m_latency;		// intrinsic latency
-    soclib::common::Loader	m_loader;		// loader
-    char			m_fsm_str[6][20];	// FSM states names
+    const bool			m_retry;		// split transactions activated
+    char			m_fsm_str[7][20];	// FSM states names
     bool			m_monitor_ok;		// monitor activated
     uint32_t			m_monitor_base;		// monitored segment base
     uint32_t			m_monitor_length; 	// monitored segment length
+    uint32_t			m_skip;			// skipped idle cycles
 
     // FSM states
     enum {
@@ -72,9 +99,13 @@ class PibusSimpleRam : sc_core::sc_module {
 	FSM_READ_OK	= 2,
 	FSM_WRITE_WAIT	= 3,
 	FSM_WRITE_OK	= 4,
-	FSM_ERROR	= 5
+	FSM_ERROR	= 5,
+	FSM_RETRY	= 6
     };
 
+    //  METHODS
+    void decode();
+
 protected:
 
     SC_HAS_PROCESS(PibusSimpleRam);
@@ -97,7 +128,8 @@ public:
 		uint32_t	         		tgtid,
 		soclib::common::PibusSegmentTable	&segtab,
 		uint32_t				latency, 	
-                const soclib::common::Loader  		&loader = soclib::common::Loader() );
+                const soclib::common::Loader  		&loader = soclib::common::Loader(),
+		bool					retry = false );
     // methods
     void transition();
     void genMoore();
@@ -105,6 +137,17 @@ public:
     void startMonitor(uint32_t base, uint32_t length);
     void stopMonitor();
 
+    // functional access
+    bool functionalRead(uint32_t address, uint32_t* data);
+    bool functionalWrite(uint32_t address, uint32_t data, uint32_t be);
+
+    // idle cycles skipping
+    uint32_t idleCycles();
+    void skipCycles(uint32_t ncycles);
+
+    // checkpoint
+    void checkpoint(soclib::common::PibusCheckpoint& ckpt);
+
 };  // end class PibusSimpleRam
 
 }} // end name spaces
@@ -19,11 +19,14 @@ PibusSimpleRam::PibusSimpleRam (sc_module_name	 	name,
 				uint32_t		tgtid,
 				PibusSegmentTable	&segtab,
 				uint32_t		latency,
-				const Loader  		&loader)
+				const Loader  		&loader,
+				bool			retry)
     : m_name(name),
       m_tgtid(tgtid),
+      m_mem("PibusSimpleRam", name, segtab, tgtid, loader),
       m_latency(latency),
-      m_loader(loader),
+      m_retry(retry),
+      m_skip(0),
       p_ck("p_ck"),
       p_resetn("p_resetn"),
       p_sel("p_sel"),
@@ -40,186 +43,129 @@ PibusSimpleRam::PibusSimpleRam (sc_module_name	 	name,
     SC_METHOD (genMoore);
     sensitive_neg << p_ck;
 
-    // segments allocation
-    m_nbseg = 0;
-    std::list<SegmentTableEntry> seglist = segtab.getTargetSegmentList(tgtid);
-    std::list<SegmentTableEntry>::iterator iter;
-  
-    for (iter = seglist.begin() ; iter != seglist.end() ; ++iter) 
-    {
-    	uint32_t base = (*iter).getBase();
-    	uint32_t size = (*iter).getSize();
-        if(m_nbseg == MAXSEG) 
-        {
-	  	printf("ERROR in component PibusSimpleRam %s\n", m_name);
-	  	printf("The number of segments cannot be larger than %d\n",MAXSEG);
-		exit(1);
-	}
-	if((base & 0x00000003) != 0x0) 
-        {
-		printf("ERROR in component PibusSimpleRam %s\n", m_name);
-		printf("The segbase address must be word aligned\n");
-		exit(1);
-	}
-	if((size & 0x00000003) != 0x0) 
-        {
-		printf("ERROR in component PibusSimpleRam %s\n", m_name);
-		printf("The m_size parameter must be multiple of 4\n");
-		exit(1);
-	}
-	m_segname[m_nbseg]   = (*iter).getName(); 
-	m_segsize[m_nbseg]   = size;
-	m_segbase[m_nbseg]   = base;
-	r_buf[m_nbseg]       = new uint32_t[size >> 2];
-	m_nbseg              = m_nbseg+1;
-    } 
-
     strcpy(m_fsm_str[0], "IDLE");
     strcpy(m_fsm_str[1], "READ_WAIT");
     strcpy(m_fsm_str[2], "READ_OK");
     strcpy(m_fsm_str[3], "WRITE_WAIT");
     strcpy(m_fsm_str[4], "WRITE_OK");
     strcpy(m_fsm_str[5], "ERROR");
+    strcpy(m_fsm_str[6], "RETRY");
 
     std::cout << std::endl << "Instanciation of PibusSimpleRam : " << m_name << std::endl;
     std::cout << "    latency = " << latency << std::endl;
-    for(uint32_t i = 0 ; i < m_nbseg ; i++) 
- 	std::cout << "    segment " << m_segname[i] << std::hex
-                  << " | base = 0x" << m_segbase[i]
-                  << " | size = 0x" << m_segsize[i] << std::endl;
+    if ( retry ) std::cout << "    split transactions" << std::endl;
+    for(uint32_t i = 0 ; i < m_mem.segments() ; i++) 
+ 	std::cout << "    segment " << m_mem.segName(i) << std::hex
+                  << " | base = 0x" << m_mem.base(i)
+                  << " | size = 0x" << m_mem.size(i) << std::endl;
 
 } // end constructor
 
-//////////////////////////////////////////////////////
-//	Functions used to manage the possible
-//	big-endianness of the simulation processor
-bool IsBigEndian()
-{
-    short int 	word = 0x0001;
-    char 	*byte = (char *) &word;
-    return(byte[0] ? false : true); 
-}
-
-int swap_bytes (int LE)
-{
-    int BE;
-    BE =   ((LE & 0xFF000000) >> 24 |
-            (LE & 0x00FF0000) >> 8  |
-            (LE & 0x0000FF00) << 8  |
-            (LE & 0x000000FF) << 24 ); 
-    return BE;
-}
-
-////////////////////////////////////////////////////////////////////////
-void write_seg(uint32_t* tab, size_t index, uint32_t data, uint32_t opc)
+//////////////////////////////////////////////////////////////
+// Decodes the address of a new transaction (the target is selected).
+//////////////////////////////////////////////////////////////
+void PibusSimpleRam::decode()
 {
-    // The memory organisation is litle endian
-    switch (opc) {
-    case PIBUS_OPC_BY0 :  // write byte 0 
-	tab[index] = (tab[index] & 0xFFFFFF00) | (data & 0x000000FF);
-        break;
-    case PIBUS_OPC_BY1 :  // write byte 1 
-	tab[index] = (tab[index] & 0xFFFF00FF) | (data & 0x0000FF00);
-        break;
-    case PIBUS_OPC_BY2 :  // write byte 2 
-	tab[index] = (tab[index] & 0xFF00FFFF) | (data & 0x00FF0000);
-        break;
-    case PIBUS_OPC_BY3 :  // write byte 3 
-	tab[index] = (tab[index] & 0x00FFFFFF) | (data & 0xFF000000);
-        break;
-    case PIBUS_OPC_HW0 :  // write lower half  
-	tab[index] = (tab[index] & 0xFFFF0000) | (data & 0x0000FFFF);
-        break;
-    case PIBUS_OPC_HW1 :  // write upper half 
-	tab[index] = (tab[index] & 0x0000FFFF) | (data & 0xFFFF0000);
-        break;
-    case PIBUS_OPC_WDU :  // write word
-	tab[index] = data;
-        break;
-    case PIBUS_OPC_NOP :  // no write  
-        break;
-    default :
-	printf("ERROR in PibusSimpleRam\n");
-	printf("illegal value of the PIBUS OPC field for a WRITE : %0x\n", opc);
-	printf("the supported values are : BY0/BY1/BY2/BY3\n");
-	printf("                           HW0/HW1/WDU/NOP\n");
-	exit(1);
-	break;
-    } // end switch 
-} // end write_seg()
+    uint32_t address = ((uint32_t)p_a.read()) & 0xfffffffc; 
+    size_t seg = m_mem.segIndex(address);
+    bool error = (seg == m_mem.segments());
+    if ( error == false ) 
+    { 
+        r_index = seg;
+        r_address  = address;
+        r_opc   = (int) p_opc.read();
+    }
+    if((error == false) && m_retry && (m_latency != 0)) 
+    {
+        if ( r_pend_valid == false )	// register the request
+        {
+            r_pend_valid   = true;
+            r_pend_addr    = address;
+            r_pend_read    = p_read.read();
+            r_pend_counter = 0;
+            r_fsm_state    = FSM_RETRY;
+        }
+        else if ( (r_pend_addr.read() == address) && (r_pend_read.read() == p_read.read()) &&
+                  (r_pend_counter.read() >= m_latency) )	// registered request restarted
+        {
+            r_pend_valid   = false;
+            if(p_read == true)  r_fsm_state = FSM_READ_OK;
+            else                r_fsm_state = FSM_WRITE_OK;
+        }
+        else
+        {
+            r_fsm_state    = FSM_RETRY;
+        }
+    }
+    else if(error == false) 
+    {
+        r_counter = m_latency;
+        if((p_read == true)  && (m_latency == 0))  r_fsm_state = FSM_READ_OK; 
+        if((p_read == true)  && (m_latency != 0))  r_fsm_state = FSM_READ_WAIT; 
+        if((p_read == false) && (m_latency == 0))  r_fsm_state = FSM_WRITE_OK; 
+        if((p_read == false) && (m_latency != 0))  r_fsm_state = FSM_WRITE_WAIT; 
+    } 
+    else 
+    {
+        r_fsm_state = FSM_ERROR;
+    }
+} // end decode()
 
 /////////////////////////////////
 void PibusSimpleRam::transition()
 {
+    // skipped idle cycles (see skipCycles())
+    uint32_t skip = m_skip;
+    m_skip = 0;
+
     if (p_resetn == false) 
     {
         m_monitor_ok = false;
         r_fsm_state  = FSM_IDLE;
-        for ( size_t seg = 0 ; seg < m_nbseg ; seg++ )
-        {
-            memset( &r_buf[seg][0], 0, m_segsize[seg] );
-            m_loader.load( &r_buf[seg][0], m_segbase[seg], m_segsize[seg] );
-            if (IsBigEndian())  
-            {
-                for( size_t word = 0; word < (m_segsize[seg] >> 2); word++) 
-                  r_buf[seg][word] = swap_bytes(r_buf[seg][word]);
-            }
-        }
+        r_pend_valid = false;
+        m_mem.reset();
         return;
     } // end p_resetn
 
+    // registered request (split transaction) : the latency is counted
+    // in parallel with the other transactions
+    if ( r_pend_valid.read() )
+    {
+        uint32_t pend = r_pend_counter.read() + skip;
+        if ( pend == m_latency + PIBUS_RETRY_EXPIRE ) r_pend_valid   = false;
+        else                                         r_pend_counter = pend + 1;
+    }
+
     switch (r_fsm_state) {
     case FSM_IDLE :
     {
-        if (p_sel == true) 
-        {
-            uint32_t address = ((uint32_t)p_a.read()) & 0xfffffffc; 
-            bool error = true;
-            for (size_t i = 0 ; ((i < m_nbseg) && (error == true)) ; i++) 
-            { 
-                if ((address >= m_segbase[i]) && (address < m_segbase[i] + m_segsize[i])) 
-                { 
-                    error=false;
-                    r_index = i;
-                    r_address  = address;
-                    r_opc   = (int) p_opc.read();
-                    
-                }  
-            }
-            if(error == false) 
-            {
-                r_counter = m_latency;
-                if((p_read == true)  && (m_latency == 0))  r_fsm_state = FSM_READ_OK; 
-                if((p_read == true)  && (m_latency != 0))  r_fsm_state = FSM_READ_WAIT; 
-                if((p_read == false) && (m_latency == 0))  r_fsm_state = FSM_WRITE_OK; 
-                if((p_read == false) && (m_latency != 0))  r_fsm_state = FSM_WRITE_WAIT; 
-            } 
-            else 
-            {
-                r_fsm_state = FSM_ERROR;
-            }
-        }
+        if (p_sel == true) decode();
         break;
     }
     case FSM_ERROR :
+    case FSM_RETRY :
     {
 	r_fsm_state = FSM_IDLE;
+        if ((p_sel == true) && (m_latency == 0)) decode();	// pipelined transaction
         break;
     }
     case FSM_READ_WAIT :
     {
-	r_counter = r_counter - 1;
-	if(r_counter == 1)  r_fsm_state = FSM_READ_OK; 
+        uint32_t counter = r_counter.read() - skip;
+	r_counter = counter - 1;
+	if(counter == 1)  r_fsm_state = FSM_READ_OK; 
         break;
     }
     case FSM_READ_OK :
     {
-	if (p_sel == true) 
+	if ((p_sel == true) && (m_latency == 0))	// burst or pipelined transaction
+        {
+            decode();
+        }
+	else if (p_sel == true) 
         {
             uint32_t address = ((uint32_t)p_a.read()) & 0xfffffffc; 
-            if ((address < m_segbase[r_index]) ||
-                ((address >= (m_segbase[r_index] + m_segsize[r_index])) ||
-                (p_read == false))) 
+            if (!m_mem.contains(r_index.read(), address) || (p_read == false)) 
             { 
                 r_fsm_state = FSM_ERROR;
             } 
@@ -236,15 +182,15 @@ void PibusSimpleRam::transition()
     }
     case FSM_WRITE_WAIT :
     {
-        r_counter = r_counter - 1;
-        if(r_counter == 1)  r_fsm_state = FSM_WRITE_OK; 
+        uint32_t counter = r_counter.read() - skip;
+        r_counter = counter - 1;
+        if(counter == 1)  r_fsm_state = FSM_WRITE_OK; 
         break;
     }
     case FSM_WRITE_OK :   
     {
 	uint32_t data     = (uint32_t)p_d.read(); 
         uint32_t address  = r_address.read();
-        uint32_t word     = (r_address.read() - m_segbase[r_index.read()]) >> 2;
 
         if ( m_monitor_ok )
         {
@@ -256,13 +202,15 @@ void PibusSimpleRam::transition()
             }
         } 
 
-  	write_seg(r_buf[r_index], word, data, r_opc);
-	if (p_sel == true) 
+  	m_mem.write(r_index.read(), address, data, r_opc.read());
+	if ((p_sel == true) && (m_latency == 0))	// burst or pipelined transaction
+        {
+            decode();
+        }
+	else if (p_sel == true) 
         { 
 	    uint32_t address = ((uint32_t)p_a.read()) & 0xfffffffc; 
-	    if ((address < m_segbase[r_index]) || 
-		    (address >= m_segbase[r_index] + m_segsize[r_index]) ||
-		    (p_read == true)) 
+	    if (!m_mem.contains(r_index.read(), address) || (p_read == true)) 
             { 
                 r_fsm_state = FSM_ERROR;	
             } 
@@ -289,13 +237,16 @@ void PibusSimpleRam::genMoore()
     case FSM_ERROR : 
         p_ack = PIBUS_ACK_ERROR;
         break;
+    case FSM_RETRY : 
+        p_ack = PIBUS_ACK_RETRY;
+        break;
     case FSM_READ_WAIT :
         p_ack = PIBUS_ACK_WAIT;
         p_d = 0;
         break;
     case FSM_READ_OK :
         p_ack = PIBUS_ACK_READY;
-        p_d = r_buf[r_index][(r_address.read() - m_segbase[r_index]) >> 2];
+        p_d = m_mem.word(r_index.read(), r_address.read());
         break;
     case FSM_WRITE_WAIT :
         p_ack = PIBUS_ACK_WAIT;
@@ -309,23 +260,11 @@ void PibusSimpleRam::genMoore()
 /////////////////////////////////////////////////
 void PibusSimpleRam::printTrace(uint32_t address)
 {
-    bool error = true;
-    size_t index;
-
     if ( address )
     {
-        for (size_t i = 0 ; ((i < m_nbseg) && (error == true)) ; i++) 
-        { 
-            if ((address >= m_segbase[i]) && (address < m_segbase[i] + m_segsize[i])) 
-            { 
-                error = false;
-                index = i;
-                break;
-            }  
-        }
-        if ( not error )
+        uint32_t data;
+        if ( m_mem.functionalRead(address, &data) )
         {
-            uint32_t data = r_buf[index][(address - m_segbase[index]) >> 2];
             std::cout << m_name << " : address = " << std::hex << address
                       << " data = " <<  data << std::endl;
         }
@@ -353,4 +292,63 @@ void PibusSimpleRam::stopMonitor()
     m_monitor_ok	= false;
 }
 
+//////////////////////////////////////////////////////////////////////
+// functional read : returns false if the address is not in a segment
+bool PibusSimpleRam::functionalRead(uint32_t address, uint32_t* data)
+{
+    return m_mem.functionalRead(address, data);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// functional write : the be argument defines the written bytes.
+// returns false if the address is not in a segment
+bool PibusSimpleRam::functionalWrite(uint32_t address, uint32_t data, uint32_t be)
+{
+    if ( !m_mem.functionalWrite(address, data, be) ) return false;
+    if ( m_monitor_ok and 
+         (address >= m_monitor_base) and
+         (address <  m_monitor_base + m_monitor_length) )
+    {
+        std::cout << " RAM Change : address = " << std::hex << address
+                  << " / data = " << data << std::endl;
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// idle cycles : the RAM is idle when it is not selected, or when it
+// counts the latency cycles. The registered request (split transaction)
+// limits the number of idle cycles to its expiration.
+uint32_t PibusSimpleRam::idleCycles()
+{
+    uint32_t idle;
+    int state = r_fsm_state.read();
+
+    if      ( (state == FSM_IDLE) && !p_sel.read() )	idle = PIBUS_IDLE_FOREVER;
+    else if ( (state == FSM_READ_WAIT) || (state == FSM_WRITE_WAIT) ) idle = r_counter.read() - 1;
+    else						idle = 0;
+
+    if ( r_pend_valid.read() )
+    {
+        uint32_t expire = m_latency + PIBUS_RETRY_EXPIRE - r_pend_counter.read();
+        if ( expire < idle ) idle = expire;
+    }
+    return idle;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// skip idle cycles : the counters are updated by the next transition
+void PibusSimpleRam::skipCycles(uint32_t ncycles)
+{
+    m_skip = ncycles;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// checkpoint : the segments are saved as memory images
+void PibusSimpleRam::checkpoint(PibusCheckpoint& ckpt)
+{
+    ckpt.section(m_name);
+    m_mem.checkpoint(ckpt);
+}
+
 }} // end namespaces
@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////
+// File : pibus_trace_format.h
+// Copyright : UPMC - LIP6
+// This program is released under the GNU public license
+///////////////////////////////////////////////////////////////////////////
+// This file defines the binary format of the PIBUS transaction traces,
+// written by the PibusTraceRecorder component, and read by the
+// pibus_trace_analyzer tool. It does not depend on SystemC.
+//
+// The file starts with the 4 bytes "PIBT", followed by the format
+// version, the number of masters and the number of targets.
+// Each transaction is then described by a variable length record :
+// - start		: address cycle, relative to the previous record start
+// - flags		: OPC (bits 3:0) / ACK (bits 6:4) / READ (bit 7)
+// - master		: master index
+// - target		: target index
+// - address		: first address, relative to the previous address
+//			  of the same master (signed value)
+// - words		: number of transfered words
+// - duration		: number of cycles (from the address cycle to
+//			  the last cycle)
+// - wait		: number of arbitration wait cycles
+// All values are encoded as unsigned LEB128 (7 bits per byte, the
+// MSB bit indicating that another byte follows), and the signed
+// address difference is zigzag encoded. A record uses at least 8 bytes,
+// and about 12 bytes in practice : the flags of a read use 2 bytes, and
+// the address difference between two transactions of the same master
+// (interleaved instruction and data accesses) uses several bytes.
+///////////////////////////////////////////////////////////////////////////
+
+#ifndef PIBUS_TRACE_FORMAT_H
+#define PIBUS_TRACE_FORMAT_H
+
+#include <stdio.h>
+#include <inttypes.h>
+
+#define PIBUS_TRACE_MAGIC	"PIBT"
+#define PIBUS_TRACE_VERSION	1
+
+// ACK field value for a transaction aborted by the BCU time-out
+// (the other values are the PIBUS_ACK codes)
+#define PIBUS_TRACE_TIMEOUT	4
+
+namespace soclib { namespace common {
+
+/////////////////////////////////
+struct PibusTraceRecord
+{
+    uint64_t	start;		// address cycle
+    uint32_t	master;		// master index
+    uint32_t	target;		// target index
+    uint32_t	address;	// first address
+    uint32_t	opc;		// PIBUS OPC
+    uint32_t	ack;		// last ACK (or PIBUS_TRACE_TIMEOUT)
+    bool	read;		// read transaction
+    uint32_t	words;		// number of transfered words
+    uint32_t	duration;	// number of cycles
+    uint32_t	wait;		// arbitration wait cycles
+};
+
+///////////////////////////////////////////////////////////////////
+// writes an unsigned LEB128 value in buf, returns the byte count
+inline size_t pibusTracePut(uint8_t* buf, uint64_t value)
+{
+    size_t n = 0;
+    while ( value >= 0x80 )
+    {
+        buf[n++] = (uint8_t)(value | 0x80);
+        value = value >> 7;
+    }
+    buf[n++] = (uint8_t)value;
+    return n;
+}
+
+///////////////////////////////////////////////////////////////////
+// reads an unsigned LEB128 value, returns false at end of file
+inline bool pibusTraceGet(FILE* file, uint64_t* value)
+{
+    uint64_t	v     = 0;
+    size_t	shift = 0;
+    int		c;
+    do
+    {
+        c = getc(file);
+        if ( (c == EOF) || (shift > 63) ) return false;
+        v = v | ((uint64_t)(c & 0x7F) << shift);
+        shift = shift + 7;
+    } while ( c & 0x80 );
+    *value = v;
+    return true;
+}
+
+inline uint32_t pibusTraceZigzag(int32_t v)  { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t  pibusTraceUnzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+}} // end namespaces
+
+#endif
+
@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////
+// File : pibus_trace_recorder.h
+// Copyright : UPMC - LIP6
+// This program is released under the GNU public license
+///////////////////////////////////////////////////////////////////////////
+// This component is a passive observer of the PIBUS, that records all
+// transactions in a compact binary file (defined in pibus_trace_format.h).
+// It is connected to the REQ, GNT and SEL signals of the BCU, and to the
+// shared A, READ, OPC, LOCK, ACK and TOUT signals. It reconstructs the
+// transactions with the same FSM as the PibusSegBcu (IDLE, AD, DTAD, DT,
+// DT_AD), and writes one record per transaction when it completes :
+// - start cycle, master index, target index,
+// - first address, READ, OPC,
+// - number of transfered words, last ACK value (or time-out),
+// - duration (from the address cycle to the last cycle),
+// - arbitration wait (number of cycles between the request and the grant).
+// The records are buffered, and the file is written by blocks of
+// TRACE_BUF_SIZE bytes : the recording overhead is a few operations per
+// cycle. The flush() method writes the buffered records (it is called
+// by the destructor). The pibus_trace_analyzer tool (tool directory)
+// builds the traffic reports from this file.
+// With a pipelined BCU, a master granted in the last address cycle of
+// a transaction (AD or DTAD state, LOCK = false) is the pipelined
+// allocation decided by the BCU pipelined() condition : the recorder
+// enters the DT_AD state, where the previous transaction is completed
+// and the address cycle of the new one is registered.
+// The recorder implements the PibusIdleSkip interface : the skipped
+// cycles are counted in the arbitration waits and durations.
+//////////////////////////////////////////////////////////////////////////
+// This component has 4 "constructor" parameters :
+// - sc_module_name	name		: instance name
+// - int 		nb_master       : number of PIBUS masters
+// - int 		nb_target       : number of PIBUS targets
+// - char*		filename	: trace file path name
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PIBUS_TRACE_RECORDER_H
+#define PIBUS_TRACE_RECORDER_H
+
+#include <systemc>
+#include <stdio.h>
+#include <inttypes.h>
+#include "pibus_mnemonics.h"
+#include "pibus_trace_format.h"
+
+#define TRACE_BUF_SIZE	65536
+
+namespace soclib { namespace caba {
+
+////////////////////////////////////////////////
+class PibusTraceRecorder : sc_core::sc_module, public soclib::common::PibusIdleSkip {
+
+	// 	FSM states (same as the BCU)
+	enum fms_state_e
+        {
+	FSM_IDLE	= 0,
+	FSM_AD		= 1,
+	FSM_DTAD	= 2,
+	FSM_DT		= 3,
+	FSM_DT_AD	= 4,
+	};
+
+	//	STRUCTURAL PARAMETERS
+        const char*			m_name;			// instance name
+	const size_t 			m_nb_master;		// number of observed masters
+	const size_t 			m_nb_target;		// number of observed targets
+	FILE*				m_file;			// trace file
+
+	//	OBSERVER STATE (no output : simple variables)
+	int				m_fsm_state;		// FSM state
+	uint64_t			m_cycle;		// cycles since reset
+	uint64_t			m_prev_start;		// previous record start cycle
+	uint32_t*			m_prev_addr;		// previous address (per master)
+	uint32_t*			m_wait;			// current arbitration wait (per master)
+	size_t				m_next_master;		// granted master (next address cycle)
+	uint32_t			m_next_wait;		// arbitration wait of the granted master
+	uint64_t			m_count;		// number of records
+	soclib::common::PibusTraceRecord	m_cur;		// current transaction
+	uint8_t				m_buf[TRACE_BUF_SIZE];	// output buffer
+	size_t				m_buf_ptr;		// number of bytes in buffer
+
+	//	METHODS
+	bool grant();
+	void address();
+	void record();
+
+protected:
+
+	SC_HAS_PROCESS(PibusTraceRecorder);
+
+public:
+
+	//	I/O PORTS
+	sc_core::sc_in<bool>  		p_ck;
+	sc_core::sc_in<bool>  		p_resetn;
+	sc_core::sc_in<bool>*		p_req;
+	sc_core::sc_in<bool>*		p_gnt;
+	sc_core::sc_in<bool>*		p_sel;
+	sc_core::sc_in<uint32_t>	p_a;
+	sc_core::sc_in<bool>		p_read;
+	sc_core::sc_in<uint32_t>	p_opc;
+	sc_core::sc_in<bool>		p_lock;
+	sc_core::sc_in<uint32_t>	p_ack;
+	sc_core::sc_in<bool>		p_tout;
+
+	//	CONSTRUCTOR
+	PibusTraceRecorder (sc_core::sc_module_name	name,
+			    size_t			nb_master,
+			    size_t			nb_target,
+			    const char*			filename);
+	~PibusTraceRecorder();
+
+	// 	METHODS
+	void transition();
+	void flush();
+	void printStatistics();
+	uint32_t idleCycles();
+	void skipCycles(uint32_t ncycles);
+
+}; // end class PibusTraceRecorder
+
+}} // end namespaces
+
+#endif
@@ -0,0 +1,285 @@
+////////////////////////////////////////////////////////////////////////////
+// File  : pibus_trace_recorder.cpp
+// Copyright  UPMC - LIP6
+// This program is released under the GNU public license
+///////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "pibus_trace_recorder.h"
+#include "alloc_elems.h"
+
+namespace soclib { namespace caba {
+
+using namespace sc_core;
+using namespace soclib::caba;
+using namespace soclib::common;
+
+////////////////////////////////////////////////////////////////////
+PibusTraceRecorder::PibusTraceRecorder (sc_module_name 	name,
+                                        size_t 		nb_master,
+                                        size_t 		nb_target,
+                                        const char*	filename)
+	: m_name(name),
+      m_nb_master(nb_master),
+      m_nb_target(nb_target),
+      p_ck("p_ck"),
+      p_resetn("p_resetn"),
+      p_req(soclib::common::alloc_elems<sc_in<bool> >("p_req", nb_master)),
+      p_gnt(soclib::common::alloc_elems<sc_in<bool> >("p_gnt", nb_master)),
+      p_sel(soclib::common::alloc_elems<sc_in<bool> >("p_sel", nb_target)),
+      p_a("p_a"),
+      p_read("p_read"),
+      p_opc("p_opc"),
+      p_lock("p_lock"),
+      p_ack("p_ack"),
+      p_tout("p_tout")
+{
+	SC_METHOD(transition);
+	sensitive << p_ck.pos();
+
+    m_file = fopen(filename, "wb");
+    if ( m_file == NULL )
+    {
+	    std::cout << "ERROR in PibusTraceRecorder Component" << std::endl;
+        std::cout << "Cannot open trace file " << filename << std::endl;
+        exit(0);
+    }
+
+    m_prev_addr = new uint32_t[nb_master];
+    m_wait      = new uint32_t[nb_master];
+    m_count     = 0;
+    m_buf_ptr   = 0;
+
+    // file header
+    memcpy(m_buf, PIBUS_TRACE_MAGIC, 4);
+    m_buf_ptr = 4;
+    m_buf_ptr += pibusTracePut(&m_buf[m_buf_ptr], PIBUS_TRACE_VERSION);
+    m_buf_ptr += pibusTracePut(&m_buf[m_buf_ptr], nb_master);
+    m_buf_ptr += pibusTracePut(&m_buf[m_buf_ptr], nb_target);
+
+    std::cout << std::endl << "Instanciation of PibusTraceRecorder : " << m_name << std::endl;
+    std::cout << "    nb_master = " << m_nb_master << std::endl;
+    std::cout << "    nb_target = " << m_nb_target << std::endl;
+    std::cout << "    file      = " << filename << std::endl;
+}
+
+PibusTraceRecorder::~PibusTraceRecorder()
+{
+    flush();
+    fclose(m_file);
+    soclib::common::dealloc_elems(p_req, m_nb_master);
+    soclib::common::dealloc_elems(p_gnt, m_nb_master);
+    soclib::common::dealloc_elems(p_sel, m_nb_target);
+    delete [] m_prev_addr;
+    delete [] m_wait;
+}
+
+////////////////////////////////
+void PibusTraceRecorder::flush()
+{
+    if ( m_buf_ptr ) fwrite(m_buf, 1, m_buf_ptr, m_file);
+    m_buf_ptr = 0;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Returns true if a master is granted in this cycle : its index and
+// arbitration wait are registered for the next address cycle.
+/////////////////////////////////////////////////////////////////////
+bool PibusTraceRecorder::grant()
+{
+    for(size_t i = 0 ; i < m_nb_master ; i++)
+    {
+        if ( p_gnt[i] )
+        {
+            m_next_master = i;
+            m_next_wait   = m_wait[i] - 1;
+            m_wait[i]     = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+/////////////////////////////////////////////////////////////////////
+// Starts the transaction of the granted master (address cycle).
+/////////////////////////////////////////////////////////////////////
+void PibusTraceRecorder::address()
+{
+    m_cur.master   = m_next_master;
+    m_cur.wait     = m_next_wait;
+    m_cur.start    = m_cycle;
+    m_cur.address  = p_a.read();
+    m_cur.read     = p_read.read();
+    m_cur.opc      = p_opc.read();
+    m_cur.ack      = PIBUS_ACK_READY;
+    m_cur.words    = 0;
+    m_cur.duration = 1;
+    m_cur.target   = m_nb_target;
+    for(size_t t = 0 ; t < m_nb_target ; t++)
+    {
+        if ( p_sel[t] ) m_cur.target = t;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////
+// Encodes the completed transaction in the output buffer.
+/////////////////////////////////////////////////////////////////////
+void PibusTraceRecorder::record()
+{
+    if ( m_buf_ptr > TRACE_BUF_SIZE - 64 ) flush();
+
+    uint8_t*	buf   = &m_buf[m_buf_ptr];
+    size_t	n     = 0;
+    int32_t	delta = (int32_t)(m_cur.address - m_prev_addr[m_cur.master]);
+    uint32_t	flags = (m_cur.opc & 0xF) | ((m_cur.ack & 0x7) << 4) | (m_cur.read ? 0x80 : 0);
+
+    n += pibusTracePut(&buf[n], m_cur.start - m_prev_start);
+    n += pibusTracePut(&buf[n], flags);
+    n += pibusTracePut(&buf[n], m_cur.master);
+    n += pibusTracePut(&buf[n], m_cur.target);
+    n += pibusTracePut(&buf[n], pibusTraceZigzag(delta));
+    n += pibusTracePut(&buf[n], m_cur.words);
+    n += pibusTracePut(&buf[n], m_cur.duration);
+    n += pibusTracePut(&buf[n], m_cur.wait);
+    m_buf_ptr += n;
+
+    m_prev_start = m_cur.start;
+    m_prev_addr[m_cur.master] = m_cur.address;
+    m_count++;
+}
+
+//////////////////////////////////////
+void PibusTraceRecorder::transition()
+{
+    if (p_resetn == false)
+    {
+        m_fsm_state   = FSM_IDLE;
+        m_cycle       = 0;
+        m_prev_start  = 0;
+        m_next_master = 0;
+        m_next_wait   = 0;
+        for(size_t i = 0 ; i < m_nb_master ; i++)
+        {
+            m_prev_addr[i] = 0;
+            m_wait[i]      = 0;
+        }
+        return;
+    } // end p_resetn
+
+    for(size_t i = 0 ; i < m_nb_master ; i++)
+    {
+        if ( p_req[i] ) m_wait[i]++;
+    }
+
+    switch(m_fsm_state) {
+    case FSM_IDLE:
+    {
+        if ( grant() ) m_fsm_state = FSM_AD;
+        break;
+    }
+    case FSM_AD:
+    {
+        address();
+        if      ( grant() ) m_fsm_state = FSM_DT_AD;	// pipelined allocation
+        else if ( p_lock )  m_fsm_state = FSM_DTAD;
+        else                m_fsm_state = FSM_DT;
+        break;
+    }
+    case FSM_DTAD:
+    case FSM_DT:
+    {
+        uint32_t ack = p_ack.read();
+        m_cur.duration++;
+        if ( p_tout )
+        {
+            m_cur.ack = PIBUS_TRACE_TIMEOUT;
+            record();
+            m_fsm_state = FSM_IDLE;
+            break;
+        }
+        if ( ack == PIBUS_ACK_READY ) m_cur.words++;
+        if ( ack == PIBUS_ACK_ERROR ) m_cur.ack = PIBUS_ACK_ERROR;
+        if ( ack == PIBUS_ACK_RETRY ) m_cur.ack = PIBUS_ACK_RETRY;
+        if ( (ack == PIBUS_ACK_RETRY) or
+             ((m_fsm_state == FSM_DT) and (ack != PIBUS_ACK_WAIT)) )
+        {
+            record();
+            if ( grant() ) m_fsm_state = FSM_AD;
+            else           m_fsm_state = FSM_IDLE;
+        }
+        else if ( (m_fsm_state == FSM_DTAD) and (ack != PIBUS_ACK_WAIT) and (p_lock == false) )
+        {
+            if ( grant() ) m_fsm_state = FSM_DT_AD;	// pipelined allocation
+            else           m_fsm_state = FSM_DT;
+        }
+        break;
+    }
+    case FSM_DT_AD:	// last data cycle of the previous transaction
+    {
+        uint32_t ack = p_ack.read();
+        m_cur.duration++;
+        if ( ack == PIBUS_ACK_READY ) m_cur.words++;
+        if ( ack == PIBUS_ACK_ERROR ) m_cur.ack = PIBUS_ACK_ERROR;
+        if ( ack == PIBUS_ACK_RETRY ) m_cur.ack = PIBUS_ACK_RETRY;
+        record();
+        address();
+        if      ( grant() ) m_fsm_state = FSM_DT_AD;	// pipelined allocation
+        else if ( p_lock )  m_fsm_state = FSM_DTAD;
+        else                m_fsm_state = FSM_DT;
+        break;
+    }
+    } // end switch FSM
+
+    m_cycle++;
+} // end transition
+
+/////////////////////////////////////////////////////////////////////
+// idle cycles : the recorder is idle when no master is granted in
+// the FSM_IDLE state, or when the target answers WAIT.
+/////////////////////////////////////////////////////////////////////
+uint32_t PibusTraceRecorder::idleCycles()
+{
+    if ( m_fsm_state == FSM_IDLE )
+    {
+        for(size_t i = 0 ; i < m_nb_master ; i++)
+        {
+            if ( p_gnt[i] ) return 0;
+        }
+        return PIBUS_IDLE_FOREVER;
+    }
+    if ( (m_fsm_state == FSM_AD) || (m_fsm_state == FSM_DT_AD) || p_tout || 
+         (p_ack.read() != PIBUS_ACK_WAIT) ) return 0;
+    return PIBUS_IDLE_FOREVER;
+}
+
+/////////////////////////////////////////////////////////////////////
+// skip idle cycles : the cycle counter, the arbitration waits, and
+// the current transaction duration are updated.
+/////////////////////////////////////////////////////////////////////
+void PibusTraceRecorder::skipCycles(uint32_t ncycles)
+{
+    for(size_t i = 0 ; i < m_nb_master ; i++)
+    {
+        if ( p_req[i] ) m_wait[i] = m_wait[i] + ncycles;
+    }
+    if ( m_fsm_state != FSM_IDLE ) m_cur.duration = m_cur.duration + ncycles;
+    m_cycle = m_cycle + ncycles;
+}
+
+//////////////////////////////////////////
+void PibusTraceRecorder::printStatistics()
+{
+    std::cout << m_name << " : " << std::dec << m_count << " recorded transactions" << std::endl;
+}
+
+}} // end namespaces
+
+
+// Local Variables:
+// tab-width: 4
+// c-basic-offset: 4
+// c-file-offsets:((innamespace . 0)(inline-open . 0))
+// indent-tabs-mode: nil
+// End:
+
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=4:softtabstop=4
@@ -0,0 +1,316 @@
+///////////////////////////////////////////////////////////////////////////
+// File : pibus_trace_analyzer.cpp
+// Copyright : UPMC - LIP6
+// This program is released under the GNU public license
+///////////////////////////////////////////////////////////////////////////
+// This standalone program analyses a PIBUS transaction trace written
+// by the PibusTraceRecorder component. It does not depend on SystemC :
+//
+//    g++ -O2 -I../source/include -o pibus_trace_analyzer pibus_trace_analyzer.cpp
+//
+//    pibus_trace_analyzer trace_file [-range log2_size] [-nranges n] [-top n]
+//
+// It displays the following reports :
+// - activity of each master (transactions, words, duration, arbitration
+//   wait, RETRY / ERROR / time-out counts),
+// - activity of each target (transactions, words, occupancy),
+// - contention map : number of transactions and mean arbitration wait
+//   for each (master, target) couple,
+// - traffic per address range (ranges of 2**log2_size bytes, default 4
+//   Kbytes) : the nranges ranges with the largest number of transactions
+//   (default 20), with the list of masters accessing each range,
+// - sharing map : number of ranges accessed by several masters, and
+//   fraction of the traffic addressing these shared ranges,
+// - the n longest transactions (default 10).
+///////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <map>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include "pibus_trace_format.h"
+
+using namespace soclib::common;
+
+// address range statistics
+struct RangeStat
+{
+    uint64_t			count;		// number of transactions
+    uint64_t			words;		// number of words
+    uint64_t			writes;		// number of write transactions
+    std::vector<uint64_t>	masters;	// number of transactions per master
+};
+
+// master or target statistics
+struct PortStat
+{
+    uint64_t	count;		// number of transactions
+    uint64_t	reads;		// number of read transactions
+    uint64_t	words;		// number of words
+    uint64_t	cycles;		// sum of durations
+    uint64_t	wait;		// sum of arbitration waits
+    uint64_t	max_wait;	// max arbitration wait
+    uint64_t	ack[5];		// number of transactions per last ACK value
+};
+
+// longest transactions : the shortest of the selected ones is on top
+struct LongerThan
+{
+    bool operator()(const PibusTraceRecord& a, const PibusTraceRecord& b) const
+    { return a.duration > b.duration; }
+};
+
+static bool rangeMore(const std::pair<uint32_t, RangeStat*>& a,
+                      const std::pair<uint32_t, RangeStat*>& b)
+{
+    return a.second->count > b.second->count;
+}
+
+static bool recordLonger(const PibusTraceRecord& a, const PibusTraceRecord& b)
+{
+    return a.duration > b.duration;
+}
+
+// last ACK values (PIBUS ACK codes, or time-out)
+#define ACK_ERROR	1
+#define ACK_RETRY	3
+
+static const char* ack_str[5] = { "WAIT", "ERROR", "READY", "RETRY", "TIMEOUT" };
+
+/////////////////////////////
+int main(int argc, char* argv[])
+{
+    size_t	range_bits = 12;
+    size_t	nranges    = 20;
+    size_t	ntop       = 10;
+
+    if ( argc < 2 )
+    {
+        printf("usage : %s trace_file [-range log2_size] [-nranges n] [-top n]\n", argv[0]);
+        exit(1);
+    }
+    for ( int n = 2 ; n < argc ; n = n + 2 )
+    {
+        if      ( (strcmp(argv[n], "-range") == 0) && (n+1 < argc) )   range_bits = atoi(argv[n+1]);
+        else if ( (strcmp(argv[n], "-nranges") == 0) && (n+1 < argc) ) nranges    = atoi(argv[n+1]);
+        else if ( (strcmp(argv[n], "-top") == 0) && (n+1 < argc) )     ntop       = atoi(argv[n+1]);
+        else
+        {
+            printf("ERROR : illegal argument %s\n", argv[n]);
+            exit(1);
+        }
+    }
+    if ( range_bits > 31 ) range_bits = 31;
+
+    FILE* file = fopen(argv[1], "rb");
+    if ( file == NULL )
+    {
+        printf("ERROR : cannot open trace file %s\n", argv[1]);
+        exit(1);
+    }
+
+    // header
+    char	magic[4];
+    uint64_t	version, nb_master, nb_target;
+    if ( (fread(magic, 1, 4, file) != 4) || (memcmp(magic, PIBUS_TRACE_MAGIC, 4) != 0) ||
+         !pibusTraceGet(file, &version) || (version != PIBUS_TRACE_VERSION) ||
+         !pibusTraceGet(file, &nb_master) || !pibusTraceGet(file, &nb_target) )
+    {
+        printf("ERROR : %s is not a PIBUS trace file\n", argv[1]);
+        exit(1);
+    }
+
+    std::vector<PortStat>	master(nb_master);
+    std::vector<PortStat>	target(nb_target + 1);		// last one : no target
+    std::vector<uint64_t>	pair_count(nb_master * (nb_target + 1), 0);
+    std::vector<uint64_t>	pair_wait(nb_master * (nb_target + 1), 0);
+    std::vector<uint32_t>	prev_addr(nb_master, 0);
+    std::map<uint32_t, RangeStat*>	ranges;
+    std::priority_queue<PibusTraceRecord, std::vector<PibusTraceRecord>, LongerThan> longest;
+    memset(&master[0], 0, nb_master * sizeof(PortStat));
+    memset(&target[0], 0, (nb_target + 1) * sizeof(PortStat));
+
+    // records
+    PibusTraceRecord	rec;
+    uint64_t		start = 0;
+    uint64_t		last  = 0;
+    uint64_t		nrec  = 0;
+    uint64_t		v[8];
+    while ( pibusTraceGet(file, &v[0]) )
+    {
+        bool ok = true;
+        for ( size_t k = 1 ; k < 8 ; k++ ) ok = ok && pibusTraceGet(file, &v[k]);
+        if ( !ok or (v[2] >= nb_master) or (v[3] > nb_target) )
+        {
+            printf("WARNING : truncated or corrupted trace after %lu records\n", (unsigned long)nrec);
+            break;
+        }
+        start          = start + v[0];
+        rec.start      = start;
+        rec.opc        = v[1] & 0xF;
+        rec.ack        = (v[1] >> 4) & 0x7;
+        rec.read       = (v[1] & 0x80) != 0;
+        rec.master     = v[2];
+        rec.target     = v[3];
+        rec.address    = prev_addr[rec.master] + pibusTraceUnzigzag((uint32_t)v[4]);
+        rec.words      = v[5];
+        rec.duration   = v[6];
+        rec.wait       = v[7];
+        prev_addr[rec.master] = rec.address;
+        if ( rec.ack > PIBUS_TRACE_TIMEOUT ) rec.ack = PIBUS_TRACE_TIMEOUT;
+        if ( start + rec.duration > last ) last = start + rec.duration;
+        nrec++;
+
+        PortStat* p[2] = { &master[rec.master], &target[rec.target] };
+        for ( size_t k = 0 ; k < 2 ; k++ )
+        {
+            p[k]->count++;
+            if ( rec.read ) p[k]->reads++;
+            p[k]->words  += rec.words;
+            p[k]->cycles += rec.duration;
+            p[k]->wait   += rec.wait;
+            if ( rec.wait > p[k]->max_wait ) p[k]->max_wait = rec.wait;
+            p[k]->ack[rec.ack]++;
+        }
+        pair_count[rec.master*(nb_target + 1) + rec.target]++;
+        pair_wait[rec.master*(nb_target + 1) + rec.target] += rec.wait;
+
+        RangeStat*& r = ranges[rec.address >> range_bits];
+        if ( r == NULL )
+        {
+            r = new RangeStat;
+            r->count  = 0;
+            r->words  = 0;
+            r->writes = 0;
+            r->masters.assign(nb_master, 0);
+        }
+        r->count++;
+        r->words += rec.words;
+        if ( !rec.read ) r->writes++;
+        r->masters[rec.master]++;
+
+        if ( longest.size() < ntop ) longest.push(rec);
+        else if ( (ntop > 0) && (rec.duration > longest.top().duration) )
+        {
+            longest.pop();
+            longest.push(rec);
+        }
+    }
+    fclose(file);
+
+    printf("\n*** PIBUS TRACE %s : %lu transactions / %lu cycles\n",
+           argv[1], (unsigned long)nrec, (unsigned long)last);
+    if ( nrec == 0 ) return 0;
+
+    // masters
+    printf("\n--- masters ---\n");
+    printf("master    trans    reads     words  mean_dur  mean_wait  max_wait  retry  error  tout\n");
+    for ( size_t i = 0 ; i < nb_master ; i++ )
+    {
+        PortStat& m = master[i];
+        if ( m.count == 0 ) continue;
+        printf("%6lu %8lu %8lu %9lu %9.2f %10.2f %9lu %6lu %6lu %5lu\n", (unsigned long)i,
+               (unsigned long)m.count, (unsigned long)m.reads, (unsigned long)m.words,
+               (double)m.cycles/m.count, (double)m.wait/m.count, (unsigned long)m.max_wait,
+               (unsigned long)m.ack[ACK_RETRY], (unsigned long)m.ack[ACK_ERROR],
+               (unsigned long)m.ack[PIBUS_TRACE_TIMEOUT]);
+    }
+
+    // targets
+    printf("\n--- targets ---\n");
+    printf("target    trans    reads     words  mean_dur  occupancy\n");
+    for ( size_t t = 0 ; t <= nb_target ; t++ )
+    {
+        PortStat& g = target[t];
+        if ( g.count == 0 ) continue;
+        if ( t == nb_target ) printf("  none");
+        else                  printf("%6lu", (unsigned long)t);
+        printf(" %8lu %8lu %9lu %9.2f %9.2f%%\n",
+               (unsigned long)g.count, (unsigned long)g.reads, (unsigned long)g.words,
+               (double)g.cycles/g.count, 100.0*(double)g.cycles/last);
+    }
+
+    // contention map
+    printf("\n--- contention map : transactions / mean arbitration wait ---\n");
+    printf("master");
+    for ( size_t t = 0 ; t < nb_target ; t++ ) printf("     target %2lu", (unsigned long)t);
+    printf("\n");
+    for ( size_t i = 0 ; i < nb_master ; i++ )
+    {
+        if ( master[i].count == 0 ) continue;
+        printf("%6lu", (unsigned long)i);
+        for ( size_t t = 0 ; t < nb_target ; t++ )
+        {
+            uint64_t count = pair_count[i*(nb_target + 1) + t];
+            if ( count ) printf(" %7lu/%5.1f", (unsigned long)count,
+                                (double)pair_wait[i*(nb_target + 1) + t]/count);
+            else         printf("            -");
+        }
+        printf("\n");
+    }
+
+    // address ranges
+    std::vector<std::pair<uint32_t, RangeStat*> > sorted(ranges.begin(), ranges.end());
+    std::sort(sorted.begin(), sorted.end(), rangeMore);
+    printf("\n--- address ranges (%lu bytes) : %lu ranges ---\n",
+           (unsigned long)(1UL << range_bits), (unsigned long)sorted.size());
+    printf("      base    trans   writes     words  masters\n");
+    for ( size_t k = 0 ; (k < sorted.size()) && (k < nranges) ; k++ )
+    {
+        RangeStat* r = sorted[k].second;
+        printf("0x%08x %8lu %8lu %9lu  ", (uint32_t)(sorted[k].first << range_bits),
+               (unsigned long)r->count, (unsigned long)r->writes, (unsigned long)r->words);
+        for ( size_t i = 0 ; i < nb_master ; i++ )
+        {
+            if ( r->masters[i] ) printf(" %lu", (unsigned long)i);
+        }
+        printf("\n");
+    }
+
+    // sharing map
+    uint64_t	shared = 0;
+    uint64_t	wshared = 0;
+    uint64_t	shared_count = 0;
+    for ( size_t k = 0 ; k < sorted.size() ; k++ )
+    {
+        RangeStat* r = sorted[k].second;
+        size_t users = 0;
+        for ( size_t i = 0 ; i < nb_master ; i++ ) if ( r->masters[i] ) users++;
+        if ( users > 1 )
+        {
+            shared++;
+            shared_count += r->count;
+            if ( r->writes ) wshared++;
+        }
+    }
+    printf("\n--- sharing map ---\n");
+    printf("shared ranges       = %lu / %lu\n", (unsigned long)shared, (unsigned long)sorted.size());
+    printf("write-shared ranges = %lu\n", (unsigned long)wshared);
+    printf("shared traffic      = %.2f%%\n", 100.0*(double)shared_count/nrec);
+
+    // longest transactions
+    std::vector<PibusTraceRecord> top;
+    while ( !longest.empty() )
+    {
+        top.push_back(longest.top());
+        longest.pop();
+    }
+    std::sort(top.begin(), top.end(), recordLonger);
+    printf("\n--- %lu longest transactions ---\n", (unsigned long)top.size());
+    printf("       start  master  target     address   read  opc  words  duration  wait  ack\n");
+    for ( size_t k = 0 ; k < top.size() ; k++ )
+    {
+        printf("%12lu %7u %7u  0x%08x %5s %4u %6u %9u %5u  %s\n",
+               (unsigned long)top[k].start, top[k].master, top[k].target, top[k].address,
+               top[k].read ? "yes" : "no", top[k].opc, top[k].words, top[k].duration,
+               top[k].wait, ack_str[top[k].ack]);
+    }
+
+    for ( size_t k = 0 ; k < sorted.size() ; k++ ) delete sorted[k].second;
+    return 0;
+}
+
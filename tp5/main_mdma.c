@@ -0,0 +1,99 @@
+#include "stdio.h"
+
+#define NPIXEL 256
+#define NLINE  256
+
+#define THRESHOLD	0x80	// blit threshold
+#define VALUE		0x40	// blit value
+
+static unsigned char	BUF[NPIXEL*NLINE] __attribute__ ((aligned(4)));
+static unsigned char	TMP[NPIXEL*NLINE] __attribute__ ((aligned(4)));
+
+//////////////////////////////////////////////////////////////////////
+//	build function
+//////////////////////////////////////////////////////////////////////
+unsigned char build(unsigned int x, unsigned int y, unsigned int step)
+{
+    if( ((x>>step & 0x1) && !(y>>step & 0x1)) ||
+        (!(x>>step & 0x1) && (y>>step & 0x1)) ) 	return 0xFF; 
+    else 						return 0; 
+} // end build
+
+//////////////////////////////////////////////////////////////////////
+//	main function
+//	The image is displayed by a chain of 4 descriptors (one per
+//	quarter of the frame) executed by the multi-channels DMA.
+//	The same threshold blit is then displayed twice, to compare
+//	the DMA operation with the software baseline :
+//	- software : the processor builds the thresholded image, that
+//	  is copied to the frame buffer by fb_sync_write().
+//	- DMA      : one FB_2D_THRESHOLD descriptor (fb_write_2d()).
+//////////////////////////////////////////////////////////////////////
+__attribute__ ((constructor)) void main() 
+{
+    fb_2d_t		list[4];
+    unsigned int 	line;
+    unsigned int 	pixel;
+    unsigned int	n;
+    unsigned int	start;
+
+    for(line = 0 ; line < NLINE ; line++) 
+    {   
+        for(pixel = 0 ; pixel < NPIXEL ; pixel++) BUF[line*NPIXEL + pixel] = build(pixel, line, 5);
+    }
+    tty_printf(" - build   OK at cycle %d\n", proctime());
+
+    for(n = 0 ; n < 4 ; n++)
+    {
+        list[n].offset     = (n >> 1)*(NLINE/2)*NPIXEL + (n & 0x1)*(NPIXEL/2);
+        list[n].buffer     = BUF + list[n].offset;
+        list[n].length     = NPIXEL/2;
+        list[n].lines      = NLINE/2;
+        list[n].fb_stride  = NPIXEL;
+        list[n].buf_stride = NPIXEL;
+        list[n].op         = FB_2D_COPY;
+        list[n].arg        = 0;
+    }
+
+    start = proctime();
+    if ( fb_write_2d(list, 4) || fb_completed() ) 
+    {
+        tty_printf("\n!!! error in fb_write_2d syscall !!!\n"); 
+        exit();
+    }
+    tty_printf(" - display OK in %d cycles (4 descriptors)\n", proctime() - start);
+
+    start = proctime();
+    for(pixel = 0 ; pixel < NPIXEL*NLINE ; pixel++)
+    {
+        if ( BUF[pixel] > THRESHOLD ) TMP[pixel] = VALUE;
+        else                          TMP[pixel] = BUF[pixel];
+    }
+    if ( fb_sync_write(0, TMP, NPIXEL*NLINE) ) 
+    {
+        tty_printf("\n!!! error in fb_sync_write syscall !!!\n"); 
+        exit();
+    }
+    tty_printf(" - software threshold OK in %d cycles\n", proctime() - start);
+
+    list[0].offset     = 0;
+    list[0].buffer     = BUF;
+    list[0].length     = NPIXEL;
+    list[0].lines      = NLINE;
+    list[0].fb_stride  = NPIXEL;
+    list[0].buf_stride = NPIXEL;
+    list[0].op         = FB_2D_THRESHOLD;
+    list[0].arg        = THRESHOLD | (VALUE << 8);
+
+    start = proctime();
+    if ( fb_write_2d(list, 1) || fb_completed() ) 
+    {
+        tty_printf("\n!!! error in fb_write_2d syscall !!!\n"); 
+        exit();
+    }
+    tty_printf(" - DMA threshold OK in %d cycles\n", proctime() - start);
+
+    tty_printf("\ncycles = %d\n", proctime() );
+    exit(); 
+
+} // end main
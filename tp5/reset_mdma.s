@@ -0,0 +1,58 @@
+#################################################################################
+#	File : reset_mdma.s
+#################################################################################
+#       This is a boot code for a mono-processor architecture containing
+#       the multi-channels DMA (tp5_top -MDMA 1).
+#       - initializes the interrupt vector for MDMA[0] and TTY.
+#       - initializes the ICU MASK register for MDMA[0] and TTY.
+#       - initializes the Status Register.
+#       - initializes the stack pointer.
+#       - initializes the EPC register, and jumps to the user code.
+#       The IRQ of the MDMA channel c is connected to IRQ_IN[2+2*nprocs+c] :
+#       IRQ_IN[4] for the channel 0 of a mono-processor architecture.
+#################################################################################
+		
+	.section .reset,"ax",@progbits
+
+	.extern	seg_stack_base
+	.extern	seg_data_base
+	.extern	seg_icu_base
+
+	.func	reset
+	.type   reset, %function
+
+reset:
+       	.set noreorder
+
+        # initialises interrupt vector 
+	la	$26,	_interrupt_vector
+	la	$27,	_isr_tty_get
+	sw	$27,	12($26)			# _interrupt_vector[3] <= _isr_tty_get
+	la	$27,	_isr_mdma
+	sw	$27,	16($26)			# _interrupt_vector[4] <= _isr_mdma
+
+        #initializes the ICU MASK[0] register
+	la	$26,	seg_icu_base
+        addiu	$26,	$26,	0		# ICU[0]
+        li  	$27,	0b00011000 		# IRQ_TTY[0] & IRQ_MDMA[0]
+        sw	$27,	8($26)
+
+        # initializes stack pointer 
+	la	$29,	seg_stack_base
+        li	$27,	0x00040000		# stack size = 256K
+	addu	$29,	$29,	$27    		# $29 <= seg_stack_base + 256K
+
+        # initializes SR register
+       	li	$26,	0x0000FF13	
+       	mtc0	$26,	$12			# SR <= 0x0000FF13
+
+        # jump to main in user mode
+	la	$26,	seg_data_base
+        lw	$26,	0($26)			# $26 <= main[0]
+	mtc0	$26,	$14			# write it in EPC register
+	eret
+
+	.set reorder
+	.endfunc
+	.size	reset, .-reset
+
@@ -0,0 +1,843 @@
+ /**********************************************************************
+ * File : tp5_cluster_top.cpp
+ * UPMC - LIP6
+ * This program is released under the GNU public license
+ **********************************************************************
+ * This architecture is a clustered version of the tp5 architecture.
+ * It contains two clusters and a global PIBUS.
+ * Each cluster contains (nprocs + 3) components :
+ *  - LBCU         : local PIBUS controler
+ *  - LRAM         : local static RAM (target 0)
+ *  - BRIDGE       : PIBUS bridge to the global PIBUS (target 1)
+ *  - PROC[i]	   : MIPS32 processors
+ * The global PIBUS contains 9 components :
+ *  - GBCU 	   : global PIBUS controler
+ *  - RAM 	   : static RAM
+ *  - ROM 	   : boot ROM
+ *  - TTY 	   : TTY Display controller
+ *  - FBF 	   : Frame Buffer controller
+ *  - ICU	   : Interrupt controller
+ *  - TIMER	   : programmable timer
+ *  - DMA          : DMA controller
+ *  - IOC	   : Disk controller
+ * The global PIBUS masters are the two bridges, the DMA and the IOC.
+ * The processors are numbered from 0 to (2*nprocs - 1).
+ *
+ * The segments placed in the local RAM are defined by the -LOCAL
+ * argument (all other segments are accessed through the bridge) :
+ *  - 0 : no local segment
+ *  - 1 : seg_stack (the stacks of the cluster processors)
+ *  - 2 : seg_stack, and the code segments (seg_reset, seg_kcode,
+ *        seg_code) replicated in each cluster
+ * The local segments are not visible from the global PIBUS : they
+ * must not be used as DMA or IOC buffers.
+ * The global PIBUS statistics (-STATS) measure the global bus load
+ * for each placement. The snoop mechanism is not supported.
+ *
+ * Interupts are connected as follows:
+ *  - IRQ_IN[0]    : DMA
+ *  - IRQ_IN[1]    : IOC
+ *  - IRQ_IN[2+2i] : TIMER[i]
+ *  - IRQ_IN[3+2i] : TTY[i]
+ **********************************************************************/
+
+// Hardware parameters default values
+// These values can be modified on the command Line
+
+#define NCLUSTERS	2	// number of clusters
+#define NPROCS		4	// number of processors per cluster
+#define FB_NPIXEL	256	// Frame buffer width
+#define FB_NLINE	256	// Frame buffer heigth
+#define BLOCK_SIZE	512	// IOC block size
+#define IOC_LATENCY	1000	// disk latency
+#define RAM_LATENCY	0	// global ram latency
+#define LRAM_LATENCY	0	// local ram latency
+#define ICACHE_WAYS	1       // instruction cache number of ways
+#define ICACHE_SETS	16     // instruction cache number of sets
+#define ICACHE_WORDS	8       // instruction cache number of words per line
+#define DCACHE_WAYS	1       // data cache number of ways
+#define DCACHE_SETS	16     // data cache number of sets
+#define DCACHE_WORDS	8       // data cache number of words per line
+#define WBUF_DEPTH	8       // cache write buffer depth
+#define	DMA_BURST	16	// number of words in a DMA burst
+#define LOCAL		1	// local segments (0 : none / 1 : stack / 2 : stack & code)
+#define BRIDGE_DEPTH	8	// bridge write queue depth
+#define GLOBAL_TIMEOUT	100	// global BCU time-out
+#define LOCAL_TIMEOUT	10000	// local BCU time-out (larger than the global latency)
+
+#include <systemc.h>
+
+#include "pibus_simple_ram.h"
+#include "pibus_frame_buffer.h"
+#include "pibus_icu.h"
+#include "pibus_multi_timer.h"
+#include "pibus_dma.h"
+#include "pibus_mips32_xcache.h"
+#include "pibus_multi_tty.h"
+#include "pibus_seg_bcu.h"
+#include "pibus_bridge.h"
+#include "pibus_segment_table.h"
+#include "pibus_mnemonics.h"
+#include "pibus_block_device.h"
+#include "pibus_checkpoint.h"
+#include "loader.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <sys/time.h>
+
+// segments definition
+
+#define SEG_RESET_BASE	0xBFC00000
+#define SEG_RESET_SIZE	0x00001000
+
+#define SEG_KCODE_BASE	0x80000000
+#define SEG_KCODE_SIZE	0x00004000
+
+#define SEG_KDATA_BASE	0x82000000
+#define SEG_KDATA_SIZE	0x00010000
+
+#define SEG_KUNC_BASE	0x81000000
+#define SEG_KUNC_SIZE	0x00010000
+
+#define SEG_CODE_BASE	0x00400000
+#define SEG_CODE_SIZE	0x00004000
+
+#define SEG_DATA_BASE	0x01000000
+#define SEG_DATA_SIZE	0x00080000
+
+#define SEG_STACK_BASE	0x02000000
+#define SEG_STACK_SIZE	0x00100000
+
+#define SEG_TTY_BASE	0x90000000
+#define SEG_TTY_SIZE	16*nprocs*NCLUSTERS
+
+#define SEG_TIM_BASE	0x91000000
+#define SEG_TIM_SIZE	16*nprocs*NCLUSTERS
+
+#define SEG_IOC_BASE	0x92000000
+#define SEG_IOC_SIZE	0x00000020
+
+#define SEG_DMA_BASE	0x93000000
+#define SEG_DMA_SIZE	0x00000020
+
+#define SEG_FBF_BASE	0x96000000
+#define SEG_FBF_SIZE	FB_NPIXEL*FB_NLINE
+
+#define SEG_ICU_BASE	0x9F000000
+#define SEG_ICU_SIZE	32*nprocs*NCLUSTERS
+
+// global PIBUS targets
+
+#define ROM_INDEX 	0
+#define RAM_INDEX	1
+#define TTY_INDEX	2
+#define FBF_INDEX	3
+#define ICU_INDEX	4
+#define TIM_INDEX	5
+#define DMA_INDEX	6
+#define IOC_INDEX	7
+
+// local PIBUS targets
+
+#define LRAM_INDEX	0
+#define BRIDGE_INDEX	1
+
+int _main (int argc, char *argv[])
+{
+    using namespace sc_core;
+    using namespace soclib::common;
+    using namespace soclib::caba;
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    //   Hardware parameters (can be redefined on the command line)
+    ///////////////////////////////////////////////////////////////////////////////////
+    size_t  ncycles             = 1000000000;          // number of simulated cycles
+    char    sys_path[256]       = "soft/sys.bin";      // pathname for system binary code
+    char    app_path[256]       = "soft/app.bin";      // pathname for application binary code
+    char    disk_path[256]      = "Makefile";          // pathname for the disk_image
+    bool    trace_ok            = false;               // debug activated
+    size_t  from_cycle          = 0;                   // debug start cycle
+    size_t  ram_latency         = RAM_LATENCY;         // global ram latency
+    size_t  lram_latency        = LRAM_LATENCY;        // local ram latency
+    size_t  ioc_latency         = IOC_LATENCY;         // disk latency
+    size_t  nprocs              = NPROCS;              // number of processors per cluster
+    size_t  icache_ways         = ICACHE_WAYS;         // instruction cache number of ways
+    size_t  icache_sets         = ICACHE_SETS;         // instruction cache number of sets
+    size_t  icache_words        = ICACHE_WORDS;        // instruction cache number of words per line
+    size_t  dcache_ways         = DCACHE_WAYS;         // data cache number of ways
+    size_t  dcache_sets         = DCACHE_SETS;         // data cache number of sets
+    size_t  dcache_words        = DCACHE_WORDS;        // data cache number of words per line
+    size_t  wbuf_depth          = WBUF_DEPTH;          // write buffer depth
+    bool    stats_ok            = false;               // statistics activation
+    size_t  stats_period        = 0;                   // statistics display period
+    size_t  dma_burst           = DMA_BURST;           // DMA burst length (number of words)
+    size_t  local               = LOCAL;               // local segments placement
+    size_t  bridge_depth        = BRIDGE_DEPTH;        // bridge write queue depth
+    char    ckpt_path[256]      = "tp5.ckpt";          // pathname for the saved checkpoint
+    char    restore_path[256]   = "";                  // pathname for the restored checkpoint
+    size_t  ckpt_cycle          = 0;                   // checkpoint cycle (0 : no checkpoint)
+
+    std::cout << std::endl;
+    std::cout << "********************************************************" << std::endl;
+    std::cout << "******        tp5_cluster_top                     ******" << std::endl;
+    std::cout << "********************************************************" << std::endl;
+    std::cout << std::endl;
+
+    if (argc > 1)
+    {
+        for( int n=1 ; n<argc ; n=n+2 )
+        {
+            if( (strcmp(argv[n],"-NCYCLES") == 0) && (n+1<argc) )
+            {
+                ncycles = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-NPROCS") == 0) && (n+1<argc) )
+            {
+                nprocs = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-TRACE") == 0) && (n+1<argc) )
+            {
+                trace_ok = true;
+                from_cycle = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-SYS") == 0) && (n+1<argc) )
+            {
+                strcpy(sys_path, argv[n+1]) ;
+            }
+            else if( (strcmp(argv[n],"-APP") == 0) && (n+1<argc) )
+            {
+                strcpy(app_path, argv[n+1]) ;
+            }
+            else if( (strcmp(argv[n],"-DISK") == 0) && (n+1<argc) )
+            {
+                strcpy(disk_path, argv[n+1]) ;
+            }
+            else if( (strcmp(argv[n],"-RAMLATENCY") == 0) && (n+1<argc) )
+            {
+                ram_latency = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-LRAMLATENCY") == 0) && (n+1<argc) )
+            {
+                lram_latency = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-IOCLATENCY") == 0) && (n+1<argc) )
+            {
+                ioc_latency = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-IWORDS") == 0) && (n+1<argc) )
+            {
+                icache_words = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-ISETS") == 0) && (n+1<argc) )
+            {
+                icache_sets = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-IWAYS") == 0) && (n+1<argc) )
+            {
+                icache_ways = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DWORDS") == 0) && (n+1<argc) )
+            {
+                dcache_words = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DSETS") == 0) && (n+1<argc) )
+            {
+                dcache_sets = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DWAYS") == 0) && (n+1<argc) )
+            {
+                dcache_ways = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-WBUF") == 0) && (n+1<argc) )
+            {
+                wbuf_depth = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-STATS") == 0) && (n+1<argc) )
+            {
+                stats_ok = true;
+                stats_period = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DMABURST") == 0) && (n+1<argc) )
+            {
+                dma_burst = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-LOCAL") == 0) && (n+1<argc) )
+            {
+                local = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-WQDEPTH") == 0) && (n+1<argc) )
+            {
+                bridge_depth = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-CHECKPOINT") == 0) && (n+1<argc) )
+            {
+                ckpt_cycle = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-CKPTFILE") == 0) && (n+1<argc) )
+            {
+                strcpy(ckpt_path, argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-RESTORE") == 0) && (n+1<argc) )
+            {
+                strcpy(restore_path, argv[n+1]);
+            }
+            else
+            {
+                std::cout << "   Arguments on the command line are (key,value) couples." << std::endl;
+                std::cout << "   The order is not important." << std::endl;
+                std::cout << "   Accepted arguments are :" << std::endl << std::endl;
+                std::cout << "   -NCYCLES number_of_simulated_cycles" << std::endl;
+                std::cout << "   -NPROCS number_of_processors_per_cluster" << std::endl;
+                std::cout << "   -TRACE debug_start_cycle" << std::endl;
+                std::cout << "   -RAMLATENCY global_ram_latency_value" << std::endl;
+                std::cout << "   -LRAMLATENCY local_ram_latency_value" << std::endl;
+                std::cout << "   -IOCLATENCY ioc_latency_value" << std::endl;
+                std::cout << "   -SYS system_code_path_name" << std::endl;
+                std::cout << "   -APP application_code_path_name" << std::endl;
+                std::cout << "   -DISK disk_image_path_name" << std::endl;
+                std::cout << "   -IWORDS number_of_words_per_line" << std::endl;
+                std::cout << "   -ISETS number_of_sets" << std::endl;
+                std::cout << "   -IWAYS number_of_ways" << std::endl;
+                std::cout << "   -DWORDS number_of_words_per_line" << std::endl;
+                std::cout << "   -DSETS number_of_sets" << std::endl;
+                std::cout << "   -DWAYS number_of_ways" << std::endl;
+                std::cout << "   -WBUF write_buffer_depth" << std::endl;
+                std::cout << "   -STATS period" << std::endl;
+                std::cout << "   -DMABURST number_of_words_in_a_burst" << std::endl;
+                std::cout << "   -LOCAL 0:none / 1:stack / 2:stack_and_code" << std::endl;
+                std::cout << "   -WQDEPTH bridge_write_queue_depth" << std::endl;
+                std::cout << "   -CHECKPOINT checkpoint_cycle" << std::endl;
+                std::cout << "   -CKPTFILE checkpoint_path_name" << std::endl;
+                std::cout << "   -RESTORE checkpoint_path_name" << std::endl;
+                exit(0);
+            }
+        }
+    }
+
+    if ( local > 2 )
+    {
+        std::cout << "ERROR : the -LOCAL value must be 0, 1 or 2" << std::endl;
+        exit(0);
+    }
+
+    size_t	ntotal = nprocs * NCLUSTERS;		// total number of processors
+
+//////////////////////////////////////////////////////
+//      SIGNALS DECLARATION
+//////////////////////////////////////////////////////
+
+    sc_clock                    	signal_ck("signal_ck");
+    sc_signal<bool>             	signal_resetn("signal_resetn");
+
+    // global PIBUS
+
+    sc_signal<bool>			signal_req_bridge[NCLUSTERS];
+    sc_signal<bool>			signal_gnt_bridge[NCLUSTERS];
+
+    sc_signal<bool>			signal_req_dma("req_dma");
+    sc_signal<bool>			signal_gnt_dma("gnt_dma");
+
+    sc_signal<bool>			signal_req_ioc("req_ioc");
+    sc_signal<bool>			signal_gnt_ioc("gnt_ioc");
+
+    sc_signal<bool>               	signal_sel_rom("sel_rom");
+    sc_signal<bool>               	signal_sel_ram("sel_ram");
+    sc_signal<bool>               	signal_sel_tty("sel_tty");
+    sc_signal<bool>               	signal_sel_fbf("sel_fbf");
+    sc_signal<bool>               	signal_sel_icu("sel_icu");
+    sc_signal<bool>               	signal_sel_tim("sel_tim");
+    sc_signal<bool>               	signal_sel_dma("sel_dma");
+    sc_signal<bool>               	signal_sel_ioc("sel_ioc");
+
+    sc_signal<uint32_t>       		signal_pi_a("pi_a");
+    sc_signal<bool>               	signal_pi_lock("pi_lock");
+    sc_signal<bool>               	signal_pi_read("pi_read");
+    sc_signal<uint32_t>        		signal_pi_opc("pi_opc");
+    sc_signal<uint32_t>       		signal_pi_d("pi_d");
+    sc_signal<uint32_t>        		signal_pi_ack("pi_ack");
+    sc_signal<bool>               	signal_pi_tout("pi_tout");
+    sc_signal<bool>               	signal_pi_avalid("pi_avalid");
+
+    // local PIBUS (one per cluster)
+
+    sc_signal<bool>			signal_req_proc[ntotal];
+    sc_signal<bool>			signal_gnt_proc[ntotal];
+
+    sc_signal<bool>               	signal_sel_lram[NCLUSTERS];
+    sc_signal<bool>               	signal_sel_bridge[NCLUSTERS];
+
+    sc_signal<uint32_t>       		signal_lpi_a[NCLUSTERS];
+    sc_signal<bool>               	signal_lpi_lock[NCLUSTERS];
+    sc_signal<bool>               	signal_lpi_read[NCLUSTERS];
+    sc_signal<uint32_t>        		signal_lpi_opc[NCLUSTERS];
+    sc_signal<uint32_t>       		signal_lpi_d[NCLUSTERS];
+    sc_signal<uint32_t>        		signal_lpi_ack[NCLUSTERS];
+    sc_signal<bool>               	signal_lpi_tout[NCLUSTERS];
+    sc_signal<bool>               	signal_lpi_avalid[NCLUSTERS];
+
+    // interrupts
+
+    sc_signal<bool>			signal_irq_proc[ntotal];
+    sc_signal<bool>               	signal_irq_tim[ntotal];
+    sc_signal<bool>               	signal_irq_tty_get[ntotal];
+    sc_signal<bool>               	signal_irq_tty_put[ntotal];
+    sc_signal<bool>               	signal_irq_dma("signal_irq_dma");
+    sc_signal<bool>               	signal_irq_ioc("signal_irq_ioc");
+
+////////////////////////////////////////////////////
+//	SEGMENT_TABLES DEFINITION
+////////////////////////////////////////////////////
+
+    // global PIBUS
+    PibusSegmentTable	segtable;
+
+    segtable.setMSBnumber(8);
+
+    segtable.addSegment("seg_reset" , SEG_RESET_BASE ,  SEG_RESET_SIZE , ROM_INDEX    , true);
+    segtable.addSegment("seg_kcode" , SEG_KCODE_BASE ,  SEG_KCODE_SIZE , RAM_INDEX    , true);
+    segtable.addSegment("seg_kdata" , SEG_KDATA_BASE ,  SEG_KDATA_SIZE , RAM_INDEX    , true);
+    segtable.addSegment("seg_kunc"  , SEG_KUNC_BASE  ,  SEG_KUNC_SIZE  , RAM_INDEX    , false);
+    segtable.addSegment("seg_code"  , SEG_CODE_BASE  ,  SEG_CODE_SIZE  , RAM_INDEX    , true);
+    segtable.addSegment("seg_stack" , SEG_STACK_BASE ,  SEG_STACK_SIZE , RAM_INDEX    , true);
+    segtable.addSegment("seg_data"  , SEG_DATA_BASE  ,  SEG_DATA_SIZE  , RAM_INDEX    , true);
+    segtable.addSegment("seg_fbf"   , SEG_FBF_BASE   ,  SEG_FBF_SIZE   , FBF_INDEX    , false);
+    segtable.addSegment("seg_tty"   , SEG_TTY_BASE   ,  SEG_TTY_SIZE   , TTY_INDEX    , false);
+    segtable.addSegment("seg_icu"   , SEG_ICU_BASE   ,  SEG_ICU_SIZE   , ICU_INDEX    , false);
+    segtable.addSegment("seg_tim"   , SEG_TIM_BASE   ,  SEG_TIM_SIZE   , TIM_INDEX    , false);
+    segtable.addSegment("seg_dma"   , SEG_DMA_BASE   ,  SEG_DMA_SIZE   , DMA_INDEX    , false);
+    segtable.addSegment("seg_ioc"   , SEG_IOC_BASE   ,  SEG_IOC_SIZE   , IOC_INDEX    , false);
+
+    segtable.print();
+    std::cout << std::endl;
+
+    // local PIBUS : same segments, allocated to the local RAM
+    // or to the bridge, depending on the placement
+    size_t	code_index  = (local == 2) ? LRAM_INDEX : BRIDGE_INDEX;
+    size_t	stack_index = (local >= 1) ? LRAM_INDEX : BRIDGE_INDEX;
+
+    PibusSegmentTable	lsegtable;
+
+    lsegtable.setMSBnumber(8);
+
+    lsegtable.addSegment("seg_reset" , SEG_RESET_BASE ,  SEG_RESET_SIZE , code_index   , true);
+    lsegtable.addSegment("seg_kcode" , SEG_KCODE_BASE ,  SEG_KCODE_SIZE , code_index   , true);
+    lsegtable.addSegment("seg_kdata" , SEG_KDATA_BASE ,  SEG_KDATA_SIZE , BRIDGE_INDEX , true);
+    lsegtable.addSegment("seg_kunc"  , SEG_KUNC_BASE  ,  SEG_KUNC_SIZE  , BRIDGE_INDEX , false);
+    lsegtable.addSegment("seg_code"  , SEG_CODE_BASE  ,  SEG_CODE_SIZE  , code_index   , true);
+    lsegtable.addSegment("seg_stack" , SEG_STACK_BASE ,  SEG_STACK_SIZE , stack_index  , true);
+    lsegtable.addSegment("seg_data"  , SEG_DATA_BASE  ,  SEG_DATA_SIZE  , BRIDGE_INDEX , true);
+    lsegtable.addSegment("seg_fbf"   , SEG_FBF_BASE   ,  SEG_FBF_SIZE   , BRIDGE_INDEX , false);
+    lsegtable.addSegment("seg_tty"   , SEG_TTY_BASE   ,  SEG_TTY_SIZE   , BRIDGE_INDEX , false);
+    lsegtable.addSegment("seg_icu"   , SEG_ICU_BASE   ,  SEG_ICU_SIZE   , BRIDGE_INDEX , false);
+    lsegtable.addSegment("seg_tim"   , SEG_TIM_BASE   ,  SEG_TIM_SIZE   , BRIDGE_INDEX , false);
+    lsegtable.addSegment("seg_dma"   , SEG_DMA_BASE   ,  SEG_DMA_SIZE   , BRIDGE_INDEX , false);
+    lsegtable.addSegment("seg_ioc"   , SEG_IOC_BASE   ,  SEG_IOC_SIZE   , BRIDGE_INDEX , false);
+
+    lsegtable.print();
+    std::cout << std::endl;
+
+/////////////////////////////////////////////////////////
+//	INSTANCIATED  COMPONENTS
+/////////////////////////////////////////////////////////
+
+    Loader		loader(sys_path, app_path);
+
+    // global PIBUS
+
+    PibusSegBcu  	gbcu("gbcu"   , segtable, NCLUSTERS + 2, 8, GLOBAL_TIMEOUT);
+    PibusSimpleRam	rom("rom"     , ROM_INDEX,   segtable, 0, loader);
+    PibusSimpleRam	ram("ram"     , RAM_INDEX,   segtable, ram_latency, loader);
+    PibusMultiTty	tty("tty"     , TTY_INDEX,   segtable, ntotal);
+    PibusFrameBuffer    fbf("fbf"     , FBF_INDEX,   segtable, 0, FB_NPIXEL, FB_NLINE);
+    PibusIcu            icu("icu"     , ICU_INDEX,   segtable, 2*ntotal + 2, ntotal);
+    PibusMultiTimer     tim("tim"     , TIM_INDEX,   segtable, ntotal);
+    PibusDma            dma("dma"     , DMA_INDEX,   segtable, dma_burst);
+    PibusBlockDevice    ioc("ioc"     , IOC_INDEX,   segtable, disk_path, BLOCK_SIZE, ioc_latency);
+
+    // clusters
+
+    PibusSegBcu*	lbcu[NCLUSTERS];
+    PibusSimpleRam*	lram[NCLUSTERS];
+    PibusBridge*	bridge[NCLUSTERS];
+    char*		cname[3*NCLUSTERS];
+    for ( size_t c=0 ; c<NCLUSTERS ; c++ )
+    {
+        cname[3*c]   = new char[16];
+        cname[3*c+1] = new char[16];
+        cname[3*c+2] = new char[16];
+        sprintf( cname[3*c]  , "lbcu[%d]", (int)c);
+        sprintf( cname[3*c+1], "lram[%d]", (int)c);
+        sprintf( cname[3*c+2], "bridge[%d]", (int)c);
+        lbcu[c]   = new PibusSegBcu( cname[3*c], lsegtable, nprocs, 2, LOCAL_TIMEOUT);
+        lram[c]   = new PibusSimpleRam( cname[3*c+1], LRAM_INDEX, lsegtable, lram_latency, loader);
+        bridge[c] = new PibusBridge( cname[3*c+2], BRIDGE_INDEX, lsegtable, bridge_depth);
+    }
+
+    PibusMips32Xcache*	proc[ntotal];
+    char*		name[ntotal];
+    for ( size_t i=0 ; i<ntotal ; i++ )
+    {
+        name[i] = new char[16];
+        sprintf( name[i], "proc[%d]", (int)i);
+        proc[i] = new PibusMips32Xcache( name[i] , lsegtable, i, icache_ways, icache_sets, icache_words,
+                                                      dcache_ways, dcache_sets, dcache_words,
+                                                      wbuf_depth, false);
+    }
+
+    std::cout << std::endl;
+
+//////////////////////////////////////////////////////////
+//	Net-List
+//////////////////////////////////////////////////////////
+
+    gbcu.p_ck			(signal_ck);
+    gbcu.p_resetn		(signal_resetn);
+    gbcu.p_sel[ROM_INDEX]	(signal_sel_rom);
+    gbcu.p_sel[RAM_INDEX]	(signal_sel_ram);
+    gbcu.p_sel[TTY_INDEX]	(signal_sel_tty);
+    gbcu.p_sel[FBF_INDEX]	(signal_sel_fbf);
+    gbcu.p_sel[ICU_INDEX]	(signal_sel_icu);
+    gbcu.p_sel[TIM_INDEX]	(signal_sel_tim);
+    gbcu.p_sel[DMA_INDEX]	(signal_sel_dma);
+    gbcu.p_sel[IOC_INDEX]	(signal_sel_ioc);
+    gbcu.p_a			(signal_pi_a);
+    gbcu.p_lock			(signal_pi_lock);
+    gbcu.p_ack			(signal_pi_ack);
+    gbcu.p_tout			(signal_pi_tout);
+    gbcu.p_avalid		(signal_pi_avalid);
+    for ( size_t c=0 ; c<NCLUSTERS ; c++)
+    {
+        gbcu.p_req[c]		(signal_req_bridge[c]);
+        gbcu.p_gnt[c]		(signal_gnt_bridge[c]);
+    }
+    gbcu.p_req[NCLUSTERS]	(signal_req_dma);
+    gbcu.p_gnt[NCLUSTERS]	(signal_gnt_dma);
+    gbcu.p_req[NCLUSTERS+1]	(signal_req_ioc);
+    gbcu.p_gnt[NCLUSTERS+1]	(signal_gnt_ioc);
+
+    std::cout << "gbcu : connected" << std::endl;
+
+    ram.p_ck			(signal_ck);
+    ram.p_resetn		(signal_resetn);
+    ram.p_sel			(signal_sel_ram);
+    ram.p_a			(signal_pi_a);
+    ram.p_read			(signal_pi_read);
+    ram.p_opc			(signal_pi_opc);
+    ram.p_ack			(signal_pi_ack);
+    ram.p_d			(signal_pi_d);
+    ram.p_tout			(signal_pi_tout);
+
+    std::cout << "ram : connected" << std::endl;
+
+    rom.p_ck			(signal_ck);
+    rom.p_resetn		(signal_resetn);
+    rom.p_sel			(signal_sel_rom);
+    rom.p_a			(signal_pi_a);
+    rom.p_read			(signal_pi_read);
+    rom.p_opc			(signal_pi_opc);
+    rom.p_ack			(signal_pi_ack);
+    rom.p_d			(signal_pi_d);
+    rom.p_tout			(signal_pi_tout);
+
+    std::cout << "rom : connected" << std::endl;
+
+    tty.p_ck			(signal_ck);
+    tty.p_resetn		(signal_resetn);
+    tty.p_sel			(signal_sel_tty);
+    tty.p_a			(signal_pi_a);
+    tty.p_read			(signal_pi_read);
+    tty.p_opc			(signal_pi_opc);
+    tty.p_ack			(signal_pi_ack);
+    tty.p_d			(signal_pi_d);
+    tty.p_tout			(signal_pi_tout);
+    for ( size_t i=0 ; i<ntotal ; i++)
+    {
+        tty.p_irq_get[i]	(signal_irq_tty_get[i]);
+        tty.p_irq_put[i]	(signal_irq_tty_put[i]);
+    }
+
+    std::cout << "tty : connected" << std::endl;
+
+    tim.p_ck			(signal_ck);
+    tim.p_resetn		(signal_resetn);
+    tim.p_sel			(signal_sel_tim);
+    tim.p_a			(signal_pi_a);
+    tim.p_read			(signal_pi_read);
+    tim.p_opc			(signal_pi_opc);
+    tim.p_ack			(signal_pi_ack);
+    tim.p_d			(signal_pi_d);
+    tim.p_tout			(signal_pi_tout);
+    for ( size_t i=0 ; i<ntotal ; i++)
+    {
+        tim.p_irq[i]	        (signal_irq_tim[i]);
+    }
+
+    std::cout << "tim : connected" << std::endl;
+
+    fbf.p_ck			(signal_ck);
+    fbf.p_resetn		(signal_resetn);
+    fbf.p_sel			(signal_sel_fbf);
+    fbf.p_a			(signal_pi_a);
+    fbf.p_read			(signal_pi_read);
+    fbf.p_opc			(signal_pi_opc);
+    fbf.p_ack			(signal_pi_ack);
+    fbf.p_d			(signal_pi_d);
+    fbf.p_tout			(signal_pi_tout);
+
+    std::cout << "fbf : connected" << std::endl;
+
+    icu.p_ck			(signal_ck);
+    icu.p_resetn		(signal_resetn);
+    icu.p_sel			(signal_sel_icu);
+    icu.p_a			(signal_pi_a);
+    icu.p_read			(signal_pi_read);
+    icu.p_opc			(signal_pi_opc);
+    icu.p_ack			(signal_pi_ack);
+    icu.p_d			(signal_pi_d);
+    icu.p_tout			(signal_pi_tout);
+    icu.p_irq_in[0]		(signal_irq_dma);
+    icu.p_irq_in[1]		(signal_irq_ioc);
+    for ( size_t i=0 ; i<ntotal ; i++)
+    {
+        icu.p_irq_in[2+2*i]	(signal_irq_tim[i]);
+        icu.p_irq_in[3+2*i]	(signal_irq_tty_get[i]);
+        icu.p_irq_out[i]  	(signal_irq_proc[i]);
+    }
+
+    std::cout << "icu : connected" << std::endl;
+
+    dma.p_ck			(signal_ck);
+    dma.p_resetn		(signal_resetn);
+    dma.p_req			(signal_req_dma);
+    dma.p_gnt			(signal_gnt_dma);
+    dma.p_sel			(signal_sel_dma);
+    dma.p_a			(signal_pi_a);
+    dma.p_read			(signal_pi_read);
+    dma.p_opc			(signal_pi_opc);
+    dma.p_lock			(signal_pi_lock);
+    dma.p_ack			(signal_pi_ack);
+    dma.p_d			(signal_pi_d);
+    dma.p_tout			(signal_pi_tout);
+    dma.p_irq 			(signal_irq_dma);
+
+    std::cout << "dma : connected" << std::endl;
+
+    ioc.p_ck			(signal_ck);
+    ioc.p_resetn		(signal_resetn);
+    ioc.p_req			(signal_req_ioc);
+    ioc.p_gnt			(signal_gnt_ioc);
+    ioc.p_sel			(signal_sel_ioc);
+    ioc.p_a			(signal_pi_a);
+    ioc.p_read			(signal_pi_read);
+    ioc.p_opc			(signal_pi_opc);
+    ioc.p_lock			(signal_pi_lock);
+    ioc.p_ack			(signal_pi_ack);
+    ioc.p_d			(signal_pi_d);
+    ioc.p_tout			(signal_pi_tout);
+    ioc.p_irq 			(signal_irq_ioc);
+
+    std::cout << "ioc : connected" << std::endl;
+
+    for ( size_t c=0 ; c<NCLUSTERS ; c++)
+    {
+        lbcu[c]->p_ck			(signal_ck);
+        lbcu[c]->p_resetn		(signal_resetn);
+        lbcu[c]->p_sel[LRAM_INDEX]	(signal_sel_lram[c]);
+        lbcu[c]->p_sel[BRIDGE_INDEX]	(signal_sel_bridge[c]);
+        lbcu[c]->p_a			(signal_lpi_a[c]);
+        lbcu[c]->p_lock			(signal_lpi_lock[c]);
+        lbcu[c]->p_ack			(signal_lpi_ack[c]);
+        lbcu[c]->p_tout			(signal_lpi_tout[c]);
+        lbcu[c]->p_avalid		(signal_lpi_avalid[c]);
+        for ( size_t i=0 ; i<nprocs ; i++)
+        {
+            lbcu[c]->p_req[i]		(signal_req_proc[c*nprocs+i]);
+            lbcu[c]->p_gnt[i]		(signal_gnt_proc[c*nprocs+i]);
+        }
+
+        lram[c]->p_ck			(signal_ck);
+        lram[c]->p_resetn		(signal_resetn);
+        lram[c]->p_sel			(signal_sel_lram[c]);
+        lram[c]->p_a			(signal_lpi_a[c]);
+        lram[c]->p_read			(signal_lpi_read[c]);
+        lram[c]->p_opc			(signal_lpi_opc[c]);
+        lram[c]->p_ack			(signal_lpi_ack[c]);
+        lram[c]->p_d			(signal_lpi_d[c]);
+        lram[c]->p_tout			(signal_lpi_tout[c]);
+
+        bridge[c]->p_ck			(signal_ck);
+        bridge[c]->p_resetn		(signal_resetn);
+        bridge[c]->p_sel		(signal_sel_bridge[c]);
+        bridge[c]->p_a			(signal_lpi_a[c]);
+        bridge[c]->p_read		(signal_lpi_read[c]);
+        bridge[c]->p_opc		(signal_lpi_opc[c]);
+        bridge[c]->p_ack		(signal_lpi_ack[c]);
+        bridge[c]->p_d			(signal_lpi_d[c]);
+        bridge[c]->p_tout		(signal_lpi_tout[c]);
+        bridge[c]->p_req		(signal_req_bridge[c]);
+        bridge[c]->p_gnt		(signal_gnt_bridge[c]);
+        bridge[c]->p_m_a		(signal_pi_a);
+        bridge[c]->p_m_read		(signal_pi_read);
+        bridge[c]->p_m_opc		(signal_pi_opc);
+        bridge[c]->p_m_lock		(signal_pi_lock);
+        bridge[c]->p_m_d		(signal_pi_d);
+        bridge[c]->p_m_ack		(signal_pi_ack);
+        bridge[c]->p_m_tout		(signal_pi_tout);
+
+        for ( size_t i=c*nprocs ; i<(c+1)*nprocs ; i++)
+        {
+            proc[i]->p_ck	        (signal_ck);
+            proc[i]->p_resetn       (signal_resetn);
+            proc[i]->p_req          (signal_req_proc[i]);
+            proc[i]->p_gnt          (signal_gnt_proc[i]);
+            proc[i]->p_lock         (signal_lpi_lock[c]);
+            proc[i]->p_read         (signal_lpi_read[c]);
+            proc[i]->p_opc          (signal_lpi_opc[c]);
+            proc[i]->p_a            (signal_lpi_a[c]);
+            proc[i]->p_d            (signal_lpi_d[c]);
+            proc[i]->p_ack          (signal_lpi_ack[c]);
+            proc[i]->p_tout         (signal_lpi_tout[c]);
+            proc[i]->p_avalid       (signal_lpi_avalid[c]);
+            proc[i]->p_irq          (signal_irq_proc[i]);
+        }
+
+        std::cout << "cluster " << c << " : connected" << std::endl;
+    }
+
+    std::cout << std::endl;
+
+//////////////////////////////////////////////
+//     simulation loop
+/////////////////////////////////////////////
+
+    signal_resetn = false;
+
+    sc_start( sc_time( 1, SC_NS ) );
+
+    signal_resetn = true;
+
+    //////////////////////////////////////////////////////////////////
+    // Checkpoint : the platform state is restored after the reset 
+    // cycle (-RESTORE), and saved at the first cycle following
+    // ckpt_cycle where all processors are ready (-CHECKPOINT).
+    //////////////////////////////////////////////////////////////////
+
+    std::vector<PibusCheckpointable*> ckpt_list;
+    for ( size_t i=0 ; i<ntotal ; i++ ) ckpt_list.push_back( proc[i] );
+    for ( size_t c=0 ; c<NCLUSTERS ; c++ ) ckpt_list.push_back( lram[c] );
+    ckpt_list.push_back( &rom );
+    ckpt_list.push_back( &ram );
+    ckpt_list.push_back( &fbf );
+    ckpt_list.push_back( &dma );
+    ckpt_list.push_back( &ioc );
+
+    size_t first = 1;		// first simulated cycle
+    if ( restore_path[0] )
+    {
+        PibusCheckpoint* restore = new PibusCheckpoint( restore_path, false );	// mapping kept
+        restore->platform( ckpt_list );
+        first = restore->cycle() + 1;
+        std::cout << "*** CHECKPOINT " << restore_path << " restored at cycle " 
+                  << restore->cycle() << std::endl;
+    }
+
+    struct timeval t_start, t_end;
+    gettimeofday(&t_start, NULL);
+
+    for( size_t n = first ; n < ncycles ; n++)
+    {
+        sc_start( sc_time( 1, SC_NS ) );
+
+        if ( ckpt_cycle && (n >= ckpt_cycle) )
+        {
+            bool ready = true;
+            for ( size_t i=0 ; i<ntotal ; i++ ) ready = ready && proc[i]->checkpointReady();
+            if ( ready )
+            {
+                PibusCheckpoint ckpt( ckpt_path, true, n );
+                ckpt.platform( ckpt_list );
+                std::cout << "*** CHECKPOINT " << ckpt_path << " saved at cycle " << n << std::endl;
+                ckpt_cycle = 0;
+            }
+        }
+
+        if ( stats_ok && (n % stats_period == 0) )
+        {
+            proc[0]->printStatistics();
+            gbcu.printStatistics();
+            for ( size_t c=0 ; c<NCLUSTERS ; c++ ) bridge[c]->printStatistics();
+        }
+
+        if ( trace_ok && (n > from_cycle) )
+        {
+            std::cout << std::dec <<"*******************  cycle = " << n
+                      << " ***************************************" << std::endl;
+            for ( size_t c=0 ; c<NCLUSTERS ; c++ )
+            {
+                proc[c*nprocs]->printTrace();
+                lbcu[c]->printTrace();
+                lram[c]->printTrace();
+                bridge[c]->printTrace();
+            }
+            gbcu.printTrace();
+            rom.printTrace();
+            ram.printTrace();
+            tty.printTrace();
+            fbf.printTrace();
+            icu.printTrace();
+            tim.printTrace();
+            dma.printTrace();
+            ioc.printTrace();
+
+            std::cout << "  -- global pibus signals --" << std::hex << std::endl;
+            std::cout << "read        = " << signal_pi_read.read()           << std::endl;
+            std::cout << "lock        = " << signal_pi_lock.read()           << std::endl;
+            std::cout << "address     = " << signal_pi_a.read()              << std::endl;
+            std::cout << "ack         = " << signal_pi_ack.read()            << std::endl;
+            std::cout << "data        = " << signal_pi_d.read()              << std::endl;
+
+            for ( size_t c=0 ; c<NCLUSTERS ; c++ )
+            {
+                std::cout << "  -- local pibus " << c << " signals --" << std::hex << std::endl;
+                std::cout << "read        = " << signal_lpi_read[c].read()   << std::endl;
+                std::cout << "lock        = " << signal_lpi_lock[c].read()   << std::endl;
+                std::cout << "address     = " << signal_lpi_a[c].read()      << std::endl;
+                std::cout << "ack         = " << signal_lpi_ack[c].read()    << std::endl;
+                std::cout << "data        = " << signal_lpi_d[c].read()      << std::endl;
+            }
+        }
+    }
+
+    // simulation speed (simulated cycles per second)
+    gettimeofday(&t_end, NULL);
+    double seconds = (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_usec - t_start.tv_usec)*1e-6;
+    if ( seconds > 0 ) std::cout << std::dec << std::endl << "*** SIMULATION SPEED = "
+                                  << (size_t)(ncycles/seconds) << " cycles/s" << std::endl;
+
+    // global bus load for the selected placement
+    std::cout << std::dec << std::endl << "*** GLOBAL PIBUS LOAD (LOCAL = " << local << ")" << std::endl;
+    gbcu.printStatistics();
+    for ( size_t c=0 ; c<NCLUSTERS ; c++ )
+    {
+        lbcu[c]->printStatistics();
+        bridge[c]->printStatistics();
+    }
+
+return EXIT_SUCCESS;
+
+} // end _main
+
+/////////////////////////////////////
+int sc_main( int argc, char* argv[] )
+{
+    try
+    {
+        return _main(argc, argv);
+    }
+    catch ( std::exception &error)
+    {
+        std::cout << error.what() << std::endl;
+    }
+    return 0;
+} // end sc_main()
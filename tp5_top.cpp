@@ -5,7 +5,8 @@
  * UPMC - LIP6
  * This program is released under the GNU public license
  **********************************************************************
- * This architecture contains (nprocs + 9) components:
+ * This architecture contains (nprocs + 9) components, 
+ * or (nprocs + 10) components with the optional MDMA:
  *  - BCU 	   : PIBUS controler
  *  - RAM 	   : static RAM
  *  - ROM 	   : boot ROM
@@ -14,6 +15,7 @@
  *  - ICU	   : Interrupt controller
  *  - TIMER	   : programmable timer
  *  - DMA          : DMA controller
+ *  - MDMA         : multi-channels DMA controller (optional)
  *  - IOC	   : Disk controller
  *  - PROC[i]	   : MIPS32 processors 
  * Interupts are connected as follows:
@@ -21,6 +23,7 @@
  *  - IRQ_IN[1]    : IOC
  *  - IRQ_IN[2+2i] : TIMER[i]
  *  - IRQ_IN[3+2i] : TTY[i]
+ *  - IRQ_IN[2+2*nprocs+c] : MDMA channel c
  **********************************************************************/
 
 // Hardware parameters default values
@@ -32,6 +35,15 @@
 #define BLOCK_SIZE	512	// IOC block size
 #define IOC_LATENCY	1000	// disk latency
 #define RAM_LATENCY	0	// ram latency
+#define RAM_RETRY	false	// ram split transactions activation
+#define DRAM_BANKS	0	// DRAM number of banks (0 : simple ram)
+#define DRAM_ROW	2048	// DRAM row buffer size (bytes)
+#define DRAM_CLOSE	false	// DRAM close page policy
+#define DRAM_TRCD	3	// DRAM activate latency
+#define DRAM_TCAS	3	// DRAM column access latency
+#define DRAM_TRP	3	// DRAM precharge latency
+#define DRAM_TREFI	1560	// DRAM refresh period (0 : no refresh)
+#define DRAM_TRFC	26	// DRAM refresh duration
 #define ICACHE_WAYS	1       // instruction cache number of ways
 #define ICACHE_SETS	16     // instruction cache number of sets
 #define ICACHE_WORDS	8       // instruction cache number of words per line
@@ -40,25 +52,54 @@
 #define DCACHE_WORDS	8       // data cache number of words per line
 #define WBUF_DEPTH	8       // cache write buffer depth
 #define SNOOP		false	// cache snoop activation
+#define WRITE_BACK	false	// cache write-back policy activation
+#define WBUF_MERGE	false	// cache write buffer merging activation
+#define IPREF_DEPTH	0	// instruction stream buffer depth (0 : no prefetch)
+#define DPREF_DEPTH	0	// data prefetch buffer depth (0 : no prefetch)
+#define DPREF_WAIT	2	// max bus grant wait for a data prefetch
+#define DCACHE_MSHR	0	// data cache miss status registers (0 : blocking cache)
+#define VICTIM_DEPTH	0	// victim caches depth (0 : no victim cache)
+#define FASTFWD		0	// instructions between two sampling windows (0 : no sampling)
+#define SAMPLE_WINDOW	1000	// number of cycles in a sampling window
+#define SAMPLE_WARMUP	1000	// number of detailed cycles before a sampling window
+#define PROFILE_SIZE	0	// per-PC profiler hash table entries (0 : no profiling)
 #define	DMA_BURST	16	// number of words in a DMA burst
+#define MDMA_CHANNELS	0	// multi-channels DMA number of channels (0 : no MDMA)
+#define MDMA_MAXCHANNELS 16	// multi-channels DMA max number of channels
+#define ARBITER		0	// BCU arbitration policy (0 : round-robin)
+#define DMA_WEIGHT	1	// DMA arbitration weight (processors and IOC weight = 1)
+#define TDMA_SLOT	16	// TDMA slot length (cycles)
+#define REG_PERIOD	0	// processors token refill period (0 : no regulation)
+#define REG_DEPTH	4	// processors token bucket depth
+#define UTIL_PERIOD	0	// BCU utilization sampling period (0 : no sampling)
+#define PIPELINE	false	// BCU address pipelining
+#define IDLE_SKIP	false	// idle cycles skipping
 
 #include <systemc.h>
 
 #include "pibus_simple_ram.h"
+#include "pibus_dram.h"
 #include "pibus_frame_buffer.h"
 #include "pibus_icu.h"
 #include "pibus_multi_timer.h"
 #include "pibus_dma.h"
+#include "pibus_multi_dma.h"
 #include "pibus_mips32_xcache.h"
 #include "pibus_multi_tty.h"
 #include "pibus_seg_bcu.h"
 #include "pibus_segment_table.h"
 #include "pibus_mnemonics.h"
 #include "pibus_block_device.h"
+#include "pibus_checkpoint.h"
+#include "pibus_trace_recorder.h"
 #include "loader.h"
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <math.h>
+#include <sys/time.h>
+#include <vector>
+#include <algorithm>
 
 // segments definition
 
@@ -89,12 +130,18 @@
 #define SEG_TIM_BASE	0x91000000
 #define SEG_TIM_SIZE	16*nprocs 
 
+#define SEG_CYC_BASE	0x03000000	// TIMER cycle counter (user space)
+#define SEG_CYC_SIZE	0x00000008
+
 #define SEG_IOC_BASE	0x92000000
 #define SEG_IOC_SIZE	0x00000020
 
 #define SEG_DMA_BASE	0x93000000
 #define SEG_DMA_SIZE	0x00000020
 
+#define SEG_MDMA_BASE	0x94000000
+#define SEG_MDMA_SIZE	0x00001000*mdma_channels
+
 #define SEG_FBF_BASE	0x96000000
 #define SEG_FBF_SIZE	FB_NPIXEL*FB_NLINE
 
@@ -109,6 +156,7 @@
 #define TIM_INDEX	5
 #define DMA_INDEX	6
 #define IOC_INDEX	7
+#define MDMA_INDEX	8
 
 int _main (int argc, char *argv[])
 {
@@ -123,9 +171,16 @@ int _main (int argc, char *argv[])
     char    sys_path[256]       = "soft/sys.bin";      // pathname for system binary code
     char    app_path[256]       = "soft/app.bin";      // pathname for application binary code
     char    disk_path[256]      = "Makefile";          // pathname for the disk_image
+    char    stat_path[256]      = "";                  // pathname for the BCU statistics file
+    char    bus_trace_path[256] = "";                  // pathname for the PIBUS transaction trace
     bool    trace_ok            = false;               // debug activated
     size_t  from_cycle          = 0;                   // debug start cycle
     size_t  ram_latency         = RAM_LATENCY;         // ram latency
+    bool    ram_retry           = RAM_RETRY;           // ram split transactions activation
+    size_t  dram_banks          = DRAM_BANKS;          // DRAM number of banks (0 : simple ram)
+    size_t  dram_row            = DRAM_ROW;            // DRAM row buffer size
+    bool    dram_close          = DRAM_CLOSE;          // DRAM close page policy
+    size_t  dram_refi           = DRAM_TREFI;          // DRAM refresh period
     size_t  ioc_latency         = IOC_LATENCY;         // disk latency
     size_t  nprocs              = NPROCS;              // number of processors 
     size_t  icache_ways         = ICACHE_WAYS;         // instruction cache number of ways
@@ -138,7 +193,30 @@ int _main (int argc, char *argv[])
     bool    stats_ok            = false;               // statistics activation
     size_t  stats_period        = 0;                   // statistics display period 
     size_t  dma_burst           = DMA_BURST;           // DMA burst length (number of words)
+    size_t  mdma_channels       = MDMA_CHANNELS;       // multi-channels DMA number of channels
     bool    snoop_active        = SNOOP;               // snoop activation
+    bool    write_back          = WRITE_BACK;          // write-back policy activation
+    bool    wbuf_merge          = WBUF_MERGE;          // write buffer merging activation
+    size_t  ipref_depth         = IPREF_DEPTH;         // instruction stream buffer depth
+    size_t  dpref_depth         = DPREF_DEPTH;         // data prefetch buffer depth
+    size_t  dpref_wait          = DPREF_WAIT;          // data prefetch max bus wait
+    size_t  dcache_mshr         = DCACHE_MSHR;         // data cache miss status registers
+    size_t  victim_depth        = VICTIM_DEPTH;        // victim caches depth
+    size_t  fastfwd_period      = FASTFWD;             // functional instructions between windows
+    size_t  sample_window       = SAMPLE_WINDOW;       // sampling window length (cycles)
+    size_t  sample_warmup       = SAMPLE_WARMUP;       // warm-up before a window (cycles)
+    size_t  profile_size        = PROFILE_SIZE;        // profiler hash table entries
+    size_t  arbiter             = ARBITER;             // BCU arbitration policy
+    size_t  dma_weight          = DMA_WEIGHT;          // DMA arbitration weight
+    size_t  tdma_slot           = TDMA_SLOT;           // TDMA slot length (cycles)
+    size_t  reg_period          = REG_PERIOD;          // processors token refill period
+    size_t  reg_depth           = REG_DEPTH;           // processors token bucket depth
+    size_t  util_period         = UTIL_PERIOD;         // BCU utilization sampling period
+    bool    pipeline            = PIPELINE;            // BCU address pipelining
+    bool    idle_skip           = IDLE_SKIP;           // idle cycles skipping
+    char    ckpt_path[256]      = "tp5.ckpt";          // pathname for the saved checkpoint
+    char    restore_path[256]   = "";                  // pathname for the restored checkpoint
+    size_t  ckpt_cycle          = 0;                   // checkpoint cycle (0 : no checkpoint)
 
     std::cout << std::endl;
     std::cout << "********************************************************" << std::endl;
@@ -179,6 +257,26 @@ int _main (int argc, char *argv[])
             {
                 ram_latency = atoi(argv[n+1]);
             }
+            else if( (strcmp(argv[n],"-RETRY") == 0) && (n+1<argc) )
+            {
+                ram_retry = (atoi(argv[n+1]) != 0);
+            }
+            else if( (strcmp(argv[n],"-DRAM") == 0) && (n+1<argc) )
+            {
+                dram_banks = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DRAMROW") == 0) && (n+1<argc) )
+            {
+                dram_row = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DRAMCLOSE") == 0) && (n+1<argc) )
+            {
+                dram_close = (atoi(argv[n+1]) != 0);
+            }
+            else if( (strcmp(argv[n],"-DRAMREFI") == 0) && (n+1<argc) )
+            {
+                dram_refi = atoi(argv[n+1]);
+            }
             else if( (strcmp(argv[n],"-IOCLATENCY") == 0) && (n+1<argc) )
             {
                 ram_latency = atoi(argv[n+1]);
@@ -187,6 +285,50 @@ int _main (int argc, char *argv[])
             {
                 snoop_active = (atoi(argv[n+1]) != 0);
             }
+            else if( (strcmp(argv[n],"-WBACK") == 0) && (n+1<argc) )
+            {
+                write_back = (atoi(argv[n+1]) != 0);
+            }
+            else if( (strcmp(argv[n],"-WMERGE") == 0) && (n+1<argc) )
+            {
+                wbuf_merge = (atoi(argv[n+1]) != 0);
+            }
+            else if( (strcmp(argv[n],"-IPREF") == 0) && (n+1<argc) )
+            {
+                ipref_depth = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DPREF") == 0) && (n+1<argc) )
+            {
+                dpref_depth = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DPWAIT") == 0) && (n+1<argc) )
+            {
+                dpref_wait = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-MSHR") == 0) && (n+1<argc) )
+            {
+                dcache_mshr = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-VICTIM") == 0) && (n+1<argc) )
+            {
+                victim_depth = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-FASTFWD") == 0) && (n+1<argc) )
+            {
+                fastfwd_period = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-SAMPLE") == 0) && (n+1<argc) )
+            {
+                sample_window = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-WARMUP") == 0) && (n+1<argc) )
+            {
+                sample_warmup = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-PROFILE") == 0) && (n+1<argc) )
+            {
+                profile_size = atoi(argv[n+1]);
+            }
             else if( (strcmp(argv[n],"-IWORDS") == 0) && (n+1<argc) )
             {
                 icache_words = atoi(argv[n+1]);
@@ -224,6 +366,62 @@ int _main (int argc, char *argv[])
             {
                 dma_burst = atoi(argv[n+1]);
             }
+            else if( (strcmp(argv[n],"-MDMA") == 0) && (n+1<argc) )
+            {
+                mdma_channels = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-STATFILE") == 0) && (n+1<argc) )
+            {
+                strcpy(stat_path, argv[n+1]) ;
+            }
+            else if( (strcmp(argv[n],"-BUSTRACE") == 0) && (n+1<argc) )
+            {
+                strcpy(bus_trace_path, argv[n+1]) ;
+            }
+            else if( (strcmp(argv[n],"-UTILPERIOD") == 0) && (n+1<argc) )
+            {
+                util_period = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-ARBITER") == 0) && (n+1<argc) )
+            {
+                arbiter = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DMAWEIGHT") == 0) && (n+1<argc) )
+            {
+                dma_weight = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-TDMASLOT") == 0) && (n+1<argc) )
+            {
+                tdma_slot = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-REGPERIOD") == 0) && (n+1<argc) )
+            {
+                reg_period = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-REGDEPTH") == 0) && (n+1<argc) )
+            {
+                reg_depth = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-PIPELINE") == 0) && (n+1<argc) )
+            {
+                pipeline = (atoi(argv[n+1]) != 0);
+            }
+            else if( (strcmp(argv[n],"-IDLESKIP") == 0) && (n+1<argc) )
+            {
+                idle_skip = (atoi(argv[n+1]) != 0);
+            }
+            else if( (strcmp(argv[n],"-CHECKPOINT") == 0) && (n+1<argc) )
+            {
+                ckpt_cycle = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-CKPTFILE") == 0) && (n+1<argc) )
+            {
+                strcpy(ckpt_path, argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-RESTORE") == 0) && (n+1<argc) )
+            {
+                strcpy(restore_path, argv[n+1]);
+            }
             else
             {
                 std::cout << "   Arguments on the command line are (key,value) couples." << std::endl;
@@ -233,11 +431,27 @@ int _main (int argc, char *argv[])
                 std::cout << "   -NPROCS number_of_processors" << std::endl;
                 std::cout << "   -TRACE debug_start_cycle" << std::endl;
                 std::cout << "   -RAMLATENCY ram_latency_value" << std::endl;
+                std::cout << "   -RETRY non_zero_value_to_activate_ram_split_transactions (simple ram only)" << std::endl;
+                std::cout << "   -DRAM number_of_dram_banks (0 : simple ram)" << std::endl;
+                std::cout << "   -DRAMROW dram_row_buffer_size_in_bytes" << std::endl;
+                std::cout << "   -DRAMCLOSE non_zero_value_for_close_page_policy" << std::endl;
+                std::cout << "   -DRAMREFI dram_refresh_period (0 : no refresh)" << std::endl;
                 std::cout << "   -IOCLATENCY ioc_latency_value" << std::endl;
                 std::cout << "   -SYS system_code_path_name" << std::endl;
                 std::cout << "   -APP application_code_path_name" << std::endl;
                 std::cout << "   -DISK disk_image_path_name" << std::endl;
                 std::cout << "   -SNOOP non_zero_value_to_activate" << std::endl;
+                std::cout << "   -WBACK non_zero_value_to_activate" << std::endl;
+                std::cout << "   -WMERGE non_zero_value_to_activate" << std::endl;
+                std::cout << "   -IPREF number_of_prefetched_lines" << std::endl;
+                std::cout << "   -DPREF number_of_prefetched_lines" << std::endl;
+                std::cout << "   -DPWAIT max_bus_wait_cycles_for_a_data_prefetch" << std::endl;
+                std::cout << "   -MSHR number_of_pending_data_misses" << std::endl;
+                std::cout << "   -VICTIM number_of_victim_cache_lines" << std::endl;
+                std::cout << "   -FASTFWD number_of_functional_instructions_between_windows" << std::endl;
+                std::cout << "   -SAMPLE number_of_cycles_in_a_window" << std::endl;
+                std::cout << "   -WARMUP number_of_cycles_before_a_window" << std::endl;
+                std::cout << "   -PROFILE number_of_profiler_entries" << std::endl;
                 std::cout << "   -IWORDS number_of_words_per_line" << std::endl;
                 std::cout << "   -ISETS number_of_sets" << std::endl;
                 std::cout << "   -IWAYS number_of_ways" << std::endl;
@@ -247,11 +461,54 @@ int _main (int argc, char *argv[])
                 std::cout << "   -WBUF write_buffer_depth" << std::endl;
                 std::cout << "   -STATS period" << std::endl;
                 std::cout << "   -DMABURST number_of_words_in_a_burst" << std::endl;
+                std::cout << "   -MDMA number_of_multi_dma_channels (0 : no multi-channels DMA)" << std::endl;
+                std::cout << "   -STATFILE bcu_statistics_path_name (.json or .csv)" << std::endl;
+                std::cout << "   -UTILPERIOD bus_utilization_sampling_period" << std::endl;
+                std::cout << "   -BUSTRACE pibus_transaction_trace_path_name" << std::endl;
+                std::cout << "   -ARBITER 0:round-robin / 1:fixed_priority / 2:weighted_rr / 3:tdma" << std::endl;
+                std::cout << "   -DMAWEIGHT dma_weight_or_priority" << std::endl;
+                std::cout << "   -TDMASLOT number_of_cycles_in_a_slot" << std::endl;
+                std::cout << "   -REGPERIOD processors_token_refill_period" << std::endl;
+                std::cout << "   -REGDEPTH processors_token_bucket_depth" << std::endl;
+                std::cout << "   -PIPELINE non_zero_value_for_bcu_address_pipelining" << std::endl;
+                std::cout << "   -IDLESKIP non_zero_value_to_skip_idle_cycles" << std::endl;
+                std::cout << "   -CHECKPOINT checkpoint_cycle" << std::endl;
+                std::cout << "   -CKPTFILE checkpoint_path_name" << std::endl;
+                std::cout << "   -RESTORE checkpoint_path_name" << std::endl;
                 exit(0);
             }
         }
     }
 
+    if ( (fastfwd_period != 0) && (nprocs != 1) )
+    {
+        std::cout << "ERROR : the sampled simulation (-FASTFWD) requires a single processor" << std::endl;
+        exit(0);
+    }
+
+    if ( (fastfwd_period != 0) && (ckpt_cycle != 0) )
+    {
+        std::cout << "ERROR : the checkpoint (-CHECKPOINT) is not supported by the sampled simulation" << std::endl;
+        exit(0);
+    }
+
+    if ( ram_retry && (dram_banks != 0) )
+    {
+        std::cout << "ERROR : the split transactions (-RETRY) are not supported by the DRAM (-DRAM)" << std::endl;
+        exit(0);
+    }
+
+    if ( mdma_channels > MDMA_MAXCHANNELS )
+    {
+        std::cout << "ERROR : the number of multi-channels DMA channels (-MDMA) cannot be larger than " 
+                  << MDMA_MAXCHANNELS << std::endl;
+        exit(0);
+    }
+
+    // the MDMA is an additional master and target on the bus
+    size_t nmasters = (mdma_channels != 0) ? nprocs + 3 : nprocs + 2;
+    size_t ntargets = (mdma_channels != 0) ? 9 : 8;
+
 //////////////////////////////////////////////////////
 //      SIGNALS DECLARATION
 //////////////////////////////////////////////////////
@@ -268,6 +525,9 @@ int _main (int argc, char *argv[])
     sc_signal<bool>			signal_req_ioc("req_ioc");
     sc_signal<bool>			signal_gnt_ioc("gnt_ioc");
 
+    sc_signal<bool>			signal_req_mdma("req_mdma");
+    sc_signal<bool>			signal_gnt_mdma("gnt_mdma");
+
     sc_signal<bool>               	signal_sel_rom("sel_rom");
     sc_signal<bool>               	signal_sel_ram("sel_ram");
     sc_signal<bool>               	signal_sel_tty("sel_tty");
@@ -276,6 +536,7 @@ int _main (int argc, char *argv[])
     sc_signal<bool>               	signal_sel_tim("sel_tim");
     sc_signal<bool>               	signal_sel_dma("sel_dma");
     sc_signal<bool>               	signal_sel_ioc("sel_ioc");
+    sc_signal<bool>               	signal_sel_mdma("sel_mdma");
 
     sc_signal<uint32_t>       		signal_pi_a("pi_a");
     sc_signal<bool>               	signal_pi_lock("pi_lock");
@@ -292,6 +553,7 @@ int _main (int argc, char *argv[])
     sc_signal<bool>               	signal_irq_tty_put[nprocs];
     sc_signal<bool>               	signal_irq_dma("signal_irq_dma");
     sc_signal<bool>               	signal_irq_ioc("signal_irq_ioc");
+    sc_signal<bool>               	signal_irq_mdma[MDMA_MAXCHANNELS];
 
 ////////////////////////////////////////////////////
 //	SEGMENT_TABLE DEFINITION
@@ -312,8 +574,10 @@ int _main (int argc, char *argv[])
     segtable.addSegment("seg_tty"   , SEG_TTY_BASE   ,  SEG_TTY_SIZE   , TTY_INDEX    , false);
     segtable.addSegment("seg_icu"   , SEG_ICU_BASE   ,  SEG_ICU_SIZE   , ICU_INDEX    , false);
     segtable.addSegment("seg_tim"   , SEG_TIM_BASE   ,  SEG_TIM_SIZE   , TIM_INDEX    , false);
+    segtable.addSegment("seg_cycle" , SEG_CYC_BASE   ,  SEG_CYC_SIZE   , TIM_INDEX    , false);
     segtable.addSegment("seg_dma"   , SEG_DMA_BASE   ,  SEG_DMA_SIZE   , DMA_INDEX    , false);
     segtable.addSegment("seg_ioc"   , SEG_IOC_BASE   ,  SEG_IOC_SIZE   , IOC_INDEX    , false);
+    if ( mdma_channels ) segtable.addSegment("seg_mdma", SEG_MDMA_BASE, SEG_MDMA_SIZE, MDMA_INDEX, false);
 
     segtable.print();
     std::cout << std::endl;
@@ -324,16 +588,38 @@ int _main (int argc, char *argv[])
 
     Loader		loader(sys_path, app_path);
 
-    PibusSegBcu  	bcu("bcu"     , segtable, nprocs + 2, 8, 100);
+    PibusSegBcu  	bcu("bcu"     , segtable, nmasters, ntargets, 100, arbiter, tdma_slot, util_period, pipeline);
+    bcu.setWeight(nprocs, dma_weight);
+    if ( pipeline )	// only the targets without wait cycles
+    {
+        bcu.setPipelined(ROM_INDEX);
+        if ( (ram_latency == 0) && (dram_banks == 0) ) bcu.setPipelined(RAM_INDEX);
+    }
+    if ( reg_period != 0 )
+    {
+        for ( size_t i=0 ; i<nprocs ; i++ ) bcu.setRegulator(i, reg_period, reg_depth);
+    }
     PibusSimpleRam	rom("rom"     , ROM_INDEX,   segtable, 0, loader);
-    PibusSimpleRam	ram("ram"     , RAM_INDEX,   segtable, ram_latency, loader);
     PibusMultiTty	tty("tty"     , TTY_INDEX,   segtable, nprocs);
     PibusFrameBuffer    fbf("fbf"     , FBF_INDEX,   segtable, 0, FB_NPIXEL, FB_NLINE);
-    PibusIcu            icu("icu"     , ICU_INDEX,   segtable, 2*nprocs + 2, nprocs);
+    PibusIcu            icu("icu"     , ICU_INDEX,   segtable, 2*nprocs + 2 + mdma_channels, nprocs);
     PibusMultiTimer     tim("tim"     , TIM_INDEX,   segtable, nprocs);
     PibusDma            dma("dma"     , DMA_INDEX,   segtable, dma_burst);
     PibusBlockDevice    ioc("ioc"     , IOC_INDEX,   segtable, disk_path, BLOCK_SIZE, ioc_latency);
 
+    PibusMultiDma*	mdma = NULL;
+    if ( mdma_channels ) mdma = new PibusMultiDma("mdma", MDMA_INDEX, segtable, dma_burst, mdma_channels);
+
+    PibusTraceRecorder*	rec = NULL;
+    if ( bus_trace_path[0] ) rec = new PibusTraceRecorder("rec", nmasters, ntargets, bus_trace_path);
+
+    // the ram is a simple ram (fixed latency) or a DRAM (banks timing)
+    PibusSimpleRam*	ram  = NULL;
+    PibusDram*		dram = NULL;
+    if ( dram_banks ) dram = new PibusDram("ram", RAM_INDEX, segtable, loader, nmasters, dram_banks, dram_row,
+                                           DRAM_TRCD, DRAM_TCAS, DRAM_TRP, 1, dram_refi, DRAM_TRFC, !dram_close);
+    else              ram  = new PibusSimpleRam("ram", RAM_INDEX, segtable, ram_latency, loader, ram_retry);
+
     
     PibusMips32Xcache*	proc[nprocs];
     char*		name[nprocs];
@@ -343,7 +629,12 @@ int _main (int argc, char *argv[])
         sprintf( name[i], "proc[%d]", i);
         proc[i] = new PibusMips32Xcache( name[i] , segtable, i, icache_ways, icache_sets, icache_words,
                                                      dcache_ways, dcache_sets, dcache_words, 
-                                                     wbuf_depth, snoop_active);
+                                                     wbuf_depth, snoop_active, write_back, wbuf_merge,
+                                                     ipref_depth, dpref_depth, dcache_mshr, victim_depth,
+                                                     profile_size, dpref_wait);
+        proc[i]->addFunctionalMemory( &rom );
+        if ( ram ) proc[i]->addFunctionalMemory( ram );
+        else       proc[i]->addFunctionalMemory( dram );
     }
 
     std::cout << std::endl;
@@ -376,18 +667,83 @@ int _main (int argc, char *argv[])
     bcu.p_gnt[nprocs]		(signal_gnt_dma);
     bcu.p_req[nprocs+1]		(signal_req_ioc);
     bcu.p_gnt[nprocs+1]		(signal_gnt_ioc);
+    if ( mdma )
+    {
+        bcu.p_sel[MDMA_INDEX]	(signal_sel_mdma);
+        bcu.p_req[nprocs+2]	(signal_req_mdma);
+        bcu.p_gnt[nprocs+2]	(signal_gnt_mdma);
+    }
 
     std::cout << "bcu : connected" << std::endl;
 
-    ram.p_ck			(signal_ck);
-    ram.p_resetn		(signal_resetn);
-    ram.p_sel			(signal_sel_ram);
-    ram.p_a			(signal_pi_a);
-    ram.p_read			(signal_pi_read);
-    ram.p_opc			(signal_pi_opc);
-    ram.p_ack			(signal_pi_ack);
-    ram.p_d			(signal_pi_d);
-    ram.p_tout			(signal_pi_tout);
+    if ( rec )
+    {
+        rec->p_ck			(signal_ck);
+        rec->p_resetn		(signal_resetn);
+        rec->p_sel[ROM_INDEX]	(signal_sel_rom);
+        rec->p_sel[RAM_INDEX]	(signal_sel_ram);
+        rec->p_sel[TTY_INDEX]	(signal_sel_tty);
+        rec->p_sel[FBF_INDEX]	(signal_sel_fbf);
+        rec->p_sel[ICU_INDEX]	(signal_sel_icu);
+        rec->p_sel[TIM_INDEX]	(signal_sel_tim);
+        rec->p_sel[DMA_INDEX]	(signal_sel_dma);
+        rec->p_sel[IOC_INDEX]	(signal_sel_ioc);
+        rec->p_a			(signal_pi_a);
+        rec->p_read			(signal_pi_read);
+        rec->p_opc			(signal_pi_opc);
+        rec->p_lock			(signal_pi_lock);
+        rec->p_ack			(signal_pi_ack);
+        rec->p_tout			(signal_pi_tout);
+        for ( size_t i=0 ; i<nprocs ; i++)
+        {
+            rec->p_req[i]		(signal_req_proc[i]);
+            rec->p_gnt[i]		(signal_gnt_proc[i]);
+        }
+        rec->p_req[nprocs]		(signal_req_dma);
+        rec->p_gnt[nprocs]		(signal_gnt_dma);
+        rec->p_req[nprocs+1]	(signal_req_ioc);
+        rec->p_gnt[nprocs+1]	(signal_gnt_ioc);
+        if ( mdma )
+        {
+            rec->p_sel[MDMA_INDEX]	(signal_sel_mdma);
+            rec->p_req[nprocs+2]	(signal_req_mdma);
+            rec->p_gnt[nprocs+2]	(signal_gnt_mdma);
+        }
+
+        std::cout << "rec : connected" << std::endl;
+    }
+
+    if ( ram )
+    {
+        ram->p_ck			(signal_ck);
+        ram->p_resetn		(signal_resetn);
+        ram->p_sel			(signal_sel_ram);
+        ram->p_a			(signal_pi_a);
+        ram->p_read			(signal_pi_read);
+        ram->p_opc			(signal_pi_opc);
+        ram->p_ack			(signal_pi_ack);
+        ram->p_d			(signal_pi_d);
+        ram->p_tout			(signal_pi_tout);
+    }
+    else
+    {
+        dram->p_ck			(signal_ck);
+        dram->p_resetn		(signal_resetn);
+        dram->p_sel			(signal_sel_ram);
+        dram->p_a			(signal_pi_a);
+        dram->p_read		(signal_pi_read);
+        dram->p_opc			(signal_pi_opc);
+        dram->p_ack			(signal_pi_ack);
+        dram->p_d			(signal_pi_d);
+        dram->p_tout		(signal_pi_tout);
+        for ( size_t i=0 ; i<nprocs ; i++)
+        {
+            dram->p_gnt[i]		(signal_gnt_proc[i]);
+        }
+        dram->p_gnt[nprocs]		(signal_gnt_dma);
+        dram->p_gnt[nprocs+1]	(signal_gnt_ioc);
+        if ( mdma ) dram->p_gnt[nprocs+2]	(signal_gnt_mdma);
+    }
    
     std::cout << "ram : connected" << std::endl;
 
@@ -465,6 +821,10 @@ int _main (int argc, char *argv[])
         icu.p_irq_in[3+2*i]	(signal_irq_tty_get[i]);
         icu.p_irq_out[i]  	(signal_irq_proc[i]);
     }
+    for ( size_t c=0 ; c<mdma_channels ; c++)
+    {
+        icu.p_irq_in[2+2*nprocs+c]	(signal_irq_mdma[c]);
+    }
    
     std::cout << "icu : connected" << std::endl;
 
@@ -500,6 +860,28 @@ int _main (int argc, char *argv[])
 
     std::cout << "ioc : connected" << std::endl;
 
+    if ( mdma )
+    {
+        mdma->p_ck			(signal_ck);
+        mdma->p_resetn		(signal_resetn);
+        mdma->p_req			(signal_req_mdma);
+        mdma->p_gnt			(signal_gnt_mdma);
+        mdma->p_sel			(signal_sel_mdma);
+        mdma->p_a			(signal_pi_a);
+        mdma->p_read		(signal_pi_read);
+        mdma->p_opc			(signal_pi_opc);
+        mdma->p_lock		(signal_pi_lock);
+        mdma->p_ack			(signal_pi_ack);
+        mdma->p_d			(signal_pi_d);
+        mdma->p_tout		(signal_pi_tout);
+        for ( size_t c=0 ; c<mdma_channels ; c++)
+        {
+            mdma->p_irq[c]		(signal_irq_mdma[c]);
+        }
+
+        std::cout << "mdma : connected" << std::endl;
+    }
+
     for ( size_t i=0 ; i<nprocs ; i++)
     {
         proc[i]->p_ck	        (signal_ck);  
@@ -531,14 +913,178 @@ int _main (int argc, char *argv[])
 
     signal_resetn = true;
 
-    for( size_t n = 1 ; n < ncycles ; n++)
+    //////////////////////////////////////////////////////////////////
+    // Checkpoint : the platform state is restored after the reset 
+    // cycle (-RESTORE), and saved at the first cycle following
+    // ckpt_cycle where all processors are ready (-CHECKPOINT).
+    //////////////////////////////////////////////////////////////////
+
+    std::vector<PibusCheckpointable*> ckpt_list;
+    for ( size_t i=0 ; i<nprocs ; i++ ) ckpt_list.push_back( proc[i] );
+    ckpt_list.push_back( &rom );
+    if ( ram ) ckpt_list.push_back( ram );
+    else       ckpt_list.push_back( dram );
+    ckpt_list.push_back( &fbf );
+    ckpt_list.push_back( &dma );
+    ckpt_list.push_back( &ioc );
+    if ( mdma ) ckpt_list.push_back( mdma );
+
+    size_t first = 1;		// first simulated cycle
+    if ( restore_path[0] )
+    {
+        PibusCheckpoint* restore = new PibusCheckpoint( restore_path, false );	// mapping kept
+        restore->platform( ckpt_list );
+        first = restore->cycle() + 1;
+        std::cout << "*** CHECKPOINT " << restore_path << " restored at cycle " 
+                  << restore->cycle() << std::endl;
+    }
+
+    //////////////////////////////////////////////////////////////////
+    // Sampled simulation : the functional phases (fastfwd_period
+    // instructions) alternate with cycle-accurate phases : a warm-up 
+    // (sample_warmup cycles) followed by a measurement window
+    // (sample_window cycles). The whole-run CPI is estimated as the
+    // ratio of the windows cycles and instructions sums (the windows
+    // have a fixed number of cycles), with a 95% confidence interval.
+    //////////////////////////////////////////////////////////////////
+
+    if ( fastfwd_period != 0 )
+    {
+        size_t	n         = first;	// simulated cycles
+        size_t	nwindows  = 0;		// number of measurement windows
+        double	ffwd_inst = 0;		// functional instructions
+        double	cyc_sum   = 0;		// windows cycles
+        double	ins_sum   = 0;		// windows instructions
+        double	cyc_sum2  = 0;		// sum of squared cycles
+        double	ins_sum2  = 0;		// sum of squared instructions
+        double	cross_sum = 0;		// sum of cycles * instructions
+
+        while ( n < ncycles )
+        {
+            // functional phase : a request that cannot be handled 
+            // in functional mode is executed in cycle-accurate mode
+            size_t done = 0;
+            while ( (done < fastfwd_period) && (n < ncycles) )
+            {
+                if ( proc[0]->functionalReady() ) 
+                    done = done + proc[0]->functionalRun( fastfwd_period - done );
+                if ( done < fastfwd_period )
+                {
+                    sc_start( sc_time( 1, SC_NS ) );
+                    n++;
+                }
+            }
+            ffwd_inst = ffwd_inst + done;
+
+            // cycle-accurate warm-up and measurement window
+            sc_start( sc_time( sample_warmup, SC_NS ) );
+            uint64_t cycles = proc[0]->getCycles();
+            uint64_t instrs = proc[0]->getInstructions();
+            sc_start( sc_time( sample_window, SC_NS ) );
+            n = n + sample_warmup + sample_window;
+            double cyc = (double)(proc[0]->getCycles() - cycles);
+            double ins = (double)(proc[0]->getInstructions() - instrs);
+            cyc_sum   = cyc_sum   + cyc;
+            ins_sum   = ins_sum   + ins;
+            cyc_sum2  = cyc_sum2  + cyc*cyc;
+            ins_sum2  = ins_sum2  + ins*ins;
+            cross_sum = cross_sum + cyc*ins;
+            nwindows++;
+
+            if ( stats_ok && (n / stats_period != (n - sample_warmup - sample_window) / stats_period) )
+            {
+                proc[0]->printStatistics();
+                bcu.printStatistics();
+                if ( stat_path[0] ) bcu.saveStatistics( stat_path );
+            }
+        }
+
+        // ratio estimator : the variance of the residuals (cyc - cpi*ins)
+        // is scaled by the squared mean number of instructions per window
+        double cpi  = (ins_sum > 0) ? cyc_sum / ins_sum : 0;
+        double var  = (nwindows > 1) ? 
+                      (cyc_sum2 - 2*cpi*cross_sum + cpi*cpi*ins_sum2) / (nwindows - 1) : 0;
+        double conf = (ins_sum > 0) ? 
+                      1.96 * sqrt( (var > 0) ? var / nwindows : 0 ) * nwindows / ins_sum : 0;
+        double inst = ffwd_inst + proc[0]->getInstructions();
+
+        std::cout << std::endl << "*** SAMPLED SIMULATION" << std::endl;
+        std::cout << "- SIMULATED CYCLES   = " << n << std::endl;
+        std::cout << "- FUNCTIONAL INSTR   = " << ffwd_inst << std::endl;
+        std::cout << "- DETAILED INSTR     = " << proc[0]->getInstructions() << std::endl;
+        std::cout << "- WINDOWS            = " << nwindows << std::endl;
+        std::cout << "- ESTIMATED CPI      = " << cpi << " +/- " << conf << " (95% confidence)" << std::endl;
+        std::cout << "- ESTIMATED CYCLES   = " << inst*cpi << std::endl;
+        if ( profile_size ) proc[0]->printProfile( loader );
+        if ( stat_path[0] ) bcu.saveStatistics( stat_path );
+        if ( rec ) rec->flush();
+        return EXIT_SUCCESS;
+    }
+
+    //////////////////////////////////////////////////////////////////
+    // Idle cycles skipping : when all components are idle (waiting
+    // an event that cannot happen before a known number of cycles), 
+    // these cycles are skipped, and the components update their 
+    // counters. The skipping is disabled in trace mode, and never
+    // crosses a statistics display cycle.
+    //////////////////////////////////////////////////////////////////
+
+    std::vector<PibusIdleSkip*> skippers;
+    for ( size_t i=0 ; i<nprocs ; i++ ) skippers.push_back( proc[i] );
+    skippers.push_back( &bcu );
+    skippers.push_back( &rom );
+    if ( ram ) skippers.push_back( ram );
+    else       skippers.push_back( dram );
+    skippers.push_back( &tty );
+    skippers.push_back( &fbf );
+    skippers.push_back( &icu );
+    skippers.push_back( &tim );
+    skippers.push_back( &dma );
+    skippers.push_back( &ioc );
+    if ( mdma ) skippers.push_back( mdma );
+    if ( rec ) skippers.push_back( rec );
+    size_t skipped = 0;
+
+    struct timeval t_start, t_end;
+    gettimeofday(&t_start, NULL);
+
+    for( size_t n = first ; n < ncycles ; n++)
     {
+        if ( idle_skip && !trace_ok )
+        {
+            size_t skip = ncycles - 1 - n;
+            if ( stats_ok ) skip = std::min( skip, (stats_period - (n % stats_period)) % stats_period );
+            for ( size_t i=0 ; (i < skippers.size()) && (skip > 0) ; i++ )
+                skip = std::min( skip, (size_t)skippers[i]->idleCycles() );
+            if ( skip > 0 )
+            {
+                for ( size_t i=0 ; i < skippers.size() ; i++ ) skippers[i]->skipCycles( skip );
+                n       = n + skip;
+                skipped = skipped + skip;
+            }
+        }
+
         sc_start( sc_time( 1, SC_NS ) );
 
+        if ( ckpt_cycle && (n >= ckpt_cycle) )
+        {
+            bool ready = true;
+            for ( size_t i=0 ; i<nprocs ; i++ ) ready = ready && proc[i]->checkpointReady();
+            if ( ready )
+            {
+                PibusCheckpoint ckpt( ckpt_path, true, n );
+                ckpt.platform( ckpt_list );
+                std::cout << "*** CHECKPOINT " << ckpt_path << " saved at cycle " << n << std::endl;
+                ckpt_cycle = 0;
+            }
+        }
+
         if ( stats_ok && (n % stats_period == 0) )
         {
             proc[0]->printStatistics();
             bcu.printStatistics();
+            if ( dram ) dram->printStatistics();
+            if ( stat_path[0] ) bcu.saveStatistics( stat_path );
         }
 
         if ( trace_ok && (n > from_cycle) )
@@ -548,13 +1094,15 @@ int _main (int argc, char *argv[])
             proc[0]->printTrace();
             bcu.printTrace();
             rom.printTrace();
-            ram.printTrace();
+            if ( ram ) ram->printTrace();
+            else       dram->printTrace();
             tty.printTrace();
             fbf.printTrace();
             icu.printTrace();
             tim.printTrace();
             dma.printTrace();
             ioc.printTrace();
+            if ( mdma ) mdma->printTrace();
 
             std::cout << "  -- select signals --" << std::dec << std::endl;
             std::cout << "sel_rom     = " << signal_sel_rom.read()           << std::endl;
@@ -565,6 +1113,7 @@ int _main (int argc, char *argv[])
             std::cout << "sel_tim     = " << signal_sel_tim.read()           << std::endl;
             std::cout << "sel_dma     = " << signal_sel_dma.read()           << std::endl;
             std::cout << "sel_ioc     = " << signal_sel_ioc.read()           << std::endl;
+            if ( mdma ) std::cout << "sel_mdma    = " << signal_sel_mdma.read() << std::endl;
 
             std::cout << "  -- pibus signals --" << std::hex << std::endl;
             std::cout << "avalid      = " << signal_pi_avalid.read()         << std::endl;
@@ -579,9 +1128,47 @@ int _main (int argc, char *argv[])
             std::cout << "tty_irq[0]  = " << signal_irq_tty_get[0].read()    << std::endl;
             std::cout << "dma_irq     = " << signal_irq_dma.read()           << std::endl;
             std::cout << "ioc_irq     = " << signal_irq_ioc.read()           << std::endl;
+            if ( mdma ) std::cout << "mdma_irq[0] = " << signal_irq_mdma[0].read() << std::endl;
             std::cout << "proc_irq[0] = " << signal_irq_proc[0].read()       << std::endl;
         }
     }
+
+    // simulation speed (simulated cycles per second)
+    gettimeofday(&t_end, NULL);
+    double seconds = (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_usec - t_start.tv_usec)*1e-6;
+#ifdef PIBUS_SC_SIGNAL_REGISTERS
+    const char* registers = "sc_signal";
+#else
+    const char* registers = "PibusRegister";
+#endif
+    if ( seconds > 0 ) std::cout << std::dec << std::endl << "*** SIMULATION SPEED = "
+                                  << (size_t)(ncycles/seconds) << " cycles/s (" 
+                                  << nprocs << " procs / " << registers << " registers)" << std::endl;
+    if ( idle_skip ) std::cout << "*** SKIPPED IDLE CYCLES = " << skipped << std::endl;
+
+    // per-master wait cycles (same format as tp5_xbar_top)
+    std::cout << std::dec << std::endl << "*** BUS WAIT CYCLES" << std::endl;
+    bcu.printStatistics();
+
+    // per-PC profile of each processor
+    if ( profile_size )
+    {
+        for ( size_t i=0 ; i<nprocs ; i++ ) proc[i]->printProfile( loader );
+    }
+
+    // BCU histograms and utilization samples
+    if ( stat_path[0] ) bcu.saveStatistics( stat_path );
+
+    // DRAM row buffer statistics
+    if ( dram ) dram->printStatistics();
+
+    // PIBUS transaction trace
+    if ( rec )
+    {
+        rec->printStatistics();
+        rec->flush();
+    }
+
 return EXIT_SUCCESS;
 
 } // end _main
@@ -0,0 +1,876 @@
+ /**********************************************************************
+ * File : tp5_xbar_top.cpp
+ * Date : 25/12/2011
+ * Author :  Alain Greiner
+ * UPMC - LIP6
+ * This program is released under the GNU public license
+ **********************************************************************
+ * This architecture is the tp5 architecture, where the PIBUS
+ * controller and the shared PIBUS signals are replaced by a crossbar:
+ * each master and each target has its own PIBUS signals, and the 
+ * transactions to different targets can run in parallel.
+ * The DMA and IOC components are connected to both a master port
+ * and a target port, using the same signals.
+ * The snoop mechanism is not supported by the crossbar.
+ * This architecture contains (nprocs + 9) components:
+ *  - XBAR 	   : PIBUS crossbar
+ *  - RAM 	   : static RAM
+ *  - ROM 	   : boot ROM
+ *  - TTY 	   : TTY Display controller
+ *  - FBF 	   : Frame Buffer controller
+ *  - ICU	   : Interrupt controller
+ *  - TIMER	   : programmable timer
+ *  - DMA          : DMA controller
+ *  - IOC	   : Disk controller
+ *  - PROC[i]	   : MIPS32 processors 
+ * Interupts are connected as follows:
+ *  - IRQ_IN[0]    : DMA
+ *  - IRQ_IN[1]    : IOC
+ *  - IRQ_IN[2+2i] : TIMER[i]
+ *  - IRQ_IN[3+2i] : TTY[i]
+ **********************************************************************/
+
+// Hardware parameters default values
+// These values can be modified on the command Line
+
+#define NPROCS		1	// number of processors
+#define FB_NPIXEL	256	// Frame buffer width
+#define FB_NLINE	256	// Frame buffer heigth
+#define BLOCK_SIZE	512	// IOC block size
+#define IOC_LATENCY	1000	// disk latency
+#define RAM_LATENCY	0	// ram latency
+#define ICACHE_WAYS	1       // instruction cache number of ways
+#define ICACHE_SETS	16     // instruction cache number of sets
+#define ICACHE_WORDS	8       // instruction cache number of words per line
+#define DCACHE_WAYS	1       // data cache number of ways
+#define DCACHE_SETS	16     // data cache number of sets
+#define DCACHE_WORDS	8       // data cache number of words per line
+#define WBUF_DEPTH	8       // cache write buffer depth
+#define SNOOP		false	// cache snoop activation
+#define WRITE_BACK	false	// cache write-back policy activation
+#define WBUF_MERGE	false	// cache write buffer merging activation
+#define IPREF_DEPTH	0	// instruction stream buffer depth (0 : no prefetch)
+#define DPREF_DEPTH	0	// data prefetch buffer depth (0 : no prefetch)
+#define DPREF_WAIT	2	// max bus grant wait for a data prefetch
+#define DCACHE_MSHR	0	// data cache miss status registers (0 : blocking cache)
+#define VICTIM_DEPTH	0	// victim caches depth (0 : no victim cache)
+#define FASTFWD		0	// instructions between two sampling windows (0 : no sampling)
+#define SAMPLE_WINDOW	1000	// number of cycles in a sampling window
+#define SAMPLE_WARMUP	1000	// number of detailed cycles before a sampling window
+#define PROFILE_SIZE	0	// per-PC profiler hash table entries (0 : no profiling)
+#define	DMA_BURST	16	// number of words in a DMA burst
+
+#include <systemc.h>
+
+#include "pibus_simple_ram.h"
+#include "pibus_frame_buffer.h"
+#include "pibus_icu.h"
+#include "pibus_multi_timer.h"
+#include "pibus_dma.h"
+#include "pibus_mips32_xcache.h"
+#include "pibus_multi_tty.h"
+#include "pibus_crossbar.h"
+#include "pibus_segment_table.h"
+#include "pibus_mnemonics.h"
+#include "pibus_block_device.h"
+#include "pibus_checkpoint.h"
+#include "loader.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <sys/time.h>
+
+// segments definition
+
+#define SEG_RESET_BASE	0xBFC00000
+#define SEG_RESET_SIZE	0x00001000
+
+#define SEG_KCODE_BASE	0x80000000
+#define SEG_KCODE_SIZE	0x00004000
+
+#define SEG_KDATA_BASE	0x82000000
+#define SEG_KDATA_SIZE	0x00010000
+
+#define SEG_KUNC_BASE	0x81000000
+#define SEG_KUNC_SIZE	0x00010000
+
+#define SEG_CODE_BASE	0x00400000
+#define SEG_CODE_SIZE	0x00004000
+
+#define SEG_DATA_BASE	0x01000000
+#define SEG_DATA_SIZE	0x00080000
+
+#define SEG_STACK_BASE	0x02000000
+#define SEG_STACK_SIZE	0x00100000
+
+#define SEG_TTY_BASE	0x90000000
+#define SEG_TTY_SIZE	16*nprocs 
+
+#define SEG_TIM_BASE	0x91000000
+#define SEG_TIM_SIZE	16*nprocs 
+
+#define SEG_IOC_BASE	0x92000000
+#define SEG_IOC_SIZE	0x00000020
+
+#define SEG_DMA_BASE	0x93000000
+#define SEG_DMA_SIZE	0x00000020
+
+#define SEG_FBF_BASE	0x96000000
+#define SEG_FBF_SIZE	FB_NPIXEL*FB_NLINE
+
+#define SEG_ICU_BASE	0x9F000000
+#define SEG_ICU_SIZE	32*nprocs 
+
+#define ROM_INDEX 	0
+#define RAM_INDEX	1
+#define TTY_INDEX	2
+#define FBF_INDEX	3
+#define ICU_INDEX	4
+#define TIM_INDEX	5
+#define DMA_INDEX	6
+#define IOC_INDEX	7
+
+int _main (int argc, char *argv[])
+{
+    using namespace sc_core;
+    using namespace soclib::common;
+    using namespace soclib::caba;
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    //   Hardware parameters (can be redefined on the command line)
+    ///////////////////////////////////////////////////////////////////////////////////
+    size_t  ncycles             = 1000000000;          // number of simulated cycles
+    char    sys_path[256]       = "soft/sys.bin";      // pathname for system binary code
+    char    app_path[256]       = "soft/app.bin";      // pathname for application binary code
+    char    disk_path[256]      = "Makefile";          // pathname for the disk_image
+    bool    trace_ok            = false;               // debug activated
+    size_t  from_cycle          = 0;                   // debug start cycle
+    size_t  ram_latency         = RAM_LATENCY;         // ram latency
+    size_t  ioc_latency         = IOC_LATENCY;         // disk latency
+    size_t  nprocs              = NPROCS;              // number of processors 
+    size_t  icache_ways         = ICACHE_WAYS;         // instruction cache number of ways
+    size_t  icache_sets         = ICACHE_SETS;         // instruction cache number of sets
+    size_t  icache_words        = ICACHE_WORDS;        // instruction cache number of words per line
+    size_t  dcache_ways         = DCACHE_WAYS;         // data cache number of ways
+    size_t  dcache_sets         = DCACHE_SETS;         // data cache number of sets
+    size_t  dcache_words        = DCACHE_WORDS;        // data cache number of words per line
+    size_t  wbuf_depth          = WBUF_DEPTH;          // write buffer depth
+    bool    stats_ok            = false;               // statistics activation
+    size_t  stats_period        = 0;                   // statistics display period 
+    size_t  dma_burst           = DMA_BURST;           // DMA burst length (number of words)
+    bool    snoop_active        = SNOOP;               // snoop activation
+    bool    write_back          = WRITE_BACK;          // write-back policy activation
+    bool    wbuf_merge          = WBUF_MERGE;          // write buffer merging activation
+    size_t  ipref_depth         = IPREF_DEPTH;         // instruction stream buffer depth
+    size_t  dpref_depth         = DPREF_DEPTH;         // data prefetch buffer depth
+    size_t  dpref_wait          = DPREF_WAIT;          // data prefetch max bus wait
+    size_t  dcache_mshr         = DCACHE_MSHR;         // data cache miss status registers
+    size_t  victim_depth        = VICTIM_DEPTH;        // victim caches depth
+    size_t  fastfwd_period      = FASTFWD;             // functional instructions between windows
+    size_t  sample_window       = SAMPLE_WINDOW;       // sampling window length (cycles)
+    size_t  sample_warmup       = SAMPLE_WARMUP;       // warm-up before a window (cycles)
+    size_t  profile_size        = PROFILE_SIZE;        // profiler hash table entries
+    char    ckpt_path[256]      = "tp5.ckpt";          // pathname for the saved checkpoint
+    char    restore_path[256]   = "";                  // pathname for the restored checkpoint
+    size_t  ckpt_cycle          = 0;                   // checkpoint cycle (0 : no checkpoint)
+
+    std::cout << std::endl;
+    std::cout << "********************************************************" << std::endl;
+    std::cout << "******        tp5_xbar_top                        ******" << std::endl;
+    std::cout << "********************************************************" << std::endl;
+    std::cout << std::endl;
+
+    if (argc > 1)
+    {
+        for( int n=1 ; n<argc ; n=n+2 )
+        {
+            if( (strcmp(argv[n],"-NCYCLES") == 0) && (n+1<argc) )
+            {
+                ncycles = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-NPROCS") == 0) && (n+1<argc) )
+            {
+                nprocs = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-TRACE") == 0) && (n+1<argc) )
+            {
+                trace_ok = true;
+                from_cycle = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-SYS") == 0) && (n+1<argc) )
+            {
+                strcpy(sys_path, argv[n+1]) ;
+            }
+            else if( (strcmp(argv[n],"-APP") == 0) && (n+1<argc) )
+            {
+                strcpy(app_path, argv[n+1]) ;
+            }
+            else if( (strcmp(argv[n],"-DISK") == 0) && (n+1<argc) )
+            {
+                strcpy(disk_path, argv[n+1]) ;
+            }
+            else if( (strcmp(argv[n],"-RAMLATENCY") == 0) && (n+1<argc) )
+            {
+                ram_latency = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-IOCLATENCY") == 0) && (n+1<argc) )
+            {
+                ram_latency = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-SNOOP") == 0) && (n+1<argc) )
+            {
+                snoop_active = (atoi(argv[n+1]) != 0);
+            }
+            else if( (strcmp(argv[n],"-WBACK") == 0) && (n+1<argc) )
+            {
+                write_back = (atoi(argv[n+1]) != 0);
+            }
+            else if( (strcmp(argv[n],"-WMERGE") == 0) && (n+1<argc) )
+            {
+                wbuf_merge = (atoi(argv[n+1]) != 0);
+            }
+            else if( (strcmp(argv[n],"-IPREF") == 0) && (n+1<argc) )
+            {
+                ipref_depth = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DPREF") == 0) && (n+1<argc) )
+            {
+                dpref_depth = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DPWAIT") == 0) && (n+1<argc) )
+            {
+                dpref_wait = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-MSHR") == 0) && (n+1<argc) )
+            {
+                dcache_mshr = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-VICTIM") == 0) && (n+1<argc) )
+            {
+                victim_depth = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-FASTFWD") == 0) && (n+1<argc) )
+            {
+                fastfwd_period = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-SAMPLE") == 0) && (n+1<argc) )
+            {
+                sample_window = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-WARMUP") == 0) && (n+1<argc) )
+            {
+                sample_warmup = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-PROFILE") == 0) && (n+1<argc) )
+            {
+                profile_size = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-IWORDS") == 0) && (n+1<argc) )
+            {
+                icache_words = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-ISETS") == 0) && (n+1<argc) )
+            {
+                icache_sets = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-IWAYS") == 0) && (n+1<argc) )
+            {
+                icache_ways = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DWORDS") == 0) && (n+1<argc) )
+            {
+                dcache_words = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DSETS") == 0) && (n+1<argc) )
+            {
+                dcache_sets = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DWAYS") == 0) && (n+1<argc) )
+            {
+                dcache_ways = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-WBUF") == 0) && (n+1<argc) )
+            {
+                wbuf_depth = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-STATS") == 0) && (n+1<argc) )
+            {
+                stats_ok = true;
+                stats_period = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-DMABURST") == 0) && (n+1<argc) )
+            {
+                dma_burst = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-CHECKPOINT") == 0) && (n+1<argc) )
+            {
+                ckpt_cycle = atoi(argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-CKPTFILE") == 0) && (n+1<argc) )
+            {
+                strcpy(ckpt_path, argv[n+1]);
+            }
+            else if( (strcmp(argv[n],"-RESTORE") == 0) && (n+1<argc) )
+            {
+                strcpy(restore_path, argv[n+1]);
+            }
+            else
+            {
+                std::cout << "   Arguments on the command line are (key,value) couples." << std::endl;
+                std::cout << "   The order is not important." << std::endl;
+                std::cout << "   Accepted arguments are :" << std::endl << std::endl;
+                std::cout << "   -NCYCLES number_of_simulated_cycles" << std::endl;
+                std::cout << "   -NPROCS number_of_processors" << std::endl;
+                std::cout << "   -TRACE debug_start_cycle" << std::endl;
+                std::cout << "   -RAMLATENCY ram_latency_value" << std::endl;
+                std::cout << "   -IOCLATENCY ioc_latency_value" << std::endl;
+                std::cout << "   -SYS system_code_path_name" << std::endl;
+                std::cout << "   -APP application_code_path_name" << std::endl;
+                std::cout << "   -DISK disk_image_path_name" << std::endl;
+                std::cout << "   -SNOOP non_zero_value_to_activate" << std::endl;
+                std::cout << "   -WBACK non_zero_value_to_activate" << std::endl;
+                std::cout << "   -WMERGE non_zero_value_to_activate" << std::endl;
+                std::cout << "   -IPREF number_of_prefetched_lines" << std::endl;
+                std::cout << "   -DPREF number_of_prefetched_lines" << std::endl;
+                std::cout << "   -DPWAIT max_bus_wait_cycles_for_a_data_prefetch" << std::endl;
+                std::cout << "   -MSHR number_of_pending_data_misses" << std::endl;
+                std::cout << "   -VICTIM number_of_victim_cache_lines" << std::endl;
+                std::cout << "   -FASTFWD number_of_functional_instructions_between_windows" << std::endl;
+                std::cout << "   -SAMPLE number_of_cycles_in_a_window" << std::endl;
+                std::cout << "   -WARMUP number_of_cycles_before_a_window" << std::endl;
+                std::cout << "   -PROFILE number_of_profiler_entries" << std::endl;
+                std::cout << "   -IWORDS number_of_words_per_line" << std::endl;
+                std::cout << "   -ISETS number_of_sets" << std::endl;
+                std::cout << "   -IWAYS number_of_ways" << std::endl;
+                std::cout << "   -DWORDS number_of_words_per_line" << std::endl;
+                std::cout << "   -DSETS number_of_sets" << std::endl;
+                std::cout << "   -DWAYS number_of_ways" << std::endl;
+                std::cout << "   -WBUF write_buffer_depth" << std::endl;
+                std::cout << "   -STATS period" << std::endl;
+                std::cout << "   -DMABURST number_of_words_in_a_burst" << std::endl;
+                std::cout << "   -CHECKPOINT checkpoint_cycle" << std::endl;
+                std::cout << "   -CKPTFILE checkpoint_path_name" << std::endl;
+                std::cout << "   -RESTORE checkpoint_path_name" << std::endl;
+                exit(0);
+            }
+        }
+    }
+
+    if ( snoop_active )
+    {
+        std::cout << "ERROR : the snoop mechanism (-SNOOP) is not supported by the crossbar" << std::endl;
+        exit(0);
+    }
+
+    if ( (fastfwd_period != 0) && (nprocs != 1) )
+    {
+        std::cout << "ERROR : the sampled simulation (-FASTFWD) requires a single processor" << std::endl;
+        exit(0);
+    }
+
+    if ( (fastfwd_period != 0) && (ckpt_cycle != 0) )
+    {
+        std::cout << "ERROR : the checkpoint (-CHECKPOINT) is not supported by the sampled simulation" << std::endl;
+        exit(0);
+    }
+
+//////////////////////////////////////////////////////
+//      SIGNALS DECLARATION
+//////////////////////////////////////////////////////
+
+    sc_clock                    	signal_ck("signal_ck");
+    sc_signal<bool>             	signal_resetn("signal_resetn");
+
+    // master ports : index nprocs for the DMA, index nprocs+1 for the IOC
+    sc_signal<bool>			signal_m_req[nprocs+2];
+    sc_signal<bool>			signal_m_gnt[nprocs+2];
+    sc_signal<uint32_t>       		signal_m_a[nprocs+2];
+    sc_signal<bool>               	signal_m_lock[nprocs+2];
+    sc_signal<bool>               	signal_m_read[nprocs+2];
+    sc_signal<uint32_t>        		signal_m_opc[nprocs+2];
+    sc_signal<uint32_t>       		signal_m_d[nprocs+2];
+    sc_signal<uint32_t>        		signal_m_ack[nprocs+2];
+    sc_signal<bool>               	signal_m_tout[nprocs+2];
+
+    // target ports : the DMA and IOC target ports use the master port signals
+    sc_signal<bool>               	signal_t_sel[8];
+    sc_signal<uint32_t>       		signal_t_a[8];
+    sc_signal<bool>               	signal_t_read[8];
+    sc_signal<uint32_t>        		signal_t_opc[8];
+    sc_signal<uint32_t>       		signal_t_d[8];
+    sc_signal<uint32_t>        		signal_t_ack[8];
+    sc_signal<bool>               	signal_t_tout[8];
+
+    sc_signal<bool>               	signal_avalid("avalid");	// never asserted (no snoop)
+
+    sc_signal<bool>			signal_irq_proc[nprocs];
+    sc_signal<bool>               	signal_irq_tim[nprocs];
+    sc_signal<bool>               	signal_irq_tty_get[nprocs];
+    sc_signal<bool>               	signal_irq_tty_put[nprocs];
+    sc_signal<bool>               	signal_irq_dma("signal_irq_dma");
+    sc_signal<bool>               	signal_irq_ioc("signal_irq_ioc");
+
+////////////////////////////////////////////////////
+//	SEGMENT_TABLE DEFINITION
+////////////////////////////////////////////////////
+  
+    PibusSegmentTable	segtable;
+
+    segtable.setMSBnumber(8);
+
+    segtable.addSegment("seg_reset" , SEG_RESET_BASE ,  SEG_RESET_SIZE , ROM_INDEX    , true);
+    segtable.addSegment("seg_kcode" , SEG_KCODE_BASE ,  SEG_KCODE_SIZE , RAM_INDEX    , true);
+    segtable.addSegment("seg_kdata" , SEG_KDATA_BASE ,  SEG_KDATA_SIZE , RAM_INDEX    , true);
+    segtable.addSegment("seg_kunc"  , SEG_KUNC_BASE  ,  SEG_KUNC_SIZE  , RAM_INDEX    , false);
+    segtable.addSegment("seg_code"  , SEG_CODE_BASE  ,  SEG_CODE_SIZE  , RAM_INDEX    , true);
+    segtable.addSegment("seg_stack" , SEG_STACK_BASE ,  SEG_STACK_SIZE , RAM_INDEX    , true);
+    segtable.addSegment("seg_data"  , SEG_DATA_BASE  ,  SEG_DATA_SIZE  , RAM_INDEX    , true);
+    segtable.addSegment("seg_fbf"   , SEG_FBF_BASE   ,  SEG_FBF_SIZE   , FBF_INDEX    , false);
+    segtable.addSegment("seg_tty"   , SEG_TTY_BASE   ,  SEG_TTY_SIZE   , TTY_INDEX    , false);
+    segtable.addSegment("seg_icu"   , SEG_ICU_BASE   ,  SEG_ICU_SIZE   , ICU_INDEX    , false);
+    segtable.addSegment("seg_tim"   , SEG_TIM_BASE   ,  SEG_TIM_SIZE   , TIM_INDEX    , false);
+    segtable.addSegment("seg_dma"   , SEG_DMA_BASE   ,  SEG_DMA_SIZE   , DMA_INDEX    , false);
+    segtable.addSegment("seg_ioc"   , SEG_IOC_BASE   ,  SEG_IOC_SIZE   , IOC_INDEX    , false);
+
+    segtable.print();
+    std::cout << std::endl;
+
+/////////////////////////////////////////////////////////
+//	INSTANCIATED  COMPONENTS
+/////////////////////////////////////////////////////////
+
+    Loader		loader(sys_path, app_path);
+
+    PibusCrossbar  	xbar("xbar"   , segtable, nprocs + 2, 8, 100);
+    PibusSimpleRam	rom("rom"     , ROM_INDEX,   segtable, 0, loader);
+    PibusSimpleRam	ram("ram"     , RAM_INDEX,   segtable, ram_latency, loader);
+    PibusMultiTty	tty("tty"     , TTY_INDEX,   segtable, nprocs);
+    PibusFrameBuffer    fbf("fbf"     , FBF_INDEX,   segtable, 0, FB_NPIXEL, FB_NLINE);
+    PibusIcu            icu("icu"     , ICU_INDEX,   segtable, 2*nprocs + 2, nprocs);
+    PibusMultiTimer     tim("tim"     , TIM_INDEX,   segtable, nprocs);
+    PibusDma            dma("dma"     , DMA_INDEX,   segtable, dma_burst);
+    PibusBlockDevice    ioc("ioc"     , IOC_INDEX,   segtable, disk_path, BLOCK_SIZE, ioc_latency);
+
+    
+    PibusMips32Xcache*	proc[nprocs];
+    char*		name[nprocs];
+    for ( size_t i=0 ; i<nprocs ; i++ )
+    {
+        name[i] = new char[16];
+        sprintf( name[i], "proc[%d]", i);
+        proc[i] = new PibusMips32Xcache( name[i] , segtable, i, icache_ways, icache_sets, icache_words,
+                                                     dcache_ways, dcache_sets, dcache_words, 
+                                                     wbuf_depth, snoop_active, write_back, wbuf_merge,
+                                                     ipref_depth, dpref_depth, dcache_mshr, victim_depth,
+                                                     profile_size, dpref_wait);
+        proc[i]->addFunctionalMemory( &rom );
+        proc[i]->addFunctionalMemory( &ram );
+    }
+
+    std::cout << std::endl;
+
+//////////////////////////////////////////////////////////
+//	Net-List
+//////////////////////////////////////////////////////////
+ 
+    xbar.p_ck			(signal_ck);
+    xbar.p_resetn		(signal_resetn);
+    for ( size_t i=0 ; i<nprocs+2 ; i++)
+    {
+        xbar.p_req[i]		(signal_m_req[i]);
+        xbar.p_gnt[i]		(signal_m_gnt[i]);
+        xbar.p_m_a[i]		(signal_m_a[i]);
+        xbar.p_m_read[i]	(signal_m_read[i]);
+        xbar.p_m_opc[i]		(signal_m_opc[i]);
+        xbar.p_m_lock[i]	(signal_m_lock[i]);
+        xbar.p_m_d[i]		(signal_m_d[i]);
+        xbar.p_m_ack[i]		(signal_m_ack[i]);
+        xbar.p_m_tout[i]	(signal_m_tout[i]);
+    }
+    for ( size_t t=0 ; t<8 ; t++)
+    {
+        size_t	m = t;		// signals index
+        if      ( t == DMA_INDEX ) m = nprocs;
+        else if ( t == IOC_INDEX ) m = nprocs + 1;
+        xbar.p_sel[t]		(signal_t_sel[t]);
+        if ( (t == DMA_INDEX) || (t == IOC_INDEX) )
+        {
+            xbar.p_t_a[t]	(signal_m_a[m]);
+            xbar.p_t_read[t]	(signal_m_read[m]);
+            xbar.p_t_opc[t]	(signal_m_opc[m]);
+            xbar.p_t_d[t]	(signal_m_d[m]);
+            xbar.p_t_ack[t]	(signal_m_ack[m]);
+            xbar.p_t_tout[t]	(signal_m_tout[m]);
+        }
+        else
+        {
+            xbar.p_t_a[t]	(signal_t_a[t]);
+            xbar.p_t_read[t]	(signal_t_read[t]);
+            xbar.p_t_opc[t]	(signal_t_opc[t]);
+            xbar.p_t_d[t]	(signal_t_d[t]);
+            xbar.p_t_ack[t]	(signal_t_ack[t]);
+            xbar.p_t_tout[t]	(signal_t_tout[t]);
+        }
+    }
+    xbar.setMasterTarget(nprocs, DMA_INDEX);
+    xbar.setMasterTarget(nprocs+1, IOC_INDEX);
+
+    std::cout << "xbar : connected" << std::endl;
+
+    ram.p_ck			(signal_ck);
+    ram.p_resetn		(signal_resetn);
+    ram.p_sel			(signal_t_sel[RAM_INDEX]);
+    ram.p_a			(signal_t_a[RAM_INDEX]);
+    ram.p_read			(signal_t_read[RAM_INDEX]);
+    ram.p_opc			(signal_t_opc[RAM_INDEX]);
+    ram.p_ack			(signal_t_ack[RAM_INDEX]);
+    ram.p_d			(signal_t_d[RAM_INDEX]);
+    ram.p_tout			(signal_t_tout[RAM_INDEX]);
+
+    std::cout << "ram : connected" << std::endl;
+
+    rom.p_ck			(signal_ck);
+    rom.p_resetn		(signal_resetn);
+    rom.p_sel			(signal_t_sel[ROM_INDEX]);
+    rom.p_a			(signal_t_a[ROM_INDEX]);
+    rom.p_read			(signal_t_read[ROM_INDEX]);
+    rom.p_opc			(signal_t_opc[ROM_INDEX]);
+    rom.p_ack			(signal_t_ack[ROM_INDEX]);
+    rom.p_d			(signal_t_d[ROM_INDEX]);
+    rom.p_tout			(signal_t_tout[ROM_INDEX]);
+
+    std::cout << "rom : connected" << std::endl;
+
+    tty.p_ck			(signal_ck);
+    tty.p_resetn		(signal_resetn);
+    tty.p_sel			(signal_t_sel[TTY_INDEX]);
+    tty.p_a			(signal_t_a[TTY_INDEX]);
+    tty.p_read			(signal_t_read[TTY_INDEX]);
+    tty.p_opc			(signal_t_opc[TTY_INDEX]);
+    tty.p_ack			(signal_t_ack[TTY_INDEX]);
+    tty.p_d			(signal_t_d[TTY_INDEX]);
+    tty.p_tout			(signal_t_tout[TTY_INDEX]);
+    for ( size_t i=0 ; i<nprocs ; i++)
+    {
+        tty.p_irq_get[i]	(signal_irq_tty_get[i]);
+        tty.p_irq_put[i]	(signal_irq_tty_put[i]);
+    }
+
+    std::cout << "tty : connected" << std::endl;
+
+    tim.p_ck			(signal_ck);
+    tim.p_resetn		(signal_resetn);
+    tim.p_sel			(signal_t_sel[TIM_INDEX]);
+    tim.p_a			(signal_t_a[TIM_INDEX]);
+    tim.p_read			(signal_t_read[TIM_INDEX]);
+    tim.p_opc			(signal_t_opc[TIM_INDEX]);
+    tim.p_ack			(signal_t_ack[TIM_INDEX]);
+    tim.p_d			(signal_t_d[TIM_INDEX]);
+    tim.p_tout			(signal_t_tout[TIM_INDEX]);
+    for ( size_t i=0 ; i<nprocs ; i++)
+    {
+        tim.p_irq[i]	        (signal_irq_tim[i]);
+    }
+
+    std::cout << "tim : connected" << std::endl;
+
+    fbf.p_ck			(signal_ck);
+    fbf.p_resetn		(signal_resetn);
+    fbf.p_sel			(signal_t_sel[FBF_INDEX]);
+    fbf.p_a			(signal_t_a[FBF_INDEX]);
+    fbf.p_read			(signal_t_read[FBF_INDEX]);
+    fbf.p_opc			(signal_t_opc[FBF_INDEX]);
+    fbf.p_ack			(signal_t_ack[FBF_INDEX]);
+    fbf.p_d			(signal_t_d[FBF_INDEX]);
+    fbf.p_tout			(signal_t_tout[FBF_INDEX]);
+
+    std::cout << "fbf : connected" << std::endl;
+
+    icu.p_ck			(signal_ck);
+    icu.p_resetn		(signal_resetn);
+    icu.p_sel			(signal_t_sel[ICU_INDEX]);
+    icu.p_a			(signal_t_a[ICU_INDEX]);
+    icu.p_read			(signal_t_read[ICU_INDEX]);
+    icu.p_opc			(signal_t_opc[ICU_INDEX]);
+    icu.p_ack			(signal_t_ack[ICU_INDEX]);
+    icu.p_d			(signal_t_d[ICU_INDEX]);
+    icu.p_tout			(signal_t_tout[ICU_INDEX]);
+    icu.p_irq_in[0]		(signal_irq_dma);
+    icu.p_irq_in[1]		(signal_irq_ioc);
+    for ( size_t i=0 ; i<nprocs ; i++)
+    {
+        icu.p_irq_in[2+2*i]	(signal_irq_tim[i]);
+        icu.p_irq_in[3+2*i]	(signal_irq_tty_get[i]);
+        icu.p_irq_out[i]  	(signal_irq_proc[i]);
+    }
+
+    std::cout << "icu : connected" << std::endl;
+
+    dma.p_ck			(signal_ck);
+    dma.p_resetn		(signal_resetn);
+    dma.p_req			(signal_m_req[nprocs]);
+    dma.p_gnt			(signal_m_gnt[nprocs]);
+    dma.p_sel			(signal_t_sel[DMA_INDEX]);
+    dma.p_a			(signal_m_a[nprocs]);
+    dma.p_read			(signal_m_read[nprocs]);
+    dma.p_opc			(signal_m_opc[nprocs]);
+    dma.p_lock			(signal_m_lock[nprocs]);
+    dma.p_ack			(signal_m_ack[nprocs]);
+    dma.p_d			(signal_m_d[nprocs]);
+    dma.p_tout			(signal_m_tout[nprocs]);
+    dma.p_irq 			(signal_irq_dma);
+
+    std::cout << "dma : connected" << std::endl;
+
+    ioc.p_ck			(signal_ck);
+    ioc.p_resetn		(signal_resetn);
+    ioc.p_req			(signal_m_req[nprocs+1]);
+    ioc.p_gnt			(signal_m_gnt[nprocs+1]);
+    ioc.p_sel			(signal_t_sel[IOC_INDEX]);
+    ioc.p_a			(signal_m_a[nprocs+1]);
+    ioc.p_read			(signal_m_read[nprocs+1]);
+    ioc.p_opc			(signal_m_opc[nprocs+1]);
+    ioc.p_lock			(signal_m_lock[nprocs+1]);
+    ioc.p_ack			(signal_m_ack[nprocs+1]);
+    ioc.p_d			(signal_m_d[nprocs+1]);
+    ioc.p_tout			(signal_m_tout[nprocs+1]);
+    ioc.p_irq 			(signal_irq_ioc);
+
+    std::cout << "ioc : connected" << std::endl;
+
+    for ( size_t i=0 ; i<nprocs ; i++)
+    {
+        proc[i]->p_ck	        (signal_ck);  
+        proc[i]->p_resetn       (signal_resetn);  
+        proc[i]->p_req          (signal_m_req[i]);
+        proc[i]->p_gnt          (signal_m_gnt[i]);
+        proc[i]->p_lock         (signal_m_lock[i]);
+        proc[i]->p_read         (signal_m_read[i]);
+        proc[i]->p_opc          (signal_m_opc[i]);
+        proc[i]->p_a            (signal_m_a[i]);
+        proc[i]->p_d            (signal_m_d[i]);
+        proc[i]->p_ack          (signal_m_ack[i]);
+        proc[i]->p_tout         (signal_m_tout[i]);
+        proc[i]->p_avalid       (signal_avalid);
+        proc[i]->p_irq          (signal_irq_proc[i]);
+    }
+  
+    std::cout << "procs : connected" << std::endl;
+
+    std::cout << std::endl;
+
+//////////////////////////////////////////////
+//     simulation loop
+/////////////////////////////////////////////
+  
+    signal_resetn = false;
+
+    sc_start( sc_time( 1, SC_NS ) );
+
+    signal_resetn = true;
+
+    //////////////////////////////////////////////////////////////////
+    // Checkpoint : the platform state is restored after the reset 
+    // cycle (-RESTORE), and saved at the first cycle following
+    // ckpt_cycle where all processors are ready (-CHECKPOINT).
+    //////////////////////////////////////////////////////////////////
+
+    std::vector<PibusCheckpointable*> ckpt_list;
+    for ( size_t i=0 ; i<nprocs ; i++ ) ckpt_list.push_back( proc[i] );
+    ckpt_list.push_back( &rom );
+    ckpt_list.push_back( &ram );
+    ckpt_list.push_back( &fbf );
+    ckpt_list.push_back( &dma );
+    ckpt_list.push_back( &ioc );
+
+    size_t first = 1;		// first simulated cycle
+    if ( restore_path[0] )
+    {
+        PibusCheckpoint* restore = new PibusCheckpoint( restore_path, false );	// mapping kept
+        restore->platform( ckpt_list );
+        first = restore->cycle() + 1;
+        std::cout << "*** CHECKPOINT " << restore_path << " restored at cycle " 
+                  << restore->cycle() << std::endl;
+    }
+
+    //////////////////////////////////////////////////////////////////
+    // Sampled simulation : the functional phases (fastfwd_period
+    // instructions) alternate with cycle-accurate phases : a warm-up 
+    // (sample_warmup cycles) followed by a measurement window
+    // (sample_window cycles). The whole-run CPI is estimated as the
+    // ratio of the windows cycles and instructions sums (the windows
+    // have a fixed number of cycles), with a 95% confidence interval.
+    //////////////////////////////////////////////////////////////////
+
+    if ( fastfwd_period != 0 )
+    {
+        size_t	n         = first;	// simulated cycles
+        size_t	nwindows  = 0;		// number of measurement windows
+        double	ffwd_inst = 0;		// functional instructions
+        double	cyc_sum   = 0;		// windows cycles
+        double	ins_sum   = 0;		// windows instructions
+        double	cyc_sum2  = 0;		// sum of squared cycles
+        double	ins_sum2  = 0;		// sum of squared instructions
+        double	cross_sum = 0;		// sum of cycles * instructions
+
+        while ( n < ncycles )
+        {
+            // functional phase : a request that cannot be handled 
+            // in functional mode is executed in cycle-accurate mode
+            size_t done = 0;
+            while ( (done < fastfwd_period) && (n < ncycles) )
+            {
+                if ( proc[0]->functionalReady() ) 
+                    done = done + proc[0]->functionalRun( fastfwd_period - done );
+                if ( done < fastfwd_period )
+                {
+                    sc_start( sc_time( 1, SC_NS ) );
+                    n++;
+                }
+            }
+            ffwd_inst = ffwd_inst + done;
+
+            // cycle-accurate warm-up and measurement window
+            sc_start( sc_time( sample_warmup, SC_NS ) );
+            uint64_t cycles = proc[0]->getCycles();
+            uint64_t instrs = proc[0]->getInstructions();
+            sc_start( sc_time( sample_window, SC_NS ) );
+            n = n + sample_warmup + sample_window;
+            double cyc = (double)(proc[0]->getCycles() - cycles);
+            double ins = (double)(proc[0]->getInstructions() - instrs);
+            cyc_sum   = cyc_sum   + cyc;
+            ins_sum   = ins_sum   + ins;
+            cyc_sum2  = cyc_sum2  + cyc*cyc;
+            ins_sum2  = ins_sum2  + ins*ins;
+            cross_sum = cross_sum + cyc*ins;
+            nwindows++;
+
+            if ( stats_ok && (n / stats_period != (n - sample_warmup - sample_window) / stats_period) )
+            {
+                proc[0]->printStatistics();
+                xbar.printStatistics();
+            }
+        }
+
+        // ratio estimator : the variance of the residuals (cyc - cpi*ins)
+        // is scaled by the squared mean number of instructions per window
+        double cpi  = (ins_sum > 0) ? cyc_sum / ins_sum : 0;
+        double var  = (nwindows > 1) ? 
+                      (cyc_sum2 - 2*cpi*cross_sum + cpi*cpi*ins_sum2) / (nwindows - 1) : 0;
+        double conf = (ins_sum > 0) ? 
+                      1.96 * sqrt( (var > 0) ? var / nwindows : 0 ) * nwindows / ins_sum : 0;
+        double inst = ffwd_inst + proc[0]->getInstructions();
+
+        std::cout << std::endl << "*** SAMPLED SIMULATION" << std::endl;
+        std::cout << "- SIMULATED CYCLES   = " << n << std::endl;
+        std::cout << "- FUNCTIONAL INSTR   = " << ffwd_inst << std::endl;
+        std::cout << "- DETAILED INSTR     = " << proc[0]->getInstructions() << std::endl;
+        std::cout << "- WINDOWS            = " << nwindows << std::endl;
+        std::cout << "- ESTIMATED CPI      = " << cpi << " +/- " << conf << " (95% confidence)" << std::endl;
+        std::cout << "- ESTIMATED CYCLES   = " << inst*cpi << std::endl;
+        if ( profile_size ) proc[0]->printProfile( loader );
+        return EXIT_SUCCESS;
+    }
+
+    struct timeval t_start, t_end;
+    gettimeofday(&t_start, NULL);
+
+    for( size_t n = first ; n < ncycles ; n++)
+    {
+        sc_start( sc_time( 1, SC_NS ) );
+
+        if ( ckpt_cycle && (n >= ckpt_cycle) )
+        {
+            bool ready = true;
+            for ( size_t i=0 ; i<nprocs ; i++ ) ready = ready && proc[i]->checkpointReady();
+            if ( ready )
+            {
+                PibusCheckpoint ckpt( ckpt_path, true, n );
+                ckpt.platform( ckpt_list );
+                std::cout << "*** CHECKPOINT " << ckpt_path << " saved at cycle " << n << std::endl;
+                ckpt_cycle = 0;
+            }
+        }
+
+        if ( stats_ok && (n % stats_period == 0) )
+        {
+            proc[0]->printStatistics();
+            xbar.printStatistics();
+        }
+
+        if ( trace_ok && (n > from_cycle) )
+        {
+            std::cout << std::dec <<"*******************  cycle = " << n 
+                      << " ***************************************" << std::endl;
+            proc[0]->printTrace();
+            xbar.printTrace();
+            rom.printTrace();
+            ram.printTrace();
+            tty.printTrace();
+            fbf.printTrace();
+            icu.printTrace();
+            tim.printTrace();
+            dma.printTrace();
+            ioc.printTrace();
+
+            std::cout << "  -- select signals --" << std::dec << std::endl;
+            std::cout << "sel_rom     = " << signal_t_sel[ROM_INDEX].read()  << std::endl;
+            std::cout << "sel_ram     = " << signal_t_sel[RAM_INDEX].read()  << std::endl;
+            std::cout << "sel_tty     = " << signal_t_sel[TTY_INDEX].read()  << std::endl;
+            std::cout << "sel_fbf     = " << signal_t_sel[FBF_INDEX].read()  << std::endl;
+            std::cout << "sel_icu     = " << signal_t_sel[ICU_INDEX].read()  << std::endl;
+            std::cout << "sel_tim     = " << signal_t_sel[TIM_INDEX].read()  << std::endl;
+            std::cout << "sel_dma     = " << signal_t_sel[DMA_INDEX].read()  << std::endl;
+            std::cout << "sel_ioc     = " << signal_t_sel[IOC_INDEX].read()  << std::endl;
+
+            std::cout << "  -- proc[0] pibus signals --" << std::hex << std::endl;
+            std::cout << "read        = " << signal_m_read[0].read()         << std::endl;
+            std::cout << "lock        = " << signal_m_lock[0].read()         << std::endl;
+            std::cout << "address     = " << signal_m_a[0].read()            << std::endl;
+            std::cout << "ack         = " << signal_m_ack[0].read()          << std::endl;
+            std::cout << "data        = " << signal_m_d[0].read()            << std::endl;
+
+            std::cout << "  -- IRQ signals --" << std::dec << std::endl;
+            std::cout << "tim_irq[0]  = " << signal_irq_tim[0].read()        << std::endl;
+            std::cout << "tty_irq[0]  = " << signal_irq_tty_get[0].read()    << std::endl;
+            std::cout << "dma_irq     = " << signal_irq_dma.read()           << std::endl;
+            std::cout << "ioc_irq     = " << signal_irq_ioc.read()           << std::endl;
+            std::cout << "proc_irq[0] = " << signal_irq_proc[0].read()       << std::endl;
+        }
+    }
+
+    // simulation speed (simulated cycles per second)
+    gettimeofday(&t_end, NULL);
+    double seconds = (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_usec - t_start.tv_usec)*1e-6;
+    if ( seconds > 0 ) std::cout << std::dec << std::endl << "*** SIMULATION SPEED = "
+                                  << (size_t)(ncycles/seconds) << " cycles/s" << std::endl;
+
+    // per-master wait cycles (same format as tp5_top)
+    std::cout << std::dec << std::endl << "*** BUS WAIT CYCLES" << std::endl;
+    xbar.printStatistics();
+
+    // per-PC profile of each processor
+    if ( profile_size )
+    {
+        for ( size_t i=0 ; i<nprocs ; i++ ) proc[i]->printProfile( loader );
+    }
+
+return EXIT_SUCCESS;
+
+} // end _main
+
+/////////////////////////////////////
+int sc_main( int argc, char* argv[] )
+{
+    try
+    {
+        return _main(argc, argv);
+    }
+    catch ( std::exception &error)
+    {
+        std::cout << error.what() << std::endl;
+    }
+    return 0;
+} // end sc_main()
+